@@ -0,0 +1,12 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef _INCLUDE_PICO_CORTEX_M
+#define _INCLUDE_PICO_CORTEX_M
+
+#include "pico_generic_gcc.h"
+
+#endif  /* PICO_CORTEX_M */
+
@@ -0,0 +1,71 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_CONNTRACK
+#define INCLUDE_PICO_CONNTRACK
+#include "pico_addressing.h"
+#include "pico_frame.h"
+
+/* Connection states, one bit each so that a filter rule can accept several */
+#define PICO_CT_NEW         0x01u /* packets seen in the original direction only */
+#define PICO_CT_ESTABLISHED 0x02u /* packets seen in both directions */
+#define PICO_CT_CLOSING     0x04u /* TCP: FIN seen in one direction */
+#define PICO_CT_CLOSED      0x08u /* TCP: RST, or FIN seen in both directions */
+#define PICO_CT_UNTRACKED   0x10u /* not a tracked flow, or no room left to track it */
+
+#define PICO_CT_DIR_ORIGINAL 0u
+#define PICO_CT_DIR_REPLY    1u
+
+struct pico_conn;
+
+#ifdef PICO_SUPPORT_CONNTRACK
+struct pico_conn *pico_conntrack_get(struct pico_frame *f);
+uint8_t pico_conntrack_state(struct pico_frame *f);
+int pico_conntrack_snat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port);
+int pico_conntrack_dnat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port);
+uint32_t pico_conntrack_count(void);
+void pico_conntrack_flush(void);
+#else
+static inline struct pico_conn *pico_conntrack_get(struct pico_frame *f)
+{
+    (void)f;
+    return NULL;
+}
+
+static inline uint8_t pico_conntrack_state(struct pico_frame *f)
+{
+    (void)f;
+    return PICO_CT_UNTRACKED;
+}
+
+static inline int pico_conntrack_snat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port)
+{
+    (void)f;
+    (void)addr;
+    (void)port;
+    pico_err = PICO_ERR_EPROTONOSUPPORT;
+    return -1;
+}
+
+static inline int pico_conntrack_dnat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port)
+{
+    (void)f;
+    (void)addr;
+    (void)port;
+    pico_err = PICO_ERR_EPROTONOSUPPORT;
+    return -1;
+}
+
+static inline uint32_t pico_conntrack_count(void)
+{
+    return 0;
+}
+
+#define pico_conntrack_flush() do {} while(0)
+#endif
+
+#endif /* INCLUDE_PICO_CONNTRACK */
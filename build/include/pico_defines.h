@@ -0,0 +1,39 @@
+/* PicoTCP - Definition file - DO NOT EDIT */
+/* This file is automatically generated at compile time */
+#ifndef PICO_DEFINES_H
+#define PICO_DEFINES_H
+
+#define PICO_SUPPORT_TFTP
+#define PICO_SUPPORT_AODV
+#define PICO_SUPPORT_ETH
+#define PICO_SUPPORT_IPV4
+#define PICO_SUPPORT_IPV4FRAG
+#define PICO_SUPPORT_ICMP4
+#define PICO_SUPPORT_PING
+#define PICO_SUPPORT_TCP
+#define PICO_SUPPORT_UDP
+#define PICO_SUPPORT_MCAST
+#define PICO_SUPPORT_IGMP
+#define PICO_SUPPORT_MLD
+#define PICO_SUPPORT_NAT
+#define PICO_SUPPORT_DEVLOOP
+#define PICO_SUPPORT_DHCPC
+#define PICO_SUPPORT_DHCPD
+#define PICO_SUPPORT_DNS_CLIENT
+#define PICO_SUPPORT_MDNS
+#define PICO_SUPPORT_DNS_SD
+#define PICO_SUPPORT_IPFILTER
+#define PICO_SUPPORT_CONNTRACK
+#define PICO_SUPPORT_BRIDGE
+#define PICO_SUPPORT_CRC
+#define PICO_SUPPORT_SLAACV4
+#define PICO_SUPPORT_BOND
+#define PICO_SUPPORT_EVQ
+#define PICO_SUPPORT_MT
+#define PICO_SUPPORT_EVQ
+#define PICO_SUPPORT_IPV6
+#define PICO_SUPPORT_ICMP6
+#define PICO_SUPPORT_IPV6FRAG
+#define PICO_SUPPORT_SNTP_CLIENT
+#define PICO_SUPPORT_PPP
+#endif
@@ -0,0 +1,65 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_MT
+#define INCLUDE_PICO_MT
+#include "pico_config.h"
+#include "pico_socket.h"
+#include "pico_spsc.h"
+#include "pico_evq.h"
+
+/* The contexts are made of lock free rings: without them (no atomic
+ * builtins on the target) the front-end is left out of the build. */
+#ifndef PICO_SUPPORT_SPSC
+#undef PICO_SUPPORT_MT
+#endif
+
+/* Operations */
+#define PICO_MT_OPEN      1u  /* net, proto, events, flags, data -> s */
+#define PICO_MT_BIND      2u  /* s, addr, port -> port */
+#define PICO_MT_CONNECT   3u  /* s, addr, port */
+#define PICO_MT_LISTEN    4u  /* s, len: backlog */
+#define PICO_MT_ACCEPT    5u  /* s, events, flags, data -> s, addr, port */
+#define PICO_MT_SEND      6u  /* s, buf, len */
+#define PICO_MT_SENDTO    7u  /* s, buf, len, addr, port */
+#define PICO_MT_RECV      8u  /* s, buf, len */
+#define PICO_MT_RECVFROM  9u  /* s, buf, len -> addr, port */
+#define PICO_MT_CLOSE    10u  /* s */
+#define PICO_MT_WAIT     11u  /* buf: struct pico_evq_event[len] */
+
+/* An operation posted by an application thread, and given back to it
+ * completed. It belongs to the stack in between, as its buffer does. */
+struct pico_mt_op {
+    uint8_t type;
+    uint8_t flags;              /* PICO_EVQ_* for the sockets opened or accepted */
+    uint16_t events;            /* PICO_SOCK_EV_*, 0 for RD, CONN and FIN */
+    uint16_t net;
+    uint16_t proto;
+    struct pico_socket *s;
+    union pico_address addr;
+    uint16_t port;
+    void *buf;
+    int len;
+    void *data;                 /* returned in the events of the socket */
+    int ret;                    /* as the pico_socket_* call, or the number of events */
+    int err;                    /* pico_err when ret < 0 */
+    struct pico_mt_op *next;    /* private */
+};
+
+struct pico_mt_ctx;
+
+/* Stack thread, before and after the application thread uses the context */
+struct pico_mt_ctx *pico_mt_ctx_create(uint32_t depth);
+void pico_mt_ctx_destroy(struct pico_mt_ctx *ctx);
+
+/* Application thread */
+int pico_mt_post(struct pico_mt_ctx *ctx, struct pico_mt_op *op);
+struct pico_mt_op *pico_mt_complete(struct pico_mt_ctx *ctx);
+
+/* Called by pico_stack_tick */
+void pico_mt_run_commands(void);
+void pico_mt_run_completions(void);
+
+#endif
@@ -0,0 +1,249 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_QUEUE
+#define INCLUDE_PICO_QUEUE
+#include "pico_config.h"
+#include "pico_frame.h"
+#include "pico_spsc.h"
+
+#define Q_LIMIT 0
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+void *pico_mutex_init(void);
+void pico_mutex_deinit(void *mutex);
+void pico_mutex_lock(void *mutex);
+int pico_mutex_lock_timeout(void *mutex, int timeout);
+void pico_mutex_unlock(void *mutex);
+void pico_mutex_unlock_ISR(void *mutex);
+
+struct pico_queue {
+    uint32_t frames;
+    uint32_t size;
+    uint32_t max_frames;
+    uint32_t max_size;
+    struct pico_frame *head;
+    struct pico_frame *tail;
+#ifdef PICO_SUPPORT_MUTEX
+    void *mutex;
+#endif
+#ifdef PICO_SUPPORT_SPSC
+    struct pico_spsc *ring;     /* lock free mode, see pico_queue_spsc() */
+#endif
+    uint8_t shared;
+    uint16_t overhead;
+};
+
+#ifdef PICO_SUPPORT_MUTEX
+#define PICOTCP_MUTEX_LOCK(x) { \
+        if (x == NULL) \
+            x = pico_mutex_init(); \
+        pico_mutex_lock(x); \
+}
+#define PICOTCP_MUTEX_UNLOCK(x) pico_mutex_unlock(x)
+#define PICOTCP_MUTEX_DEL(x) pico_mutex_deinit(x)
+
+#else
+#define PICOTCP_MUTEX_LOCK(x) do {} while(0)
+#define PICOTCP_MUTEX_UNLOCK(x) do {} while(0)
+#define PICOTCP_MUTEX_DEL(x) do {} while(0)
+#endif
+
+#ifdef PICO_SUPPORT_DEBUG_TOOLS
+static void debug_q(struct pico_queue *q)
+{
+    struct pico_frame *p = q->head;
+    dbg("%d: ", q->frames);
+    while(p) {
+        dbg("(%p)-->", p);
+        p = p->next;
+    }
+    dbg("X\n");
+}
+
+#else
+
+#define debug_q(x) do {} while(0)
+#endif
+
+#ifdef PICO_SUPPORT_SPSC
+/* Lock free mode, for a queue with one producer thread and one consumer
+ * thread: frames go through a ring instead of the list. The frames and the
+ * size are counted before the frame is visible to the consumer, which
+ * uncounts it after taking it, so that they never go below the content. */
+static inline int32_t pico_enqueue_spsc(struct pico_queue *q, struct pico_frame *p)
+{
+    uint32_t len = p->buffer_len + q->overhead;
+    uint32_t size;
+
+    pico_spsc_fetch_add(&q->frames, 1u);
+    size = pico_spsc_fetch_add(&q->size, len) + len;
+    if (pico_spsc_push(q->ring, p) < 0) {
+        pico_spsc_fetch_sub(&q->frames, 1u);
+        pico_spsc_fetch_sub(&q->size, len);
+        return -1;
+    }
+
+    return (int32_t)size;
+}
+
+static inline struct pico_frame *pico_dequeue_spsc(struct pico_queue *q)
+{
+    struct pico_frame *p = (struct pico_frame *)pico_spsc_pop(q->ring);
+
+    if (!p)
+        return NULL;
+
+    pico_spsc_fetch_sub(&q->frames, 1u);
+    pico_spsc_fetch_sub(&q->size, p->buffer_len + q->overhead);
+    p->next = NULL;
+    return p;
+}
+
+/* Switches an empty queue to the lock free mode, slots is a power of two */
+static inline int pico_queue_spsc(struct pico_queue *q, uint32_t slots)
+{
+    struct pico_spsc *ring;
+
+    if (q->ring || q->head || q->shared)
+        return -1;
+
+    ring = PICO_ZALLOC(sizeof(struct pico_spsc) + slots * sizeof(void *));
+    if (!ring)
+        return -1;
+
+    if (pico_spsc_init(ring, (void **)(ring + 1), slots) < 0) {
+        PICO_FREE(ring);
+        return -1;
+    }
+
+    q->ring = ring;
+    return 0;
+}
+#endif
+
+static inline int32_t pico_enqueue(struct pico_queue *q, struct pico_frame *p)
+{
+    if ((q->max_frames) && (q->max_frames <= q->frames))
+        return -1;
+
+#if (Q_LIMIT != 0)
+    if ((Q_LIMIT < p->buffer_len + q->size))
+        return -1;
+
+#endif
+
+    if ((q->max_size) && (q->max_size < (p->buffer_len + q->size)))
+        return -1;
+
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return pico_enqueue_spsc(q, p);
+
+#endif
+    if (q->shared)
+        PICOTCP_MUTEX_LOCK(q->mutex);
+
+    p->next = NULL;
+    if (!q->head) {
+        q->head = p;
+        q->tail = p;
+        q->size = 0;
+        q->frames = 0;
+    } else {
+        q->tail->next = p;
+        q->tail = p;
+    }
+
+    q->size += p->buffer_len + q->overhead;
+    q->frames++;
+    debug_q(q);
+
+    if (q->shared)
+        PICOTCP_MUTEX_UNLOCK(q->mutex);
+
+    return (int32_t)q->size;
+}
+
+static inline struct pico_frame *pico_dequeue(struct pico_queue *q)
+{
+    struct pico_frame *p = q->head;
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return pico_dequeue_spsc(q);
+
+#endif
+    if (!p)
+        return NULL;
+
+    if (q->frames < 1)
+        return NULL;
+
+    if (q->shared)
+        PICOTCP_MUTEX_LOCK(q->mutex);
+
+    q->head = p->next;
+    q->frames--;
+    q->size -= p->buffer_len - q->overhead;
+    if (q->head == NULL)
+        q->tail = NULL;
+
+    debug_q(q);
+
+    p->next = NULL;
+    if (q->shared)
+        PICOTCP_MUTEX_UNLOCK(q->mutex);
+
+    return p;
+}
+
+static inline struct pico_frame *pico_queue_peek(struct pico_queue *q)
+{
+    struct pico_frame *p = q->head;
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return (struct pico_frame *)pico_spsc_peek(q->ring);
+
+#endif
+    if (q->frames < 1)
+        return NULL;
+
+    debug_q(q);
+    return p;
+}
+
+static inline void pico_queue_deinit(struct pico_queue *q)
+{
+    if (q->shared) {
+        PICOTCP_MUTEX_DEL(q->mutex);
+    }
+
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring) {
+        PICO_FREE(q->ring);
+        q->ring = NULL;
+    }
+
+#endif
+}
+
+static inline void pico_queue_empty(struct pico_queue *q)
+{
+    struct pico_frame *p = pico_dequeue(q);
+    while(p) {
+        pico_frame_discard(p);
+        p = pico_dequeue(q);
+    }
+}
+
+static inline void pico_queue_protect(struct pico_queue *q)
+{
+    q->shared = 1;
+}
+
+#endif
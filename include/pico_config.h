@@ -171,6 +171,14 @@ static inline uint64_t long_long_be(uint64_t le)
 #   define MOCKABLE
 #endif
 
+/* State of the stack: one instance per thread in a sharded stack (see
+ * pico_shard.h), a single one otherwise */
+#if defined PICO_SUPPORT_SHARD
+#   define PICO_TLS __thread
+#else
+#   define PICO_TLS
+#endif
+
 #include "pico_constants.h"
 #include "pico_mm.h"
 
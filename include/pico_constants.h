@@ -15,7 +15,7 @@
 
 /** Endian-dependant constants **/
 typedef uint64_t pico_time;
-extern volatile uint64_t pico_tick;
+extern PICO_TLS volatile uint64_t pico_tick;
 
 
 /*** *** *** *** *** *** ***
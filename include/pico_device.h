@@ -9,7 +9,7 @@
 #include "pico_frame.h"
 #include "pico_addressing.h"
 #include "pico_tree.h"
-extern struct pico_tree Device_tree;
+extern PICO_TLS struct pico_tree Device_tree;
 #include "pico_ipv6_nd.h"
 #define MAX_DEVICE_NAME 16
 
@@ -37,6 +37,12 @@ struct pico_device {
   #ifdef PICO_SUPPORT_IPV6
     struct pico_nd_hostvars hostvars;
   #endif
+  #ifdef PICO_SUPPORT_BRIDGE
+    struct pico_device *bridge; /* Non-null if port of a bridge */
+  #endif
+  #ifdef PICO_SUPPORT_BOND
+    struct pico_device *bond; /* Non-null if member of a bond */
+  #endif
 };
 
 
@@ -47,6 +53,9 @@ struct pico_device*pico_get_device(const char*name);
 int32_t pico_device_broadcast(struct pico_frame *f);
 int pico_device_link_state(struct pico_device *dev);
 int pico_device_ipv6_random_ll(struct pico_device *dev);
+#ifdef PICO_SUPPORT_SPSC
+int pico_device_queues_spsc(struct pico_device *dev, uint32_t rx_slots, uint32_t tx_slots);
+#endif
 #ifdef PICO_SUPPORT_IPV6
 struct pico_ipv6_link *pico_ipv6_link_add_local(struct pico_device *dev, const struct pico_ip6 *prefix);
 #endif
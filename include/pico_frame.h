@@ -11,11 +11,12 @@
 #define PICO_FRAME_FLAG_BCAST               (0x01)
 #define PICO_FRAME_FLAG_EXT_BUFFER          (0x02)
 #define PICO_FRAME_FLAG_EXT_USAGE_COUNTER   (0x04)
-#define PICO_FRAME_FLAG_SACKED              (0x80)
+#define PICO_FRAME_FLAG_BRIDGED             (0x08)
 #define IS_BCAST(f) ((f->flags & PICO_FRAME_FLAG_BCAST) == PICO_FRAME_FLAG_BCAST)
 
 
 struct pico_socket;
+struct pico_conn;
 
 
 struct pico_frame {
@@ -84,6 +85,13 @@ struct pico_frame {
 
     uint8_t send_ttl; /* Special TTL/HOPS value, 0 = auto assign */
     uint8_t send_tos; /* Type of service */
+
+#ifdef PICO_SUPPORT_CONNTRACK
+    /* Tracked connection, set by the first pico_conntrack_get() on the frame */
+    struct pico_conn *conn;
+    uint32_t conn_id;       /* id of conn when it was set */
+    uint8_t conn_dir;
+#endif
 };
 
 /** frame alloc/dealloc/copy **/
@@ -63,7 +63,7 @@ enum pico_err_e {
 };
 
 typedef enum pico_err_e pico_err_t;
-extern volatile pico_err_t pico_err;
+extern PICO_TLS volatile pico_err_t pico_err;
 
 #define IS_IPV6(f) (f && f->net_hdr && ((((uint8_t *)(f->net_hdr))[0] & 0xf0) == 0x60))
 #define IS_IPV4(f) (f && f->net_hdr && ((((uint8_t *)(f->net_hdr))[0] & 0xf0) == 0x40))
@@ -75,8 +75,8 @@ struct pico_protocol {
     uint32_t hash;
     enum pico_layer layer;
     uint16_t proto_number;
-    struct pico_queue *q_in;
-    struct pico_queue *q_out;
+    struct pico_queue q_in;     /* part of the protocol, so that the whole of */
+    struct pico_queue q_out;    /* it can be per instance (PICO_TLS) */
     struct pico_frame *(*alloc)(struct pico_protocol *self, uint16_t size); /* Frame allocation. */
     int (*push)(struct pico_protocol *self, struct pico_frame *p);    /* Push function, for active outgoing pkts from above */
     int (*process_out)(struct pico_protocol *self, struct pico_frame *p);  /* Send loop. */
@@ -92,4 +92,9 @@ int pico_protocol_network_loop(int loop_score, int direction);
 int pico_protocol_transport_loop(int loop_score, int direction);
 int pico_protocol_socket_loop(int loop_score, int direction);
 
+/* Incoming frame for proto: processed right away in run-to-completion mode,
+ * queued for the next pico_stack_tick otherwise */
+int32_t pico_protocol_receive(struct pico_protocol *proto, struct pico_frame *f);
+int pico_protocol_run_to_completion(int enable);
+
 #endif
@@ -7,6 +7,7 @@
 #define INCLUDE_PICO_QUEUE
 #include "pico_config.h"
 #include "pico_frame.h"
+#include "pico_spsc.h"
 
 #define Q_LIMIT 0
 
@@ -30,6 +31,9 @@ struct pico_queue {
     struct pico_frame *tail;
 #ifdef PICO_SUPPORT_MUTEX
     void *mutex;
+#endif
+#ifdef PICO_SUPPORT_SPSC
+    struct pico_spsc *ring;     /* lock free mode, see pico_queue_spsc() */
 #endif
     uint8_t shared;
     uint16_t overhead;
@@ -67,6 +71,62 @@ static void debug_q(struct pico_queue *q)
 #define debug_q(x) do {} while(0)
 #endif
 
+#ifdef PICO_SUPPORT_SPSC
+/* Lock free mode, for a queue with one producer thread and one consumer
+ * thread: frames go through a ring instead of the list. The frames and the
+ * size are counted before the frame is visible to the consumer, which
+ * uncounts it after taking it, so that they never go below the content. */
+static inline int32_t pico_enqueue_spsc(struct pico_queue *q, struct pico_frame *p)
+{
+    uint32_t len = p->buffer_len + q->overhead;
+    uint32_t size;
+
+    pico_spsc_fetch_add(&q->frames, 1u);
+    size = pico_spsc_fetch_add(&q->size, len) + len;
+    if (pico_spsc_push(q->ring, p) < 0) {
+        pico_spsc_fetch_sub(&q->frames, 1u);
+        pico_spsc_fetch_sub(&q->size, len);
+        return -1;
+    }
+
+    return (int32_t)size;
+}
+
+static inline struct pico_frame *pico_dequeue_spsc(struct pico_queue *q)
+{
+    struct pico_frame *p = (struct pico_frame *)pico_spsc_pop(q->ring);
+
+    if (!p)
+        return NULL;
+
+    pico_spsc_fetch_sub(&q->frames, 1u);
+    pico_spsc_fetch_sub(&q->size, p->buffer_len + q->overhead);
+    p->next = NULL;
+    return p;
+}
+
+/* Switches an empty queue to the lock free mode, slots is a power of two */
+static inline int pico_queue_spsc(struct pico_queue *q, uint32_t slots)
+{
+    struct pico_spsc *ring;
+
+    if (q->ring || q->head || q->shared)
+        return -1;
+
+    ring = PICO_ZALLOC(sizeof(struct pico_spsc) + slots * sizeof(void *));
+    if (!ring)
+        return -1;
+
+    if (pico_spsc_init(ring, (void **)(ring + 1), slots) < 0) {
+        PICO_FREE(ring);
+        return -1;
+    }
+
+    q->ring = ring;
+    return 0;
+}
+#endif
+
 static inline int32_t pico_enqueue(struct pico_queue *q, struct pico_frame *p)
 {
     if ((q->max_frames) && (q->max_frames <= q->frames))
@@ -81,6 +141,11 @@ static inline int32_t pico_enqueue(struct pico_queue *q, struct pico_frame *p)
     if ((q->max_size) && (q->max_size < (p->buffer_len + q->size)))
         return -1;
 
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return pico_enqueue_spsc(q, p);
+
+#endif
     if (q->shared)
         PICOTCP_MUTEX_LOCK(q->mutex);
 
@@ -108,6 +173,11 @@ static inline int32_t pico_enqueue(struct pico_queue *q, struct pico_frame *p)
 static inline struct pico_frame *pico_dequeue(struct pico_queue *q)
 {
     struct pico_frame *p = q->head;
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return pico_dequeue_spsc(q);
+
+#endif
     if (!p)
         return NULL;
 
@@ -135,6 +205,11 @@ static inline struct pico_frame *pico_dequeue(struct pico_queue *q)
 static inline struct pico_frame *pico_queue_peek(struct pico_queue *q)
 {
     struct pico_frame *p = q->head;
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring)
+        return (struct pico_frame *)pico_spsc_peek(q->ring);
+
+#endif
     if (q->frames < 1)
         return NULL;
 
@@ -147,6 +222,14 @@ static inline void pico_queue_deinit(struct pico_queue *q)
     if (q->shared) {
         PICOTCP_MUTEX_DEL(q->mutex);
     }
+
+#ifdef PICO_SUPPORT_SPSC
+    if (q->ring) {
+        PICO_FREE(q->ring);
+        q->ring = NULL;
+    }
+
+#endif
 }
 
 static inline void pico_queue_empty(struct pico_queue *q)
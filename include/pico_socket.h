@@ -56,7 +56,9 @@ struct pico_socket {
     struct pico_queue q_out;
 
     void (*wakeup)(uint16_t ev, struct pico_socket *s);
-
+#ifdef PICO_SUPPORT_EVQ
+    struct pico_evq_entry *evq; /* registration on an event queue */
+#endif
 
 #ifdef PICO_SUPPORT_TCP
     /* For the TCP backlog queue */
@@ -127,6 +129,7 @@ struct pico_ip_mreq_source {
 
 /* Socket options */
 # define PICO_TCP_NODELAY                     1
+# define PICO_TCP_FASTOPEN                    23
 # define PICO_SOCKET_OPT_TCPNODELAY           0x0000u
 
 # define PICO_IP_MULTICAST_EXCLUDE            0
@@ -147,6 +150,9 @@ struct pico_ip_mreq_source {
 # define PICO_SOCKET_OPT_KEEPCNT               6
 
 #define PICO_SOCKET_OPT_LINGER                13
+# define PICO_SOCKET_OPT_REUSEPORT            15 /* also the index in opt_flags */
+
+# define PICO_SOCKET_OPT_MAX_PACING_RATE      47
 
 # define PICO_SOCKET_OPT_RCVBUF               52
 # define PICO_SOCKET_OPT_SNDBUF               53
@@ -177,6 +183,16 @@ struct pico_msginfo {
     uint8_t tos;
 };
 
+/* One datagram of a batch, see pico_socket_sendmmsg() and pico_socket_recvmmsg() */
+struct pico_mmsg {
+    void *buf;
+    int len;                      /* datagram length (send) or buffer size (receive) */
+    union pico_address addr;      /* destination (send) or origin (receive) */
+    uint16_t port;                /* remote port, network order */
+    struct pico_msginfo *msginfo; /* optional */
+    int ret;                      /* bytes sent or received */
+};
+
 struct pico_socket *pico_socket_open(uint16_t net, uint16_t proto, void (*wakeup)(uint16_t ev, struct pico_socket *s));
 
 int pico_socket_read(struct pico_socket *s, void *buf, int len);
@@ -190,6 +206,11 @@ int pico_socket_recvfrom(struct pico_socket *s, void *buf, int len, void *orig,
 int pico_socket_recvfrom_extended(struct pico_socket *s, void *buf, int len, void *orig,
                                   uint16_t *remote_port, struct pico_msginfo *msginfo);
 
+int pico_socket_sendmmsg(struct pico_socket *s, struct pico_mmsg *msgs, int n);
+int pico_socket_recvmmsg(struct pico_socket *s, struct pico_mmsg *msgs, int n);
+int pico_socket_sendto_segmented(struct pico_socket *s, const void *buf, int len, int segsize,
+                                 void *dst, uint16_t remote_port, struct pico_msginfo *msginfo);
+
 int pico_socket_send(struct pico_socket *s, const void *buf, int len);
 int pico_socket_recv(struct pico_socket *s, void *buf, int len);
 
@@ -198,6 +219,7 @@ int pico_socket_getname(struct pico_socket *s, void *local_addr, uint16_t *port,
 int pico_socket_getpeername(struct pico_socket *s, void *remote_addr, uint16_t *port, uint16_t *proto);
 
 int pico_socket_connect(struct pico_socket *s, const void *srv_addr, uint16_t remote_port);
+int pico_socket_connect_fastopen(struct pico_socket *s, const void *srv_addr, uint16_t remote_port, const void *buf, int len);
 int pico_socket_listen(struct pico_socket *s, const int backlog);
 struct pico_socket *pico_socket_accept(struct pico_socket *s, void *orig, uint16_t *port);
 int8_t pico_socket_del(struct pico_socket *s);
@@ -247,6 +269,7 @@ struct pico_socket*pico_sockets_find(uint16_t local, uint16_t remote);
 int pico_is_port_free(uint16_t proto, uint16_t port, void *addr, void *net);
 
 struct pico_sockport *pico_get_sockport(uint16_t proto, uint16_t port);
+struct pico_socket *pico_socket_reuseport_select(struct pico_sockport *sp, struct pico_socket *s, struct pico_frame *f);
 
 uint32_t pico_socket_get_mss(struct pico_socket *s);
 int pico_socket_set_family(struct pico_socket *s, uint16_t family);
@@ -0,0 +1,99 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_SPSC
+#define INCLUDE_PICO_SPSC
+#include "pico_config.h"
+
+/* Single producer, single consumer ring of pointers, without locks.
+ * One thread pushes and one thread pops, each only writes its own index:
+ * the slot is written before the head is published (release), and read
+ * after the head is seen (acquire), and the same in the other direction
+ * for the tail. Targets without the GCC atomic builtins can provide the
+ * accessors below, PICO_SUPPORT_SPSC tells whether the ring is available. */
+#if !defined(pico_spsc_load_acquire) && (defined(__clang__) || \
+    (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)))))
+# define pico_spsc_load_acquire(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+# define pico_spsc_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+# define pico_spsc_fetch_add(p, v)     __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+# define pico_spsc_fetch_sub(p, v)     __atomic_fetch_sub((p), (v), __ATOMIC_RELAXED)
+#endif
+
+#ifdef pico_spsc_load_acquire
+#define PICO_SUPPORT_SPSC
+
+/* The indexes are written by different threads, keep them apart */
+#ifndef PICO_SPSC_CACHELINE
+# define PICO_SPSC_CACHELINE 64
+#endif
+
+struct pico_spsc {
+    uint32_t head;                  /* written by the producer */
+    uint8_t pad0[PICO_SPSC_CACHELINE - sizeof(uint32_t)];
+    uint32_t tail;                  /* written by the consumer */
+    uint8_t pad1[PICO_SPSC_CACHELINE - sizeof(uint32_t)];
+    uint32_t mask;
+    void **slot;
+};
+
+/* size must be a power of two, slots an array of size pointers */
+static inline int pico_spsc_init(struct pico_spsc *r, void **slots, uint32_t size)
+{
+    if (!r || !slots || !size || (size & (size - 1u)))
+        return -1;
+
+    r->head = 0;
+    r->tail = 0;
+    r->mask = size - 1u;
+    r->slot = slots;
+    return 0;
+}
+
+/* Producer side. Returns -1 if the ring is full. */
+static inline int pico_spsc_push(struct pico_spsc *r, void *p)
+{
+    uint32_t head = r->head;
+
+    if ((head - pico_spsc_load_acquire(&r->tail)) > r->mask)
+        return -1;
+
+    r->slot[head & r->mask] = p;
+    pico_spsc_store_release(&r->head, head + 1u);
+    return 0;
+}
+
+/* Consumer side. Returns NULL if the ring is empty. */
+static inline void *pico_spsc_pop(struct pico_spsc *r)
+{
+    uint32_t tail = r->tail;
+    void *p;
+
+    if (tail == pico_spsc_load_acquire(&r->head))
+        return NULL;
+
+    p = r->slot[tail & r->mask];
+    pico_spsc_store_release(&r->tail, tail + 1u);
+    return p;
+}
+
+/* Consumer side: next element, left in the ring */
+static inline void *pico_spsc_peek(struct pico_spsc *r)
+{
+    uint32_t tail = r->tail;
+
+    if (tail == pico_spsc_load_acquire(&r->head))
+        return NULL;
+
+    return r->slot[tail & r->mask];
+}
+
+/* Exact from either side for its own end, a snapshot otherwise */
+static inline uint32_t pico_spsc_count(struct pico_spsc *r)
+{
+    return pico_spsc_load_acquire(&r->head) - pico_spsc_load_acquire(&r->tail);
+}
+
+#endif
+#endif
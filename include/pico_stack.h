@@ -35,6 +35,9 @@ int32_t pico_stack_recv_zerocopy(struct pico_device *dev, uint8_t *buffer, uint3
 int32_t pico_stack_recv_zerocopy_ext_buffer(struct pico_device *dev, uint8_t *buffer, uint32_t len);
 int32_t pico_stack_recv_zerocopy_ext_buffer_notify(struct pico_device *dev, uint8_t *buffer, uint32_t len, void (*notify_free)(uint8_t *buffer));
 
+/* Symmetric flow hash of a frame, from its ethernet header if eth is set */
+uint32_t pico_flow_hash(const uint8_t *buf, uint32_t len, int eth);
+
 /* ===== SENDING FUNCTIONS (from socket down to dev) ===== */
 
 int32_t pico_network_send(struct pico_frame *f);
@@ -60,6 +63,34 @@ int pico_stack_init(void);
 
 /* ----- Loop Function. ----- */
 void pico_stack_tick(void);
+
+/* Scheduling of the loops run by pico_stack_tick */
+#define PICO_SCHED_ADAPTIVE     0   /* scores adjusted to the load, the default */
+#define PICO_SCHED_LATENCY      1   /* small budgets, run-to-completion receive */
+#define PICO_SCHED_THROUGHPUT   2   /* large batches */
+
+/* Phases of a tick, indexes of pico_sched_stats.work */
+#define PICO_SCHED_PHASE_DEV_IN         0
+#define PICO_SCHED_PHASE_DATALINK_IN    1
+#define PICO_SCHED_PHASE_NETWORK_IN     2
+#define PICO_SCHED_PHASE_TRANSPORT_IN   3
+#define PICO_SCHED_PHASE_SOCKET_IN      4
+#define PICO_SCHED_PHASE_SOCKETS        5   /* output of the sockets */
+#define PICO_SCHED_PHASE_SOCKET_OUT     6
+#define PICO_SCHED_PHASE_TRANSPORT_OUT  7
+#define PICO_SCHED_PHASE_NETWORK_OUT    8
+#define PICO_SCHED_PHASE_DATALINK_OUT   9
+#define PICO_SCHED_PHASE_DEV_OUT        10
+#define PICO_SCHED_PHASES               11
+
+struct pico_sched_stats {
+    uint32_t ticks;
+    uint32_t work[PICO_SCHED_PHASES];   /* frames handled by each phase */
+};
+
+int pico_stack_sched_mode(int mode);
+int pico_stack_sched_weights(int in, int out);
+void pico_stack_sched_stats(struct pico_sched_stats *stats, int reset);
 void pico_stack_loop(void);
 
 /* ---- Notifications for stack errors */
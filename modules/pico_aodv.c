@@ -30,7 +30,7 @@ static const struct pico_ip4 ANY_HOST = {
     0x0
 };
 
-static uint32_t pico_aodv_local_id = 0;
+static PICO_TLS uint32_t pico_aodv_local_id = 0;
 static int aodv_node_compare(void *ka, void *kb)
 {
     struct pico_aodv_node *a = ka, *b = kb;
@@ -55,10 +55,10 @@ static int aodv_dev_cmp(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(aodv_nodes, aodv_node_compare);
-PICO_TREE_DECLARE(aodv_devices, aodv_dev_cmp);
+PICO_TLS PICO_TREE_DECLARE(aodv_nodes, aodv_node_compare);
+PICO_TLS PICO_TREE_DECLARE(aodv_devices, aodv_dev_cmp);
 
-static struct pico_socket *aodv_socket = NULL;
+static PICO_TLS struct pico_socket *aodv_socket = NULL;
 
 static struct pico_aodv_node *get_node_by_addr(const union pico_address *addr)
 {
@@ -418,9 +418,9 @@ static void pico_aodv_parse(union pico_address *from, uint8_t *buf, int len, str
 
 static void pico_aodv_socket_callback(uint16_t ev, struct pico_socket *s)
 {
-    static uint8_t aodv_pkt[AODV_MAX_PKT];
-    static union pico_address from;
-    static struct pico_msginfo msginfo;
+    static PICO_TLS uint8_t aodv_pkt[AODV_MAX_PKT];
+    static PICO_TLS union pico_address from;
+    static PICO_TLS struct pico_msginfo msginfo;
     uint16_t sport;
     int r;
     if (s != aodv_socket)
@@ -461,7 +461,7 @@ static void aodv_retrans_rreq(pico_time now, void *arg)
     struct pico_aodv_node *node = (struct pico_aodv_node *)arg;
     struct pico_device *dev;
     struct pico_tree_node *index;
-    static struct pico_aodv_rreq rreq;
+    static PICO_TLS struct pico_aodv_rreq rreq;
     struct pico_ipv4_link *ip4l = NULL;
     struct pico_msginfo info = {
         .dev = NULL, .tos = 0, .ttl = AODV_TTL_START
@@ -515,7 +515,7 @@ static int aodv_send_req(struct pico_aodv_node *node)
 {
     struct pico_device *dev;
     struct pico_tree_node *index;
-    static struct pico_aodv_rreq rreq;
+    static PICO_TLS struct pico_aodv_rreq rreq;
     int n = 0;
     struct pico_ipv4_link *ip4l = NULL;
     struct pico_msginfo info = {
@@ -10,7 +10,6 @@
 
 #include "pico_config.h"
 #include "pico_arp.h"
-#include "pico_tree.h"
 #include "pico_ipv4.h"
 #include "pico_device.h"
 #include "pico_stack.h"
@@ -18,7 +17,21 @@
 extern const uint8_t PICO_ETHADDR_ALL[6];
 #define PICO_ARP_TIMEOUT 600000llu
 #define PICO_ARP_RETRY 300lu
-#define PICO_ARP_MAX_PENDING 5
+#define PICO_ARP_MAX_PROBES 3
+
+/* Frames parked on each unresolved neighbor */
+#ifndef PICO_ARP_MAX_PENDING
+#define PICO_ARP_MAX_PENDING 16
+#endif
+
+/* Buckets in the neighbor table and slots in the destination cache,
+ * both must be a power of two */
+#ifndef PICO_ARP_HASH_SIZE
+#define PICO_ARP_HASH_SIZE 64
+#endif
+#ifndef PICO_ARP_DST_CACHE
+#define PICO_ARP_DST_CACHE 64
+#endif
 
 #ifdef DEBUG_ARP
     #define arp_dbg dbg
@@ -26,25 +39,7 @@ extern const uint8_t PICO_ETHADDR_ALL[6];
     #define arp_dbg(...) do {} while(0)
 #endif
 
-static int max_arp_reqs = PICO_ARP_MAX_RATE;
-static struct pico_frame *frames_queued[PICO_ARP_MAX_PENDING] = { 0 };
-
-static void pico_arp_queued_trigger(void)
-{
-    int i;
-    struct pico_frame *f;
-    for (i = 0; i < PICO_ARP_MAX_PENDING; i++)
-    {
-        f = frames_queued[i];
-        if (f) {
-            if (!pico_ethernet_send(f))
-            {
-                pico_frame_discard(f);
-                frames_queued[i] = NULL;
-            }
-        }
-    }
-}
+static PICO_TLS int max_arp_reqs = PICO_ARP_MAX_RATE;
 
 static void update_max_arp_reqs(pico_time now, void *unused)
 {
@@ -88,7 +83,7 @@ struct arp_service_ipconflict {
     void (*conflict)(int);
 };
 
-static struct arp_service_ipconflict conflict_ipv4;
+static PICO_TLS struct arp_service_ipconflict conflict_ipv4;
 
 
 
@@ -104,34 +99,96 @@ struct pico_arp {
     pico_time timestamp;
     struct pico_device *dev;
     uint32_t timer;
+    uint16_t probes;
+    uint16_t pending_count;
+    struct pico_frame *pending;      /* frames waiting for this neighbor, linked by f->next */
+    struct pico_frame *pending_tail;
+    struct pico_arp *next;           /* hash chain */
+};
+
+/* Last next hop resolved for a destination. The slot is valid as long
+ * as the IPv4 routing generation it was filled with is current, so
+ * that a hit skips the link, route and neighbor lookups. */
+struct pico_arp_dst {
+    struct pico_ip4 dst;
+    struct pico_device *dev;
+    uint32_t gen;
+    struct pico_arp *entry;          /* neighbor, or NULL when dst is local */
+    struct pico_eth *local;          /* own MAC when dst is one of our addresses */
 };
 
 
 
 /*****************/
-/**  ARP TREE **/
+/**  ARP TABLE  **/
 /*****************/
 
-/* Routing destination */
+static PICO_TLS struct pico_arp *arp_table[PICO_ARP_HASH_SIZE];
+static PICO_TLS struct pico_arp_dst arp_dst_cache[PICO_ARP_DST_CACHE];
 
-static int arp_compare(void *ka, void *kb)
+static inline uint32_t arp_hash(uint32_t addr)
 {
-    struct pico_arp *a = ka, *b = kb;
-    return pico_ipv4_compare(&a->ipv4, &b->ipv4);
+    addr ^= addr >> 16;
+    addr *= 0x7feb352du;
+    addr ^= addr >> 15;
+    return addr;
 }
 
-PICO_TREE_DECLARE(arp_tree, arp_compare);
+static struct pico_arp *pico_arp_find(uint32_t addr)
+{
+    struct pico_arp *a = arp_table[arp_hash(addr) & (PICO_ARP_HASH_SIZE - 1)];
+    while (a && (a->ipv4.addr != addr))
+        a = a->next;
+    return a;
+}
+
+static void pico_arp_insert(struct pico_arp *entry)
+{
+    struct pico_arp **head = &arp_table[arp_hash(entry->ipv4.addr) & (PICO_ARP_HASH_SIZE - 1)];
+    entry->next = *head;
+    *head = entry;
+}
+
+static void pico_arp_timer_stop(struct pico_arp *a)
+{
+    if (a->timer) {
+        pico_timer_cancel(a->timer);
+        a->timer = 0;
+    }
+}
+
+static void pico_arp_del(struct pico_arp *entry)
+{
+    struct pico_arp **pp = &arp_table[arp_hash(entry->ipv4.addr) & (PICO_ARP_HASH_SIZE - 1)];
+    struct pico_frame *f;
+    int i;
+
+    while (*pp && (*pp != entry))
+        pp = &(*pp)->next;
+    if (*pp)
+        *pp = entry->next;
+
+    for (i = 0; i < PICO_ARP_DST_CACHE; i++) {
+        if (arp_dst_cache[i].entry == entry)
+            arp_dst_cache[i].entry = NULL;
+    }
+    while (entry->pending) {
+        f = entry->pending;
+        entry->pending = f->next;
+        pico_frame_discard(f);
+    }
+    pico_arp_timer_stop(entry);
+    PICO_FREE(entry);
+}
 
 /*********************/
-/**  END ARP TREE **/
+/**  END ARP TABLE **/
 /*********************/
 
 struct pico_eth *pico_arp_lookup(struct pico_ip4 *dst)
 {
-    struct pico_arp search, *found;
-    search.ipv4.addr = dst->addr;
-    found = pico_tree_findKey(&arp_tree, &search);
-    if (found && (found->arp_status != PICO_ARP_STATUS_STALE))
+    struct pico_arp *found = pico_arp_find(dst->addr);
+    if (found && (found->arp_status != PICO_ARP_STATUS_INCOMPLETE))
         return &found->eth;
 
     return NULL;
@@ -139,141 +196,148 @@ struct pico_eth *pico_arp_lookup(struct pico_ip4 *dst)
 
 struct pico_ip4 *pico_arp_reverse_lookup(struct pico_eth *dst)
 {
-    struct pico_arp*search;
-    struct pico_tree_node *index;
-    pico_tree_foreach(index, &arp_tree){
-        search = index->keyValue;
-        if(memcmp(&(search->eth.addr), &dst->addr, 6) == 0)
-            return &search->ipv4;
+    struct pico_arp *search;
+    int i;
+    for (i = 0; i < PICO_ARP_HASH_SIZE; i++) {
+        for (search = arp_table[i]; search; search = search->next) {
+            if ((search->arp_status != PICO_ARP_STATUS_INCOMPLETE) &&
+                (memcmp(&(search->eth.addr), &dst->addr, 6) == 0))
+                return &search->ipv4;
+        }
     }
     return NULL;
 }
 
-static void pico_arp_unreachable(struct pico_ip4 *a)
+/* Resolution failed: report and drop the frames waiting for the neighbor */
+static void pico_arp_unreachable(struct pico_arp *a)
 {
-    int i;
     struct pico_frame *f;
-    struct pico_ipv4_hdr *hdr;
-    struct pico_ip4 dst;
-    for (i = 0; i < PICO_ARP_MAX_PENDING; i++)
-    {
-        f = frames_queued[i];
-        if (f) {
-            hdr = (struct pico_ipv4_hdr *) f->net_hdr;
-            dst = pico_ipv4_route_get_gateway(&hdr->dst);
-            if (!dst.addr)
-                dst.addr = hdr->dst.addr;
-
-            if (dst.addr ==  a->addr) {
-                if (!pico_source_is_local(f)) {
-                    pico_notify_dest_unreachable(f);
-                }
-
-                pico_frame_discard(f);
-                frames_queued[i] = NULL;
-            }
+    while (a->pending) {
+        f = a->pending;
+        a->pending = f->next;
+        if (!pico_source_is_local(f)) {
+            pico_notify_dest_unreachable(f);
         }
-    }
-}
 
-static void pico_arp_retry(struct pico_frame *f, struct pico_ip4 *where)
-{
-    if (++f->failure_count < 4) {
-        arp_dbg ("================= ARP REQUIRED: %d =============\n\n", f->failure_count);
-        /* check if dst is local (gateway = 0), or if to use gateway */
-        pico_arp_request(f->dev, where, PICO_ARP_QUERY);
-    } else {
-        pico_arp_unreachable(where);
+        pico_frame_discard(f);
     }
+    a->pending_tail = NULL;
+    a->pending_count = 0;
 }
 
-struct pico_eth *pico_arp_get(struct pico_frame *f)
+/* Resolution succeeded: hand the waiting frames back to their device */
+static void pico_arp_flush(struct pico_arp *a)
 {
-    struct pico_eth *a4;
-    struct pico_ip4 gateway;
-    struct pico_ip4 *where;
-    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *) f->net_hdr;
-    struct pico_ipv4_link *l;
-    if (!hdr)
-        return NULL;
-
-    l = pico_ipv4_link_get(&hdr->dst);
-    if(l) {
-        /* address belongs to ourself */
-        return &l->dev->eth->mac;
+    struct pico_frame *f = a->pending, *next;
+    a->pending = NULL;
+    a->pending_tail = NULL;
+    a->pending_count = 0;
+    while (f) {
+        next = f->next;
+        if (pico_enqueue(f->dev->q_out, f) < 0)
+            pico_frame_discard(f);
+
+        f = next;
     }
+}
 
-    gateway = pico_ipv4_route_get_gateway(&hdr->dst);
-    /* check if dst is local (gateway = 0), or if to use gateway */
-    if (gateway.addr != 0)
-        where = &gateway;
-    else
-        where = &hdr->dst;
-
-    a4 = pico_arp_lookup(where);      /* check if dst ip mac in cache */
-
-    if (!a4)
-        pico_arp_retry(f, where);
+static void arp_retry(pico_time now, void *_a);
 
-    return a4;
+static void pico_arp_solicit(struct pico_arp *a)
+{
+    a->probes++;
+    arp_dbg("================= ARP REQUIRED: %d =============\n\n", a->probes);
+    pico_arp_request(a->dev, &a->ipv4, PICO_ARP_QUERY);
+    a->timer = pico_timer_add(PICO_ARP_RETRY, arp_retry, a);
 }
 
-
-void pico_arp_postpone(struct pico_frame *f)
+/* INCOMPLETE and PROBE: ask again, or give the neighbor up */
+static void arp_retry(pico_time now, void *_a)
 {
-    int i;
-    for (i = 0; i < PICO_ARP_MAX_PENDING; i++)
-    {
-        if (!frames_queued[i]) {
-            frames_queued[i] = pico_frame_copy(f);
-            return;
-        }
+    struct pico_arp *a = (struct pico_arp *) _a;
+    IGNORE_PARAMETER(now);
+    a->timer = 0;
+    if (a->probes < PICO_ARP_MAX_PROBES) {
+        pico_arp_solicit(a);
+        return;
     }
-    /* Not possible to enqueue: caller will discard packet */
-}
 
+    arp_dbg("ARP: %08x unreachable\n", a->ipv4.addr);
+    pico_arp_unreachable(a);
+    pico_arp_del(a);
+}
 
 #ifdef DEBUG_ARP
 void dbg_arp(void)
 {
     struct pico_arp *a;
-    struct pico_tree_node *index;
+    int i;
 
-    pico_tree_foreach(index, &arp_tree) {
-        a = index->keyValue;
-        arp_dbg("ARP to  %08x, mac: %02x:%02x:%02x:%02x:%02x:%02x\n", a->ipv4.addr, a->eth.addr[0], a->eth.addr[1], a->eth.addr[2], a->eth.addr[3], a->eth.addr[4], a->eth.addr[5] );
+    for (i = 0; i < PICO_ARP_HASH_SIZE; i++) {
+        for (a = arp_table[i]; a; a = a->next)
+            arp_dbg("ARP to  %08x, mac: %02x:%02x:%02x:%02x:%02x:%02x\n", a->ipv4.addr, a->eth.addr[0], a->eth.addr[1], a->eth.addr[2], a->eth.addr[3], a->eth.addr[4], a->eth.addr[5] );
     }
 }
 #endif
 
+/* REACHABLE: turn STALE when not confirmed for PICO_ARP_TIMEOUT.
+ * A stale entry is still used, and only probed when traffic needs it;
+ * if nobody needs it for another PICO_ARP_TIMEOUT it is removed. */
 static void arp_expire(pico_time now, void *_stale)
 {
     struct pico_arp *stale = (struct pico_arp *) _stale;
-    if (now >= (stale->timestamp + PICO_ARP_TIMEOUT)) {
+    stale->timer = 0;
+    if (stale->arp_status == PICO_ARP_STATUS_STALE) {
+        pico_arp_del(stale);
+    } else if (now >= (stale->timestamp + PICO_ARP_TIMEOUT)) {
         stale->arp_status = PICO_ARP_STATUS_STALE;
         arp_dbg("ARP: Setting arp_status to STALE\n");
-        pico_arp_request(stale->dev, &stale->ipv4, PICO_ARP_QUERY);
+        stale->timer = pico_timer_add(PICO_ARP_TIMEOUT, arp_expire, stale);
     } else {
         /* Timer must be rescheduled, ARP entry has been renewed lately.
          * No action required to refresh the entry, will check on the next timeout */
-        pico_timer_add(PICO_ARP_TIMEOUT + stale->timestamp - now, arp_expire, stale);
+        stale->timer = pico_timer_add(PICO_ARP_TIMEOUT + stale->timestamp - now, arp_expire, stale);
     }
 }
 
 static void pico_arp_add_entry(struct pico_arp *entry)
 {
     entry->arp_status = PICO_ARP_STATUS_REACHABLE;
-    entry->timestamp  = PICO_TIME();
+    entry->timestamp  = pico_tick;
 
-    pico_tree_insert(&arp_tree, entry);
+    pico_arp_insert(entry);
     arp_dbg("ARP ## reachable.\n");
-    pico_arp_queued_trigger();
-    pico_timer_add(PICO_ARP_TIMEOUT, arp_expire, entry);
+    entry->timer = pico_timer_add(PICO_ARP_TIMEOUT, arp_expire, entry);
+}
+
+/* The neighbor answered, or spoke to us: it is reachable at mac */
+static void pico_arp_confirm(struct pico_arp *entry, uint8_t *mac)
+{
+    memcpy(entry->eth.addr, mac, PICO_SIZE_ETH);
+    /* Refresh timestamp, this will force a reschedule on the next timeout */
+    entry->timestamp = pico_tick;
+    if ((entry->arp_status != PICO_ARP_STATUS_REACHABLE) &&
+        (entry->arp_status != PICO_ARP_STATUS_PERMANENT)) {
+        pico_arp_timer_stop(entry);
+        entry->arp_status = PICO_ARP_STATUS_REACHABLE;
+        entry->probes = 0;
+        entry->timer = pico_timer_add(PICO_ARP_TIMEOUT, arp_expire, entry);
+        arp_dbg("ARP ## reachable.\n");
+    }
+
+    pico_arp_flush(entry);
 }
 
 int pico_arp_create_entry(uint8_t *hwaddr, struct pico_ip4 ipv4, struct pico_device *dev)
 {
-    struct pico_arp*arp = PICO_ZALLOC(sizeof(struct pico_arp));
+    struct pico_arp *arp = pico_arp_find(ipv4.addr);
+    if (arp) {
+        arp->dev = dev;
+        pico_arp_confirm(arp, hwaddr);
+        return 0;
+    }
+
+    arp = PICO_ZALLOC(sizeof(struct pico_arp));
     if(!arp) {
         pico_err = PICO_ERR_ENOMEM;
         return -1;
@@ -288,6 +352,120 @@ int pico_arp_create_entry(uint8_t *hwaddr, struct pico_ip4 ipv4, struct pico_dev
     return 0;
 }
 
+/* Next hop for dst through dev, served from the destination cache when
+ * possible. An unknown neighbor gets an INCOMPLETE entry and a first
+ * request, so that the frames sent to it meanwhile can be parked. */
+static struct pico_arp_dst *pico_arp_dst_get(struct pico_device *dev, struct pico_ip4 *dst)
+{
+    struct pico_arp_dst *d = &arp_dst_cache[arp_hash(dst->addr) & (PICO_ARP_DST_CACHE - 1)];
+    uint32_t gen = pico_ipv4_route_generation();
+    struct pico_ipv4_link *l;
+    struct pico_ip4 gateway;
+    struct pico_arp *a = NULL;
+
+    if ((d->gen == gen) && (d->dst.addr == dst->addr) && (d->dev == dev) && (d->entry || d->local))
+        return d;
+
+    d->entry = NULL;
+    d->local = NULL;
+    l = pico_ipv4_link_get(dst);
+    if (l) {
+        /* address belongs to ourself */
+        d->local = &l->dev->eth->mac;
+    } else {
+        gateway = pico_ipv4_route_get_gateway(dst);
+        /* check if dst is local (gateway = 0), or if to use gateway */
+        if (gateway.addr == 0)
+            gateway.addr = dst->addr;
+
+        a = pico_arp_find(gateway.addr);
+        if (!a) {
+            a = PICO_ZALLOC(sizeof(struct pico_arp));
+            if (!a) {
+                pico_err = PICO_ERR_ENOMEM;
+                return NULL;
+            }
+
+            a->ipv4.addr = gateway.addr;
+            a->dev = dev;
+            a->arp_status = PICO_ARP_STATUS_INCOMPLETE;
+            pico_arp_insert(a);
+            pico_arp_solicit(a);
+        }
+
+        d->entry = a;
+    }
+
+    d->dst.addr = dst->addr;
+    d->dev = dev;
+    d->gen = gen;
+    return d;
+}
+
+struct pico_eth *pico_arp_get(struct pico_frame *f)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *) f->net_hdr;
+    struct pico_arp_dst *d;
+    struct pico_arp *a;
+    if (!hdr)
+        return NULL;
+
+    d = pico_arp_dst_get(f->dev, &hdr->dst);
+    if (!d)
+        return NULL;
+
+    if (d->local)
+        return d->local;
+
+    a = d->entry;
+    if (a->arp_status == PICO_ARP_STATUS_INCOMPLETE)
+        return NULL;
+
+    if (a->arp_status == PICO_ARP_STATUS_STALE) {
+        /* Keep using the stale address while checking it is still valid */
+        pico_arp_timer_stop(a);
+        a->arp_status = PICO_ARP_STATUS_PROBE;
+        a->probes = 0;
+        pico_arp_solicit(a);
+    }
+
+    return &a->eth;
+}
+
+
+void pico_arp_postpone(struct pico_frame *f)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *) f->net_hdr;
+    struct pico_arp_dst *d;
+    struct pico_arp *a;
+    struct pico_frame *cp;
+
+    if (!hdr)
+        return;
+
+    d = pico_arp_dst_get(f->dev, &hdr->dst);
+    if (!d || !d->entry)
+        return;
+
+    a = d->entry;
+    /* Not possible to enqueue: caller will discard packet */
+    if ((a->arp_status != PICO_ARP_STATUS_INCOMPLETE) || (a->pending_count >= PICO_ARP_MAX_PENDING))
+        return;
+
+    cp = pico_frame_copy(f);
+    if (!cp)
+        return;
+
+    cp->next = NULL;
+    if (a->pending_tail)
+        a->pending_tail->next = cp;
+    else
+        a->pending = cp;
+
+    a->pending_tail = cp;
+    a->pending_count++;
+}
+
 static void pico_arp_check_conflict(struct pico_arp_hdr *hdr)
 {
     if (conflict_ipv4.conflict)
@@ -302,27 +480,15 @@ static void pico_arp_check_conflict(struct pico_arp_hdr *hdr)
 
 static struct pico_arp *pico_arp_lookup_entry(struct pico_frame *f)
 {
-    struct pico_arp search;
     struct pico_arp *found = NULL;
     struct pico_arp_hdr *hdr = (struct pico_arp_hdr *) f->net_hdr;
-    /* Populate a new arp entry */
-    search.ipv4.addr = hdr->src.addr;
 
     /* Search for already existing entry */
-    found = pico_tree_findKey(&arp_tree, &search);
+    found = pico_arp_find(hdr->src.addr);
     if (found) {
-        if (found->arp_status == PICO_ARP_STATUS_STALE) {
-            /* Replace if stale */
-            pico_tree_delete(&arp_tree, found);
-            pico_arp_add_entry(found);
-        } else {
-            /* Update mac address */
-            memcpy(found->eth.addr, hdr->s_mac, PICO_SIZE_ETH);
-            arp_dbg("ARP entry updated!\n");
-
-            /* Refresh timestamp, this will force a reschedule on the next timeout*/
-            found->timestamp = PICO_TIME();
-        }
+        /* Update mac address, release the frames waiting for it */
+        pico_arp_confirm(found, hdr->s_mac);
+        arp_dbg("ARP entry updated!\n");
     }
 
     return found;
@@ -513,15 +679,15 @@ int32_t pico_arp_request(struct pico_device *dev, struct pico_ip4 *dst, uint8_t
 
 int pico_arp_get_neighbors(struct pico_device *dev, struct pico_ip4 *neighbors, int maxlen)
 {
-    struct pico_arp*search;
-    struct pico_tree_node *index;
-    int i = 0;
-    pico_tree_foreach(index, &arp_tree){
-        search = index->keyValue;
-        if (search->dev == dev) {
-            neighbors[i++].addr = search->ipv4.addr;
-            if (i >= maxlen)
-                return i;
+    struct pico_arp *search;
+    int i = 0, b;
+    for (b = 0; b < PICO_ARP_HASH_SIZE; b++) {
+        for (search = arp_table[b]; search; search = search->next) {
+            if ((search->dev == dev) && (search->arp_status != PICO_ARP_STATUS_INCOMPLETE)) {
+                neighbors[i++].addr = search->ipv4.addr;
+                if (i >= maxlen)
+                    return i;
+            }
         }
     }
     return i;
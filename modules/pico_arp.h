@@ -17,6 +17,8 @@ int32_t pico_arp_request(struct pico_device *dev, struct pico_ip4 *dst, uint8_t
 #define PICO_ARP_STATUS_REACHABLE 0x00
 #define PICO_ARP_STATUS_PERMANENT 0x01
 #define PICO_ARP_STATUS_STALE     0x02
+#define PICO_ARP_STATUS_INCOMPLETE 0x03
+#define PICO_ARP_STATUS_PROBE     0x04
 
 #define PICO_ARP_QUERY    0x00
 #define PICO_ARP_PROBE    0x01
@@ -0,0 +1,479 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_frame.h"
+#include "pico_ipv4.h"
+#include "pico_tcp.h"
+#include "pico_udp.h"
+#include "pico_icmp4.h"
+#include "pico_conntrack.h"
+
+#ifdef PICO_SUPPORT_IPV4
+#ifdef PICO_SUPPORT_CONNTRACK
+
+#define ct_dbg(...) do {} while(0)
+
+/* Each connection sits in one hash table under both its original and its
+ * reply tuple, so a packet finds its connection and direction with a single
+ * lookup. The result is kept in the frame: NAT and the IP filter share it
+ * and a packet is tracked only once, whichever module asks first. The frame
+ * also keeps the id of its connection. Freed connections are kept for reuse
+ * and lose their id, so a frame that outlives its connection, or sees its
+ * memory reused by another one, finds a different id and looks it up again.
+ * Expired connections are dropped by the lookups and by a timer that sweeps
+ * 1/PICO_CT_SWEEP_SLICES of the buckets each interval. */
+#define PICO_CT_HASH_MIN        64u
+#define PICO_CT_HASH_LOAD       2u   /* average chain length before the table grows */
+#define PICO_CT_SWEEP_INTERVAL  1000 /* msec */
+#define PICO_CT_SWEEP_SLICES    64u
+
+#ifndef PICO_CONNTRACK_MAX
+# define PICO_CONNTRACK_MAX     16384u
+#endif
+
+/* Timeouts, msec */
+#define PICO_CT_TCP_NEW         120000ull
+#define PICO_CT_TCP_ESTABLISHED (24ull * 3600ull * 1000ull)
+#define PICO_CT_TCP_CLOSING     120000ull
+#define PICO_CT_TCP_CLOSED      10000ull
+#define PICO_CT_UDP_NEW         30000ull
+#define PICO_CT_UDP_ESTABLISHED 180000ull
+#define PICO_CT_ICMP            30000ull
+
+struct pico_conn_tuple {
+    struct pico_ip4 src;
+    struct pico_ip4 dst;
+    uint16_t sport;         /* ICMP echo: identifier */
+    uint16_t dport;
+};
+
+struct pico_conn_node {
+    struct pico_conn_node *next;
+    struct pico_conn *conn;
+    uint8_t dir;
+};
+
+struct pico_conn {
+    struct pico_conn_tuple tuple[2]; /* original, reply */
+    struct pico_conn_node node[2];
+    pico_time expire;
+    uint32_t id;            /* 0 once freed */
+    uint8_t proto;
+    uint8_t state;          /* PICO_CT_* */
+    uint8_t fin;            /* bit per direction */
+};
+
+struct pico_conn_table {
+    struct pico_conn_node **buckets;
+    uint32_t size;          /* power of two */
+    uint32_t count;         /* connections, twice as many nodes */
+    uint32_t sweep;         /* next bucket to sweep */
+    uint32_t next_id;
+    struct pico_conn *spare; /* freed connections, chained through node[0].next */
+    uint8_t timer;          /* sweep timer armed */
+};
+
+static PICO_TLS struct pico_conn_table ct_table = {
+    0
+};
+
+static inline uint32_t ct_hash_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline uint32_t ct_hash(uint8_t proto, const struct pico_conn_tuple *t)
+{
+    uint32_t ports = ((uint32_t)t->sport << 16) | t->dport;
+    return ct_hash_mix(t->src.addr ^ ct_hash_mix(t->dst.addr ^ ct_hash_mix(ports ^ proto)));
+}
+
+static inline int ct_tuple_eq(const struct pico_conn_tuple *a, const struct pico_conn_tuple *b)
+{
+    return (a->src.addr == b->src.addr) && (a->dst.addr == b->dst.addr) &&
+           (a->sport == b->sport) && (a->dport == b->dport);
+}
+
+static inline int ct_expired(struct pico_conn *c, pico_time now)
+{
+    return c->expire <= now;
+}
+
+static void ct_node_link(struct pico_conn_node *n)
+{
+    uint32_t idx = ct_hash(n->conn->proto, &n->conn->tuple[n->dir]) & (ct_table.size - 1u);
+    n->next = ct_table.buckets[idx];
+    ct_table.buckets[idx] = n;
+}
+
+static void ct_node_unlink(struct pico_conn_node *n)
+{
+    struct pico_conn_node **pp;
+    uint32_t idx = ct_hash(n->conn->proto, &n->conn->tuple[n->dir]) & (ct_table.size - 1u);
+
+    for (pp = &ct_table.buckets[idx]; *pp; pp = &(*pp)->next) {
+        if (*pp == n) {
+            *pp = n->next;
+            return;
+        }
+    }
+}
+
+/* The memory is kept for reuse, frames may still read the id */
+static void ct_free(struct pico_conn *c)
+{
+    ct_node_unlink(&c->node[PICO_CT_DIR_ORIGINAL]);
+    ct_node_unlink(&c->node[PICO_CT_DIR_REPLY]);
+    ct_table.count--;
+    c->id = 0;
+    c->node[PICO_CT_DIR_ORIGINAL].next = (struct pico_conn_node *)ct_table.spare;
+    ct_table.spare = c;
+}
+
+/* Both nodes of a connection may hang in the same chain: after a free the
+ * walk starts over, the chains are short. */
+static void ct_expire_bucket(uint32_t idx, pico_time now)
+{
+    struct pico_conn_node **pp = &ct_table.buckets[idx];
+
+    while (*pp) {
+        if (ct_expired((*pp)->conn, now)) {
+            ct_dbg("CONNTRACK: connection %p expired\n", (*pp)->conn);
+            ct_free((*pp)->conn);
+            pp = &ct_table.buckets[idx];
+        } else {
+            pp = &(*pp)->next;
+        }
+    }
+}
+
+static int ct_resize(uint32_t size)
+{
+    struct pico_conn_node **old = ct_table.buckets, *n, *next;
+    uint32_t old_size = ct_table.size;
+    uint32_t i;
+
+    ct_table.buckets = PICO_ZALLOC(size * sizeof(struct pico_conn_node *));
+    if (!ct_table.buckets) {
+        ct_table.buckets = old;
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    ct_table.size = size;
+    ct_table.sweep = 0;
+    for (i = 0; i < old_size; i++) {
+        for (n = old[i]; n; n = next) {
+            next = n->next;
+            ct_node_link(n);
+        }
+    }
+    if (old)
+        PICO_FREE(old);
+
+    return 0;
+}
+
+static void ct_cleanup(pico_time now, void *_unused)
+{
+    uint32_t n;
+    IGNORE_PARAMETER(_unused);
+
+    if (ct_table.size) {
+        n = (ct_table.size / PICO_CT_SWEEP_SLICES) + 1u;
+        while (n--) {
+            ct_expire_bucket(ct_table.sweep, now);
+            ct_table.sweep = (ct_table.sweep + 1u) & (ct_table.size - 1u);
+        }
+    }
+
+    pico_timer_add(PICO_CT_SWEEP_INTERVAL, ct_cleanup, NULL);
+}
+
+static struct pico_conn *ct_find(uint8_t proto, const struct pico_conn_tuple *t, uint8_t *dir)
+{
+    struct pico_conn_node *n;
+
+    if (!ct_table.size)
+        return NULL;
+
+    for (n = ct_table.buckets[ct_hash(proto, t) & (ct_table.size - 1u)]; n; n = n->next) {
+        if ((n->conn->proto == proto) && ct_tuple_eq(&n->conn->tuple[n->dir], t)) {
+            if (ct_expired(n->conn, pico_tick)) {
+                ct_free(n->conn);
+                return NULL;
+            }
+
+            *dir = n->dir;
+            return n->conn;
+        }
+    }
+    return NULL;
+}
+
+static struct pico_conn *ct_add(uint8_t proto, const struct pico_conn_tuple *t)
+{
+    struct pico_conn *c;
+    uint8_t i;
+
+    if (ct_table.count >= PICO_CONNTRACK_MAX) {
+        pico_err = PICO_ERR_EAGAIN;
+        return NULL;
+    }
+
+    if (((ct_table.count << 1) >= (ct_table.size * PICO_CT_HASH_LOAD)) &&
+        (ct_resize(ct_table.size ? (ct_table.size << 1) : PICO_CT_HASH_MIN) < 0) &&
+        !ct_table.size)
+        return NULL;
+
+    c = ct_table.spare;
+    if (c) {
+        ct_table.spare = (struct pico_conn *)c->node[PICO_CT_DIR_ORIGINAL].next;
+        memset(c, 0, sizeof(struct pico_conn));
+    } else {
+        c = PICO_ZALLOC(sizeof(struct pico_conn));
+        if (!c) {
+            pico_err = PICO_ERR_ENOMEM;
+            return NULL;
+        }
+    }
+
+    if (++ct_table.next_id == 0)
+        ct_table.next_id = 1;
+
+    c->id = ct_table.next_id;
+
+    c->proto = proto;
+    c->state = PICO_CT_NEW;
+    c->tuple[PICO_CT_DIR_ORIGINAL] = *t;
+    c->tuple[PICO_CT_DIR_REPLY].src = t->dst;
+    c->tuple[PICO_CT_DIR_REPLY].dst = t->src;
+    c->tuple[PICO_CT_DIR_REPLY].sport = t->dport;
+    c->tuple[PICO_CT_DIR_REPLY].dport = t->sport;
+    for (i = 0; i < 2; i++) {
+        c->node[i].conn = c;
+        c->node[i].dir = i;
+        ct_node_link(&c->node[i]);
+    }
+    ct_table.count++;
+
+    if (!ct_table.timer) {
+        ct_table.timer = 1;
+        pico_timer_add(PICO_CT_SWEEP_INTERVAL, ct_cleanup, NULL);
+    }
+
+    return c;
+}
+
+/* Tuple of the packet as seen in its own direction. Only first fragments
+ * carry the ports, and of ICMP only echo requests open a connection. */
+static int ct_frame_tuple(struct pico_frame *f, uint8_t *proto, struct pico_conn_tuple *t, int *may_open)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct pico_trans *trans;
+    struct pico_icmp4_hdr *icmp;
+
+    if (!hdr || !f->transport_hdr || (short_be(hdr->frag) & PICO_IPV4_FRAG_MASK))
+        return -1;
+
+    t->src = hdr->src;
+    t->dst = hdr->dst;
+    *proto = hdr->proto;
+    *may_open = 1;
+    switch (hdr->proto) {
+    case PICO_PROTO_TCP:
+    case PICO_PROTO_UDP:
+        trans = (struct pico_trans *)f->transport_hdr;
+        t->sport = trans->sport;
+        t->dport = trans->dport;
+        return 0;
+
+    case PICO_PROTO_ICMP4:
+        icmp = (struct pico_icmp4_hdr *)f->transport_hdr;
+        if ((icmp->type != PICO_ICMP_ECHO) && (icmp->type != PICO_ICMP_ECHOREPLY))
+            return -1;
+
+        t->sport = icmp->hun.ih_idseq.idseq_id;
+        t->dport = icmp->hun.ih_idseq.idseq_id;
+        *may_open = (icmp->type == PICO_ICMP_ECHO);
+        return 0;
+
+    default:
+        return -1;
+    }
+}
+
+static void ct_update_tcp(struct pico_conn *c, uint8_t dir, struct pico_frame *f)
+{
+    struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)f->transport_hdr;
+
+    if ((c->state == PICO_CT_CLOSED) && (dir == PICO_CT_DIR_ORIGINAL) &&
+        ((tcp->flags & (PICO_TCP_SYN | PICO_TCP_ACK)) == PICO_TCP_SYN)) {
+        /* the tuple is reused by a new connection */
+        c->state = PICO_CT_NEW;
+        c->fin = 0;
+    }
+
+    if (tcp->flags & PICO_TCP_RST) {
+        c->state = PICO_CT_CLOSED;
+    } else if ((tcp->flags & PICO_TCP_FIN) && (c->state != PICO_CT_CLOSED)) {
+        c->fin = (uint8_t)(c->fin | (1u << dir));
+        c->state = (c->fin == 3u) ? PICO_CT_CLOSED : PICO_CT_CLOSING;
+    }
+
+    switch (c->state) {
+    case PICO_CT_NEW:
+        c->expire = pico_tick + PICO_CT_TCP_NEW;
+        break;
+    case PICO_CT_ESTABLISHED:
+        c->expire = pico_tick + PICO_CT_TCP_ESTABLISHED;
+        break;
+    case PICO_CT_CLOSING:
+        c->expire = pico_tick + PICO_CT_TCP_CLOSING;
+        break;
+    default:
+        c->expire = pico_tick + PICO_CT_TCP_CLOSED;
+        break;
+    }
+}
+
+static void ct_update(struct pico_conn *c, uint8_t dir, struct pico_frame *f)
+{
+    if ((dir == PICO_CT_DIR_REPLY) && (c->state == PICO_CT_NEW))
+        c->state = PICO_CT_ESTABLISHED;
+
+    switch (c->proto) {
+    case PICO_PROTO_TCP:
+        ct_update_tcp(c, dir, f);
+        break;
+    case PICO_PROTO_UDP:
+        c->expire = pico_tick + ((c->state == PICO_CT_ESTABLISHED) ? PICO_CT_UDP_ESTABLISHED : PICO_CT_UDP_NEW);
+        break;
+    default:
+        c->expire = pico_tick + PICO_CT_ICMP;
+        break;
+    }
+}
+
+/* Looks the packet up once, creating the connection if needed, and
+ * caches the result in the frame. NULL for untracked packets. */
+struct pico_conn *pico_conntrack_get(struct pico_frame *f)
+{
+    struct pico_conn_tuple t = {
+        0
+    };
+    struct pico_conn *c;
+    uint8_t proto = 0, dir = PICO_CT_DIR_ORIGINAL;
+    int may_open = 0;
+
+    if (f->conn && (f->conn->id == f->conn_id))
+        return f->conn;
+
+    f->conn = NULL;
+    if (ct_frame_tuple(f, &proto, &t, &may_open) < 0)
+        return NULL;
+
+    c = ct_find(proto, &t, &dir);
+    if (!c) {
+        if (!may_open)
+            return NULL;
+
+        c = ct_add(proto, &t);
+        if (!c)
+            return NULL;
+    }
+
+    ct_update(c, dir, f);
+    f->conn = c;
+    f->conn_id = c->id;
+    f->conn_dir = dir;
+    return c;
+}
+
+uint8_t pico_conntrack_state(struct pico_frame *f)
+{
+    struct pico_conn *c = pico_conntrack_get(f);
+    if (!c)
+        return PICO_CT_UNTRACKED;
+
+    return c->state;
+}
+
+/* Rewrites an end of the reply tuple, so that replies to a translated
+ * packet still match the connection */
+static int ct_nat(struct pico_frame *f, int dnat, struct pico_ip4 *addr, uint16_t port)
+{
+    struct pico_conn *c = pico_conntrack_get(f);
+    struct pico_conn_tuple *r;
+
+    if (!c) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    /* replies are translated back on the mapping of the original direction */
+    if (f->conn_dir != PICO_CT_DIR_ORIGINAL)
+        return 0;
+
+    r = &c->tuple[PICO_CT_DIR_REPLY];
+    ct_node_unlink(&c->node[PICO_CT_DIR_REPLY]);
+    if (dnat) {
+        r->src = *addr;
+        r->sport = port;
+    } else {
+        r->dst = *addr;
+        r->dport = port;
+    }
+
+    ct_node_link(&c->node[PICO_CT_DIR_REPLY]);
+    return 0;
+}
+
+/* Source of the packet translated to addr:port, call after pico_conntrack_get() */
+int pico_conntrack_snat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port)
+{
+    return ct_nat(f, 0, addr, port);
+}
+
+/* Destination of the packet translated to addr:port, call after pico_conntrack_get() */
+int pico_conntrack_dnat(struct pico_frame *f, struct pico_ip4 *addr, uint16_t port)
+{
+    return ct_nat(f, 1, addr, port);
+}
+
+uint32_t pico_conntrack_count(void)
+{
+    return ct_table.count;
+}
+
+/* Frames still holding a connection must not be in flight: this is the
+ * only place where connections go back to the heap */
+void pico_conntrack_flush(void)
+{
+    struct pico_conn *c;
+    uint32_t i;
+
+    for (i = 0; i < ct_table.size; i++) {
+        while (ct_table.buckets[i])
+            ct_free(ct_table.buckets[i]->conn);
+    }
+    while ((c = ct_table.spare) != NULL) {
+        ct_table.spare = (struct pico_conn *)c->node[PICO_CT_DIR_ORIGINAL].next;
+        PICO_FREE(c);
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,211 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_device.h"
+#include "pico_stack.h"
+#include "pico_eth.h"
+#include "pico_hotplug_detection.h"
+#include "pico_dev_bond.h"
+
+#ifdef PICO_SUPPORT_BOND
+
+/* A bond is an ethernet device of its own, owning the link addresses,
+ * that transmits on one of its member devices and receives on all of them.
+ * The members must accept the frames sent to the MAC address of the bond.
+ *
+ * Members whose driver reports the link state are followed by the hotplug
+ * detection: a member going down leaves the set of active members, and the
+ * flows it was carrying move to the others. The flows of the members that
+ * stay up are not moved, so a flow is never reordered by a failover
+ * elsewhere. */
+#ifndef PICO_BOND_MAX_MEMBERS
+# define PICO_BOND_MAX_MEMBERS 8
+#endif
+
+struct pico_bond_member {
+    struct pico_device *dev;
+    int up;
+};
+
+struct pico_bond {
+    struct pico_device dev;   /* must be first */
+    struct pico_bond_member member[PICO_BOND_MAX_MEMBERS];
+    uint8_t active[PICO_BOND_MAX_MEMBERS]; /* indexes of the members up */
+    uint8_t members;
+    uint8_t n_active;
+    uint8_t mode;
+    uint32_t rr;
+};
+
+static void pico_bond_update(struct pico_bond *bond)
+{
+    uint8_t i;
+
+    bond->n_active = 0;
+    for (i = 0; i < bond->members; i++) {
+        if (bond->member[i].up)
+            bond->active[bond->n_active++] = i;
+    }
+}
+
+static int pico_bond_send(struct pico_device *dev, void *buf, int len)
+{
+    struct pico_bond *bond = (struct pico_bond *)dev;
+    struct pico_device *member;
+    uint32_t h;
+
+    if (bond->n_active == 0)
+        return len; /* all links down: drop rather than stall the queue */
+
+    if (bond->mode == PICO_BOND_MODE_ROUNDROBIN) {
+        member = bond->member[bond->active[bond->rr++ % bond->n_active]].dev;
+    } else {
+        h = pico_flow_hash((uint8_t *)buf, (uint32_t)len, 1);
+        member = bond->member[h % bond->members].dev;
+        if (!bond->member[h % bond->members].up)
+            member = bond->member[bond->active[h % bond->n_active]].dev;
+    }
+
+    return member->send(member, buf, len);
+}
+
+static int pico_bond_link_state(struct pico_device *dev)
+{
+    return ((struct pico_bond *)dev)->n_active > 0;
+}
+
+static int pico_bond_is_bond(struct pico_device *dev)
+{
+    return dev && (dev->send == pico_bond_send);
+}
+
+static int pico_bond_find(struct pico_bond *bond, struct pico_device *member)
+{
+    int i;
+    for (i = 0; i < bond->members; i++) {
+        if (bond->member[i].dev == member)
+            return i;
+    }
+    return -1;
+}
+
+static void pico_bond_hotplug(struct pico_device *dev, int event)
+{
+    struct pico_bond *bond = (struct pico_bond *)dev->bond;
+    int i;
+
+    if (!bond)
+        return;
+
+    i = pico_bond_find(bond, dev);
+    if (i < 0)
+        return;
+
+    bond->member[i].up = (event == PICO_HOTPLUG_EVENT_UP);
+    pico_bond_update(bond);
+}
+
+int pico_bond_add_member(struct pico_device *bond, struct pico_device *member)
+{
+    struct pico_bond *b = (struct pico_bond *)bond;
+    struct pico_bond_member *m;
+
+    if (!pico_bond_is_bond(bond) || !member || !member->eth || member->bond || pico_bond_is_bond(member)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+#ifdef PICO_SUPPORT_BRIDGE
+    if (member->bridge) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+#endif
+
+    if (b->members >= PICO_BOND_MAX_MEMBERS) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    if (member->link_state && (pico_hotplug_register(member, pico_bond_hotplug) < 0))
+        return -1;
+
+    m = &b->member[b->members++];
+    m->dev = member;
+    m->up = (member->link_state) ? (member->link_state(member) == 1) : 1;
+    member->bond = bond;
+    if (member->mtu < bond->mtu)
+        bond->mtu = member->mtu;
+
+    pico_bond_update(b);
+    return 0;
+}
+
+int pico_bond_del_member(struct pico_device *bond, struct pico_device *member)
+{
+    struct pico_bond *b = (struct pico_bond *)bond;
+    int i;
+
+    if (!pico_bond_is_bond(bond) || !member || (member->bond != bond)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    i = pico_bond_find(b, member);
+    if (i >= 0) {
+        b->members--;
+        memmove(&b->member[i], &b->member[i + 1], (size_t)(b->members - i) * sizeof(struct pico_bond_member));
+    }
+
+    if (member->link_state)
+        pico_hotplug_deregister(member, pico_bond_hotplug);
+
+    member->bond = NULL;
+    pico_bond_update(b);
+    return 0;
+}
+
+static void pico_bond_destroy(struct pico_device *dev)
+{
+    struct pico_bond *bond = (struct pico_bond *)dev;
+
+    while (bond->members)
+        (void)pico_bond_del_member(dev, bond->member[0].dev);
+}
+
+struct pico_device *pico_bond_create(const char *name, uint8_t *mac, int mode)
+{
+    struct pico_bond *bond;
+
+    if (!name || !mac || ((mode != PICO_BOND_MODE_XOR) && (mode != PICO_BOND_MODE_ROUNDROBIN))) {
+        pico_err = PICO_ERR_EINVAL;
+        return NULL;
+    }
+
+    bond = PICO_ZALLOC(sizeof(struct pico_bond));
+    if (!bond) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    bond->mode = (uint8_t)mode;
+    bond->dev.send = pico_bond_send;
+    bond->dev.link_state = pico_bond_link_state;
+    bond->dev.destroy = pico_bond_destroy;
+    if (pico_device_init(&bond->dev, name, mac) != 0) {
+        dbg("Bond init failed.\n");
+        pico_device_destroy(&bond->dev);
+        return NULL;
+    }
+
+    dbg("Device %s created.\n", bond->dev.name);
+    return &bond->dev;
+}
+
+#endif
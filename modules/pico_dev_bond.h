@@ -0,0 +1,19 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_BOND
+#define INCLUDE_PICO_BOND
+#include "pico_config.h"
+#include "pico_device.h"
+
+/* Transmit policies */
+#define PICO_BOND_MODE_XOR        0 /* one member per flow, chosen by an L3/L4 hash */
+#define PICO_BOND_MODE_ROUNDROBIN 1 /* members in turn, frame by frame */
+
+struct pico_device *pico_bond_create(const char *name, uint8_t *mac, int mode);
+int pico_bond_add_member(struct pico_device *bond, struct pico_device *member);
+int pico_bond_del_member(struct pico_device *bond, struct pico_device *member);
+
+#endif
@@ -0,0 +1,365 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_device.h"
+#include "pico_stack.h"
+#include "pico_frame.h"
+#include "pico_eth.h"
+#include "pico_dev_bridge.h"
+
+#ifdef PICO_SUPPORT_BRIDGE
+
+#define bridge_dbg(...) do {} while(0)
+
+/* A bridge is an ethernet device of its own, that the stack uses like any
+ * other, switching frames between its member devices (ports).
+ * Frames received on a port never enter the IP layer unless they are meant
+ * for the bridge itself: they are queued on the output queue of the port
+ * they leave from. Flooded frames share the buffer of the received one.
+ *
+ * Source addresses are learned in a hash table of PICO_BRIDGE_FDB_HASH
+ * chains. An address not seen for PICO_BRIDGE_AGEING is forgotten; a timer
+ * sweeps 1/PICO_BRIDGE_SWEEP_SLICES of the chains each interval. */
+#ifndef PICO_BRIDGE_FDB_HASH
+# define PICO_BRIDGE_FDB_HASH      256u  /* power of two */
+#endif
+#ifndef PICO_BRIDGE_FDB_MAX
+# define PICO_BRIDGE_FDB_MAX       1024u
+#endif
+#ifndef PICO_BRIDGE_AGEING
+# define PICO_BRIDGE_AGEING        300000u /* msec, 802.1D default */
+#endif
+#define PICO_BRIDGE_SWEEP_INTERVAL 1000u   /* msec */
+#define PICO_BRIDGE_SWEEP_SLICES   16u
+
+struct pico_bridge_fdb {
+    uint8_t mac[PICO_SIZE_ETH];
+    struct pico_device *port;
+    pico_time seen;
+    struct pico_bridge_fdb *next;
+};
+
+struct pico_bridge_port {
+    struct pico_device *dev;
+    struct pico_bridge_port *next;
+};
+
+struct pico_bridge {
+    struct pico_device dev;   /* must be first */
+    struct pico_bridge_port *ports;
+    struct pico_bridge_fdb *fdb[PICO_BRIDGE_FDB_HASH];
+    uint32_t fdb_count;
+    uint32_t sweep;           /* next chain to sweep */
+    uint32_t timer;
+};
+
+static inline uint32_t pico_bridge_hash(const uint8_t *mac)
+{
+    uint32_t h = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+    h ^= ((uint32_t)mac[0] << 8) | mac[1];
+    h *= 0x9E3779B1u;
+    return (h >> 16) & (PICO_BRIDGE_FDB_HASH - 1u);
+}
+
+static inline int pico_bridge_fdb_aged(struct pico_bridge_fdb *e, pico_time now)
+{
+    return (e->seen + PICO_BRIDGE_AGEING) <= now;
+}
+
+/* Drops the entries of a chain that are aged, or that point to port if not NULL */
+static void pico_bridge_fdb_flush(struct pico_bridge *br, uint32_t idx, struct pico_device *port, pico_time now)
+{
+    struct pico_bridge_fdb **pp = &br->fdb[idx], *e;
+
+    while (*pp) {
+        e = *pp;
+        if ((port && (e->port == port)) || (!port && pico_bridge_fdb_aged(e, now))) {
+            *pp = e->next;
+            PICO_FREE(e);
+            br->fdb_count--;
+        } else {
+            pp = &e->next;
+        }
+    }
+}
+
+static struct pico_device *pico_bridge_fdb_find(struct pico_bridge *br, const uint8_t *mac)
+{
+    struct pico_bridge_fdb *e;
+
+    for (e = br->fdb[pico_bridge_hash(mac)]; e; e = e->next) {
+        if (memcmp(e->mac, mac, PICO_SIZE_ETH) == 0)
+            return pico_bridge_fdb_aged(e, pico_tick) ? NULL : e->port;
+    }
+    return NULL;
+}
+
+static void pico_bridge_fdb_learn(struct pico_bridge *br, const uint8_t *mac, struct pico_device *port)
+{
+    uint32_t idx = pico_bridge_hash(mac);
+    struct pico_bridge_fdb *e;
+
+    for (e = br->fdb[idx]; e; e = e->next) {
+        if (memcmp(e->mac, mac, PICO_SIZE_ETH) == 0) {
+            e->port = port; /* the station may have moved */
+            e->seen = pico_tick;
+            return;
+        }
+    }
+
+    if (br->fdb_count >= PICO_BRIDGE_FDB_MAX) {
+        pico_bridge_fdb_flush(br, idx, NULL, pico_tick);
+        if (br->fdb_count >= PICO_BRIDGE_FDB_MAX)
+            return; /* keep flooding to this station */
+    }
+
+    e = PICO_ZALLOC(sizeof(struct pico_bridge_fdb));
+    if (!e)
+        return;
+
+    memcpy(e->mac, mac, PICO_SIZE_ETH);
+    e->port = port;
+    e->seen = pico_tick;
+    e->next = br->fdb[idx];
+    br->fdb[idx] = e;
+    br->fdb_count++;
+}
+
+static void pico_bridge_sweep(pico_time now, void *arg)
+{
+    struct pico_bridge *br = (struct pico_bridge *)arg;
+    uint32_t n = PICO_BRIDGE_FDB_HASH / PICO_BRIDGE_SWEEP_SLICES;
+
+    while (n--) {
+        pico_bridge_fdb_flush(br, br->sweep, NULL, now);
+        br->sweep = (br->sweep + 1u) & (PICO_BRIDGE_FDB_HASH - 1u);
+    }
+    br->timer = pico_timer_add(PICO_BRIDGE_SWEEP_INTERVAL, pico_bridge_sweep, br);
+}
+
+/* The frame leaves as it is, see devloop_sendto_dev() */
+static int pico_bridge_forward(struct pico_frame *f, struct pico_device *port)
+{
+    f->dev = port;
+    f->flags |= PICO_FRAME_FLAG_BRIDGED;
+    if (pico_enqueue(port->q_out, f) < 0) {
+        bridge_dbg("Bridge: %s output queue full\n", port->name);
+        pico_frame_discard(f);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Every port but the input one gets a reference to the frame, the last one the frame itself */
+static void pico_bridge_flood(struct pico_bridge *br, struct pico_frame *f, struct pico_device *in)
+{
+    struct pico_bridge_port *p;
+    struct pico_device *last = NULL;
+    struct pico_frame *ref;
+
+    for (p = br->ports; p; p = p->next) {
+        if (p->dev == in)
+            continue;
+
+        if (last) {
+            ref = pico_frame_copy(f);
+            if (ref)
+                (void)pico_bridge_forward(ref, last);
+        }
+
+        last = p->dev;
+    }
+    if (last)
+        (void)pico_bridge_forward(f, last);
+    else
+        pico_frame_discard(f);
+}
+
+static void pico_bridge_local(struct pico_bridge *br, struct pico_frame *f)
+{
+    f->dev = &br->dev;
+    (void)pico_ethernet_receive(f);
+}
+
+int pico_bridge_receive(struct pico_frame *f)
+{
+    struct pico_bridge *br = (struct pico_bridge *)f->dev->bridge;
+    struct pico_device *in = f->dev, *port;
+    struct pico_eth_hdr *hdr = (struct pico_eth_hdr *)f->datalink_hdr;
+    struct pico_frame *local;
+
+    if (!br || (f->len < PICO_SIZE_ETHHDR)) {
+        pico_frame_discard(f);
+        return -1;
+    }
+
+    if (!(hdr->saddr[0] & 0x01u))
+        pico_bridge_fdb_learn(br, hdr->saddr, in);
+
+    if (hdr->daddr[0] & 0x01u) {
+        /* Broadcast and multicast go to the bridge too. The stack may answer
+         * in place (ARP), so it gets a copy of its own. */
+        local = pico_frame_deepcopy(f);
+        pico_bridge_flood(br, f, in);
+        if (local)
+            pico_bridge_local(br, local);
+
+        return 0;
+    }
+
+    if (memcmp(hdr->daddr, br->dev.eth->mac.addr, PICO_SIZE_ETH) == 0) {
+        pico_bridge_local(br, f);
+        return 0;
+    }
+
+    port = pico_bridge_fdb_find(br, hdr->daddr);
+    if (!port) {
+        pico_bridge_flood(br, f, in);
+        return 0;
+    }
+
+    if (port == in) {
+        /* both stations are on the same segment */
+        pico_frame_discard(f);
+        return 0;
+    }
+
+    return pico_bridge_forward(f, port);
+}
+
+/* Frames sent by the stack through the bridge */
+static int pico_bridge_send(struct pico_device *dev, void *buf, int len)
+{
+    struct pico_bridge *br = (struct pico_bridge *)dev;
+    struct pico_eth_hdr *hdr = (struct pico_eth_hdr *)buf;
+    struct pico_bridge_port *p;
+    struct pico_device *port = NULL;
+
+    if (!(hdr->daddr[0] & 0x01u))
+        port = pico_bridge_fdb_find(br, hdr->daddr);
+
+    if (port)
+        return port->send(port, buf, len);
+
+    for (p = br->ports; p; p = p->next)
+        (void)p->dev->send(p->dev, buf, len);
+    return len;
+}
+
+static int pico_bridge_is_bridge(struct pico_device *dev)
+{
+    return dev && (dev->send == pico_bridge_send);
+}
+
+int pico_bridge_add_port(struct pico_device *bridge, struct pico_device *port)
+{
+    struct pico_bridge *br = (struct pico_bridge *)bridge;
+    struct pico_bridge_port *p;
+
+    if (!pico_bridge_is_bridge(bridge) || !port || !port->eth || port->bridge || pico_bridge_is_bridge(port)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+#ifdef PICO_SUPPORT_BOND
+    if (port->bond) {
+        pico_err = PICO_ERR_EINVAL; /* the bond is the port */
+        return -1;
+    }
+#endif
+
+    p = PICO_ZALLOC(sizeof(struct pico_bridge_port));
+    if (!p) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    p->dev = port;
+    p->next = br->ports;
+    br->ports = p;
+    port->bridge = bridge;
+    if (port->mtu < bridge->mtu)
+        bridge->mtu = port->mtu;
+
+    return 0;
+}
+
+int pico_bridge_del_port(struct pico_device *bridge, struct pico_device *port)
+{
+    struct pico_bridge *br = (struct pico_bridge *)bridge;
+    struct pico_bridge_port **pp, *p;
+    uint32_t i;
+
+    if (!pico_bridge_is_bridge(bridge) || !port || (port->bridge != bridge)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    for (pp = &br->ports; *pp; pp = &(*pp)->next) {
+        if ((*pp)->dev == port) {
+            p = *pp;
+            *pp = p->next;
+            PICO_FREE(p);
+            break;
+        }
+    }
+    for (i = 0; i < PICO_BRIDGE_FDB_HASH; i++)
+        pico_bridge_fdb_flush(br, i, port, 0);
+    port->bridge = NULL;
+    return 0;
+}
+
+static void pico_bridge_destroy(struct pico_device *dev)
+{
+    struct pico_bridge *br = (struct pico_bridge *)dev;
+    struct pico_bridge_fdb *e;
+    uint32_t i;
+
+    while (br->ports)
+        (void)pico_bridge_del_port(dev, br->ports->dev);
+    for (i = 0; i < PICO_BRIDGE_FDB_HASH; i++) {
+        while ((e = br->fdb[i]) != NULL) {
+            br->fdb[i] = e->next;
+            PICO_FREE(e);
+        }
+    }
+    br->fdb_count = 0;
+    pico_timer_cancel(br->timer);
+}
+
+struct pico_device *pico_bridge_create(const char *name, uint8_t *mac)
+{
+    struct pico_bridge *br;
+
+    if (!name || !mac) {
+        pico_err = PICO_ERR_EINVAL;
+        return NULL;
+    }
+
+    br = PICO_ZALLOC(sizeof(struct pico_bridge));
+    if (!br) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    br->dev.send = pico_bridge_send;
+    br->dev.destroy = pico_bridge_destroy;
+    if (pico_device_init(&br->dev, name, mac) != 0) {
+        dbg("Bridge init failed.\n");
+        pico_device_destroy(&br->dev);
+        return NULL;
+    }
+
+    br->timer = pico_timer_add(PICO_BRIDGE_SWEEP_INTERVAL, pico_bridge_sweep, br);
+    dbg("Device %s created.\n", br->dev.name);
+    return &br->dev;
+}
+
+#endif
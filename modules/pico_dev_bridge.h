@@ -0,0 +1,18 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_BRIDGE
+#define INCLUDE_PICO_BRIDGE
+#include "pico_config.h"
+#include "pico_device.h"
+
+struct pico_device *pico_bridge_create(const char *name, uint8_t *mac);
+int pico_bridge_add_port(struct pico_device *bridge, struct pico_device *port);
+int pico_bridge_del_port(struct pico_device *bridge, struct pico_device *port);
+
+/* Entry point for the frames received on a port, called by the device loop */
+int pico_bridge_receive(struct pico_frame *f);
+
+#endif
@@ -12,8 +12,8 @@
 
 
 #define LOOP_MTU 1500
-static uint8_t l_buf[LOOP_MTU];
-static int l_bufsize = 0;
+static PICO_TLS uint8_t l_buf[LOOP_MTU];
+static PICO_TLS int l_bufsize = 0;
 
 
 static int pico_loop_send(struct pico_device *dev, void *buf, int len)
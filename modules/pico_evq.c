@@ -0,0 +1,367 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_socket.h"
+#include "pico_tree.h"
+#include "pico_tcp.h"
+#include "pico_evq.h"
+
+#ifdef PICO_SUPPORT_EVQ
+
+/* Readiness notification for many sockets at once. A registered socket has
+ * its wakeup callback replaced by pico_evq_wakeup, which merges the events
+ * into the entry of the socket and links the entry on the ready list of its
+ * queue, once, however many events arrive before the next pico_evq_wait.
+ * pico_evq_wait then only visits the sockets that have something to report.
+ *
+ * In level mode, the readiness is checked again when the entry is taken
+ * off the ready list, and an entry still ready after being reported goes
+ * back to its tail, so that a socket that is not drained keeps being
+ * reported without starving the others. */
+
+/* Always reported, as EPOLLERR and EPOLLHUP */
+#define PICO_EVQ_ALWAYS (PICO_SOCK_EV_ERR | PICO_SOCK_EV_CLOSE)
+
+struct pico_evq_entry {
+    struct pico_evq *q;
+    struct pico_socket *s;
+    void (*wakeup)(uint16_t ev, struct pico_socket *s); /* the one replaced */
+    void *data;
+    uint16_t interest;
+    uint16_t pending;
+    uint8_t flags;
+    uint8_t queued;
+    struct pico_evq_entry *prev, *next;     /* registered on q */
+    struct pico_evq_entry *rprev, *rnext;   /* ready list of q */
+};
+
+struct pico_evq {
+    struct pico_evq_entry *entries;
+    struct pico_evq_entry *ready, *ready_tail;
+    uint32_t n_ready;
+};
+
+static void pico_evq_ready_add(struct pico_evq_entry *e)
+{
+    struct pico_evq *q = e->q;
+
+    if (e->queued)
+        return;
+
+    e->queued = 1;
+    e->rnext = NULL;
+    e->rprev = q->ready_tail;
+    if (q->ready_tail)
+        q->ready_tail->rnext = e;
+    else
+        q->ready = e;
+
+    q->ready_tail = e;
+    q->n_ready++;
+}
+
+static void pico_evq_ready_del(struct pico_evq_entry *e)
+{
+    struct pico_evq *q = e->q;
+
+    if (!e->queued)
+        return;
+
+    if (e->rprev)
+        e->rprev->rnext = e->rnext;
+    else
+        q->ready = e->rnext;
+
+    if (e->rnext)
+        e->rnext->rprev = e->rprev;
+    else
+        q->ready_tail = e->rprev;
+
+    e->queued = 0;
+    q->n_ready--;
+}
+
+#ifdef PICO_SUPPORT_TCP
+static int pico_evq_tcp_acceptable(struct pico_socket *s)
+{
+    struct pico_sockport *sp = pico_get_sockport(PICO_PROTO_TCP, s->local_port);
+    struct pico_tree_node *index;
+    struct pico_socket *child;
+
+    if (!sp)
+        return 0;
+
+    pico_tree_foreach(index, &sp->socks) {
+        child = index->keyValue;
+        if ((child->parent == s) && ((TCPSTATE(child) == PICO_SOCKET_STATE_TCP_ESTABLISHED) || pico_tcp_fastopen_accepted(child)))
+            return 1;
+    }
+    return 0;
+}
+#endif
+
+/* Current readiness of s, used on registration and by the level mode */
+static uint16_t pico_evq_probe(struct pico_socket *s)
+{
+    uint16_t ev = 0;
+
+#ifdef PICO_SUPPORT_UDP
+    if (s->proto->proto_number == PICO_PROTO_UDP) {
+        if (s->q_in.frames > 0)
+            ev |= PICO_SOCK_EV_RD;
+
+        ev |= PICO_SOCK_EV_WR;
+    }
+
+#endif
+#ifdef PICO_SUPPORT_TCP
+    if (s->proto->proto_number == PICO_PROTO_TCP) {
+        if (TCPSTATE(s) == PICO_SOCKET_STATE_TCP_LISTEN)
+            return pico_evq_tcp_acceptable(s) ? PICO_SOCK_EV_CONN : 0;
+
+        if (!pico_tcp_queue_in_is_empty(s) || (s->state & PICO_SOCKET_STATE_SHUT_REMOTE))
+            ev |= PICO_SOCK_EV_RD;
+
+        if (((TCPSTATE(s) == PICO_SOCKET_STATE_TCP_ESTABLISHED) || (TCPSTATE(s) == PICO_SOCKET_STATE_TCP_CLOSE_WAIT)) &&
+            !pico_tcp_queue_out_is_full(s))
+            ev |= PICO_SOCK_EV_WR;
+    }
+
+#endif
+    return ev;
+}
+
+/* Events whose pending state pico_evq_probe tells */
+static uint16_t pico_evq_probed(struct pico_socket *s)
+{
+#ifdef PICO_SUPPORT_TCP
+    if ((s->proto->proto_number == PICO_PROTO_TCP) && (TCPSTATE(s) == PICO_SOCKET_STATE_TCP_LISTEN))
+        return PICO_SOCK_EV_CONN;
+
+#else
+    IGNORE_PARAMETER(s);
+#endif
+    return PICO_SOCK_EV_RD | PICO_SOCK_EV_WR;
+}
+
+static void pico_evq_wakeup(uint16_t ev, struct pico_socket *s)
+{
+    struct pico_evq_entry *e = s->evq;
+
+    /* connections not accepted yet inherit the callback of their listener */
+    if (!e)
+        return;
+
+    ev &= (uint16_t)(e->interest | PICO_EVQ_ALWAYS);
+    if (!ev)
+        return;
+
+    e->pending |= ev;
+    pico_evq_ready_add(e);
+}
+
+/* A socket created by a registered listener inherits pico_evq_wakeup without
+ * being registered itself: give it the callback the listener had before. */
+void pico_evq_socket_accepted(struct pico_socket *s, struct pico_socket *listener)
+{
+    if (s->evq || (s->wakeup != pico_evq_wakeup))
+        return;
+
+    if (!listener)
+        s->wakeup = NULL;
+    else if (listener->evq)
+        s->wakeup = listener->evq->wakeup;
+    else
+        s->wakeup = listener->wakeup;
+}
+
+static void pico_evq_arm(struct pico_evq_entry *e, uint16_t events, uint8_t flags, void *data)
+{
+    uint16_t ev;
+
+    e->interest = events;
+    e->flags = flags;
+    e->data = data;
+    e->pending &= (uint16_t)(events | PICO_EVQ_ALWAYS);
+
+    ev = (uint16_t)(pico_evq_probe(e->s) & events);
+    if (ev) {
+        e->pending |= ev;
+        pico_evq_ready_add(e);
+    } else if (!e->pending) {
+        pico_evq_ready_del(e);
+    }
+}
+
+static void pico_evq_release(struct pico_evq_entry *e)
+{
+    struct pico_evq *q = e->q;
+
+    pico_evq_ready_del(e);
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        q->entries = e->next;
+
+    if (e->next)
+        e->next->prev = e->prev;
+
+    e->s->wakeup = e->wakeup;
+    e->s->evq = NULL;
+    PICO_FREE(e);
+}
+
+struct pico_evq *pico_evq_create(void)
+{
+    struct pico_evq *q = PICO_ZALLOC(sizeof(struct pico_evq));
+
+    if (!q) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    return q;
+}
+
+void pico_evq_destroy(struct pico_evq *q)
+{
+    if (!q)
+        return;
+
+    while (q->entries)
+        pico_evq_release(q->entries);
+    PICO_FREE(q);
+}
+
+int pico_evq_add(struct pico_evq *q, struct pico_socket *s, uint16_t events, uint8_t flags, void *data)
+{
+    struct pico_evq_entry *e;
+
+    if (!q || !s || (flags & (uint8_t)~(PICO_EVQ_EDGE | PICO_EVQ_ONESHOT))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (s->evq) {
+        pico_err = PICO_ERR_EEXIST;
+        return -1;
+    }
+
+    e = PICO_ZALLOC(sizeof(struct pico_evq_entry));
+    if (!e) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+#ifdef PICO_SUPPORT_TCP
+    pico_evq_socket_accepted(s, s->parent);
+#endif
+    e->q = q;
+    e->s = s;
+    e->wakeup = s->wakeup;
+    e->next = q->entries;
+    if (q->entries)
+        q->entries->prev = e;
+
+    q->entries = e;
+    s->evq = e;
+    s->wakeup = pico_evq_wakeup;
+    pico_evq_arm(e, events, flags, data);
+    return 0;
+}
+
+int pico_evq_mod(struct pico_evq *q, struct pico_socket *s, uint16_t events, uint8_t flags, void *data)
+{
+    if (!q || !s || (flags & (uint8_t)~(PICO_EVQ_EDGE | PICO_EVQ_ONESHOT))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (!s->evq || (s->evq->q != q)) {
+        pico_err = PICO_ERR_ENOENT;
+        return -1;
+    }
+
+    pico_evq_arm(s->evq, events, flags, data);
+    return 0;
+}
+
+int pico_evq_del(struct pico_evq *q, struct pico_socket *s)
+{
+    if (!q || !s) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (!s->evq || (s->evq->q != q)) {
+        pico_err = PICO_ERR_ENOENT;
+        return -1;
+    }
+
+    pico_evq_release(s->evq);
+    return 0;
+}
+
+void pico_evq_socket_gone(struct pico_socket *s)
+{
+    if (s->evq)
+        pico_evq_release(s->evq);
+}
+
+/* Fills ev with up to max events and returns how many. Never blocks: the
+ * caller runs pico_stack_tick between two calls. Each socket appears once
+ * per call, with all the events received since it was last reported. */
+int pico_evq_wait(struct pico_evq *q, struct pico_evq_event *ev, int max)
+{
+    struct pico_evq_entry *e;
+    uint32_t todo;
+    uint16_t events, still;
+    int n = 0;
+
+    if (!q || !ev || (max <= 0)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    /* entries requeued by the level mode wait for the next call */
+    todo = q->n_ready;
+    while (todo-- && (n < max)) {
+        e = q->ready;
+        pico_evq_ready_del(e);
+        events = (uint16_t)(e->pending & (e->interest | PICO_EVQ_ALWAYS));
+        if (!(e->flags & PICO_EVQ_EDGE)) {
+            /* the socket may have been drained since it was queued */
+            events &= (uint16_t)~pico_evq_probed(e->s);
+            events |= (uint16_t)(pico_evq_probe(e->s) & e->interest);
+        }
+
+        e->pending = 0;
+        if (!events)
+            continue;
+
+        ev[n].s = e->s;
+        ev[n].data = e->data;
+        ev[n].events = events;
+        n++;
+
+        if (e->flags & PICO_EVQ_ONESHOT) {
+            e->interest = 0;
+        } else if (!(e->flags & PICO_EVQ_EDGE)) {
+            still = (uint16_t)(pico_evq_probe(e->s) & e->interest);
+            if (still) {
+                e->pending = still;
+                pico_evq_ready_add(e);
+            }
+        }
+    }
+    return n;
+}
+
+#endif
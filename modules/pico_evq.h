@@ -0,0 +1,36 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_EVQ
+#define INCLUDE_PICO_EVQ
+#include "pico_config.h"
+#include "pico_socket.h"
+
+/* Registration flags */
+#define PICO_EVQ_LEVEL   0x00u /* reported again while the socket stays ready */
+#define PICO_EVQ_EDGE    0x01u /* reported once per change of readiness */
+#define PICO_EVQ_ONESHOT 0x02u /* interest cleared once reported, re-armed by pico_evq_mod */
+
+struct pico_evq;
+
+struct pico_evq_event {
+    struct pico_socket *s;
+    void *data;          /* as given at registration */
+    uint16_t events;     /* PICO_SOCK_EV_* */
+};
+
+struct pico_evq *pico_evq_create(void);
+void pico_evq_destroy(struct pico_evq *q);
+int pico_evq_add(struct pico_evq *q, struct pico_socket *s, uint16_t events, uint8_t flags, void *data);
+int pico_evq_mod(struct pico_evq *q, struct pico_socket *s, uint16_t events, uint8_t flags, void *data);
+int pico_evq_del(struct pico_evq *q, struct pico_socket *s);
+int pico_evq_wait(struct pico_evq *q, struct pico_evq_event *ev, int max);
+
+/* Called by the socket layer when a registered socket goes away */
+void pico_evq_socket_gone(struct pico_socket *s);
+/* Called by the socket layer when a connection is taken from its listener */
+void pico_evq_socket_accepted(struct pico_socket *s, struct pico_socket *listener);
+
+#endif
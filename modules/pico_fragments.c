@@ -59,8 +59,8 @@ static void pico_fragments_complete(unsigned int bookmark, uint8_t proto, uint8_
 static int pico_fragments_check_complete(uint8_t proto, uint8_t net);
 
 #if defined(PICO_SUPPORT_IPV6) && defined(PICO_SUPPORT_IPV6FRAG)
-static uint32_t ipv6_cur_frag_id = 0u;
-uint32_t ipv6_fragments_timer = 0u;
+static PICO_TLS uint32_t ipv6_cur_frag_id = 0u;
+PICO_TLS uint32_t ipv6_fragments_timer = 0u;
 
 static int pico_ipv6_frag_compare(void *ka, void *kb)
 {
@@ -73,7 +73,7 @@ static int pico_ipv6_frag_compare(void *ka, void *kb)
 
     return 0;
 }
-PICO_TREE_DECLARE(ipv6_fragments, pico_ipv6_frag_compare);
+PICO_TLS PICO_TREE_DECLARE(ipv6_fragments, pico_ipv6_frag_compare);
 
 static void pico_ipv6_fragments_complete(unsigned int len, uint8_t proto)
 {
@@ -134,8 +134,8 @@ static int pico_ipv6_frag_match(struct pico_frame *a, struct pico_frame *b)
 #endif
 
 #if defined(PICO_SUPPORT_IPV4) && defined(PICO_SUPPORT_IPV4FRAG)
-static uint32_t ipv4_cur_frag_id = 0u;
-uint32_t ipv4_fragments_timer = 0u;
+static PICO_TLS uint32_t ipv4_cur_frag_id = 0u;
+PICO_TLS uint32_t ipv4_fragments_timer = 0u;
 
 static int pico_ipv4_frag_compare(void *ka, void *kb)
 {
@@ -148,7 +148,7 @@ static int pico_ipv4_frag_compare(void *ka, void *kb)
 
     return 0;
 }
-PICO_TREE_DECLARE(ipv4_fragments, pico_ipv4_frag_compare);
+PICO_TLS PICO_TREE_DECLARE(ipv4_fragments, pico_ipv4_frag_compare);
 
 static void pico_ipv4_fragments_complete(unsigned int len, uint8_t proto)
 {
@@ -15,7 +15,7 @@ struct pico_hotplug_device{
   struct pico_tree callbacks;
 };
 
-uint32_t timer_id = 0;
+PICO_TLS uint32_t timer_id = 0;
 
 static int pico_hotplug_dev_cmp(void *ka, void *kb)
 {
@@ -38,7 +38,7 @@ static int callback_compare(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(Hotplug_device_tree, pico_hotplug_dev_cmp);
+PICO_TLS PICO_TREE_DECLARE(Hotplug_device_tree, pico_hotplug_dev_cmp);
 
 static void timer_cb(__attribute__((unused)) pico_time t, __attribute__((unused)) void* v)
 {
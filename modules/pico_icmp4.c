@@ -16,12 +16,16 @@
 #include "pico_stack.h"
 #include "pico_tree.h"
 
-/* Queues */
-static struct pico_queue icmp_in = {
-    0
-};
-static struct pico_queue icmp_out = {
-    0
+/* Errors are limited by default, echo replies on request */
+static PICO_TLS struct pico_icmp_ratelimit icmp4_ratelimit = {
+    .mask = {
+        (1u << PICO_ICMP_DEST_UNREACH) | (1u << PICO_ICMP_SOURCE_QUENCH) |
+        (1u << PICO_ICMP_TIME_EXCEEDED) | (1u << PICO_ICMP_PARAMETERPROB)
+    },
+    .interval = PICO_ICMP_RATELIMIT_INTERVAL,
+    .rate = PICO_ICMP_RATELIMIT_RATE,
+    .burst = PICO_ICMP_RATELIMIT_BURST,
+    .tokens = PICO_ICMP_RATELIMIT_BURST * 1000u
 };
 
 
@@ -47,9 +51,9 @@ static void ping_recv_reply(struct pico_frame *f);
 static int pico_icmp4_process_in(struct pico_protocol *self, struct pico_frame *f)
 {
     struct pico_icmp4_hdr *hdr = (struct pico_icmp4_hdr *) f->transport_hdr;
-    static int firstpkt = 1;
-    static uint16_t last_id = 0;
-    static uint16_t last_seq = 0;
+    static PICO_TLS int firstpkt = 1;
+    static PICO_TLS uint16_t last_id = 0;
+    static PICO_TLS uint16_t last_seq = 0;
     IGNORE_PARAMETER(self);
 
     if (hdr->type == PICO_ICMP_ECHO) {
@@ -67,6 +71,12 @@ static int pico_icmp4_process_in(struct pico_protocol *self, struct pico_frame *
         firstpkt = 0;
         last_id = hdr->hun.ih_idseq.idseq_id;
         last_seq = hdr->hun.ih_idseq.idseq_seq;
+        if (!pico_icmp_ratelimit_allow(&icmp4_ratelimit, PICO_ICMP_ECHOREPLY,
+                                       (uint8_t *)&((struct pico_ipv4_hdr *)f->net_hdr)->src.addr, PICO_SIZE_IP4)) {
+            pico_frame_discard(f);
+            return 0;
+        }
+
         pico_icmp4_checksum(f);
         pico_ipv4_rebound(f);
     } else if (hdr->type == PICO_ICMP_UNREACH) {
@@ -93,14 +103,12 @@ static int pico_icmp4_process_out(struct pico_protocol *self, struct pico_frame
 }
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_icmp4 = {
+PICO_TLS struct pico_protocol pico_proto_icmp4 = {
     .name = "icmp4",
     .proto_number = PICO_PROTO_ICMP4,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_icmp4_process_in,
     .process_out = pico_icmp4_process_out,
-    .q_in = &icmp_in,
-    .q_out = &icmp_out,
 };
 
 static int pico_icmp4_notify(struct pico_frame *f, uint8_t type, uint8_t code)
@@ -125,8 +133,11 @@ static int pico_icmp4_notify(struct pico_frame *f, uint8_t type, uint8_t code)
         return -1;
     }
 
-    reply = pico_proto_ipv4.alloc(&pico_proto_ipv4, (uint16_t) (f_tot_len + PICO_ICMPHDR_UN_SIZE));
     info = (struct pico_ipv4_hdr*)(f->net_hdr);
+    if (!pico_icmp_ratelimit_allow(&icmp4_ratelimit, type, (uint8_t *)&info->src.addr, PICO_SIZE_IP4))
+        return 0; /* suppressed */
+
+    reply = pico_proto_ipv4.alloc(&pico_proto_ipv4, (uint16_t) (f_tot_len + PICO_ICMPHDR_UN_SIZE));
     hdr = (struct pico_icmp4_hdr *) reply->transport_hdr;
     hdr->type = type;
     hdr->code = code;
@@ -140,6 +151,21 @@ static int pico_icmp4_notify(struct pico_frame *f, uint8_t type, uint8_t code)
     return 0;
 }
 
+int pico_icmp4_ratelimit(uint32_t interval, uint32_t rate, uint32_t burst)
+{
+    return pico_icmp_ratelimit_set(&icmp4_ratelimit, interval, rate, burst);
+}
+
+void pico_icmp4_ratemask(uint8_t type, int limited)
+{
+    pico_icmp_ratelimit_type(&icmp4_ratelimit, type, limited);
+}
+
+void pico_icmp4_ratelimit_stats(struct pico_icmp_ratelimit_stats *stats)
+{
+    *stats = icmp4_ratelimit.stats;
+}
+
 int pico_icmp4_port_unreachable(struct pico_frame *f)
 {
     /*Parameter check executed in pico_icmp4_notify*/
@@ -225,7 +251,7 @@ static int cookie_compare(void *ka, void *kb)
     return (a->seq - b->seq);
 }
 
-PICO_TREE_DECLARE(Pings, cookie_compare);
+PICO_TLS PICO_TREE_DECLARE(Pings, cookie_compare);
 
 static int8_t pico_icmp4_send_echo(struct pico_icmp4_ping_cookie *cookie)
 {
@@ -336,7 +362,7 @@ static void ping_recv_reply(struct pico_frame *f)
 
 int pico_icmp4_ping(char *dst, int count, int interval, int timeout, int size, void (*cb)(struct pico_icmp4_stats *))
 {
-    static uint16_t next_id = 0x91c0;
+    static PICO_TLS uint16_t next_id = 0x91c0;
     struct pico_icmp4_ping_cookie *cookie;
 
     if((dst == NULL) || (interval == 0) || (timeout == 0) || (count == 0)) {
@@ -10,9 +10,10 @@
 #include "pico_defines.h"
 #include "pico_addressing.h"
 #include "pico_protocol.h"
+#include "pico_icmp_ratelimit.h"
 
 
-extern struct pico_protocol pico_proto_icmp4;
+extern PICO_TLS struct pico_protocol pico_proto_icmp4;
 
 PACKED_STRUCT_DEF pico_icmp4_hdr {
     uint8_t type;
@@ -144,6 +145,9 @@ int pico_icmp4_ttl_expired(struct pico_frame *f);
 int pico_icmp4_frag_expired(struct pico_frame *f);
 int pico_icmp4_ping(char *dst, int count, int interval, int timeout, int size, void (*cb)(struct pico_icmp4_stats *));
 int pico_icmp4_ping_abort(int id);
+int pico_icmp4_ratelimit(uint32_t interval, uint32_t rate, uint32_t burst);
+void pico_icmp4_ratemask(uint8_t type, int limited);
+void pico_icmp4_ratelimit_stats(struct pico_icmp_ratelimit_stats *stats);
 
 #ifdef PICO_SUPPORT_ICMP4
 int pico_icmp4_packet_filtered(struct pico_frame *f);
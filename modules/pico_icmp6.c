@@ -18,8 +18,18 @@
 #include "pico_mld.h"
 #define icmp6_dbg(...) do { }while(0); 
 
-static struct pico_queue icmp6_in;
-static struct pico_queue icmp6_out;
+
+/* Errors but Packet Too Big, needed by path MTU discovery, are limited by
+ * default. Echo replies on request. */
+static PICO_TLS struct pico_icmp_ratelimit icmp6_ratelimit = {
+    .mask = {
+        0xFFFFFFFFu & ~(1u << PICO_ICMP6_PKT_TOO_BIG), 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu
+    },
+    .interval = PICO_ICMP_RATELIMIT_INTERVAL,
+    .rate = PICO_ICMP_RATELIMIT_RATE,
+    .burst = PICO_ICMP_RATELIMIT_BURST,
+    .tokens = PICO_ICMP_RATELIMIT_BURST * 1000u
+};
 
 uint16_t pico_icmp6_checksum(struct pico_frame *f)
 {
@@ -51,6 +61,10 @@ static int pico_icmp6_send_echoreply(struct pico_frame *echo)
     struct pico_ip6 src;
     struct pico_ip6 dst;
 
+    if (!pico_icmp_ratelimit_allow(&icmp6_ratelimit, PICO_ICMP6_ECHO_REPLY,
+                                   ((struct pico_ipv6_hdr *)echo->net_hdr)->src.addr, PICO_SIZE_IP6))
+        return 0; /* suppressed */
+
     reply = pico_proto_ipv6.alloc(&pico_proto_ipv6, (uint16_t)(echo->transport_len));
     if (!reply) {
         pico_err = PICO_ERR_ENOMEM;
@@ -127,14 +141,12 @@ static int pico_icmp6_process_out(struct pico_protocol *self, struct pico_frame
 }
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_icmp6 = {
+PICO_TLS struct pico_protocol pico_proto_icmp6 = {
     .name = "icmp6",
     .proto_number = PICO_PROTO_ICMP6,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_icmp6_process_in,
     .process_out = pico_icmp6_process_out,
-    .q_in = &icmp6_in,
-    .q_out = &icmp6_out,
 };
 
 static int pico_icmp6_notify(struct pico_frame *f, uint8_t type, uint8_t code, uint32_t ptr)
@@ -148,6 +160,9 @@ static int pico_icmp6_notify(struct pico_frame *f, uint8_t type, uint8_t code, u
         return -1;
 
     ipv6_hdr = (struct pico_ipv6_hdr *)(f->net_hdr);
+    if (!pico_icmp_ratelimit_allow(&icmp6_ratelimit, type, ipv6_hdr->src.addr, PICO_SIZE_IP6))
+        return 0; /* suppressed */
+
     len = (uint16_t)(short_be(ipv6_hdr->len) + PICO_SIZE_IP6HDR);
     switch (type)
     {
@@ -214,6 +229,21 @@ static int pico_icmp6_notify(struct pico_frame *f, uint8_t type, uint8_t code, u
     return 0;
 }
 
+int pico_icmp6_ratelimit(uint32_t interval, uint32_t rate, uint32_t burst)
+{
+    return pico_icmp_ratelimit_set(&icmp6_ratelimit, interval, rate, burst);
+}
+
+void pico_icmp6_ratemask(uint8_t type, int limited)
+{
+    pico_icmp_ratelimit_type(&icmp6_ratelimit, type, limited);
+}
+
+void pico_icmp6_ratelimit_stats(struct pico_icmp_ratelimit_stats *stats)
+{
+    *stats = icmp6_ratelimit.stats;
+}
+
 int pico_icmp6_port_unreachable(struct pico_frame *f)
 {
     struct pico_ipv6_hdr *hdr = (struct pico_ipv6_hdr *)f->net_hdr;
@@ -513,7 +543,7 @@ static int icmp6_cookie_compare(void *ka, void *kb)
 
     return (a->seq - b->seq);
 }
-PICO_TREE_DECLARE(IPV6Pings, icmp6_cookie_compare);
+PICO_TLS PICO_TREE_DECLARE(IPV6Pings, icmp6_cookie_compare);
 
 static int pico_icmp6_send_echo(struct pico_icmp6_ping_cookie *cookie)
 {
@@ -640,7 +670,7 @@ static void pico_icmp6_ping_recv_reply(struct pico_frame *f)
 
 int pico_icmp6_ping(char *dst, int count, int interval, int timeout, int size, void (*cb)(struct pico_icmp6_stats *), struct pico_device *dev)
 {
-    static uint16_t next_id = 0x91c0;
+    static PICO_TLS uint16_t next_id = 0x91c0;
     struct pico_icmp6_ping_cookie *cookie = NULL;
 
     if(!dst || !count || !interval || !timeout) {
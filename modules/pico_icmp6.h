@@ -10,6 +10,7 @@
 #include "pico_addressing.h"
 #include "pico_protocol.h"
 #include "pico_mld.h"
+#include "pico_icmp_ratelimit.h"
 /* ICMP header sizes */
 #define PICO_ICMP6HDR_DRY_SIZE          4
 #define PICO_ICMP6HDR_ECHO_REQUEST_SIZE 8
@@ -61,7 +62,9 @@
 #define PICO_PING6_ERR_PENDING         0xFFFF
 
 /* ND configuration */
-#define PICO_ND_MAX_FRAMES_QUEUED      4 /* max frames queued while awaiting address resolution */
+#ifndef PICO_ND_MAX_FRAMES_QUEUED
+#define PICO_ND_MAX_FRAMES_QUEUED      16 /* max frames queued on each neighbor awaiting address resolution */
+#endif
 
 /* ND RFC constants */
 #define PICO_ND_MAX_SOLICIT            3
@@ -99,7 +102,7 @@
 #define PICO_SIZE_ICMP6HDR ((sizeof(struct pico_icmp6_hdr)))
 #define PICO_ICMP6_OPT_LLADDR_SIZE (8)
 
-extern struct pico_protocol pico_proto_icmp6;
+extern PICO_TLS struct pico_protocol pico_proto_icmp6;
 
 PACKED_STRUCT_DEF pico_icmp6_hdr {
     uint8_t type;
@@ -236,6 +239,9 @@ struct pico_icmp6_stats
 
 int pico_icmp6_ping(char *dst, int count, int interval, int timeout, int size, void (*cb)(struct pico_icmp6_stats *), struct pico_device *dev);
 int pico_icmp6_ping_abort(int id);
+int pico_icmp6_ratelimit(uint32_t interval, uint32_t rate, uint32_t burst);
+void pico_icmp6_ratemask(uint8_t type, int limited);
+void pico_icmp6_ratelimit_stats(struct pico_icmp_ratelimit_stats *stats);
 
 int pico_icmp6_neighbor_solicitation(struct pico_device *dev, struct pico_ip6 *dst, uint8_t type);
 int pico_icmp6_neighbor_advertisement(struct pico_frame *f, struct pico_ip6 *target);
@@ -0,0 +1,128 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_protocol.h"
+#include "pico_icmp_ratelimit.h"
+
+/* Rate limits of the ICMP messages sent in response to received packets,
+ * shared by ICMPv4 and ICMPv6. Both limits are token buckets: the global
+ * one counts thousandths of a message, the destination ones count msec.
+ * Destinations are kept in a small direct mapped cache: a destination
+ * evicted by another one starts again with a full bucket, the global
+ * limit bounds what this can cost. */
+
+#define ICMP_RATELIMIT_TOKEN 1000u
+
+static uint32_t pico_icmp_ratelimit_hash(const uint8_t *dst, uint32_t len)
+{
+    uint32_t h = 2166136261u, i;
+
+    for (i = 0; i < len; i++)
+        h = (h ^ dst[i]) * 16777619u;
+    return h ? h : 1u;
+}
+
+static int pico_icmp_ratelimit_global(struct pico_icmp_ratelimit *rl, pico_time now)
+{
+    uint64_t tokens;
+    uint32_t max = rl->burst * ICMP_RATELIMIT_TOKEN;
+
+    if (!rl->rate)
+        return 1;
+
+    tokens = (uint64_t)rl->tokens + (uint64_t)(now - rl->stamp) * rl->rate;
+    rl->tokens = (tokens > max) ? max : (uint32_t)tokens;
+    rl->stamp = now;
+    if (rl->tokens < ICMP_RATELIMIT_TOKEN)
+        return 0;
+
+    rl->tokens -= ICMP_RATELIMIT_TOKEN;
+    return 1;
+}
+
+static int pico_icmp_ratelimit_dest(struct pico_icmp_ratelimit *rl, const uint8_t *dst, uint32_t len, pico_time now)
+{
+    uint32_t hash = pico_icmp_ratelimit_hash(dst, len);
+    struct pico_icmp_ratelimit_dest *d = &rl->dest[hash % PICO_ICMP_RATELIMIT_DESTS];
+    uint32_t max = rl->interval * PICO_ICMP_RATELIMIT_BURST_FACTOR;
+    uint64_t tokens;
+
+    if (!rl->interval)
+        return 1;
+
+    if (d->hash != hash) {
+        d->hash = hash;
+        d->tokens = max;
+    } else {
+        tokens = (uint64_t)d->tokens + (uint64_t)(now - d->stamp);
+        d->tokens = (tokens > max) ? max : (uint32_t)tokens;
+    }
+
+    d->stamp = now;
+    if (d->tokens < rl->interval)
+        return 0;
+
+    d->tokens -= rl->interval;
+    return 1;
+}
+
+int pico_icmp_ratelimit_allow(struct pico_icmp_ratelimit *rl, uint8_t type, const uint8_t *dst, uint32_t len)
+{
+    pico_time now;
+
+    if (!(rl->mask[type >> 5] & (1u << (type & 31u))))
+        return 1;
+
+    now = PICO_TIME_MS();
+    if (!pico_icmp_ratelimit_global(rl, now)) {
+        rl->stats.suppressed_global++;
+        return 0;
+    }
+
+    if (!pico_icmp_ratelimit_dest(rl, dst, len, now)) {
+        rl->stats.suppressed_dest++;
+        /* the message is not sent, give its token back */
+        if (rl->rate)
+            rl->tokens += ICMP_RATELIMIT_TOKEN;
+
+        return 0;
+    }
+
+    rl->stats.sent++;
+    return 1;
+}
+
+int pico_icmp_ratelimit_set(struct pico_icmp_ratelimit *rl, uint32_t interval, uint32_t rate, uint32_t burst)
+{
+    uint32_t i;
+
+    if ((rate && !burst) || (burst > (0xFFFFFFFFu / ICMP_RATELIMIT_TOKEN)) ||
+        (interval > (0xFFFFFFFFu / PICO_ICMP_RATELIMIT_BURST_FACTOR))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    rl->interval = interval;
+    rl->rate = rate;
+    rl->burst = burst;
+    rl->tokens = burst * ICMP_RATELIMIT_TOKEN;
+    rl->stamp = PICO_TIME_MS();
+    for (i = 0; i < PICO_ICMP_RATELIMIT_DESTS; i++)
+        rl->dest[i].hash = 0;
+    return 0;
+}
+
+void pico_icmp_ratelimit_type(struct pico_icmp_ratelimit *rl, uint8_t type, int limited)
+{
+    if (limited)
+        rl->mask[type >> 5] |= (1u << (type & 31u));
+    else
+        rl->mask[type >> 5] &= ~(1u << (type & 31u));
+}
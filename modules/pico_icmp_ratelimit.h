@@ -0,0 +1,64 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_ICMP_RATELIMIT
+#define INCLUDE_PICO_ICMP_RATELIMIT
+#include "pico_config.h"
+
+/* Destinations remembered by the per destination limit */
+#ifndef PICO_ICMP_RATELIMIT_DESTS
+# define PICO_ICMP_RATELIMIT_DESTS 64u
+#endif
+
+/* Defaults: as many ICMP errors as Linux sends */
+#ifndef PICO_ICMP_RATELIMIT_INTERVAL
+# define PICO_ICMP_RATELIMIT_INTERVAL 1000u /* msec, per destination */
+#endif
+#ifndef PICO_ICMP_RATELIMIT_RATE
+# define PICO_ICMP_RATELIMIT_RATE     1000u /* messages per second, all destinations */
+#endif
+#ifndef PICO_ICMP_RATELIMIT_BURST
+# define PICO_ICMP_RATELIMIT_BURST    50u
+#endif
+
+/* A destination may receive this many messages back to back */
+#define PICO_ICMP_RATELIMIT_BURST_FACTOR 6u
+
+struct pico_icmp_ratelimit_stats {
+    uint32_t sent;              /* messages of limited types sent */
+    uint32_t suppressed_global; /* dropped by the global limit */
+    uint32_t suppressed_dest;   /* dropped by the per destination limit */
+};
+
+struct pico_icmp_ratelimit_dest {
+    uint32_t hash;              /* of the destination address, 0 when free */
+    uint32_t tokens;            /* msec */
+    pico_time stamp;
+};
+
+/* Both limits apply to the ICMP types set in the mask, others are never limited.
+ * - per destination: one message every 'interval' msec, in bursts of
+ *   PICO_ICMP_RATELIMIT_BURST_FACTOR at most;
+ * - global: 'rate' messages per second, in bursts of 'burst' at most.
+ * A zero interval or rate disables the corresponding limit. */
+struct pico_icmp_ratelimit {
+    uint32_t mask[256 / 32];
+    uint32_t interval;
+    uint32_t rate;
+    uint32_t burst;
+    uint32_t tokens;            /* thousandths of a message */
+    pico_time stamp;
+    struct pico_icmp_ratelimit_dest dest[PICO_ICMP_RATELIMIT_DESTS];
+    struct pico_icmp_ratelimit_stats stats;
+};
+
+/* Returns 1 if a message of this type can be sent to dst now, 0 if it must be dropped */
+int pico_icmp_ratelimit_allow(struct pico_icmp_ratelimit *rl, uint8_t type, const uint8_t *dst, uint32_t len);
+int pico_icmp_ratelimit_set(struct pico_icmp_ratelimit *rl, uint32_t interval, uint32_t rate, uint32_t burst);
+void pico_icmp_ratelimit_type(struct pico_icmp_ratelimit *rl, uint8_t type, int limited);
+
+#endif
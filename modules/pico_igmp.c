@@ -136,14 +136,6 @@ struct igmp_timer {
     void (*callback)(struct igmp_timer *t);
 };
 
-/* queues */
-static struct pico_queue igmp_in = {
-    0
-};
-static struct pico_queue igmp_out = {
-    0
-};
-
 /* finite state machine caller */
 static int pico_igmp_process_event(struct igmp_parameters *p);
 
@@ -187,7 +179,7 @@ static int igmp_timer_cmp(void *ka, void *kb)
     return igmpt_link_compare(a, b);
 
 }
-PICO_TREE_DECLARE(IGMPTimers, igmp_timer_cmp);
+PICO_TLS PICO_TREE_DECLARE(IGMPTimers, igmp_timer_cmp);
 
 static inline int igmpparm_group_compare(struct igmp_parameters *a,  struct igmp_parameters *b)
 {
@@ -208,15 +200,15 @@ static int igmp_parameters_cmp(void *ka, void *kb)
 
     return igmpparm_link_compare(a, b);
 }
-PICO_TREE_DECLARE(IGMPParameters, igmp_parameters_cmp);
+PICO_TLS PICO_TREE_DECLARE(IGMPParameters, igmp_parameters_cmp);
 
 static int igmp_sources_cmp(void *ka, void *kb)
 {
     struct pico_ip4 *a = ka, *b = kb;
     return pico_ipv4_compare(a, b);
 }
-PICO_TREE_DECLARE(IGMPAllow, igmp_sources_cmp);
-PICO_TREE_DECLARE(IGMPBlock, igmp_sources_cmp);
+PICO_TLS PICO_TREE_DECLARE(IGMPAllow, igmp_sources_cmp);
+PICO_TLS PICO_TREE_DECLARE(IGMPBlock, igmp_sources_cmp);
 
 static struct igmp_parameters *pico_igmp_find_parameter(struct pico_ip4 *mcast_link, struct pico_ip4 *mcast_group)
 {
@@ -567,14 +559,12 @@ static int pico_igmp_process_out(struct pico_protocol *self, struct pico_frame *
 }
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_igmp = {
+PICO_TLS struct pico_protocol pico_proto_igmp = {
     .name = "igmp",
     .proto_number = PICO_PROTO_IGMP,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_igmp_process_in,
     .process_out = pico_igmp_process_out,
-    .q_in = &igmp_in,
-    .q_out = &igmp_out,
 };
 
 int pico_igmp_state_change(struct pico_ip4 *mcast_link, struct pico_ip4 *mcast_group, uint8_t filter_mode, struct pico_tree *_MCASTFilter, uint8_t state)
@@ -1233,12 +1223,6 @@ static int pico_igmp_process_event(struct igmp_parameters *p)
 }
 
 #else
-static struct pico_queue igmp_in = {
-    0
-};
-static struct pico_queue igmp_out = {
-    0
-};
 
 static int pico_igmp_process_in(struct pico_protocol *self, struct pico_frame *f) {
     IGNORE_PARAMETER(self);
@@ -1254,14 +1238,12 @@ static int pico_igmp_process_out(struct pico_protocol *self, struct pico_frame *
 }
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_igmp = {
+PICO_TLS struct pico_protocol pico_proto_igmp = {
     .name = "igmp",
     .proto_number = PICO_PROTO_IGMP,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_igmp_process_in,
     .process_out = pico_igmp_process_out,
-    .q_in = &igmp_in,
-    .q_out = &igmp_out,
 };
 
 int pico_igmp_state_change(struct pico_ip4 *mcast_link, struct pico_ip4 *mcast_group, uint8_t filter_mode, struct pico_tree *_MCASTFilter, uint8_t state) {
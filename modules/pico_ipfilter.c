@@ -24,12 +24,38 @@
 
 #define ipf_dbg(...) do {} while(0)
 
+/* Token buckets count thousandths of a packet */
+#define IPF_TOKEN       1000u
+/* Per source buckets of a rate limit: PICO_IPFILTER_RATE_SOURCES slots,
+ * in sets of IPF_RATE_WAYS where the least recently seen source is replaced */
+#ifndef PICO_IPFILTER_RATE_SOURCES
+# define PICO_IPFILTER_RATE_SOURCES 256u
+#endif
+#define IPF_RATE_WAYS   4u
+/* Connection states a rule can ask for, PICO_CT_NEW to PICO_CT_UNTRACKED */
+#define IPF_STATES      5u
+#define IPF_STATE_MASK  ((1u << IPF_STATES) - 1u)
+
 /**************** LOCAL DECLARATIONS ****************/
 struct filter_node;
 static int filter_compare(void *filterA, void *filterB);
 
 /**************** FILTER TREE ****************/
 
+struct filter_bucket {
+    uint32_t addr;      /* source, per source buckets only */
+    uint32_t tokens;
+    pico_time stamp;    /* last refill */
+};
+
+struct filter_rate {
+    uint32_t rate;      /* packets per second */
+    uint32_t burst;     /* tokens */
+    uint8_t flags;
+    struct filter_bucket bucket;
+    struct filter_bucket *sources;
+};
+
 struct filter_node {
     struct pico_device *fdev;
     /* output address */
@@ -45,11 +71,13 @@ struct filter_node {
     uint8_t proto;
     int8_t priority;
     uint8_t tos;
+    uint8_t state;      /* rules: PICO_CT_* mask, 0 for any; packets: PICO_CT_* */
     uint32_t filter_id;
+    struct filter_rate *rate;
     int (*function_ptr)(struct filter_node *filter, struct pico_frame *f);
 };
 
-PICO_TREE_DECLARE(filter_tree, &filter_compare);
+PICO_TLS PICO_TREE_DECLARE(filter_tree, &filter_compare);
 
 static inline int ipfilter_uint32_cmp(uint32_t a, uint32_t b)
 {
@@ -211,6 +239,24 @@ static inline int filter_match_packet_port_out(struct filter_node *a, struct fil
     return 0;
 }
 
+static inline int filter_match_packet_tos(struct filter_node *a, struct filter_node *b, struct filter_node *rule)
+{
+    /* 5. Compare type of service */
+    if (rule->tos)
+        return ipfilter_uint8_cmp(a->tos, b->tos);
+
+    return 0;
+}
+
+static inline int filter_match_packet_state(struct filter_node *a, struct filter_node *b, struct filter_node *rule)
+{
+    /* 6. Connection state, the rule holds a set of states */
+    if (rule->state && !(a->state & b->state))
+        return ipfilter_uint8_cmp(a->state, b->state);
+
+    return 0;
+}
+
 static inline int filter_match_packet_dev_and_proto(struct filter_node *a, struct filter_node *b, struct filter_node *rule)
 {
     int cmp = filter_match_packet_dev(a, b, rule);
@@ -265,7 +311,11 @@ static inline int filter_match_packet(struct filter_node *a, struct filter_node
     if (cmp)
         return cmp;
 
-    return 0;
+    cmp = filter_match_packet_tos(a, b, rule);
+    if (cmp)
+        return cmp;
+
+    return filter_match_packet_state(a, b, rule);
 }
 
 
@@ -284,7 +334,7 @@ int filter_compare(void *filterA, void *filterB)
         return 0;
 
     /* 1. Compare devices */
-    cmp = ipfilter_ptr_cmp(a->fdev, a->fdev);
+    cmp = ipfilter_ptr_cmp(a->fdev, b->fdev);
     if (cmp)
         return cmp;
 
@@ -296,17 +346,439 @@ int filter_compare(void *filterA, void *filterB)
     /* 3. Compare addresses order: in, out */
     /* 4. Compare ports     order: in, out */
     cmp = filter_compare_address_port(a, b);
+    if (cmp)
+        return cmp;
 
-    return cmp;
+    /* 5. Compare connection states */
+    return ipfilter_uint8_cmp(a->state, b->state);
+}
+
+/**************** COMPILED CLASSIFIER ****************/
+
+/* The rule set is compiled into bit vectors, one per distinct value of each
+ * field: bit i is set when rule i accepts that value. A packet is classified
+ * by ANDing the vectors of its field values, the first bit left set is the
+ * oldest matching rule. Each vector has a summary with a bit per non-zero
+ * word, so only the words that can hold a match are visited.
+ * Rules are compiled again on every add and delete. */
+
+struct ipf_field {          /* exact match, 0 in a rule matches anything */
+    uintptr_t *keys;        /* sorted values named by the rules */
+    uint32_t count;
+    uint32_t *vec;          /* count + 1 vectors, the last one for unnamed values */
+    uint32_t *sum;
+};
+
+struct ipf_range {          /* address prefix, split in elementary intervals */
+    uintptr_t *starts;      /* sorted, host order, starts[0] == 0 */
+    uint32_t count;
+    uint32_t *vec;
+    uint32_t *sum;
+};
+
+struct ipf_classifier {
+    struct filter_node **rules; /* by filter id */
+    uint32_t count;
+    uint32_t words;             /* per vector */
+    uint32_t swords;            /* per summary */
+    struct ipf_field dev, proto, tos, in_port, out_port;
+    struct ipf_field state;     /* a vector per state bit, no keys */
+    struct ipf_range in_addr, out_addr;
+};
+
+static PICO_TLS struct ipf_classifier *ipf_compiled = NULL;
+
+/* Rules asking for a connection state: while there are none, packets are
+ * not looked up in the connection table */
+static PICO_TLS uint32_t ipf_stateful = 0;
+
+static inline void ipf_vec_set(uint32_t *vec, uint32_t bit)
+{
+    vec[bit >> 5] |= (1u << (bit & 31u));
+}
+
+static int ipf_summarize(struct ipf_classifier *c, uint32_t *vec, uint32_t rows, uint32_t **sum)
+{
+    uint32_t r, w;
+
+    *sum = PICO_ZALLOC(rows * c->swords * sizeof(uint32_t));
+    if (!*sum)
+        return -1;
+
+    for (r = 0; r < rows; r++) {
+        for (w = 0; w < c->words; w++) {
+            if (vec[r * c->words + w])
+                ipf_vec_set(*sum + r * c->swords, w);
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t ipf_first_bit(uint32_t w)
+{
+    uint32_t n = 0;
+    if (!(w & 0xFFFFu)) {
+        n += 16u;
+        w >>= 16;
+    }
+
+    if (!(w & 0xFFu)) {
+        n += 8u;
+        w >>= 8;
+    }
+
+    if (!(w & 0xFu)) {
+        n += 4u;
+        w >>= 4;
+    }
+
+    if (!(w & 0x3u)) {
+        n += 2u;
+        w >>= 2;
+    }
+
+    return n + ((w & 1u) ? 0u : 1u);
+}
+
+/* Sorts and removes duplicates, the rule sets are small enough for insertion sort */
+static uint32_t ipf_sort_unique(uintptr_t *v, uint32_t n)
+{
+    uint32_t i, j, u = 0;
+    uintptr_t x;
+
+    for (i = 1; i < n; i++) {
+        x = v[i];
+        for (j = i; (j > 0) && (v[j - 1] > x); j--)
+            v[j] = v[j - 1];
+        v[j] = x;
+    }
+    for (i = 0; i < n; i++) {
+        if (!u || (v[u - 1] != v[i]))
+            v[u++] = v[i];
+    }
+    return u;
+}
+
+/* Last entry <= key in a sorted array whose first entry is <= key.
+ * No data dependent branches, the lookups are made for every packet. */
+static inline uint32_t ipf_search(const uintptr_t *v, uint32_t n, uintptr_t key)
+{
+    const uintptr_t *base = v;
+    uint32_t half;
+
+    while (n > 1u) {
+        half = n >> 1;
+        base += half & (0u - (uint32_t)(base[half] <= key));
+        n -= half;
+    }
+    return (uint32_t)(base - v);
+}
+
+/* Index of the vector for key, count when no rule names it */
+static inline uint32_t ipf_field_find(const struct ipf_field *fld, uintptr_t key)
+{
+    uint32_t i;
+
+    if (!fld->count)
+        return 0;
+
+    i = ipf_search(fld->keys, fld->count, key);
+    return (fld->keys[i] == key) ? i : fld->count;
+}
+
+/* Interval holding key */
+static inline uint32_t ipf_range_find(const struct ipf_range *rng, uint32_t key)
+{
+    return ipf_search(rng->starts, rng->count, key);
+}
+
+static uintptr_t ipf_rule_key(struct filter_node *rule, int field)
+{
+    switch (field) {
+    case 0:  return (uintptr_t)rule->fdev;
+    case 1:  return rule->proto;
+    case 2:  return rule->tos;
+    case 3:  return rule->in_port;
+    default: return rule->out_port;
+    }
+}
+
+static int ipf_field_compile(struct ipf_classifier *c, struct ipf_field *fld, int field)
+{
+    uint32_t i, j;
+    uintptr_t key;
+
+    fld->keys = PICO_ZALLOC((c->count + 1u) * sizeof(uintptr_t));
+    if (!fld->keys)
+        return -1;
+
+    fld->count = 0;
+    for (i = 0; i < c->count; i++) {
+        key = ipf_rule_key(c->rules[i], field);
+        if (key)
+            fld->keys[fld->count++] = key;
+    }
+    fld->count = ipf_sort_unique(fld->keys, fld->count);
+    fld->vec = PICO_ZALLOC((fld->count + 1u) * c->words * sizeof(uint32_t));
+    if (!fld->vec)
+        return -1;
+
+    for (i = 0; i < c->count; i++) {
+        key = ipf_rule_key(c->rules[i], field);
+        if (key) {
+            ipf_vec_set(fld->vec + ipf_field_find(fld, key) * c->words, i);
+        } else {
+            for (j = 0; j <= fld->count; j++)
+                ipf_vec_set(fld->vec + j * c->words, i);
+        }
+    }
+    return ipf_summarize(c, fld->vec, fld->count + 1u, &fld->sum);
+}
+
+/* Rules name a set of states, so every rule is set in the vector of each
+ * state it accepts */
+static int ipf_state_compile(struct ipf_classifier *c, struct ipf_field *fld)
+{
+    struct filter_node *rule;
+    uint32_t i, b;
+
+    fld->count = IPF_STATES;
+    fld->vec = PICO_ZALLOC(IPF_STATES * c->words * sizeof(uint32_t));
+    if (!fld->vec)
+        return -1;
+
+    for (i = 0; i < c->count; i++) {
+        rule = c->rules[i];
+        for (b = 0; b < IPF_STATES; b++) {
+            if (!rule->state || (rule->state & (1u << b)))
+                ipf_vec_set(fld->vec + b * c->words, i);
+        }
+    }
+    return ipf_summarize(c, fld->vec, IPF_STATES, &fld->sum);
+}
+
+/* Vector of a packet state. Packets are only tracked while a rule asks
+ * for a state, otherwise every rule is in any of the vectors. */
+static inline uint32_t ipf_state_find(uint8_t state)
+{
+    if (!state)
+        return 0;
+
+    return ipf_first_bit(state);
+}
+
+/* Host order bounds of the addresses a rule accepts. Masks that are not a
+ * prefix accept the whole range here, the final match sorts them out. */
+static void ipf_rule_bounds(uint32_t addr, uint32_t netmask, uint32_t *lo, uint32_t *hi)
+{
+    uint32_t mask = long_be(netmask);
+    if ((~mask) & ((~mask) + 1u))
+        mask = 0;
+
+    *lo = long_be(addr) & mask;
+    *hi = *lo | ~mask;
+}
+
+static int ipf_range_compile(struct ipf_classifier *c, struct ipf_range *rng, int out)
+{
+    struct filter_node *rule;
+    uintptr_t *bounds;
+    uint32_t i, j, n = 0, lo, hi;
+
+    bounds = PICO_ZALLOC((2u * c->count + 1u) * sizeof(uintptr_t));
+    if (!bounds)
+        return -1;
+
+    bounds[n++] = 0;
+    for (i = 0; i < c->count; i++) {
+        rule = c->rules[i];
+        ipf_rule_bounds(out ? rule->out_addr : rule->in_addr, out ? rule->out_addr_netmask : rule->in_addr_netmask, &lo, &hi);
+        bounds[n++] = lo;
+        if (hi != 0xFFFFFFFFu)
+            bounds[n++] = hi + 1u;
+    }
+    rng->starts = bounds;
+    rng->count = ipf_sort_unique(bounds, n);
+    n = rng->count;
+    rng->vec = PICO_ZALLOC(n * c->words * sizeof(uint32_t));
+    if (!rng->vec)
+        return -1;
+
+    for (i = 0; i < c->count; i++) {
+        rule = c->rules[i];
+        ipf_rule_bounds(out ? rule->out_addr : rule->in_addr, out ? rule->out_addr_netmask : rule->in_addr_netmask, &lo, &hi);
+        for (j = ipf_range_find(rng, lo); (j < n) && (rng->starts[j] <= hi); j++)
+            ipf_vec_set(rng->vec + j * c->words, i);
+    }
+    return ipf_summarize(c, rng->vec, n, &rng->sum);
+}
+
+/* Same order as ipf_rule_key() */
+static void ipf_classifier_fields(struct ipf_classifier *c, struct ipf_field **fields)
+{
+    fields[0] = &c->dev;
+    fields[1] = &c->proto;
+    fields[2] = &c->tos;
+    fields[3] = &c->in_port;
+    fields[4] = &c->out_port;
+    fields[5] = &c->state;
+}
+
+static void ipf_classifier_free(struct ipf_classifier *c)
+{
+    struct ipf_field *fields[6];
+    struct ipf_range *ranges[2];
+    int i;
+
+    if (!c)
+        return;
+
+    ipf_classifier_fields(c, fields);
+    ranges[0] = &c->in_addr;
+    ranges[1] = &c->out_addr;
+    for (i = 0; i < 6; i++) {
+        if (fields[i]->keys)
+            PICO_FREE(fields[i]->keys);
+
+        if (fields[i]->vec)
+            PICO_FREE(fields[i]->vec);
+
+        if (fields[i]->sum)
+            PICO_FREE(fields[i]->sum);
+    }
+    for (i = 0; i < 2; i++) {
+        if (ranges[i]->starts)
+            PICO_FREE(ranges[i]->starts);
+
+        if (ranges[i]->vec)
+            PICO_FREE(ranges[i]->vec);
+
+        if (ranges[i]->sum)
+            PICO_FREE(ranges[i]->sum);
+    }
+    if (c->rules)
+        PICO_FREE(c->rules);
+
+    PICO_FREE(c);
+}
+
+static struct ipf_classifier *ipf_classifier_build(void)
+{
+    struct ipf_classifier *c;
+    struct ipf_field *fields[6];
+    struct pico_tree_node *index;
+    struct filter_node *rule;
+    uint32_t i, j, n = 0;
+
+    pico_tree_foreach(index, &filter_tree) {
+        n++;
+    }
+    if (!n)
+        return NULL;
+
+    c = PICO_ZALLOC(sizeof(struct ipf_classifier));
+    if (!c)
+        return NULL;
+
+    c->rules = PICO_ZALLOC(n * sizeof(struct filter_node *));
+    if (!c->rules) {
+        PICO_FREE(c);
+        return NULL;
+    }
+
+    pico_tree_foreach(index, &filter_tree) {
+        rule = index->keyValue;
+        for (j = c->count; (j > 0) && (c->rules[j - 1]->filter_id > rule->filter_id); j--)
+            c->rules[j] = c->rules[j - 1];
+        c->rules[j] = rule;
+        c->count++;
+    }
+    c->words = (n + 31u) >> 5;
+    c->swords = (c->words + 31u) >> 5;
+
+    ipf_classifier_fields(c, fields);
+    for (i = 0; i < 5; i++) {
+        if (ipf_field_compile(c, fields[i], (int)i) < 0) {
+            ipf_classifier_free(c);
+            return NULL;
+        }
+    }
+    if ((ipf_state_compile(c, &c->state) < 0) ||
+        (ipf_range_compile(c, &c->in_addr, 0) < 0) || (ipf_range_compile(c, &c->out_addr, 1) < 0)) {
+        ipf_classifier_free(c);
+        return NULL;
+    }
+
+    return c;
+}
+
+/* Without memory for the compiled form, ipfilter() keeps using the tree */
+static void ipf_compile(void)
+{
+    ipf_classifier_free(ipf_compiled);
+    ipf_compiled = ipf_classifier_build();
+}
+
+static struct filter_node *ipf_classify(struct ipf_classifier *c, struct filter_node *pkt)
+{
+    const uint32_t *v[8], *sv[8];
+    uint32_t idx[8];
+    uint32_t s, w, sbits, bits;
+    struct filter_node *rule;
+    int i;
+
+    idx[0] = ipf_field_find(&c->dev, (uintptr_t)pkt->fdev);
+    idx[1] = ipf_field_find(&c->proto, pkt->proto);
+    idx[2] = ipf_field_find(&c->tos, pkt->tos);
+    idx[3] = ipf_field_find(&c->in_port, pkt->in_port);
+    idx[4] = ipf_field_find(&c->out_port, pkt->out_port);
+    idx[5] = ipf_range_find(&c->in_addr, long_be(pkt->in_addr));
+    idx[6] = ipf_range_find(&c->out_addr, long_be(pkt->out_addr));
+    idx[7] = ipf_state_find(pkt->state);
+    v[0] = c->dev.vec;
+    sv[0] = c->dev.sum;
+    v[1] = c->proto.vec;
+    sv[1] = c->proto.sum;
+    v[2] = c->tos.vec;
+    sv[2] = c->tos.sum;
+    v[3] = c->in_port.vec;
+    sv[3] = c->in_port.sum;
+    v[4] = c->out_port.vec;
+    sv[4] = c->out_port.sum;
+    v[5] = c->in_addr.vec;
+    sv[5] = c->in_addr.sum;
+    v[6] = c->out_addr.vec;
+    sv[6] = c->out_addr.sum;
+    v[7] = c->state.vec;
+    sv[7] = c->state.sum;
+    for (i = 0; i < 8; i++) {
+        v[i] += idx[i] * c->words;
+        sv[i] += idx[i] * c->swords;
+    }
+
+    for (s = 0; s < c->swords; s++) {
+        sbits = sv[0][s] & sv[1][s] & sv[2][s] & sv[3][s] & sv[4][s] & sv[5][s] & sv[6][s] & sv[7][s];
+        while (sbits) {
+            w = (s << 5) + ipf_first_bit(sbits);
+            bits = v[0][w] & v[1][w] & v[2][w] & v[3][w] & v[4][w] & v[5][w] & v[6][w] & v[7][w];
+            while (bits) {
+                rule = c->rules[(w << 5) + ipf_first_bit(bits)];
+                if (filter_match_packet(pkt, rule) == 0)
+                    return rule;
+
+                bits &= bits - 1u;
+            }
+            sbits &= sbits - 1u;
+        }
+    }
+    return NULL;
 }
 
 /**************** FILTER CALLBACKS ****************/
 
 static int fp_priority(struct filter_node *filter, struct pico_frame *f)
 {
-    /* TODO do priority-stuff */
-    IGNORE_PARAMETER(filter);
-    IGNORE_PARAMETER(f);
+    f->priority = filter->priority;
     return 0;
 }
 
@@ -328,6 +800,66 @@ static int fp_drop(struct filter_node *filter, struct pico_frame *f)
     return 1;
 }
 
+static struct filter_bucket *fp_rate_bucket(struct filter_rate *r, struct pico_frame *f, pico_time now)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct filter_bucket *set, *b = NULL;
+    uint32_t h, i;
+
+    if (!(r->flags & PICO_IPFILTER_RATE_PER_SOURCE))
+        return &r->bucket;
+
+    h = hdr->src.addr * 0x9E3779B1u;
+    set = r->sources + ((h >> 16) % (PICO_IPFILTER_RATE_SOURCES / IPF_RATE_WAYS)) * IPF_RATE_WAYS;
+    for (i = 0; i < IPF_RATE_WAYS; i++) {
+        if ((set[i].addr == hdr->src.addr) && set[i].stamp)
+            return &set[i];
+
+        if (!b || (set[i].stamp < b->stamp))
+            b = &set[i];
+    }
+    /* a new source starts with a full bucket */
+    b->addr = hdr->src.addr;
+    b->tokens = r->burst;
+    b->stamp = now;
+    return b;
+}
+
+static int fp_ratelimit(struct filter_node *filter, struct pico_frame *f)
+{
+    struct filter_rate *r = filter->rate;
+    pico_time now = PICO_TIME_MS();
+    struct filter_bucket *b = fp_rate_bucket(r, f, now);
+    uint64_t tokens;
+
+    if (now > b->stamp) {
+        tokens = (uint64_t)b->tokens + (uint64_t)(now - b->stamp) * r->rate;
+        b->tokens = (tokens > r->burst) ? r->burst : (uint32_t)tokens;
+    }
+
+    b->stamp = now;
+    if (b->tokens >= IPF_TOKEN) {
+        b->tokens -= IPF_TOKEN;
+        return 0;
+    }
+
+    if (r->flags & PICO_IPFILTER_RATE_MARK) {
+        f->priority = filter->priority;
+        return 0;
+    }
+
+    ipf_dbg("ipfilter> rate exceeded\n");
+    pico_frame_discard(f);
+    return 1;
+}
+
+static int fp_accept(struct filter_node *filter, struct pico_frame *f)
+{
+    IGNORE_PARAMETER(filter);
+    IGNORE_PARAMETER(f);
+    return 0;
+}
+
 struct fp_function {
     int (*fn)(struct filter_node *filter, struct pico_frame *f);
 };
@@ -337,7 +869,9 @@ static const struct fp_function fp_function[FILTER_COUNT] =
 {
     {&fp_priority},
     {&fp_reject},
-    {&fp_drop}
+    {&fp_drop},
+    {&fp_ratelimit},
+    {&fp_accept}
 };
 
 static int pico_ipv4_filter_add_validate(int8_t priority, enum filter_action action)
@@ -354,20 +888,25 @@ static int pico_ipv4_filter_add_validate(int8_t priority, enum filter_action act
 }
 
 
-/**************** FILTER API's ****************/
-uint32_t pico_ipv4_filter_add(struct pico_device *dev, uint8_t proto,
-                              struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask,
-                              struct pico_ip4 *in_addr, struct pico_ip4 *in_addr_netmask,
-                              uint16_t out_port, uint16_t in_port, int8_t priority,
-                              uint8_t tos, enum filter_action action)
+static void filter_rate_free(struct filter_rate *r)
 {
-    static uint32_t filter_id = 1u; /* 0 is a special value used in the binary-tree search for packets being processed */
-    struct filter_node *new_filter;
+    if (!r)
+        return;
 
-    if (pico_ipv4_filter_add_validate(priority, action) < 0) {
-        pico_err = PICO_ERR_EINVAL;
-        return 0;
-    }
+    if (r->sources)
+        PICO_FREE(r->sources);
+
+    PICO_FREE(r);
+}
+
+static uint32_t ipfilter_add(struct pico_device *dev, uint8_t proto,
+                             struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask,
+                             struct pico_ip4 *in_addr, struct pico_ip4 *in_addr_netmask,
+                             uint16_t out_port, uint16_t in_port, int8_t priority,
+                             uint8_t tos, enum filter_action action, struct filter_rate *rate, uint8_t states)
+{
+    static PICO_TLS uint32_t filter_id = 1u; /* 0 is a special value used in the binary-tree search for packets being processed */
+    struct filter_node *new_filter;
 
     new_filter = PICO_ZALLOC(sizeof(struct filter_node));
     if (!new_filter) {
@@ -385,7 +924,9 @@ uint32_t pico_ipv4_filter_add(struct pico_device *dev, uint8_t proto,
     new_filter->in_port = in_port;
     new_filter->priority = priority;
     new_filter->tos = tos;
+    new_filter->state = states;
     new_filter->filter_id = filter_id++;
+    new_filter->rate = rate;
     new_filter->function_ptr = fp_function[action].fn;
 
     if(pico_tree_insert(&filter_tree, new_filter))
@@ -395,34 +936,127 @@ uint32_t pico_ipv4_filter_add(struct pico_device *dev, uint8_t proto,
         return 0;
     }
 
+    if (states)
+        ipf_stateful++;
+
+    ipf_compile();
     return new_filter->filter_id;
 }
 
-int pico_ipv4_filter_del(uint32_t filter_id)
+/**************** FILTER API's ****************/
+uint32_t pico_ipv4_filter_add(struct pico_device *dev, uint8_t proto,
+                              struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask,
+                              struct pico_ip4 *in_addr, struct pico_ip4 *in_addr_netmask,
+                              uint16_t out_port, uint16_t in_port, int8_t priority,
+                              uint8_t tos, enum filter_action action)
+{
+    /* rate limits need their parameters, see pico_ipv4_filter_add_ratelimit() */
+    if ((pico_ipv4_filter_add_validate(priority, action) < 0) || (action == FILTER_RATELIMIT)) {
+        pico_err = PICO_ERR_EINVAL;
+        return 0;
+    }
+
+    return ipfilter_add(dev, proto, out_addr, out_addr_netmask, in_addr, in_addr_netmask,
+                        out_port, in_port, priority, tos, action, NULL, 0);
+}
+
+uint32_t pico_ipv4_filter_add_state(struct pico_device *dev, uint8_t proto,
+                                    struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask,
+                                    struct pico_ip4 *in_addr, struct pico_ip4 *in_addr_netmask,
+                                    uint16_t out_port, uint16_t in_port, int8_t priority,
+                                    uint8_t tos, enum filter_action action, uint8_t states)
+{
+    if ((pico_ipv4_filter_add_validate(priority, action) < 0) || (action == FILTER_RATELIMIT) ||
+        !states || (states & ~IPF_STATE_MASK)) {
+        pico_err = PICO_ERR_EINVAL;
+        return 0;
+    }
+
+    return ipfilter_add(dev, proto, out_addr, out_addr_netmask, in_addr, in_addr_netmask,
+                        out_port, in_port, priority, tos, action, NULL, states);
+}
+
+uint32_t pico_ipv4_filter_add_ratelimit(struct pico_device *dev, uint8_t proto,
+                                        struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask,
+                                        struct pico_ip4 *in_addr, struct pico_ip4 *in_addr_netmask,
+                                        uint16_t out_port, uint16_t in_port, int8_t priority,
+                                        uint8_t tos, uint32_t rate, uint32_t burst, uint8_t flags)
 {
-    struct filter_node *node = NULL;
-    struct filter_node dummy = { 0 };
+    struct filter_rate *r;
+    uint32_t id;
+
+    if ((pico_ipv4_filter_add_validate(priority, FILTER_RATELIMIT) < 0) || !rate || !burst ||
+        (burst > (0xFFFFFFFFu / IPF_TOKEN)) || (flags & ~(PICO_IPFILTER_RATE_PER_SOURCE | PICO_IPFILTER_RATE_MARK))) {
+        pico_err = PICO_ERR_EINVAL;
+        return 0;
+    }
+
+    r = PICO_ZALLOC(sizeof(struct filter_rate));
+    if (!r) {
+        pico_err = PICO_ERR_ENOMEM;
+        return 0;
+    }
 
-    dummy.filter_id = filter_id;
-    if((node = pico_tree_delete(&filter_tree, &dummy)) == NULL)
+    r->rate = rate;
+    r->burst = burst * IPF_TOKEN;
+    r->flags = flags;
+    r->bucket.tokens = r->burst;
+    r->bucket.stamp = PICO_TIME_MS();
+    if (flags & PICO_IPFILTER_RATE_PER_SOURCE) {
+        r->sources = PICO_ZALLOC(PICO_IPFILTER_RATE_SOURCES * sizeof(struct filter_bucket));
+        if (!r->sources) {
+            PICO_FREE(r);
+            pico_err = PICO_ERR_ENOMEM;
+            return 0;
+        }
+    }
+
+    id = ipfilter_add(dev, proto, out_addr, out_addr_netmask, in_addr, in_addr_netmask,
+                      out_port, in_port, priority, tos, FILTER_RATELIMIT, r, 0);
+    if (!id)
+        filter_rate_free(r);
+
+    return id;
+}
+
+int pico_ipv4_filter_del(uint32_t filter_id)
+{
+    struct filter_node *node = NULL, *rule;
+    struct pico_tree_node *index;
+
+    /* the tree is ordered on the rule fields, not on the id */
+    pico_tree_foreach(index, &filter_tree) {
+        rule = index->keyValue;
+        if (rule->filter_id == filter_id) {
+            node = rule;
+            break;
+        }
+    }
+    if(!node || (pico_tree_delete(&filter_tree, node) == NULL))
     {
         ipf_dbg("ipfilter> failed to delete filter :%d\n", filter_id);
         return -1;
     }
 
+    if (node->state)
+        ipf_stateful--;
+
+    filter_rate_free(node->rate);
     PICO_FREE(node);
+    ipf_compile();
     return 0;
 }
 
 static int ipfilter_apply_filter(struct pico_frame *f, struct filter_node *pkt)
 {
     struct filter_node *filter_frame = NULL;
-    filter_frame = pico_tree_findKey(&filter_tree, pkt);
+    if (ipf_compiled)
+        filter_frame = ipf_classify(ipf_compiled, pkt);
+    else
+        filter_frame = pico_tree_findKey(&filter_tree, pkt);
+
     if(filter_frame)
-    {
-        filter_frame->function_ptr(filter_frame, f);
-        return 1;
-    }
+        return filter_frame->function_ptr(filter_frame, f);
 
     return 0;
 }
@@ -453,6 +1087,9 @@ int ipfilter(struct pico_frame *f)
     temp.proto = ipv4_hdr->proto;
     temp.priority = f->priority;
     temp.tos = ipv4_hdr->tos;
+    if (ipf_stateful)
+        temp.state = pico_conntrack_state(f);
+
     return ipfilter_apply_filter(f, &temp);
 }
 
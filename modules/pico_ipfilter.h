@@ -8,19 +8,37 @@
 #define INCLUDE_PICO_IPFILTER
 
 #include "pico_device.h"
+#include "pico_conntrack.h"
 
 enum filter_action {
     FILTER_PRIORITY = 0,
     FILTER_REJECT,
     FILTER_DROP,
+    FILTER_RATELIMIT,
+    FILTER_ACCEPT,
     FILTER_COUNT
 };
 
+/* Rate limit flags */
+#define PICO_IPFILTER_RATE_PER_SOURCE 0x01u /* one token bucket per source address */
+#define PICO_IPFILTER_RATE_MARK       0x02u /* excess packets get the filter priority instead of being dropped */
+
 uint32_t pico_ipv4_filter_add(struct pico_device *dev, uint8_t proto,
                               struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask, struct pico_ip4 *in_addr,
                               struct pico_ip4 *in_addr_netmask, uint16_t out_port, uint16_t in_port,
                               int8_t priority, uint8_t tos, enum filter_action action);
 
+uint32_t pico_ipv4_filter_add_ratelimit(struct pico_device *dev, uint8_t proto,
+                                        struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask, struct pico_ip4 *in_addr,
+                                        struct pico_ip4 *in_addr_netmask, uint16_t out_port, uint16_t in_port,
+                                        int8_t priority, uint8_t tos, uint32_t rate, uint32_t burst, uint8_t flags);
+
+/* Matches only packets whose connection is in one of the PICO_CT_* states */
+uint32_t pico_ipv4_filter_add_state(struct pico_device *dev, uint8_t proto,
+                                    struct pico_ip4 *out_addr, struct pico_ip4 *out_addr_netmask, struct pico_ip4 *in_addr,
+                                    struct pico_ip4 *in_addr_netmask, uint16_t out_port, uint16_t in_port,
+                                    int8_t priority, uint8_t tos, enum filter_action action, uint8_t states);
+
 int pico_ipv4_filter_del(uint32_t filter_id);
 
 int ipfilter(struct pico_frame *f);
@@ -30,21 +30,13 @@
 /* #define ip_mcast_dbg dbg */
 # define PICO_MCAST_ALL_HOSTS long_be(0xE0000001) /* 224.0.0.1 */
 /* Default network interface for multicast transmission */
-static struct pico_ipv4_link *mcast_default_link = NULL;
+static PICO_TLS struct pico_ipv4_link *mcast_default_link = NULL;
 #endif
 #ifdef PICO_SUPPORT_IPV4FRAG
 /* # define reassembly_dbg dbg */
 # define reassembly_dbg(...) do {} while(0)
 #endif
 
-/* Queues */
-static struct pico_queue in = {
-    0
-};
-static struct pico_queue out = {
-    0
-};
-
 /* Functions */
 static int ipv4_route_compare(void *ka, void *kb);
 static struct pico_frame *pico_ipv4_alloc(struct pico_protocol *self, uint16_t size);
@@ -284,7 +276,7 @@ static int ipv4_link_compare(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(Tree_dev_link, ipv4_link_compare);
+PICO_TLS PICO_TREE_DECLARE(Tree_dev_link, ipv4_link_compare);
 
 static int pico_ipv4_process_bcast_in(struct pico_frame *f)
 {
@@ -293,7 +285,7 @@ static int pico_ipv4_process_bcast_in(struct pico_frame *f)
     if (pico_ipv4_is_broadcast(hdr->dst.addr) && (hdr->proto == PICO_PROTO_UDP)) {
         /* Receiving UDP broadcast datagram */
         f->flags |= PICO_FRAME_FLAG_BCAST;
-        pico_enqueue(pico_proto_udp.q_in, f);
+        pico_protocol_receive(&pico_proto_udp, f);
         return 1;
     }
 
@@ -303,7 +295,7 @@ static int pico_ipv4_process_bcast_in(struct pico_frame *f)
     if (pico_ipv4_is_broadcast(hdr->dst.addr) && (hdr->proto == PICO_PROTO_ICMP4)) {
         /* Receiving ICMP4 bcast packet */
         f->flags |= PICO_FRAME_FLAG_BCAST;
-        pico_enqueue(pico_proto_icmp4.q_in, f);
+        pico_protocol_receive(&pico_proto_icmp4, f);
         return 1;
     }
 
@@ -322,7 +314,7 @@ static int pico_ipv4_process_mcast_in(struct pico_frame *f)
             pico_transport_receive(f, PICO_PROTO_IGMP);
             return 1;
         } else if ((pico_ipv4_mcast_filter(f) == 0) && (hdr->proto == PICO_PROTO_UDP)) {
-            pico_enqueue(pico_proto_udp.q_in, f);
+            pico_protocol_receive(&pico_proto_udp, f);
             return 1;
         }
 
@@ -342,7 +334,7 @@ static int pico_ipv4_process_local_unicast_in(struct pico_frame *f)
     };
     if (pico_ipv4_link_find(&hdr->dst)) {
         if (pico_ipv4_nat_inbound(f, &hdr->dst) == 0)
-            pico_enqueue(pico_proto_ipv4.q_in, f); /* dst changed, reprocess */
+            pico_enqueue(&pico_proto_ipv4.q_in, f); /* dst changed, reprocess */
         else
             pico_transport_receive(f, hdr->proto);
 
@@ -353,7 +345,7 @@ static int pico_ipv4_process_local_unicast_in(struct pico_frame *f)
         /* XXX KRO: is obsolete. Broadcast flag is set on outgoing DHCP messages.
          * incomming DHCP messages are to be broadcasted. Our current DHCP server
          * implementation does not take this flag into account yet though ... */
-        pico_enqueue(pico_proto_udp.q_in, f);
+        pico_protocol_receive(&pico_proto_udp, f);
         return 1;
 #endif
     }
@@ -459,7 +451,16 @@ static int pico_ipv4_process_in(struct pico_protocol *self, struct pico_frame *f
     return 0;
 }
 
-PICO_TREE_DECLARE(Routes, ipv4_route_compare);
+PICO_TLS PICO_TREE_DECLARE(Routes, ipv4_route_compare);
+
+/* Bumped whenever routes or links change, so that next hops cached by
+ * the datalink layer can tell they are out of date */
+static PICO_TLS uint32_t ipv4_route_gen = 1;
+
+uint32_t pico_ipv4_route_generation(void)
+{
+    return ipv4_route_gen;
+}
 
 
 static int pico_ipv4_process_out(struct pico_protocol *self, struct pico_frame *f)
@@ -497,7 +498,7 @@ static struct pico_frame *pico_ipv4_alloc(struct pico_protocol *self, uint16_t s
 static int pico_ipv4_frame_sock_push(struct pico_protocol *self, struct pico_frame *f);
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_ipv4 = {
+PICO_TLS struct pico_protocol pico_proto_ipv4 = {
     .name = "ipv4",
     .proto_number = PICO_PROTO_IPV4,
     .layer = PICO_LAYER_NETWORK,
@@ -505,8 +506,6 @@ struct pico_protocol pico_proto_ipv4 = {
     .process_in = pico_ipv4_process_in,
     .process_out = pico_ipv4_process_out,
     .push = pico_ipv4_frame_sock_push,
-    .q_in = &in,
-    .q_out = &out,
 };
 
 
@@ -540,7 +539,7 @@ static int ipv4_route_compare(void *ka, void *kb)
 }
 
 
-static struct pico_ipv4_route default_bcast_route = {
+static PICO_TLS struct pico_ipv4_route default_bcast_route = {
     .dest = {PICO_IP4_BCAST},
     .netmask = {PICO_IP4_BCAST},
     .gateway  = { 0 },
@@ -554,15 +553,28 @@ static struct pico_ipv4_route *route_find_default_bcast(void)
 }
 
 
+/* Last destination looked up: bursts to one peer walk the table once */
+static PICO_TLS struct {
+    struct pico_ip4 dst;
+    struct pico_ipv4_route *route;
+    uint32_t gen;
+} route_last;
+
 static struct pico_ipv4_route *route_find(const struct pico_ip4 *addr)
 {
     struct pico_ipv4_route *r;
     struct pico_tree_node *index;
 
     if (addr->addr != PICO_IP4_BCAST) {
+        if ((route_last.gen == ipv4_route_gen) && (route_last.dst.addr == addr->addr))
+            return route_last.route;
+
         pico_tree_foreach_reverse(index, &Routes) {
             r = index->keyValue;
             if ((addr->addr & (r->netmask.addr)) == (r->dest.addr)) {
+                route_last.dst.addr = addr->addr;
+                route_last.route = r;
+                route_last.gen = ipv4_route_gen;
                 return r;
             }
         }
@@ -920,7 +932,7 @@ int pico_ipv4_frame_push(struct pico_frame *f, struct pico_ip4 *dst, uint8_t pro
     struct pico_ipv4_hdr *hdr;
     uint8_t ttl = PICO_IPV4_DEFAULT_TTL;
     uint8_t vhl = 0x45; /* version 4, header length 20 */
-    static uint16_t ipv4_progressive_id = 0x91c0;
+    static PICO_TLS uint16_t ipv4_progressive_id = 0x91c0;
 #ifdef PICO_SUPPORT_MCAST
     struct pico_tree_node *index;
 #endif
@@ -1047,7 +1059,7 @@ int pico_ipv4_frame_push(struct pico_frame *f, struct pico_ip4 *dst, uint8_t pro
         if ((proto != PICO_PROTO_IGMP) && (pico_ipv4_mcast_filter(f) == 0)) {
             ip_mcast_dbg("MCAST: sender is member of group, loopback copy\n");
             cpy = pico_frame_copy(f);
-            pico_enqueue(&in, cpy);
+            pico_enqueue(&pico_proto_ipv4.q_in, cpy);
         }
     }
 
@@ -1065,10 +1077,10 @@ int pico_ipv4_frame_push(struct pico_frame *f, struct pico_ip4 *dst, uint8_t pro
 
     if (pico_ipv4_link_get(&hdr->dst)) {
         /* it's our own IP */
-        return pico_enqueue(&in, f);
+        return pico_enqueue(&pico_proto_ipv4.q_in, f);
     } else{
         /* TODO: Check if there are members subscribed here */
-        return pico_enqueue(&out, f);
+        return pico_enqueue(&pico_proto_ipv4.q_out, f);
     }
 
 drop:
@@ -1147,6 +1159,7 @@ int MOCKABLE pico_ipv4_route_add(struct pico_ip4 address, struct pico_ip4 netmas
     }
 
     pico_tree_insert(&Routes, new);
+    ipv4_route_gen++;
     dbg_route();
     return 0;
 }
@@ -1164,6 +1177,7 @@ int pico_ipv4_route_del(struct pico_ip4 address, struct pico_ip4 netmask, int me
 
         pico_tree_delete(&Routes, found);
         PICO_FREE(found);
+        ipv4_route_gen++;
 
         dbg_route();
         return 0;
@@ -1224,6 +1238,7 @@ int pico_ipv4_link_add(struct pico_device *dev, struct pico_ip4 address, struct
 #endif
 
     pico_tree_insert(&Tree_dev_link, new);
+    ipv4_route_gen++;
 #ifdef PICO_SUPPORT_MCAST
     do {
         struct pico_ip4 mcast_all_hosts, mcast_addr, mcast_nm, mcast_gw;
@@ -1310,8 +1325,14 @@ int pico_ipv4_link_del(struct pico_device *dev, struct pico_ip4 address)
     PICO_FREE(found->MCASTGroups);
 #endif
 
+#ifdef PICO_SUPPORT_NAT
+    if (pico_ipv4_nat_is_enabled(&found->address))
+        pico_ipv4_nat_disable_link(found);
+
+#endif
     pico_ipv4_cleanup_routes(found);
     pico_tree_delete(&Tree_dev_link, found);
+    ipv4_route_gen++;
     if (default_bcast_route.link == found)
         default_bcast_route.link = NULL;
 
@@ -1462,12 +1483,12 @@ int pico_ipv4_rebound(struct pico_frame *f)
 
 static int pico_ipv4_pre_forward_checks(struct pico_frame *f)
 {
-    static uint16_t last_id = 0;
-    static uint16_t last_proto = 0;
-    static struct pico_ip4 last_src = {
+    static PICO_TLS uint16_t last_id = 0;
+    static PICO_TLS uint16_t last_proto = 0;
+    static PICO_TLS struct pico_ip4 last_src = {
         0
     };
-    static struct pico_ip4 last_dst = {
+    static PICO_TLS struct pico_ip4 last_dst = {
         0
     };
     struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)f->net_hdr;
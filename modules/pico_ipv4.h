@@ -28,7 +28,7 @@
     #define PICO_IPV4_FRAG_MAX_SIZE PICO_DEFAULT_SOCKETQ
 #endif
 
-extern struct pico_protocol pico_proto_ipv4;
+extern PICO_TLS struct pico_protocol pico_proto_ipv4;
 
 PACKED_STRUCT_DEF pico_ipv4_hdr {
     uint8_t vhl;
@@ -86,7 +86,7 @@ struct pico_ipv4_route
     uint32_t metric;
 };
 
-extern struct pico_tree Routes;
+extern PICO_TLS struct pico_tree Routes;
 
 
 int pico_ipv4_compare(struct pico_ip4 *a, struct pico_ip4 *b);
@@ -114,6 +114,7 @@ int pico_ipv4_route_add(struct pico_ip4 address, struct pico_ip4 netmask, struct
 int pico_ipv4_route_del(struct pico_ip4 address, struct pico_ip4 netmask, int metric);
 struct pico_ip4 pico_ipv4_route_get_gateway(struct pico_ip4 *addr);
 void pico_ipv4_route_set_bcast_link(struct pico_ipv4_link *link);
+uint32_t pico_ipv4_route_generation(void);
 void pico_ipv4_unreachable(struct pico_frame *f, int err);
 
 int pico_ipv4_mcast_join(struct pico_ip4 *mcast_link, struct pico_ip4 *mcast_group, uint8_t reference_count, uint8_t filter_mode, struct pico_tree *MCASTFilter);
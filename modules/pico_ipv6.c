@@ -37,11 +37,7 @@
 
 #define ipv6_dbg(...) do { }while(0); 
 #define ipv6_mcast_dbg do{ }while(0);
-static struct pico_ipv6_link *mcast_default_link_ipv6 = NULL;
-
-/* queues */
-static struct pico_queue ipv6_in;
-static struct pico_queue ipv6_out;
+static PICO_TLS struct pico_ipv6_link *mcast_default_link_ipv6 = NULL;
 
 const uint8_t PICO_IP6_ANY[PICO_SIZE_IP6] = {
     0
@@ -118,9 +114,18 @@ static int ipv6_route_compare(void *ka, void *kb)
 
 }
 
-PICO_TREE_DECLARE(Tree_dev_ip6_link, ipv6_link_compare);
-PICO_TREE_DECLARE(IPV6Routes, ipv6_route_compare);
-PICO_TREE_DECLARE(IPV6Links, ipv6_link_compare);
+PICO_TLS PICO_TREE_DECLARE(Tree_dev_ip6_link, ipv6_link_compare);
+PICO_TLS PICO_TREE_DECLARE(IPV6Routes, ipv6_route_compare);
+
+/* Bumped whenever routes or links change, so that next hops cached by
+ * neighbor discovery can tell they are out of date */
+static PICO_TLS uint32_t ipv6_route_gen = 1;
+
+uint32_t pico_ipv6_route_generation(void)
+{
+    return ipv6_route_gen;
+}
+PICO_TLS PICO_TREE_DECLARE(IPV6Links, ipv6_link_compare);
 
 static char pico_ipv6_dec_to_char(uint8_t u)
 {
@@ -381,6 +386,13 @@ int pico_ipv6_is_unspecified(const uint8_t addr[PICO_SIZE_IP6])
     return !memcmp(PICO_IP6_ANY, addr, PICO_SIZE_IP6);
 }
 
+/* Last destination looked up: bursts to one peer walk the table once */
+static PICO_TLS struct {
+    struct pico_ip6 dst;
+    struct pico_ipv6_route *route;
+    uint32_t gen;
+} ipv6_route_last;
+
 static struct pico_ipv6_route *pico_ipv6_route_find(const struct pico_ip6 *addr)
 {
     struct pico_ipv6_route *r = NULL;
@@ -389,6 +401,10 @@ static struct pico_ipv6_route *pico_ipv6_route_find(const struct pico_ip6 *addr)
     if (!pico_ipv6_is_localhost(addr->addr) && (pico_ipv6_is_linklocal(addr->addr)  || pico_ipv6_is_sitelocal(addr->addr)))    {
         return NULL;
     }
+
+    if ((ipv6_route_last.gen == ipv6_route_gen) && (memcmp(ipv6_route_last.dst.addr, addr->addr, PICO_SIZE_IP6) == 0))
+        return ipv6_route_last.route;
+
     pico_tree_foreach_reverse(index, &IPV6Routes)
     {
         r = index->keyValue;
@@ -398,6 +414,9 @@ static struct pico_ipv6_route *pico_ipv6_route_find(const struct pico_ip6 *addr)
             }
 
             if (i + 1 == PICO_SIZE_IP6) {
+                memcpy(ipv6_route_last.dst.addr, addr->addr, PICO_SIZE_IP6);
+                ipv6_route_last.route = r;
+                ipv6_route_last.gen = ipv6_route_gen;
                 return r;
             }
         }
@@ -806,7 +825,7 @@ static int pico_ipv6_process_mcast_in(struct pico_frame *f)
             pico_transport_receive(f, PICO_PROTO_ICMP6);
             return 1;
         } else if ((pico_ipv6_mcast_filter(f) == 0) && (hdr->nxthdr == PICO_PROTO_UDP)) {
-            pico_enqueue(pico_proto_udp.q_in, f);
+            pico_protocol_receive(&pico_proto_udp, f);
             return 1;
         }
 
@@ -1286,10 +1305,10 @@ static int ipv6_frame_push_final(struct pico_frame *f)
     struct pico_ipv6_hdr *hdr = NULL;
     hdr = (struct pico_ipv6_hdr *)f->net_hdr;
     if(pico_ipv6_link_get(&hdr->dst)) {
-        return pico_enqueue(&ipv6_in, f);
+        return pico_enqueue(&pico_proto_ipv6.q_in, f);
     }
     else {
-        return pico_enqueue(&ipv6_out, f);
+        return pico_enqueue(&pico_proto_ipv6.q_out, f);
     }
 }
 
@@ -1370,7 +1389,7 @@ static int pico_ipv6_frame_sock_push(struct pico_protocol *self, struct pico_fra
 }
 
 /* interface: protocol definition */
-struct pico_protocol pico_proto_ipv6 = {
+PICO_TLS struct pico_protocol pico_proto_ipv6 = {
     .name = "ipv6",
     .proto_number = PICO_PROTO_IPV6,
     .layer = PICO_LAYER_NETWORK,
@@ -1378,8 +1397,6 @@ struct pico_protocol pico_proto_ipv6 = {
     .process_in = pico_ipv6_process_in,
     .process_out = pico_ipv6_process_out,
     .push = pico_ipv6_frame_sock_push,
-    .q_in = &ipv6_in,
-    .q_out = &ipv6_out,
 };
 
 #ifdef DEBUG_ROUTE
@@ -1466,6 +1483,7 @@ int pico_ipv6_route_add(struct pico_ip6 address, struct pico_ip6 netmask, struct
 
 
     pico_tree_insert(&IPV6Routes, new);
+    ipv6_route_gen++;
     pico_ipv6_dbg_route();
     return 0;
 }
@@ -1489,6 +1507,7 @@ int pico_ipv6_route_del(struct pico_ip6 address, struct pico_ip6 netmask, struct
     if (found) {
         pico_tree_delete(&IPV6Routes, found);
         PICO_FREE(found);
+        ipv6_route_gen++;
         pico_ipv6_dbg_route();
         return 0;
     }
@@ -1553,6 +1572,7 @@ static void pico_ipv6_nd_dad(pico_time now, void *arg)
         if (l->dup_detect_retrans-- == 0) {
             dbg("IPv6: DAD verified valid address.\n");
             l->istentative = 0;
+            ipv6_route_gen++;
         } else {
             /* Duplicate Address Detection */
             pico_icmp6_neighbor_solicitation(l->dev, &l->address, PICO_ICMP6_ND_DAD);
@@ -1622,6 +1642,7 @@ struct pico_ipv6_link *pico_ipv6_link_add(struct pico_device *dev, struct pico_i
     new->mcast_last_query_interval = MLD_QUERY_INTERVAL;
 #endif
     pico_tree_insert(&IPV6Links, new);
+    ipv6_route_gen++;
     for (i = 0; i < PICO_SIZE_IP6; ++i) {
         network.addr[i] = address.addr[i] & netmask.addr[i];
     }
@@ -1703,6 +1724,7 @@ int pico_ipv6_link_del(struct pico_device *dev, struct pico_ip6 address)
         pico_timer_cancel(found->dad_timer);
 
     pico_tree_delete(&IPV6Links, found);
+    ipv6_route_gen++;
     /* XXX MUST leave the solicited-node multicast address corresponding to the address (RFC 4861 $7.2.1) */
     PICO_FREE(found);
     return 0;
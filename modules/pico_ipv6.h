@@ -30,8 +30,8 @@
 #define HBH_LEN(hbh) ((((hbh->ext.hopbyhop.len + 1) << 3) - 2)) /* len in bytes, minus nxthdr and len byte */
 
 extern const uint8_t PICO_IP6_ANY[PICO_SIZE_IP6];
-extern struct pico_protocol pico_proto_ipv6;
-extern struct pico_tree IPV6Routes;
+extern PICO_TLS struct pico_protocol pico_proto_ipv6;
+extern PICO_TLS struct pico_tree IPV6Routes;
 
 PACKED_STRUCT_DEF pico_ipv6_hdr {
     uint32_t vtf;
@@ -152,6 +152,7 @@ struct pico_ipv6_link *pico_ipv6_link_istentative(struct pico_ip6 *address);
 struct pico_ipv6_link *pico_ipv6_link_get(struct pico_ip6 *address);
 struct pico_device *pico_ipv6_link_find(struct pico_ip6 *address);
 struct pico_ip6 pico_ipv6_route_get_gateway(struct pico_ip6 *addr);
+uint32_t pico_ipv6_route_generation(void);
 struct pico_ip6 *pico_ipv6_source_find(const struct pico_ip6 *dst);
 struct pico_device *pico_ipv6_source_dev_find(const struct pico_ip6 *dst);
 struct pico_ipv6_link *pico_ipv6_link_by_dev(struct pico_device *dev);
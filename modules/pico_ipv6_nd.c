@@ -22,7 +22,20 @@
 
 #define nd_dbg(...) do {} while(0)
 
-static struct pico_frame *frames_queued_v6[PICO_ND_MAX_FRAMES_QUEUED] = { 0 };
+/* Buckets in the neighbor cache and slots in the destination cache,
+ * both must be a power of two */
+#ifndef PICO_ND_HASH_SIZE
+#define PICO_ND_HASH_SIZE 64
+#endif
+#ifndef PICO_ND_DST_CACHE
+#define PICO_ND_DST_CACHE 64
+#endif
+
+/* Neighbor timers are kept in a wheel of PICO_ND_TIMER_SLOTS slots,
+ * one slot per PICO_ND_TIMER_TICK ms. Timers further away than one
+ * turn of the wheel are simply looked at again on the next turn. */
+#define PICO_ND_TIMER_TICK  200
+#define PICO_ND_TIMER_SLOTS 64
 
 
 enum pico_ipv6_neighbor_state {
@@ -41,40 +54,94 @@ struct pico_ipv6_neighbor {
     uint16_t is_router;
     uint16_t failure_count;
     pico_time expire;
+    uint16_t frames_count;
+    struct pico_frame *frames;           /* waiting for resolution, linked by f->next */
+    struct pico_frame *frames_tail;
+    struct pico_ipv6_neighbor *next;     /* hash chain */
+    struct pico_ipv6_neighbor *tnext;    /* timer wheel slot */
+    struct pico_ipv6_neighbor **tprev;
+};
+
+/* Last next hop resolved for a destination, valid while the IPv6
+ * routing generation it was filled with is current */
+struct pico_nd_dst {
+    struct pico_ip6 dst;
+    struct pico_device *dev;
+    uint32_t gen;
+    struct pico_ipv6_neighbor *n;        /* neighbor, or NULL when dst is local */
+    struct pico_eth *local;              /* own MAC when dst is one of our addresses */
 };
 
-static int pico_ipv6_neighbor_compare(void *ka, void *kb)
+static PICO_TLS struct pico_ipv6_neighbor *NCache[PICO_ND_HASH_SIZE];
+static PICO_TLS struct pico_nd_dst nd_dst_cache[PICO_ND_DST_CACHE];
+static PICO_TLS struct pico_ipv6_neighbor *nd_wheel[PICO_ND_TIMER_SLOTS];
+static PICO_TLS pico_time nd_wheel_tick;          /* next tick to be processed */
+
+static inline uint32_t pico_nd_hash(const struct pico_ip6 *a)
+{
+    uint32_t h = 0;
+    int i;
+    for (i = 0; i < PICO_SIZE_IP6; i++)
+        h ^= (uint32_t)a->addr[i] << ((i & 3) << 3);
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+static struct pico_ipv6_neighbor *pico_nd_find_neighbor(struct pico_ip6 *dst)
 {
-    struct pico_ipv6_neighbor *a = ka, *b = kb;
-    return pico_ipv6_compare(&a->address, &b->address);
+    struct pico_ipv6_neighbor *n = NCache[pico_nd_hash(dst) & (PICO_ND_HASH_SIZE - 1)];
+    while (n && (memcmp(n->address.addr, dst->addr, PICO_SIZE_IP6) != 0))
+        n = n->next;
+    return n;
 }
 
+static void pico_nd_timer_unlink(struct pico_ipv6_neighbor *n)
+{
+    if (!n->tprev)
+        return;
+
+    *n->tprev = n->tnext;
+    if (n->tnext)
+        n->tnext->tprev = n->tprev;
 
-PICO_TREE_DECLARE(NCache, pico_ipv6_neighbor_compare);
+    n->tnext = NULL;
+    n->tprev = NULL;
+}
 
-static struct pico_ipv6_neighbor *pico_nd_find_neighbor(struct pico_ip6 *dst)
+/* (Re)arm the neighbor timer for n->expire */
+static void pico_nd_timer_schedule(struct pico_ipv6_neighbor *n)
 {
-    struct pico_ipv6_neighbor test = {
-        0
-    };
+    pico_time tick = n->expire / PICO_ND_TIMER_TICK;
+    struct pico_ipv6_neighbor **slot;
+
+    pico_nd_timer_unlink(n);
+    if (tick < nd_wheel_tick)
+        tick = nd_wheel_tick;
+
+    slot = &nd_wheel[tick & (PICO_ND_TIMER_SLOTS - 1)];
+    n->tnext = *slot;
+    if (*slot)
+        (*slot)->tprev = &n->tnext;
 
-    test.address = *dst;
-    return pico_tree_findKey(&NCache, &test);
+    *slot = n;
+    n->tprev = slot;
 }
 
-static void pico_ipv6_nd_queued_trigger(void)
+/* Resolution succeeded: hand the waiting frames back to their device */
+static void pico_ipv6_nd_queued_trigger(struct pico_ipv6_neighbor *n)
 {
-    int i;
-    struct pico_frame *f;
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++)
-    {
-        f = frames_queued_v6[i];
-        if (f) {
-            (void)pico_ethernet_send(f);
-            if(frames_queued_v6[i])
-              pico_frame_discard(frames_queued_v6[i]);
-            frames_queued_v6[i] = NULL;
-        }
+    struct pico_frame *f = n->frames, *next;
+    n->frames = NULL;
+    n->frames_tail = NULL;
+    n->frames_count = 0;
+    while (f) {
+        next = f->next;
+        if (pico_enqueue(f->dev->q_out, f) < 0)
+            pico_frame_discard(f);
+
+        f = next;
     }
 }
 
@@ -92,6 +159,7 @@ static void ipv6_duplicate_detected(struct pico_ipv6_link *l)
 static struct pico_ipv6_neighbor *pico_nd_add(struct pico_ip6 *addr, struct pico_device *dev)
 {
     struct pico_ipv6_neighbor *n = PICO_ZALLOC(sizeof(struct pico_ipv6_neighbor));
+    struct pico_ipv6_neighbor **head;
     char address[120];
     if (!n)
         return NULL;
@@ -100,35 +168,51 @@ static struct pico_ipv6_neighbor *pico_nd_add(struct pico_ip6 *addr, struct pico
     nd_dbg("Adding address %s to cache...\n", address);
     memcpy(&n->address, addr, sizeof(struct pico_ip6));
     n->dev = dev;
-    pico_tree_insert(&NCache, n);
+    head = &NCache[pico_nd_hash(addr) & (PICO_ND_HASH_SIZE - 1)];
+    n->next = *head;
+    *head = n;
     return n;
 }
 
-static void pico_ipv6_nd_unreachable(struct pico_ip6 *a)
+static void pico_nd_del(struct pico_ipv6_neighbor *n)
 {
-    int i;
+    struct pico_ipv6_neighbor **pp = &NCache[pico_nd_hash(&n->address) & (PICO_ND_HASH_SIZE - 1)];
     struct pico_frame *f;
-    struct pico_ipv6_hdr *hdr;
-    struct pico_ip6 dst;
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++)
-    {
-        f = frames_queued_v6[i];
-        if (f) {
-            hdr = (struct pico_ipv6_hdr *) f->net_hdr;
-            dst = pico_ipv6_route_get_gateway(&hdr->dst);
-            if (pico_ipv6_is_unspecified(dst.addr))
-                dst = hdr->dst;
-
-            if (memcmp(dst.addr, a->addr, PICO_SIZE_IP6) == 0) {
-                if (!pico_source_is_local(f)) {
-                    pico_notify_dest_unreachable(f);
-                }
+    int i;
 
-                pico_frame_discard(f);
-                frames_queued_v6[i] = NULL;
-            }
+    while (*pp && (*pp != n))
+        pp = &(*pp)->next;
+    if (*pp)
+        *pp = n->next;
+
+    for (i = 0; i < PICO_ND_DST_CACHE; i++) {
+        if (nd_dst_cache[i].n == n)
+            nd_dst_cache[i].n = NULL;
+    }
+    while (n->frames) {
+        f = n->frames;
+        n->frames = f->next;
+        pico_frame_discard(f);
+    }
+    pico_nd_timer_unlink(n);
+    PICO_FREE(n);
+}
+
+/* Resolution failed: report and drop the frames waiting for the neighbor */
+static void pico_ipv6_nd_unreachable(struct pico_ipv6_neighbor *n)
+{
+    struct pico_frame *f;
+    while (n->frames) {
+        f = n->frames;
+        n->frames = f->next;
+        if (!pico_source_is_local(f)) {
+            pico_notify_dest_unreachable(f);
         }
+
+        pico_frame_discard(f);
     }
+    n->frames_tail = NULL;
+    n->frames_count = 0;
 }
 
 static void pico_nd_new_expire_time(struct pico_ipv6_neighbor *n)
@@ -140,6 +224,8 @@ static void pico_nd_new_expire_time(struct pico_ipv6_neighbor *n)
     else {
         n->expire = n->dev->hostvars.retranstime + PICO_TIME_MS();
     }
+
+    pico_nd_timer_schedule(n);
 }
 
 static void pico_nd_discover(struct pico_ipv6_neighbor *n)
@@ -162,15 +248,9 @@ static void pico_nd_discover(struct pico_ipv6_neighbor *n)
     pico_nd_new_expire_time(n);
 }
 
-static struct pico_eth *pico_nd_get_neighbor(struct pico_ip6 *addr, struct pico_ipv6_neighbor *n, struct pico_device *dev)
+static struct pico_eth *pico_nd_get_neighbor(struct pico_ipv6_neighbor *n)
 {
-    /* dbg("Finding neighbor %02x:...:%02x, state = %d\n", addr->addr[0], addr->addr[15], n?n->state:-1); */
-
-    if (!n) {
-        n = pico_nd_add(addr, dev);
-        pico_nd_discover(n);
-        return NULL;
-    }
+    /* dbg("Finding neighbor %02x:...:%02x, state = %d\n", n->address.addr[0], n->address.addr[15], n->state); */
 
     if (n->state == PICO_ND_STATE_INCOMPLETE) {
         return NULL;
@@ -188,18 +268,48 @@ static struct pico_eth *pico_nd_get_neighbor(struct pico_ip6 *addr, struct pico_
 
 }
 
-static struct pico_eth *pico_nd_get(struct pico_ip6 *address, struct pico_device *dev)
+/* Next hop for dst through dev, served from the destination cache when
+ * possible. An unknown neighbor is added as INCOMPLETE and solicited. */
+static struct pico_nd_dst *pico_nd_dst_get(struct pico_ip6 *dst, struct pico_device *dev)
 {
-    struct pico_ip6 gateway = {{0}}, addr = {{0}};
+    struct pico_nd_dst *d = &nd_dst_cache[pico_nd_hash(dst) & (PICO_ND_DST_CACHE - 1)];
+    uint32_t gen = pico_ipv6_route_generation();
+    struct pico_ip6 addr;
+    struct pico_ipv6_link *l;
+    struct pico_ipv6_neighbor *n;
 
-    /* should we use gateway, or is dst local (gateway == 0)? */
-    gateway = pico_ipv6_route_get_gateway(address);
-    if (memcmp(gateway.addr, PICO_IP6_ANY, PICO_SIZE_IP6) == 0)
-        addr = *address;
-    else
-        addr = gateway;
+    if ((d->gen == gen) && (d->dev == dev) && (d->n || d->local) &&
+        (memcmp(d->dst.addr, dst->addr, PICO_SIZE_IP6) == 0))
+        return d;
 
-    return pico_nd_get_neighbor(&addr, pico_nd_find_neighbor(&addr), dev);
+    d->n = NULL;
+    d->local = NULL;
+    /* address belongs to ourselves? */
+    l = pico_ipv6_link_get(dst);
+    if (l) {
+        d->local = &l->dev->eth->mac;
+    } else {
+        /* should we use gateway, or is dst local (gateway == 0)? */
+        addr = pico_ipv6_route_get_gateway(dst);
+        if (memcmp(addr.addr, PICO_IP6_ANY, PICO_SIZE_IP6) == 0)
+            addr = *dst;
+
+        n = pico_nd_find_neighbor(&addr);
+        if (!n) {
+            n = pico_nd_add(&addr, dev);
+            if (!n)
+                return NULL;
+
+            pico_nd_discover(n);
+        }
+
+        d->n = n;
+    }
+
+    d->dst = *dst;
+    d->dev = dev;
+    d->gen = gen;
+    return d;
 }
 
 static int neigh_options(struct pico_frame *f, struct pico_icmp6_opt_lladdr *opt, uint8_t expected_opt)
@@ -274,7 +384,7 @@ static int neigh_adv_reconfirm_no_tlla(struct pico_ipv6_neighbor *n, struct pico
     if (IS_SOLICITED(hdr)) {
         n->state = PICO_ND_STATE_REACHABLE;
         n->failure_count = 0;
-        pico_ipv6_nd_queued_trigger();
+        pico_ipv6_nd_queued_trigger(n);
         pico_nd_new_expire_time(n);
         return 0;
     }
@@ -289,7 +399,7 @@ static int neigh_adv_reconfirm(struct pico_ipv6_neighbor *n, struct pico_icmp6_o
     if (IS_SOLICITED(hdr) && !IS_OVERRIDE(hdr) && (pico_ipv6_neighbor_compare_stored(n, opt) == 0)) {
         n->state = PICO_ND_STATE_REACHABLE;
         n->failure_count = 0;
-        pico_ipv6_nd_queued_trigger();
+        pico_ipv6_nd_queued_trigger(n);
         pico_nd_new_expire_time(n);
         return 0;
     }
@@ -303,7 +413,7 @@ static int neigh_adv_reconfirm(struct pico_ipv6_neighbor *n, struct pico_icmp6_o
         pico_ipv6_neighbor_update(n, opt);
         n->state = PICO_ND_STATE_REACHABLE;
         n->failure_count = 0;
-        pico_ipv6_nd_queued_trigger();
+        pico_ipv6_nd_queued_trigger(n);
         pico_nd_new_expire_time(n);
         return 0;
     }
@@ -311,7 +421,7 @@ static int neigh_adv_reconfirm(struct pico_ipv6_neighbor *n, struct pico_icmp6_o
     if (!IS_SOLICITED(hdr) && IS_OVERRIDE(hdr) && (pico_ipv6_neighbor_compare_stored(n, opt) != 0)) {
         pico_ipv6_neighbor_update(n, opt);
         n->state = PICO_ND_STATE_STALE;
-        pico_ipv6_nd_queued_trigger();
+        pico_ipv6_nd_queued_trigger(n);
         pico_nd_new_expire_time(n);
         return 0;
     }
@@ -357,7 +467,7 @@ static void neigh_adv_process_incomplete(struct pico_ipv6_neighbor *n, struct pi
     if (opt)
         pico_ipv6_neighbor_update(n, opt);
 
-    pico_ipv6_nd_queued_trigger();
+    pico_ipv6_nd_queued_trigger(n);
 }
 
 
@@ -407,7 +517,6 @@ static struct pico_ipv6_neighbor *pico_ipv6_neighbor_from_sol_new(struct pico_ip
 
     memcpy(n->mac.addr, opt->addr.mac.addr, PICO_SIZE_ETH);
     n->state = PICO_ND_STATE_STALE;
-    pico_ipv6_nd_queued_trigger();
     return n;
 }
 
@@ -427,7 +536,7 @@ static void pico_ipv6_neighbor_from_unsolicited(struct pico_frame *f)
         } else if (memcmp(opt.addr.mac.addr, n->mac.addr, PICO_SIZE_ETH)) {
             pico_ipv6_neighbor_update(n, &opt);
             n->state = PICO_ND_STATE_STALE;
-            pico_ipv6_nd_queued_trigger();
+            pico_ipv6_nd_queued_trigger(n);
             pico_nd_new_expire_time(n);
         }
 
@@ -845,9 +954,8 @@ static void pico_ipv6_nd_timer_elapsed(pico_time now, struct pico_ipv6_neighbor
     /* intentional fall through */
     case PICO_ND_STATE_PROBE:
         if (n->failure_count > PICO_ND_MAX_SOLICIT) {
-            pico_ipv6_nd_unreachable(&n->address);
-            pico_tree_delete(&NCache, n);
-            PICO_FREE(n);
+            pico_ipv6_nd_unreachable(n);
+            pico_nd_del(n);
             return;
         }
 
@@ -873,20 +981,34 @@ static void pico_ipv6_nd_timer_elapsed(pico_time now, struct pico_ipv6_neighbor
     pico_nd_new_expire_time(n);
 }
 
+/* Walk the wheel slots elapsed since the last call: only neighbors
+ * whose timer falls in them are looked at. */
 static void pico_ipv6_nd_timer_callback(pico_time now, void *arg)
 {
-    struct pico_tree_node *index = NULL, *_tmp = NULL;
-    struct pico_ipv6_neighbor *n;
+    struct pico_ipv6_neighbor *n, *due;
+    pico_time last = now / PICO_ND_TIMER_TICK;
 
     (void)arg;
-    pico_tree_foreach_safe(index, &NCache, _tmp)
-    {
-        n = index->keyValue;
-        if ( now > n->expire) {
-            pico_ipv6_nd_timer_elapsed(now, n);
+    if (last >= nd_wheel_tick + PICO_ND_TIMER_SLOTS)
+        nd_wheel_tick = last - PICO_ND_TIMER_SLOTS + 1;
+
+    while (nd_wheel_tick <= last) {
+        /* Detach the slot, timers rescheduled from here land in later ticks */
+        due = nd_wheel[nd_wheel_tick & (PICO_ND_TIMER_SLOTS - 1)];
+        nd_wheel[nd_wheel_tick & (PICO_ND_TIMER_SLOTS - 1)] = NULL;
+        if (due)
+            due->tprev = &due;
+
+        nd_wheel_tick++;
+        while ((n = due) != NULL) {
+            pico_nd_timer_unlink(n);
+            if (now > n->expire)
+                pico_ipv6_nd_timer_elapsed(now, n);
+            else
+                pico_nd_timer_schedule(n);
         }
     }
-    pico_timer_add(200, pico_ipv6_nd_timer_callback, NULL);
+    pico_timer_add(PICO_ND_TIMER_TICK, pico_ipv6_nd_timer_callback, NULL);
 }
 
 #define PICO_IPV6_ND_MIN_RADV_INTERVAL  (5000)
@@ -924,7 +1046,7 @@ static void pico_ipv6_nd_ra_timer_callback(pico_time now, void *arg)
 struct pico_eth *pico_ipv6_get_neighbor(struct pico_frame *f)
 {
     struct pico_ipv6_hdr *hdr = NULL;
-    struct pico_ipv6_link *l = NULL;
+    struct pico_nd_dst *d;
     if (!f)
         return NULL;
 
@@ -933,36 +1055,54 @@ struct pico_eth *pico_ipv6_get_neighbor(struct pico_frame *f)
     if (pico_ipv6_link_istentative(&hdr->src))
         return NULL;
 
-    /* address belongs to ourselves? */
-    l = pico_ipv6_link_get(&hdr->dst);
-    if (l)
-        return &l->dev->eth->mac;
+    d = pico_nd_dst_get(&hdr->dst, f->dev);
+    if (!d)
+        return NULL;
 
-    return pico_nd_get(&hdr->dst, f->dev);
+    if (d->local)
+        return d->local;
+
+    return pico_nd_get_neighbor(d->n);
 }
 
 void pico_ipv6_nd_postpone(struct pico_frame *f)
 {
-    int i;
-    static int last_enq = -1;
-    struct pico_frame *cp = pico_frame_copy(f);
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++)
-    {
-        if (!frames_queued_v6[i]) {
-            frames_queued_v6[i] = cp;
-            last_enq = i;
-            return;
-        }
-    }
-    /* Overwrite the oldest frame in the buffer */
-    if (++last_enq >= PICO_ND_MAX_FRAMES_QUEUED) {
-        last_enq = 0;
+    struct pico_ipv6_hdr *hdr = (struct pico_ipv6_hdr *)f->net_hdr;
+    struct pico_ipv6_neighbor *n;
+    struct pico_nd_dst *d;
+    struct pico_frame *cp;
+
+    if (!hdr || pico_ipv6_link_istentative(&hdr->src))
+        return;
+
+    d = pico_nd_dst_get(&hdr->dst, f->dev);
+    if (!d || !d->n || (d->n->state != PICO_ND_STATE_INCOMPLETE))
+        return;
+
+    n = d->n;
+    cp = pico_frame_copy(f);
+    if (!cp)
+        return;
+
+    /* Overwrite the oldest frame in the queue */
+    if (n->frames_count >= PICO_ND_MAX_FRAMES_QUEUED) {
+        struct pico_frame *old = n->frames;
+        n->frames = old->next;
+        if (!n->frames)
+            n->frames_tail = NULL;
+
+        n->frames_count--;
+        pico_frame_discard(old);
     }
 
-    if (frames_queued_v6[last_enq])
-        pico_frame_discard(frames_queued_v6[last_enq]);
+    cp->next = NULL;
+    if (n->frames_tail)
+        n->frames_tail->next = cp;
+    else
+        n->frames = cp;
 
-    frames_queued_v6[last_enq] = cp;
+    n->frames_tail = cp;
+    n->frames_count++;
 }
 
 
@@ -1001,7 +1141,7 @@ int pico_ipv6_nd_recv(struct pico_frame *f)
 
 void pico_ipv6_nd_init(void)
 {
-    pico_timer_add(200, pico_ipv6_nd_timer_callback, NULL);
+    pico_timer_add(PICO_ND_TIMER_TICK, pico_ipv6_nd_timer_callback, NULL);
     pico_timer_add(200, pico_ipv6_nd_ra_timer_callback, NULL);
     pico_timer_add(1000, pico_ipv6_check_lifetime_expired, NULL);
 }
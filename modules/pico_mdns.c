@@ -107,7 +107,7 @@ struct pico_mdns_cookie
 /* MARK: TREES & GLOBAL VARIABLES */
 
 /* MDNS Communication variables */
-static struct pico_socket *mdns_sock_ipv4 = NULL;
+static PICO_TLS struct pico_socket *mdns_sock_ipv4 = NULL;
 static uint16_t mdns_port = 5353u;
 static struct pico_ip4 inaddr_any = {
     0
@@ -116,8 +116,8 @@ static struct pico_ip4 inaddr_any = {
 /* ****************************************************************************
  *  Hostname for this machine, only 1 hostname can be set.
  * ****************************************************************************/
-static char *_hostname = NULL;
-static void (*init_callback)(pico_mdns_rtree *, char *, void *) = 0;
+static PICO_TLS char *_hostname = NULL;
+static PICO_TLS void (*init_callback)(pico_mdns_rtree *, char *, void *) = 0;
 
 /* ****************************************************************************
  *  Compares 2 mDNS records by name and type only
@@ -212,14 +212,14 @@ pico_mdns_cookie_cmp( void *ka, void *kb )
 
 #if PICO_MDNS_ALLOW_CACHING == 1
 /* Cache records from mDNS peers on the network */
-PICO_TREE_DECLARE(Cache, &pico_mdns_record_cmp);
+PICO_TLS PICO_TREE_DECLARE(Cache, &pico_mdns_record_cmp);
 #endif
 
 /* My records for which I want to have the authority */
-PICO_TREE_DECLARE(MyRecords, &pico_mdns_record_cmp_name_type);
+PICO_TLS PICO_TREE_DECLARE(MyRecords, &pico_mdns_record_cmp_name_type);
 
 /* Cookie-tree */
-PICO_TREE_DECLARE(Cookies, &pico_mdns_cookie_cmp);
+PICO_TLS PICO_TREE_DECLARE(Cookies, &pico_mdns_cookie_cmp);
 
 /* ****************************************************************************
  *  MARK: PROTOTYPES                                                          */
@@ -1194,7 +1194,7 @@ pico_mdns_my_records_add( pico_mdns_rtree *records, uint8_t reclaim )
 {
     struct pico_tree_node *node = NULL;
     struct pico_mdns_record *record = NULL;
-    static uint8_t claim_id_count = 0;
+    static PICO_TLS uint8_t claim_id_count = 0;
 
     if (!reclaim)
         ++claim_id_count;
@@ -31,7 +31,7 @@
 #define MLDV2_ALL_ROUTER_GROUP           "FF02:0:0:0:0:0:0:16"
 #define MLD_ROUTER_ALERT_LEN             (8)
  
-uint8_t pico_mld_flag = 0;
+PICO_TLS uint8_t pico_mld_flag = 0;
 
 PACKED_STRUCT_DEF mld_message {
 	uint8_t type;
@@ -144,7 +144,7 @@ static void pico_mld_report_expired(struct mld_timer *t) {
     p->event = MLD_EVENT_TIMER_EXPIRED;
     pico_mld_process_event(p);
 }
-PICO_TREE_DECLARE(MLDTimers, mld_timer_cmp);
+PICO_TLS PICO_TREE_DECLARE(MLDTimers, mld_timer_cmp);
 static void pico_mld_v1querier_expired(struct mld_timer *t)
 {
     struct pico_ipv6_link *link = NULL;
@@ -183,7 +183,7 @@ static int mld_parameters_cmp(void *ka, void *kb) {
     return mldparm_link_compare(a, b);
 }
 
-PICO_TREE_DECLARE(MLDParameters, mld_parameters_cmp);
+PICO_TLS PICO_TREE_DECLARE(MLDParameters, mld_parameters_cmp);
 
 static int pico_mld_delete_parameter(struct mld_parameters *p) {
     if (pico_tree_delete(&MLDParameters, p))
@@ -348,8 +348,8 @@ static int mld_sources_cmp(void *ka, void *kb) {
     return pico_ipv6_compare(a, b);
 }
 
-PICO_TREE_DECLARE(MLDAllow, mld_sources_cmp);
-PICO_TREE_DECLARE(MLDBlock, mld_sources_cmp);
+PICO_TLS PICO_TREE_DECLARE(MLDAllow, mld_sources_cmp);
+PICO_TLS PICO_TREE_DECLARE(MLDBlock, mld_sources_cmp);
 
 static struct mld_parameters *pico_mld_find_parameter(struct pico_ip6 *mcast_link, struct pico_ip6 *mcast_group) {
     struct mld_parameters test = {
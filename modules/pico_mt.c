@@ -0,0 +1,263 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_socket.h"
+#include "pico_spsc.h"
+#include "pico_evq.h"
+#include "pico_mt.h"
+
+#ifdef PICO_SUPPORT_MT
+
+/* Front-end for applications running on other threads than the stack.
+ * Each application thread owns a context: a ring of operations to the
+ * stack and a ring of completed operations back, both lock free, and an
+ * event queue where the sockets opened through the context are registered.
+ * pico_stack_tick runs the posted operations first, and at its end it
+ * completes the PICO_MT_WAIT operations that have events to report.
+ *
+ * Nothing else in the stack is touched by the application threads: the
+ * operations are run by the stack thread, which is the only one to see
+ * the sockets and pico_err. */
+
+#define PICO_MT_DEFAULT_EVENTS (PICO_SOCK_EV_RD | PICO_SOCK_EV_CONN | PICO_SOCK_EV_FIN)
+
+struct pico_mt_ctx {
+    struct pico_spsc cmd;       /* application -> stack */
+    struct pico_spsc done;      /* stack -> application */
+    struct pico_evq *evq;
+    struct pico_mt_op *waiting, *waiting_tail;  /* PICO_MT_WAIT with no event yet */
+    struct pico_mt_op *backlog, *backlog_tail;  /* completed, the done ring was full */
+    struct pico_mt_ctx *next;
+};
+
+static PICO_TLS struct pico_mt_ctx *mt_contexts = NULL;
+
+static void pico_mt_append(struct pico_mt_op **head, struct pico_mt_op **tail, struct pico_mt_op *op)
+{
+    op->next = NULL;
+    if (*tail)
+        (*tail)->next = op;
+    else
+        *head = op;
+
+    *tail = op;
+}
+
+static struct pico_mt_op *pico_mt_take(struct pico_mt_op **head, struct pico_mt_op **tail)
+{
+    struct pico_mt_op *op = *head;
+
+    *head = op->next;
+    if (!*head)
+        *tail = NULL;
+
+    op->next = NULL;
+    return op;
+}
+
+static void pico_mt_done(struct pico_mt_ctx *ctx, struct pico_mt_op *op, int ret)
+{
+    op->ret = ret;
+    op->err = (ret < 0) ? (int)pico_err : 0;
+    if (ctx->backlog || (pico_spsc_push(&ctx->done, op) < 0))
+        pico_mt_append(&ctx->backlog, &ctx->backlog_tail, op);
+}
+
+static int pico_mt_register(struct pico_mt_ctx *ctx, struct pico_socket *s, struct pico_mt_op *op)
+{
+    uint16_t events = op->events ? op->events : PICO_MT_DEFAULT_EVENTS;
+
+    if (pico_evq_add(ctx->evq, s, events, op->flags, op->data) < 0) {
+        pico_socket_close(s);
+        return -1;
+    }
+
+    op->s = s;
+    return 0;
+}
+
+static int pico_mt_open(struct pico_mt_ctx *ctx, struct pico_mt_op *op)
+{
+    struct pico_socket *s = pico_socket_open(op->net, op->proto, NULL);
+
+    if (!s)
+        return -1;
+
+    return pico_mt_register(ctx, s, op);
+}
+
+static int pico_mt_accept(struct pico_mt_ctx *ctx, struct pico_mt_op *op)
+{
+    struct pico_socket *s = pico_socket_accept(op->s, &op->addr, &op->port);
+
+    if (!s)
+        return -1;
+
+    return pico_mt_register(ctx, s, op);
+}
+
+static void pico_mt_wait(struct pico_mt_ctx *ctx, struct pico_mt_op *op)
+{
+    int n;
+
+    if (!ctx->waiting) {
+        n = pico_evq_wait(ctx->evq, (struct pico_evq_event *)op->buf, op->len);
+        if (n != 0) {
+            pico_mt_done(ctx, op, n);
+            return;
+        }
+    }
+
+    pico_mt_append(&ctx->waiting, &ctx->waiting_tail, op);
+}
+
+static void pico_mt_exec(struct pico_mt_ctx *ctx, struct pico_mt_op *op)
+{
+    int ret;
+
+    pico_err = PICO_ERR_NOERR;
+    switch (op->type) {
+    case PICO_MT_OPEN:
+        ret = pico_mt_open(ctx, op);
+        break;
+    case PICO_MT_BIND:
+        ret = pico_socket_bind(op->s, &op->addr, &op->port);
+        break;
+    case PICO_MT_CONNECT:
+        ret = pico_socket_connect(op->s, &op->addr, op->port);
+        break;
+    case PICO_MT_LISTEN:
+        ret = pico_socket_listen(op->s, op->len);
+        break;
+    case PICO_MT_ACCEPT:
+        ret = pico_mt_accept(ctx, op);
+        break;
+    case PICO_MT_SEND:
+        ret = pico_socket_send(op->s, op->buf, op->len);
+        break;
+    case PICO_MT_SENDTO:
+        ret = pico_socket_sendto(op->s, op->buf, op->len, &op->addr, op->port);
+        break;
+    case PICO_MT_RECV:
+        ret = pico_socket_recv(op->s, op->buf, op->len);
+        break;
+    case PICO_MT_RECVFROM:
+        ret = pico_socket_recvfrom(op->s, op->buf, op->len, &op->addr, &op->port);
+        break;
+    case PICO_MT_CLOSE:
+        ret = pico_socket_close(op->s);
+        break;
+    case PICO_MT_WAIT:
+        pico_mt_wait(ctx, op);
+        return;
+    default:
+        pico_err = PICO_ERR_EINVAL;
+        ret = -1;
+        break;
+    }
+    pico_mt_done(ctx, op, ret);
+}
+
+void pico_mt_run_commands(void)
+{
+    struct pico_mt_ctx *ctx;
+    struct pico_mt_op *op;
+    uint32_t n;
+
+    for (ctx = mt_contexts; ctx; ctx = ctx->next) {
+        /* what was posted before the tick, not what keeps coming during it */
+        n = pico_spsc_count(&ctx->cmd);
+        while (n-- && ((op = pico_spsc_pop(&ctx->cmd)) != NULL))
+            pico_mt_exec(ctx, op);
+    }
+}
+
+void pico_mt_run_completions(void)
+{
+    struct pico_mt_ctx *ctx;
+    struct pico_mt_op *op;
+    int n;
+
+    for (ctx = mt_contexts; ctx; ctx = ctx->next) {
+        while (ctx->waiting) {
+            op = ctx->waiting;
+            n = pico_evq_wait(ctx->evq, (struct pico_evq_event *)op->buf, op->len);
+            if (n == 0)
+                break;
+
+            pico_mt_done(ctx, pico_mt_take(&ctx->waiting, &ctx->waiting_tail), n);
+        }
+        while (ctx->backlog && (pico_spsc_push(&ctx->done, ctx->backlog) == 0))
+            (void)pico_mt_take(&ctx->backlog, &ctx->backlog_tail);
+    }
+}
+
+/* depth: size of the two rings, a power of two */
+struct pico_mt_ctx *pico_mt_ctx_create(uint32_t depth)
+{
+    struct pico_mt_ctx *ctx;
+    void **slots;
+
+    if (!depth || (depth & (depth - 1u)) || (depth > 0x10000u)) {
+        pico_err = PICO_ERR_EINVAL;
+        return NULL;
+    }
+
+    ctx = PICO_ZALLOC(sizeof(struct pico_mt_ctx) + 2u * depth * sizeof(void *));
+    if (!ctx) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    ctx->evq = pico_evq_create();
+    if (!ctx->evq) {
+        PICO_FREE(ctx);
+        return NULL;
+    }
+
+    slots = (void **)(ctx + 1);
+    (void)pico_spsc_init(&ctx->cmd, slots, depth);
+    (void)pico_spsc_init(&ctx->done, slots + depth, depth);
+    ctx->next = mt_contexts;
+    mt_contexts = ctx;
+    return ctx;
+}
+
+/* The operations still in the context are dropped, the sockets stay open */
+void pico_mt_ctx_destroy(struct pico_mt_ctx *ctx)
+{
+    struct pico_mt_ctx **p;
+
+    if (!ctx)
+        return;
+
+    for (p = &mt_contexts; *p; p = &(*p)->next) {
+        if (*p == ctx) {
+            *p = ctx->next;
+            break;
+        }
+    }
+    pico_evq_destroy(ctx->evq);
+    PICO_FREE(ctx);
+}
+
+/* Application thread. Returns -1 if the ring of operations is full. */
+int pico_mt_post(struct pico_mt_ctx *ctx, struct pico_mt_op *op)
+{
+    return pico_spsc_push(&ctx->cmd, op);
+}
+
+/* Application thread. Returns the next completed operation, or NULL. */
+struct pico_mt_op *pico_mt_complete(struct pico_mt_ctx *ctx)
+{
+    return (struct pico_mt_op *)pico_spsc_pop(&ctx->done);
+}
+
+#endif
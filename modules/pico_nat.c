@@ -14,7 +14,10 @@
 #include "pico_udp.h"
 #include "pico_ipv4.h"
 #include "pico_addressing.h"
+#include "pico_socket.h"
 #include "pico_nat.h"
+#include "pico_conntrack.h"
+#include "pico_shard.h"
 
 #ifdef PICO_SUPPORT_IPV4
 #ifdef PICO_SUPPORT_NAT
@@ -22,125 +25,361 @@
 #define nat_dbg(...) do {} while(0)
 /* #define nat_dbg dbg */
 #define PICO_NAT_TIMEWAIT  240000 /* msec (4 mins) */
+#define PICO_NAT_TCP_TIMEOUT (24ull * 3600ull * 1000ull) /* msec, idle established TCP (24 hours) */
+
+/* Sessions age on the state of the connection that refreshed them last, as
+ * tracked by pico_conntrack: TIMEWAIT until a TCP connection is answered and
+ * once it is closed, TCP_TIMEOUT while established. Connections that
+ * pico_conntrack does not track, when its table is full, get their state
+ * from the TCP flags seen by the session. */
 
 #define PICO_NAT_INBOUND   0
 #define PICO_NAT_OUTBOUND  1
 
+/* Sessions are kept in two hash tables, by NAT port and by source.
+ * Expired entries are dropped lazily from the buckets a lookup walks,
+ * and a timer sweeps 1/PICO_NAT_SWEEP_SLICES of the buckets each interval. */
+#define PICO_NAT_HASH_MIN       64u
+#define PICO_NAT_HASH_LOAD      2u  /* average chain length before the table grows */
+#define PICO_NAT_SWEEP_INTERVAL 1000 /* msec */
+#define PICO_NAT_SWEEP_SLICES   64u
+
+/* External ports handed out by the NAT, tracked in a bitmap per protocol
+ * and NAT address. Mappings are endpoint independent (RFC 4787): a source
+ * keeps its external port on a NAT address whatever the destination. */
+#define PICO_NAT_PORT_MIN   1024u
+#define PICO_NAT_PORT_COUNT (65536u - PICO_NAT_PORT_MIN)
+#define PICO_NAT_PORT_WORDS (PICO_NAT_PORT_COUNT >> 5)
+#define PICO_NAT_PORT_RECLAIM 16u /* ports whose sessions are checked when all are taken */
+
+struct pico_nat_ports {
+    uint32_t *map;  /* bit set: port in use */
+    uint32_t next;  /* next-fit cursor, randomized on first use */
+    uint32_t used;
+};
+
+struct pico_nat_link {
+    struct pico_ipv4_link *link;
+    struct pico_nat_ports ports[2]; /* TCP, UDP */
+};
+
 struct pico_nat_tuple {
     uint8_t proto;
-    uint16_t conn_active : 11;
-    uint16_t portforward : 1;
-    uint16_t rst : 1;
-    uint16_t syn : 1;
-    uint16_t fin_in : 1;
-    uint16_t fin_out : 1;
+    uint8_t portforward : 1;
+    uint8_t answered : 1;   /* untracked TCP: ACK seen inbound */
+    uint8_t closed : 1;     /* untracked TCP: FIN or RST seen */
     uint16_t src_port;
     uint16_t dst_port;
     uint16_t nat_port;
     struct pico_ip4 src_addr;
     struct pico_ip4 dst_addr;
     struct pico_ip4 nat_addr;
+    pico_time expire; /* 0: never */
+    struct pico_nat_link *link; /* owner of nat_port, if allocated from a NAT link */
+    struct pico_nat_tuple *next_in;
+    struct pico_nat_tuple *next_out;
 };
 
-static struct pico_ipv4_link *nat_link = NULL;
-
-static int nat_cmp_natport(struct pico_nat_tuple *a, struct pico_nat_tuple *b)
-{
+struct pico_nat_table {
+    struct pico_nat_tuple **in;  /* by nat_port, proto */
+    struct pico_nat_tuple **out; /* by src_addr, src_port, proto */
+    uint32_t size;               /* buckets, power of two */
+    uint32_t count;
+    uint32_t sweep;              /* next bucket to sweep */
+    uint8_t timer;               /* cleanup timer armed */
+};
 
-    if (a->nat_port < b->nat_port)
-        return -1;
+static PICO_TLS struct pico_nat_table nat_table = {
+    0
+};
 
-    if (a->nat_port > b->nat_port)
+static int nat_cmp_link(void *ka, void *kb)
+{
+    struct pico_nat_link *a = ka, *b = kb;
+    return pico_ipv4_compare(&a->link->address, &b->link->address);
+}
 
-        return 1;
+PICO_TLS PICO_TREE_DECLARE(NATLinks, nat_cmp_link);
 
-    return 0;
+static struct pico_nat_link *pico_ipv4_nat_link_find(struct pico_ip4 *addr)
+{
+    struct pico_ipv4_link l = {
+        0
+    };
+    struct pico_nat_link test = {
+        0
+    };
 
+    l.address = *addr;
+    test.link = &l;
+    return pico_tree_findKey(&NATLinks, &test);
 }
 
-static int nat_cmp_srcport(struct pico_nat_tuple *a, struct pico_nat_tuple *b)
+static struct pico_nat_ports *pico_ipv4_nat_ports(struct pico_nat_link *nl, uint8_t proto)
 {
+    if (!nl)
+        return NULL;
 
-    if (a->src_port < b->src_port)
-        return -1;
-
-    if (a->src_port > b->src_port)
-
-        return 1;
+    if (proto == PICO_PROTO_TCP)
+        return &nl->ports[0];
 
-    return 0;
+    if (proto == PICO_PROTO_UDP)
+        return &nl->ports[1];
 
+    return NULL;
 }
 
-static int nat_cmp_proto(struct pico_nat_tuple *a, struct pico_nat_tuple *b)
+static inline int pico_ipv4_nat_port_idx(uint16_t port, uint32_t *idx)
 {
-    if (a->proto < b->proto)
+    uint16_t p = short_be(port);
+    if (p < PICO_NAT_PORT_MIN)
         return -1;
 
-    if (a->proto > b->proto)
-        return 1;
-
+    *idx = (uint32_t)p - PICO_NAT_PORT_MIN;
     return 0;
 }
 
-static int nat_cmp_address(struct pico_nat_tuple *a, struct pico_nat_tuple *b)
+static void pico_ipv4_nat_port_set(struct pico_nat_ports *p, uint32_t idx)
 {
-    return pico_ipv4_compare(&a->src_addr, &b->src_addr);
+    p->map[idx >> 5] |= (1u << (idx & 31u));
+    p->used++;
 }
 
-static int nat_cmp_inbound(void *ka, void *kb)
+static void pico_ipv4_nat_port_release(struct pico_nat_link *nl, uint8_t proto, uint16_t port)
 {
-    struct pico_nat_tuple *a = ka, *b = kb;
-    int cport = nat_cmp_natport(a, b);
-    if (cport)
-        return cport;
+    struct pico_nat_ports *p = pico_ipv4_nat_ports(nl, proto);
+    uint32_t idx;
+
+    if (!p || !p->map || (pico_ipv4_nat_port_idx(port, &idx) < 0))
+        return;
 
-    return nat_cmp_proto(a, b);
+    if (p->map[idx >> 5] & (1u << (idx & 31u))) {
+        p->map[idx >> 5] &= ~(1u << (idx & 31u));
+        p->used--;
+    }
 }
 
+/* The bitmap is only allocated once a port is needed on the NAT address */
+static int pico_ipv4_nat_ports_init(struct pico_nat_ports *p)
+{
+    if (p->map)
+        return 0;
+
+    p->map = PICO_ZALLOC(PICO_NAT_PORT_WORDS * sizeof(uint32_t));
+    if (!p->map) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    p->next = pico_rand() % PICO_NAT_PORT_COUNT;
+#ifdef PICO_SUPPORT_SHARD
+    p->next = (uint32_t)pico_shard_port_hint((uint16_t)(p->next + PICO_NAT_PORT_MIN)) - PICO_NAT_PORT_MIN;
+#endif
+    p->used = 0;
+    return 0;
+}
 
-static int nat_cmp_outbound(void *ka, void *kb)
+static int pico_ipv4_nat_port_reserve(struct pico_nat_link *nl, uint8_t proto, uint16_t port)
 {
-    struct pico_nat_tuple *a = ka, *b = kb;
-    int caddr, cport;
+    struct pico_nat_ports *p = pico_ipv4_nat_ports(nl, proto);
+    uint32_t idx;
 
-    caddr = nat_cmp_address(a, b);
-    if (caddr)
-        return caddr;
+    if (!p || (pico_ipv4_nat_port_idx(port, &idx) < 0) || (pico_ipv4_nat_ports_init(p) < 0))
+        return -1;
+
+    if (!(p->map[idx >> 5] & (1u << (idx & 31u))))
+        pico_ipv4_nat_port_set(p, idx);
+
+    return 0;
+}
 
-    cport = nat_cmp_srcport(a, b);
+static inline uint32_t nat_hash_mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
 
-    if (cport)
-        return cport;
+static inline uint32_t nat_hash_in(uint16_t nat_port, uint8_t proto)
+{
+    return nat_hash_mix(((uint32_t)nat_port << 8) | proto);
+}
 
-    return nat_cmp_proto(a, b);
+static inline uint32_t nat_hash_out(struct pico_ip4 *src_addr, uint16_t src_port, uint8_t proto)
+{
+    return nat_hash_mix(src_addr->addr ^ nat_hash_mix(((uint32_t)src_port << 8) | proto));
 }
 
-PICO_TREE_DECLARE(NATOutbound, nat_cmp_outbound);
-PICO_TREE_DECLARE(NATInbound, nat_cmp_inbound);
+static inline int nat_expired(struct pico_nat_tuple *t, pico_time now)
+{
+    return (t->expire != 0) && (t->expire <= now);
+}
 
 void pico_ipv4_nat_print_table(void)
 {
     struct pico_nat_tuple *t = NULL;
-    struct pico_tree_node *index = NULL;
+    uint32_t i;
     (void)t;
 
     nat_dbg("++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
     nat_dbg("+                                                        NAT table                                                       +\n");
     nat_dbg("+------------------------------------------------------------------------------------------------------------------------+\n");
-    nat_dbg("+ src_addr | src_port | dst_addr | dst_port | nat_addr | nat_port | proto | conn active | FIN1 | FIN2 | SYN | RST | FORW +\n");
+    nat_dbg("+ src_addr | src_port | dst_addr | dst_port | nat_addr | nat_port | proto |   expire    | FORW                              +\n");
     nat_dbg("+------------------------------------------------------------------------------------------------------------------------+\n");
 
-    pico_tree_foreach(index, &NATOutbound)
-    {
-        t = index->keyValue;
-        nat_dbg("+ %08X |  %05u   | %08X |  %05u   | %08X |  %05u   |  %03u  |     %03u     |   %u  |   %u  |  %u  |  %u  |   %u  +\n",
-                long_be(t->src_addr.addr), t->src_port, long_be(t->dst_addr.addr), t->dst_port, long_be(t->nat_addr.addr), t->nat_port,
-                t->proto, t->conn_active, t->fin_in, t->fin_out, t->syn, t->rst, t->portforward);
+    for (i = 0; i < nat_table.size; i++) {
+        for (t = nat_table.out[i]; t; t = t->next_out) {
+            nat_dbg("+ %08X |  %05u   | %08X |  %05u   | %08X |  %05u   |  %03u  | %11lu |   %u                               +\n",
+                    long_be(t->src_addr.addr), t->src_port, long_be(t->dst_addr.addr), t->dst_port, long_be(t->nat_addr.addr), t->nat_port,
+                    t->proto, (unsigned long)t->expire, t->portforward);
+        }
     }
     nat_dbg("++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++\n");
 }
 
+static void pico_ipv4_nat_hash_del(struct pico_nat_tuple *t)
+{
+    struct pico_nat_tuple **pp;
+    uint32_t mask = nat_table.size - 1u;
+
+    for (pp = &nat_table.in[nat_hash_in(t->nat_port, t->proto) & mask]; *pp; pp = &(*pp)->next_in) {
+        if (*pp == t) {
+            *pp = t->next_in;
+            break;
+        }
+    }
+    for (pp = &nat_table.out[nat_hash_out(&t->src_addr, t->src_port, t->proto) & mask]; *pp; pp = &(*pp)->next_out) {
+        if (*pp == t) {
+            *pp = t->next_out;
+            break;
+        }
+    }
+    nat_table.count--;
+}
+
+static void pico_ipv4_nat_hash_add(struct pico_nat_tuple *t)
+{
+    uint32_t mask = nat_table.size - 1u;
+    uint32_t hin = nat_hash_in(t->nat_port, t->proto) & mask;
+    uint32_t hout = nat_hash_out(&t->src_addr, t->src_port, t->proto) & mask;
+
+    t->next_in = nat_table.in[hin];
+    nat_table.in[hin] = t;
+    t->next_out = nat_table.out[hout];
+    nat_table.out[hout] = t;
+    nat_table.count++;
+}
+
+static void pico_ipv4_nat_free(struct pico_nat_tuple *t)
+{
+    pico_ipv4_nat_hash_del(t);
+    pico_ipv4_nat_port_release(t->link, t->proto, t->nat_port);
+    PICO_FREE(t);
+}
+
+/* Drops the expired sessions of an inbound bucket */
+static void pico_ipv4_nat_expire_bucket(uint32_t idx, pico_time now)
+{
+    struct pico_nat_tuple *t = nat_table.in[idx], *next;
+
+    while (t) {
+        next = t->next_in;
+        if (nat_expired(t, now)) {
+            nat_dbg("NAT: session on port %u expired\n", short_be(t->nat_port));
+            pico_ipv4_nat_free(t);
+        }
+
+        t = next;
+    }
+}
+
+static int pico_ipv4_nat_resize(uint32_t size)
+{
+    struct pico_nat_tuple **in, **out, *t, *next;
+    struct pico_nat_tuple **old_in = nat_table.in;
+    uint32_t old_size = nat_table.size;
+    uint32_t i;
+
+    in = PICO_ZALLOC(size * sizeof(struct pico_nat_tuple *));
+    out = PICO_ZALLOC(size * sizeof(struct pico_nat_tuple *));
+    if (!in || !out) {
+        if (in)
+            PICO_FREE(in);
+
+        if (out)
+            PICO_FREE(out);
+
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    if (nat_table.out)
+        PICO_FREE(nat_table.out);
+
+    nat_table.in = in;
+    nat_table.out = out;
+    nat_table.size = size;
+    nat_table.count = 0;
+    nat_table.sweep = 0;
+    for (i = 0; i < old_size; i++) {
+        for (t = old_in[i]; t; t = next) {
+            next = t->next_in;
+            pico_ipv4_nat_hash_add(t);
+        }
+    }
+    if (old_in)
+        PICO_FREE(old_in);
+
+    return 0;
+}
+
+static inline int nat_addr_match(struct pico_nat_tuple *t, struct pico_ip4 *nat_addr)
+{
+    return !nat_addr || (t->nat_addr.addr == nat_addr->addr);
+}
+
+/* A NULL nat_addr matches sessions on any NAT address */
+static struct pico_nat_tuple *pico_ipv4_nat_find_in(struct pico_ip4 *nat_addr, uint16_t nat_port, uint8_t proto)
+{
+    struct pico_nat_tuple *t;
+    uint32_t idx;
+
+    if (!nat_table.size)
+        return NULL;
+
+    idx = nat_hash_in(nat_port, proto) & (nat_table.size - 1u);
+    pico_ipv4_nat_expire_bucket(idx, pico_tick);
+    for (t = nat_table.in[idx]; t; t = t->next_in) {
+        if ((t->nat_port == nat_port) && (t->proto == proto) && nat_addr_match(t, nat_addr))
+            return t;
+    }
+    return NULL;
+}
+
+static struct pico_nat_tuple *pico_ipv4_nat_find_out(struct pico_ip4 *nat_addr, struct pico_ip4 *src_addr, uint16_t src_port, uint8_t proto)
+{
+    struct pico_nat_tuple *t;
+    uint32_t idx;
+
+    if (!nat_table.size)
+        return NULL;
+
+    idx = nat_hash_out(src_addr, src_port, proto) & (nat_table.size - 1u);
+    for (t = nat_table.out[idx]; t; t = t->next_out) {
+        if ((t->src_addr.addr == src_addr->addr) && (t->src_port == src_port) && (t->proto == proto) && nat_addr_match(t, nat_addr)) {
+            if (!nat_expired(t, pico_tick))
+                return t;
+
+            pico_ipv4_nat_free(t);
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
 /*
    2 options:
     find on nat_port and proto
@@ -149,25 +388,14 @@ void pico_ipv4_nat_print_table(void)
  */
 static struct pico_nat_tuple *pico_ipv4_nat_find_tuple(uint16_t nat_port, struct pico_ip4 *src_addr, uint16_t src_port, uint8_t proto)
 {
-    struct pico_nat_tuple *found = NULL, test = {
+    struct pico_ip4 any = {
         0
     };
 
-    test.nat_port = nat_port;
-    test.src_port = src_port;
-    test.proto = proto;
-    if (src_addr)
-        test.src_addr = *src_addr;
-
     if (nat_port)
-        found = pico_tree_findKey(&NATInbound, &test);
-    else
-        found = pico_tree_findKey(&NATOutbound, &test);
+        return pico_ipv4_nat_find_in(NULL, nat_port, proto);
 
-    if (found)
-        return found;
-    else
-        return NULL;
+    return pico_ipv4_nat_find_out(NULL, src_addr ? src_addr : &any, src_port, proto);
 }
 
 int pico_ipv4_nat_find(uint16_t nat_port, struct pico_ip4 *src_addr, uint16_t src_port, uint8_t proto)
@@ -184,7 +412,17 @@ int pico_ipv4_nat_find(uint16_t nat_port, struct pico_ip4 *src_addr, uint16_t sr
 static struct pico_nat_tuple *pico_ipv4_nat_add(struct pico_ip4 dst_addr, uint16_t dst_port, struct pico_ip4 src_addr, uint16_t src_port,
                                                 struct pico_ip4 nat_addr, uint16_t nat_port, uint8_t proto)
 {
-    struct pico_nat_tuple *t = PICO_ZALLOC(sizeof(struct pico_nat_tuple));
+    struct pico_nat_tuple *t;
+
+    if (pico_ipv4_nat_find_in(&nat_addr, nat_port, proto) || pico_ipv4_nat_find_out(&nat_addr, &src_addr, src_port, proto))
+        return NULL;
+
+    if ((nat_table.count >= (nat_table.size * PICO_NAT_HASH_LOAD)) &&
+        (pico_ipv4_nat_resize(nat_table.size ? (nat_table.size << 1) : PICO_NAT_HASH_MIN) < 0) &&
+        !nat_table.size)
+        return NULL;
+
+    t = PICO_ZALLOC(sizeof(struct pico_nat_tuple));
     if (!t) {
         pico_err = PICO_ERR_ENOMEM;
         return NULL;
@@ -197,40 +435,94 @@ static struct pico_nat_tuple *pico_ipv4_nat_add(struct pico_ip4 dst_addr, uint16
     t->nat_addr = nat_addr;
     t->nat_port = nat_port;
     t->proto = proto;
-    t->conn_active = 1;
-    t->portforward = 0;
-    t->rst = 0;
-    t->syn = 0;
-    t->fin_in = 0;
-    t->fin_out = 0;
-
-    if (pico_tree_insert(&NATOutbound, t)) {
-        PICO_FREE(t);
-        return NULL;
-    }
-
-    if (pico_tree_insert(&NATInbound, t)) {
-        pico_tree_delete(&NATOutbound, t);
-        PICO_FREE(t);
-        return NULL;
-    }
-
+    t->expire = pico_tick + PICO_NAT_TIMEWAIT;
+    pico_ipv4_nat_hash_add(t);
     return t;
 }
 
-static int pico_ipv4_nat_del(uint16_t nat_port, uint8_t proto)
+static int pico_ipv4_nat_del(struct pico_ip4 *nat_addr, uint16_t nat_port, uint8_t proto)
 {
     struct pico_nat_tuple *t = NULL;
-    t = pico_ipv4_nat_find_tuple(nat_port, NULL, 0, proto);
-    if (t) {
-        pico_tree_delete(&NATOutbound, t);
-        pico_tree_delete(&NATInbound, t);
-        PICO_FREE(t);
-    }
+    t = pico_ipv4_nat_find_in(nat_addr, nat_port, proto);
+    if (t)
+        pico_ipv4_nat_free(t);
 
     return 0;
 }
 
+/* Next-fit over the port bitmap of the NAT address, skipping full words.
+ * Ports still held by expired sessions are reclaimed before giving up. */
+static int pico_ipv4_nat_port_take(struct pico_nat_link *nl, struct pico_nat_ports *p, uint8_t proto, uint32_t idx, uint16_t *port)
+{
+    uint16_t nport = short_be((uint16_t)(idx + PICO_NAT_PORT_MIN));
+
+    if (p->map[idx >> 5] & (1u << (idx & 31u)))
+        return -1;
+
+#ifdef PICO_SUPPORT_SHARD
+    /* the replies must be steered back to this instance */
+    if (!pico_shard_port_mine(nport))
+        return -1;
+
+#endif
+    /* skip ports bound by local sockets or taken by a port forward */
+    if (pico_get_sockport(proto, nport) ||
+        pico_ipv4_nat_find_in(&nl->link->address, nport, proto))
+        return -1;
+
+    pico_ipv4_nat_port_set(p, idx);
+    p->next = (idx + 1u) % PICO_NAT_PORT_COUNT;
+    *port = nport;
+    return 0;
+}
+
+static int pico_ipv4_nat_port_alloc(struct pico_nat_link *nl, uint8_t proto, uint16_t *port)
+{
+    struct pico_nat_ports *p = pico_ipv4_nat_ports(nl, proto);
+    uint32_t idx, scanned, i;
+
+    if (!p) {
+        pico_err = PICO_ERR_EPROTONOSUPPORT;
+        return -1;
+    }
+
+    if (pico_ipv4_nat_ports_init(p) < 0)
+        return -1;
+
+    idx = p->next;
+    scanned = 0;
+    while (scanned < PICO_NAT_PORT_COUNT) {
+        if (p->map[idx >> 5] == 0xFFFFFFFFu) {
+            scanned += 32u - (idx & 31u);
+            idx = (idx | 31u) + 1u;
+        } else {
+            if (pico_ipv4_nat_port_take(nl, p, proto, idx, port) == 0)
+                return 0;
+
+            scanned++;
+            idx++;
+        }
+
+        if (idx >= PICO_NAT_PORT_COUNT)
+            idx = 0;
+    }
+
+    /* All taken: expired sessions may still hold some. Only the buckets of
+     * the next few ports are swept here, the cursor moves on so that the
+     * next calls look further, and the sweep timer does the rest. */
+    idx = p->next;
+    for (i = 0; (i < PICO_NAT_PORT_RECLAIM) && nat_table.size; i++) {
+        pico_ipv4_nat_expire_bucket(nat_hash_in(short_be((uint16_t)(idx + PICO_NAT_PORT_MIN)), proto) & (nat_table.size - 1u), pico_tick);
+        if (pico_ipv4_nat_port_take(nl, p, proto, idx, port) == 0)
+            return 0;
+
+        idx = (idx + 1u) % PICO_NAT_PORT_COUNT;
+    }
+    p->next = idx;
+    pico_err = PICO_ERR_EAGAIN;
+    return -1;
+}
+
 static struct pico_trans *pico_nat_generate_tuple_trans(struct pico_ipv4_hdr *net, struct pico_frame *f)
 {
     struct pico_trans *trans = NULL;
@@ -254,64 +546,73 @@ static struct pico_trans *pico_nat_generate_tuple_trans(struct pico_ipv4_hdr *ne
     return trans;
 }
 
-static struct pico_nat_tuple *pico_ipv4_nat_generate_tuple(struct pico_frame *f)
+static struct pico_nat_tuple *pico_ipv4_nat_generate_tuple(struct pico_frame *f, struct pico_nat_link *nl)
 {
     struct pico_trans *trans = NULL;
     struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct pico_nat_tuple *t;
     uint16_t nport = 0;
-    uint8_t retry = 32;
-
-    /* generate NAT port */
-    do {
-        uint32_t rand = pico_rand();
-        nport = (uint16_t) (rand & 0xFFFFU);
-        nport = (uint16_t)((nport % (65535 - 1024)) + 1024U);
-        nport = short_be(nport);
 
-        if (pico_is_port_free(net->proto, nport, NULL, &pico_proto_ipv4))
-            break;
-    } while (--retry);
+    trans = pico_nat_generate_tuple_trans(net, f);
+    if(!trans)
+        return NULL;
 
-    if (!retry)
+    if (pico_ipv4_nat_port_alloc(nl, net->proto, &nport) < 0)
         return NULL;
 
-    trans = pico_nat_generate_tuple_trans(net, f);
-    if(!trans)
+    t = pico_ipv4_nat_add(net->dst, trans->dport, net->src, trans->sport, nl->link->address, nport, net->proto);
+    if (!t) {
+        pico_ipv4_nat_port_release(nl, net->proto, nport);
         return NULL;
+    }
 
-    return pico_ipv4_nat_add(net->dst, trans->dport, net->src, trans->sport, nat_link->address, nport, net->proto);
-    /* XXX return pico_ipv4_nat_add(nat_link->address, port, net->src, trans->sport, net->proto); */
+    t->link = nl;
+    return t;
 }
 
-static inline void pico_ipv4_nat_set_tcp_flags(struct pico_nat_tuple *t, struct pico_frame *f, uint8_t direction)
+static uint8_t pico_ipv4_nat_tcp_state(struct pico_nat_tuple *t, struct pico_frame *f, uint8_t direction)
 {
     struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)f->transport_hdr;
-    if (tcp->flags & PICO_TCP_SYN)
-        t->syn = 1;
 
-    if (tcp->flags & PICO_TCP_RST)
-        t->rst = 1;
+    if ((tcp->flags & (PICO_TCP_SYN | PICO_TCP_ACK)) == PICO_TCP_SYN) {
+        /* the tuple is reused by a new connection */
+        t->answered = 0;
+        t->closed = 0;
+    }
+
+    if ((tcp->flags & PICO_TCP_ACK) && (direction == PICO_NAT_INBOUND))
+        t->answered = 1;
+
+    if (tcp->flags & (PICO_TCP_FIN | PICO_TCP_RST))
+        t->closed = 1;
 
-    if ((tcp->flags & PICO_TCP_FIN) && (direction == PICO_NAT_INBOUND))
-        t->fin_in = 1;
+    if (t->closed)
+        return PICO_CT_CLOSED;
 
-    if ((tcp->flags & PICO_TCP_FIN) && (direction == PICO_NAT_OUTBOUND))
-        t->fin_out = 1;
+    return t->answered ? PICO_CT_ESTABLISHED : PICO_CT_NEW;
 }
 
-static int pico_ipv4_nat_sniff_session(struct pico_nat_tuple *t, struct pico_frame *f, uint8_t direction)
+static int pico_ipv4_nat_sniff_session(struct pico_nat_tuple *t, struct pico_frame *f, uint8_t state, uint8_t direction)
 {
     struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    pico_time now = pico_tick;
 
     switch (net->proto) {
     case PICO_PROTO_TCP:
     {
-        pico_ipv4_nat_set_tcp_flags(t, f, direction);
+        if (state == PICO_CT_UNTRACKED)
+            state = pico_ipv4_nat_tcp_state(t, f, direction);
+
+        if (state & (PICO_CT_NEW | PICO_CT_CLOSED))
+            t->expire = now + PICO_NAT_TIMEWAIT;
+        else
+            t->expire = now + PICO_NAT_TCP_TIMEOUT;
+
         break;
     }
 
     case PICO_PROTO_UDP:
-        t->conn_active = 1;
+        t->expire = now + PICO_NAT_TIMEWAIT;
         break;
 
     case PICO_PROTO_ICMP4:
@@ -322,63 +623,28 @@ static int pico_ipv4_nat_sniff_session(struct pico_nat_tuple *t, struct pico_fra
         return -1;
     }
 
+    if (t->portforward)
+        t->expire = 0;
+
     return 0;
 }
 
+/* Sweeps the next slice of the table, so that each bucket is visited
+ * every PICO_NAT_SWEEP_SLICES intervals whatever the number of sessions. */
 static void pico_ipv4_nat_table_cleanup(pico_time now, void *_unused)
 {
-    struct pico_tree_node *index = NULL, *_tmp = NULL;
-    struct pico_nat_tuple *t = NULL;
-    IGNORE_PARAMETER(now);
+    uint32_t n;
     IGNORE_PARAMETER(_unused);
-    nat_dbg("NAT: before table cleanup:\n");
-    pico_ipv4_nat_print_table();
 
-    pico_tree_foreach_reverse_safe(index, &NATOutbound, _tmp)
-    {
-        t = index->keyValue;
-        switch (t->proto)
-        {
-        case PICO_PROTO_TCP:
-            if (t->portforward)
-                break;
-            else if (t->conn_active == 0 || t->conn_active > 360) /* conn active for > 24 hours */
-                pico_ipv4_nat_del(t->nat_port, t->proto);
-            else if (t->rst || (t->fin_in && t->fin_out))
-                t->conn_active = 0;
-            else
-                t->conn_active++;
-
-            break;
-
-        case PICO_PROTO_UDP:
-            if (t->portforward)
-                break;
-            else if (t->conn_active > 1)
-                pico_ipv4_nat_del(t->nat_port, t->proto);
-            else
-                t->conn_active++;
-
-            break;
-
-        case PICO_PROTO_ICMP4:
-            if (t->conn_active > 1)
-                pico_ipv4_nat_del(t->nat_port, t->proto);
-            else
-                t->conn_active++;
-
-        default:
-            /* unknown protocol in NAT table, delete when it has existed NAT_TIMEWAIT */
-            if (t->conn_active > 1)
-                pico_ipv4_nat_del(t->nat_port, t->proto);
-            else
-                t->conn_active++;
+    if (nat_table.size) {
+        n = (nat_table.size / PICO_NAT_SWEEP_SLICES) + 1u;
+        while (n--) {
+            pico_ipv4_nat_expire_bucket(nat_table.sweep, now);
+            nat_table.sweep = (nat_table.sweep + 1u) & (nat_table.size - 1u);
         }
     }
 
-    nat_dbg("NAT: after table cleanup:\n");
-    pico_ipv4_nat_print_table();
-    pico_timer_add(PICO_NAT_TIMEWAIT, pico_ipv4_nat_table_cleanup, NULL);
+    pico_timer_add(PICO_NAT_SWEEP_INTERVAL, pico_ipv4_nat_table_cleanup, NULL);
 }
 
 int pico_ipv4_port_forward(struct pico_ip4 nat_addr, uint16_t nat_port, struct pico_ip4 src_addr, uint16_t src_port, uint8_t proto, uint8_t flag)
@@ -399,10 +665,15 @@ int pico_ipv4_port_forward(struct pico_ip4 nat_addr, uint16_t nat_port, struct p
         }
 
         t->portforward = 1;
+        t->expire = 0;
+        t->link = pico_ipv4_nat_link_find(&nat_addr);
+        if (t->link && (pico_ipv4_nat_port_reserve(t->link, proto, nat_port) < 0))
+            t->link = NULL;
+
         break;
 
     case PICO_NAT_PORT_FORWARD_DEL:
-        return pico_ipv4_nat_del(nat_port, proto);
+        return pico_ipv4_nat_del(&nat_addr, nat_port, proto);
 
     default:
         pico_err = PICO_ERR_EINVAL;
@@ -418,6 +689,7 @@ int pico_ipv4_nat_inbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     struct pico_nat_tuple *tuple = NULL;
     struct pico_trans *trans = NULL;
     struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    uint8_t state = PICO_CT_UNTRACKED;
 
     if (!pico_ipv4_nat_is_enabled(link_addr))
         return -1;
@@ -428,10 +700,12 @@ int pico_ipv4_nat_inbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     {
         struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)f->transport_hdr;
         trans = (struct pico_trans *)&tcp->trans;
-        tuple = pico_ipv4_nat_find_tuple(trans->dport, 0, 0, net->proto);
+        tuple = pico_ipv4_nat_find_in(link_addr, trans->dport, net->proto);
         if (!tuple)
             return -1;
 
+        /* track on the untranslated tuple */
+        state = pico_conntrack_state(f);
         /* replace dst IP and dst PORT */
         net->dst = tuple->src_addr;
         trans->dport = tuple->src_port;
@@ -446,10 +720,12 @@ int pico_ipv4_nat_inbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     {
         struct pico_udp_hdr *udp = (struct pico_udp_hdr *)f->transport_hdr;
         trans = (struct pico_trans *)&udp->trans;
-        tuple = pico_ipv4_nat_find_tuple(trans->dport, 0, 0, net->proto);
+        tuple = pico_ipv4_nat_find_in(link_addr, trans->dport, net->proto);
         if (!tuple)
             return -1;
 
+        /* track on the untranslated tuple */
+        state = pico_conntrack_state(f);
         /* replace dst IP and dst PORT */
         net->dst = tuple->src_addr;
         trans->dport = tuple->src_port;
@@ -461,14 +737,15 @@ int pico_ipv4_nat_inbound(struct pico_frame *f, struct pico_ip4 *link_addr)
 #endif
     case PICO_PROTO_ICMP4:
         /* XXX reimplement */
-        break;
+        return -1;
 
     default:
         nat_dbg("NAT ERROR: inbound NAT on erroneous protocol\n");
         return -1;
     }
 
-    pico_ipv4_nat_sniff_session(tuple, f, PICO_NAT_INBOUND);
+    pico_conntrack_dnat(f, &tuple->src_addr, tuple->src_port);
+    pico_ipv4_nat_sniff_session(tuple, f, state, PICO_NAT_INBOUND);
     net->crc = 0;
     net->crc = short_be(pico_checksum(net, f->net_len));
 
@@ -483,8 +760,10 @@ int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     struct pico_nat_tuple *tuple = NULL;
     struct pico_trans *trans = NULL;
     struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct pico_nat_link *nl = pico_ipv4_nat_link_find(link_addr);
+    uint8_t state = PICO_CT_UNTRACKED;
 
-    if (!pico_ipv4_nat_is_enabled(link_addr))
+    if (!nl)
         return -1;
 
     switch (net->proto) {
@@ -493,10 +772,15 @@ int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     {
         struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)f->transport_hdr;
         trans = (struct pico_trans *)&tcp->trans;
-        tuple = pico_ipv4_nat_find_tuple(0, &net->src, trans->sport, net->proto);
+        tuple = pico_ipv4_nat_find_out(link_addr, &net->src, trans->sport, net->proto);
         if (!tuple)
-            tuple = pico_ipv4_nat_generate_tuple(f);
+            tuple = pico_ipv4_nat_generate_tuple(f, nl);
+
+        if (!tuple)
+            return -1;
 
+        /* track on the untranslated tuple */
+        state = pico_conntrack_state(f);
         /* replace src IP and src PORT */
         net->src = tuple->nat_addr;
         trans->sport = tuple->nat_port;
@@ -511,10 +795,15 @@ int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr)
     {
         struct pico_udp_hdr *udp = (struct pico_udp_hdr *)f->transport_hdr;
         trans = (struct pico_trans *)&udp->trans;
-        tuple = pico_ipv4_nat_find_tuple(0, &net->src, trans->sport, net->proto);
+        tuple = pico_ipv4_nat_find_out(link_addr, &net->src, trans->sport, net->proto);
         if (!tuple)
-            tuple = pico_ipv4_nat_generate_tuple(f);
+            tuple = pico_ipv4_nat_generate_tuple(f, nl);
 
+        if (!tuple)
+            return -1;
+
+        /* track on the untranslated tuple */
+        state = pico_conntrack_state(f);
         /* replace src IP and src PORT */
         net->src = tuple->nat_addr;
         trans->sport = tuple->nat_port;
@@ -526,14 +815,15 @@ int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr)
 #endif
     case PICO_PROTO_ICMP4:
         /* XXX reimplement */
-        break;
+        return -1;
 
     default:
         nat_dbg("NAT ERROR: outbound NAT on erroneous protocol\n");
         return -1;
     }
 
-    pico_ipv4_nat_sniff_session(tuple, f, PICO_NAT_OUTBOUND);
+    pico_conntrack_snat(f, &tuple->nat_addr, tuple->nat_port);
+    pico_ipv4_nat_sniff_session(tuple, f, state, PICO_NAT_OUTBOUND);
     net->crc = 0;
     net->crc = short_be(pico_checksum(net, f->net_len));
 
@@ -545,28 +835,88 @@ int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr)
 
 int pico_ipv4_nat_enable(struct pico_ipv4_link *link)
 {
+    struct pico_nat_link *nl;
+    struct pico_nat_tuple *t;
+    uint32_t i;
+
     if (link == NULL) {
         pico_err = PICO_ERR_EINVAL;
         return -1;
     }
 
-    nat_link = link;
-    pico_timer_add(PICO_NAT_TIMEWAIT, pico_ipv4_nat_table_cleanup, NULL);
+    if (pico_ipv4_nat_link_find(&link->address))
+        return 0;
+
+    nl = PICO_ZALLOC(sizeof(struct pico_nat_link));
+    if (!nl) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    nl->link = link;
+    pico_tree_insert(&NATLinks, nl);
+
+    /* port forwards configured before the link was enabled keep their port */
+    for (i = 0; i < nat_table.size; i++) {
+        for (t = nat_table.in[i]; t; t = t->next_in) {
+            if (t->portforward && (t->nat_addr.addr == link->address.addr) &&
+                (pico_ipv4_nat_port_reserve(nl, t->proto, t->nat_port) == 0))
+                t->link = nl;
+        }
+    }
+    if (!nat_table.timer) {
+        nat_table.timer = 1;
+        pico_timer_add(PICO_NAT_SWEEP_INTERVAL, pico_ipv4_nat_table_cleanup, NULL);
+    }
+
+    return 0;
+}
+
+int pico_ipv4_nat_disable_link(struct pico_ipv4_link *link)
+{
+    struct pico_nat_link *nl;
+    struct pico_nat_tuple *t, *next;
+    uint32_t i;
+
+    if (!link || !(nl = pico_ipv4_nat_link_find(&link->address))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    /* flush the sessions translated on this link, keep the port forwards */
+    for (i = 0; i < nat_table.size; i++) {
+        for (t = nat_table.in[i]; t; t = next) {
+            next = t->next_in;
+            if (t->link != nl)
+                continue;
+
+            if (t->portforward)
+                t->link = NULL;
+            else
+                pico_ipv4_nat_free(t);
+        }
+    }
+    pico_tree_delete(&NATLinks, nl);
+    for (i = 0; i < 2; i++) {
+        if (nl->ports[i].map)
+            PICO_FREE(nl->ports[i].map);
+    }
+    PICO_FREE(nl);
     return 0;
 }
 
 int pico_ipv4_nat_disable(void)
 {
-    nat_link = NULL;
+    struct pico_nat_link *nl;
+
+    while ((nl = pico_tree_first(&NATLinks)) != NULL)
+        pico_ipv4_nat_disable_link(nl->link);
     return 0;
 }
 
 int pico_ipv4_nat_is_enabled(struct pico_ip4 *link_addr)
 {
-    if (!nat_link)
-        return 0;
-
-    if (nat_link->address.addr != link_addr->addr)
+    if (!pico_ipv4_nat_link_find(link_addr))
         return 0;
 
     return 1;
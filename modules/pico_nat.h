@@ -23,6 +23,7 @@ int pico_ipv4_nat_inbound(struct pico_frame *f, struct pico_ip4 *link_addr);
 int pico_ipv4_nat_outbound(struct pico_frame *f, struct pico_ip4 *link_addr);
 int pico_ipv4_nat_enable(struct pico_ipv4_link *link);
 int pico_ipv4_nat_disable(void);
+int pico_ipv4_nat_disable_link(struct pico_ipv4_link *link);
 int pico_ipv4_nat_is_enabled(struct pico_ip4 *link_addr);
 #else
 
@@ -56,6 +57,13 @@ static inline int pico_ipv4_nat_disable(void)
     return -1;
 }
 
+static inline int pico_ipv4_nat_disable_link(struct pico_ipv4_link *link)
+{
+    (void)link;
+    pico_err = PICO_ERR_EPROTONOSUPPORT;
+    return -1;
+}
+
 static inline int pico_ipv4_nat_is_enabled(struct pico_ip4 *link_addr)
 {
     (void)link_addr;
@@ -33,7 +33,7 @@ static const struct pico_ip4 HOST_NETMASK = {
 #define fresher(a, b) ((a > b) || ((b - a) > 32768))
 
 
-static uint16_t msg_counter; /* Global message sequence number */
+static PICO_TLS uint16_t msg_counter; /* Global message sequence number */
 
 /* Objects */
 struct olsr_dev_entry
@@ -108,10 +108,10 @@ PACKED_STRUCT_DEF olsrhdr
 
 
 /* Globals */
-static struct pico_socket *udpsock = NULL;
+static PICO_TLS struct pico_socket *udpsock = NULL;
 uint16_t my_ansn = 0;
-static struct olsr_route_entry  *Local_interfaces = NULL;
-static struct olsr_dev_entry    *Local_devices    = NULL;
+static PICO_TLS struct olsr_route_entry  *Local_interfaces = NULL;
+static PICO_TLS struct olsr_dev_entry    *Local_devices    = NULL;
 
 static struct olsr_dev_entry *olsr_get_deventry(struct pico_device *dev)
 {
@@ -336,7 +336,7 @@ struct olsr_fwd_pkt
     struct pico_device *pdev;
 };
 
-static uint32_t buffer_mem_used = 0U;
+static PICO_TLS uint32_t buffer_mem_used = 0U;
 
 static void olsr_process_out(pico_time now, void *arg)
 {
@@ -0,0 +1,420 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   .
+
+ *********************************************************************/
+
+#include "pico_config.h"
+#include "pico_device.h"
+#include "pico_stack.h"
+#include "pico_eth.h"
+#include "pico_ipv4.h"
+#include "pico_ipv6.h"
+#include "pico_icmp4.h"
+#include "pico_icmp6.h"
+#include "pico_shard.h"
+
+#ifdef PICO_SUPPORT_SHARD
+
+/* A group of stack instances sharing one network device, each instance
+ * run by a thread of its own: all the state of the stack (timers, sockets,
+ * routes, devices, ARP and neighbor caches, pico_err) is per thread with
+ * PICO_SUPPORT_SHARD (see PICO_TLS), so an instance starts with
+ * pico_stack_init() on its thread, and attaches there to the group.
+ *
+ * One receive thread hands each frame of the shared device to the group,
+ * which steers it to the instance owning its flow, or to all of them for
+ * the traffic every instance must see (ARP, neighbor discovery, multicast,
+ * broadcast). The frames are queued on the lock free receive ring of the
+ * device of the instance.
+ *
+ * The configuration (links, routes) is replicated: a control thread posts
+ * a call to the group, and each instance runs it on its own thread, from
+ * the poll of its device. */
+
+struct pico_shard_call {
+    void (*fn)(struct pico_device *dev, void *arg);
+    void *arg;
+};
+
+struct pico_shard_dev {
+    struct pico_device dev;     /* must be first */
+    struct pico_shard_group *group;
+    uint32_t idx;
+};
+
+struct pico_shard_instance {
+    struct pico_shard_dev *dev; /* published by its thread */
+    struct pico_spsc calls;     /* from the control thread */
+    void *slot[PICO_SHARD_CALLS];
+    struct pico_shard_call call[PICO_SHARD_CALLS];
+};
+
+struct pico_shard_addr {
+    uint16_t net;
+    union pico_address addr;
+};
+
+struct pico_shard_group {
+    uint32_t n;
+    uint32_t depth;
+    int (*send)(struct pico_device *dev, void *buf, int len);
+    struct pico_shard_addr addr[PICO_SHARD_ADDRS];
+    uint32_t n_addr;            /* published after the address */
+    struct pico_shard_instance inst[PICO_SHARD_MAX];
+};
+
+/* The instance run by this thread, if any */
+static PICO_TLS struct pico_shard_dev *shard_self;
+
+struct pico_shard_group *pico_shard_group_create(uint32_t n, uint32_t depth,
+                                                 int (*send)(struct pico_device *dev, void *buf, int len))
+{
+    struct pico_shard_group *g;
+    uint32_t i;
+
+    if (!n || (n > PICO_SHARD_MAX) || !depth || (depth & (depth - 1u)) || !send) {
+        pico_err = PICO_ERR_EINVAL;
+        return NULL;
+    }
+
+    g = PICO_ZALLOC(sizeof(struct pico_shard_group));
+    if (!g) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    g->n = n;
+    g->depth = depth;
+    g->send = send;
+    for (i = 0; i < n; i++)
+        (void)pico_spsc_init(&g->inst[i].calls, g->inst[i].slot, PICO_SHARD_CALLS);
+
+    return g;
+}
+
+/* Once every instance has left the group */
+int pico_shard_group_destroy(struct pico_shard_group *g)
+{
+    uint32_t i;
+
+    if (!g) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < g->n; i++) {
+        if (pico_spsc_load_acquire(&g->inst[i].dev)) {
+            pico_err = PICO_ERR_EBUSY;
+            return -1;
+        }
+    }
+    PICO_FREE(g);
+    return 0;
+}
+
+/* Local address of the group: the traffic to it is steered to the owner
+ * of the destination port, the rest is forwarded traffic. */
+int pico_shard_group_address(struct pico_shard_group *g, uint16_t net, union pico_address *addr)
+{
+    uint32_t n;
+
+    if (!g || !addr || ((net != PICO_PROTO_IPV4) && (net != PICO_PROTO_IPV6))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    n = g->n_addr;
+    if (n >= PICO_SHARD_ADDRS) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    g->addr[n].net = net;
+    g->addr[n].addr = *addr;
+    pico_spsc_store_release(&g->n_addr, n + 1u);
+    return 0;
+}
+
+/* fn(dev, arg) is run by every instance, on its thread, dev being its device
+ * in the group. fn must not add nor remove devices. Nothing is posted if any
+ * instance has no room left. */
+int pico_shard_group_call(struct pico_shard_group *g, void (*fn)(struct pico_device *dev, void *arg), void *arg)
+{
+    struct pico_shard_instance *in;
+    uint32_t i, head;
+
+    if (!g || !fn) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < g->n; i++) {
+        if (pico_spsc_count(&g->inst[i].calls) >= PICO_SHARD_CALLS) {
+            pico_err = PICO_ERR_EAGAIN;
+            return -1;
+        }
+    }
+
+    for (i = 0; i < g->n; i++) {
+        in = &g->inst[i];
+        /* the record of a slot is free as long as the slot is */
+        head = in->calls.head;
+        in->call[head & in->calls.mask].fn = fn;
+        in->call[head & in->calls.mask].arg = arg;
+        (void)pico_spsc_push(&in->calls, &in->call[head & in->calls.mask]);
+    }
+    return 0;
+}
+
+/* Calls not yet run, over all the instances */
+uint32_t pico_shard_group_pending(struct pico_shard_group *g)
+{
+    uint32_t i, pending = 0;
+
+    if (!g)
+        return 0;
+
+    for (i = 0; i < g->n; i++)
+        pending += pico_spsc_count(&g->inst[i].calls);
+
+    return pending;
+}
+
+static int pico_shard_is_local(struct pico_shard_group *g, uint16_t net, const uint8_t *dst)
+{
+    uint32_t i, n = pico_spsc_load_acquire(&g->n_addr);
+
+    for (i = 0; i < n; i++) {
+        if (g->addr[i].net != net)
+            continue;
+
+#ifdef PICO_SUPPORT_IPV4
+        if ((net == PICO_PROTO_IPV4) && !memcmp(&g->addr[i].addr.ip4.addr, dst, PICO_SIZE_IP4))
+            return 1;
+
+#endif
+#ifdef PICO_SUPPORT_IPV6
+        if ((net == PICO_PROTO_IPV6) && !memcmp(g->addr[i].addr.ip6.addr, dst, PICO_SIZE_IP6))
+            return 1;
+
+#endif
+    }
+    return 0;
+}
+
+/* Instance for a frame of the shared device, from the ethernet header:
+ *  - broadcast, multicast and non IP frames (ARP) go to all the instances;
+ *  - the frames to another host are forwarded by the owner of the flow;
+ *  - to a local address, TCP and UDP from PICO_SHARD_PORT_MIN up go to the
+ *    owner of the destination port, the others (listeners, echo requests)
+ *    to the owner of the flow, and the rest of ICMP (errors, replies,
+ *    neighbor discovery) to all the instances.
+ * Fragments are steered on their addresses only, as they have no ports. */
+int pico_shard_steer(struct pico_shard_group *g, const uint8_t *buf, uint32_t len)
+{
+    const struct pico_eth_hdr *ehdr = (const struct pico_eth_hdr *)buf;
+    const uint8_t *l3 = buf + PICO_SIZE_ETHHDR;
+    uint32_t hlen = 0, l3len;
+    uint16_t dport;
+    uint8_t proto = 0, type;
+    int ip = 0, local = 0, frag = 0;
+
+    if (!g || !buf || (len < PICO_SIZE_ETHHDR)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (g->n == 1)
+        return 0;
+
+    if (ehdr->daddr[0] & 0x01u)
+        return PICO_SHARD_ALL;
+
+    l3len = len - PICO_SIZE_ETHHDR;
+#ifdef PICO_SUPPORT_IPV4
+    if ((ehdr->proto == PICO_IDETH_IPV4) && (l3len >= PICO_SIZE_IP4HDR)) {
+        const struct pico_ipv4_hdr *hdr = (const struct pico_ipv4_hdr *)l3;
+        ip = 1;
+        local = pico_shard_is_local(g, PICO_PROTO_IPV4, (const uint8_t *)&hdr->dst.addr);
+        frag = (hdr->frag & short_be(PICO_IPV4_MOREFRAG | PICO_IPV4_FRAG_MASK)) != 0;
+        proto = hdr->proto;
+        hlen = (uint32_t)(hdr->vhl & 0x0fu) << 2;
+    }
+
+#endif
+#ifdef PICO_SUPPORT_IPV6
+    if ((ehdr->proto == PICO_IDETH_IPV6) && (l3len >= PICO_SIZE_IP6HDR)) {
+        const struct pico_ipv6_hdr *hdr = (const struct pico_ipv6_hdr *)l3;
+        ip = 1;
+        local = pico_shard_is_local(g, PICO_PROTO_IPV6, hdr->dst.addr);
+        frag = (hdr->nxthdr == PICO_IPV6_EXTHDR_FRAG);
+        proto = hdr->nxthdr;
+        hlen = PICO_SIZE_IP6HDR;
+    }
+
+#endif
+    if (!ip)
+        return PICO_SHARD_ALL;
+
+    if (!local || frag)
+        return (int)(pico_flow_hash(buf, len, 1) % g->n);
+
+    if (((proto == PICO_PROTO_TCP) || (proto == PICO_PROTO_UDP)) && (l3len >= hlen + 4u)) {
+        memcpy(&dport, l3 + hlen + 2, sizeof(dport));
+        dport = short_be(dport);
+        if (dport >= PICO_SHARD_PORT_MIN)
+            return (int)(dport % g->n);
+
+        return (int)(pico_flow_hash(buf, len, 1) % g->n);
+    }
+
+    if (((proto == PICO_PROTO_ICMP4) || (proto == PICO_PROTO_ICMP6)) && (l3len > hlen)) {
+        type = l3[hlen];
+        if ((proto == PICO_PROTO_ICMP4) ? (type == PICO_ICMP_ECHO) : (type == PICO_ICMP6_ECHO_REQUEST))
+            return (int)(pico_flow_hash(buf, len, 1) % g->n);
+    }
+
+    return PICO_SHARD_ALL;
+}
+
+/* The frame is copied to the instance it is steered to, or to all of them.
+ * Returns the number of instances that took it, -1 if none could. */
+int32_t pico_shard_group_recv(struct pico_shard_group *g, uint8_t *buf, uint32_t len)
+{
+    struct pico_shard_dev *sd;
+    int32_t taken = 0;
+    uint32_t i;
+    int to = pico_shard_steer(g, buf, len);
+
+    if (to == -1)
+        return -1;
+
+    for (i = 0; i < g->n; i++) {
+        if ((to != PICO_SHARD_ALL) && (i != (uint32_t)to))
+            continue;
+
+        sd = pico_spsc_load_acquire(&g->inst[i].dev);
+        if (sd && (pico_stack_recv(&sd->dev, buf, len) > 0))
+            taken++;
+    }
+    return (taken > 0) ? taken : -1;
+}
+
+/* The calls posted to the group are run here, on the thread of the instance */
+static int pico_shard_poll(struct pico_device *dev, int loop_score)
+{
+    struct pico_shard_dev *sd = (struct pico_shard_dev *)dev;
+    struct pico_shard_instance *in = &sd->group->inst[sd->idx];
+    struct pico_shard_call *c;
+
+    while ((c = pico_spsc_peek(&in->calls)) != NULL) {
+        c->fn(dev, c->arg);
+        (void)pico_spsc_pop(&in->calls);
+    }
+    return loop_score;
+}
+
+static int pico_shard_send(struct pico_device *dev, void *buf, int len)
+{
+    struct pico_shard_dev *sd = (struct pico_shard_dev *)dev;
+    return sd->group->send(dev, buf, len);
+}
+
+/* The receive thread must have stopped handing frames to the instance */
+static void pico_shard_destroy(struct pico_device *dev)
+{
+    struct pico_shard_dev *sd = (struct pico_shard_dev *)dev;
+
+    if (sd->group) {
+        pico_spsc_store_release(&sd->group->inst[sd->idx].dev, (struct pico_shard_dev *)NULL);
+        sd->group = NULL;
+    }
+
+    if (shard_self == sd)
+        shard_self = NULL;
+}
+
+/* The calling thread, on which pico_stack_init() has been run, becomes
+ * instance idx of the group. Its device, of the MAC address of the shared
+ * device, receives the frames steered to it, and transmits with the send
+ * callback of the group, from this thread. pico_device_destroy() leaves the
+ * group. */
+struct pico_device *pico_shard_attach(struct pico_shard_group *g, uint32_t idx, const char *name, uint8_t *mac)
+{
+    struct pico_shard_dev *sd;
+
+    if (!g || (idx >= g->n) || !name || !mac || shard_self || pico_spsc_load_acquire(&g->inst[idx].dev)) {
+        pico_err = PICO_ERR_EINVAL;
+        return NULL;
+    }
+
+    sd = PICO_ZALLOC(sizeof(struct pico_shard_dev));
+    if (!sd) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    sd->dev.send = pico_shard_send;
+    sd->dev.poll = pico_shard_poll;
+    sd->dev.destroy = pico_shard_destroy;
+    if (pico_device_init(&sd->dev, name, mac) != 0) {
+        dbg("Shard init failed.\n");
+        pico_device_destroy(&sd->dev);
+        return NULL;
+    }
+
+    if (pico_device_queues_spsc(&sd->dev, g->depth, 0) != 0) {
+        dbg("Shard queues failed.\n");
+        pico_device_destroy(&sd->dev);
+        return NULL;
+    }
+
+    sd->group = g;
+    sd->idx = idx;
+    shard_self = sd;
+    pico_spsc_store_release(&g->inst[idx].dev, sd);
+    dbg("Device %s created, instance %u.\n", sd->dev.name, idx);
+    return &sd->dev;
+}
+
+/* Index of the instance run by the calling thread, -1 if none */
+int pico_shard_self(void)
+{
+    return shard_self ? (int)shard_self->idx : -1;
+}
+
+/* Whether a local port (network order) can be taken as ephemeral by this
+ * instance: its replies must be steered back here. */
+int pico_shard_port_mine(uint16_t port)
+{
+    uint16_t p = short_be(port);
+
+    if (!shard_self || (shard_self->group->n == 1))
+        return 1;
+
+    return (p >= PICO_SHARD_PORT_MIN) && ((p % shard_self->group->n) == shard_self->idx);
+}
+
+/* First port (host order) of this instance from port on, to start a search */
+uint16_t pico_shard_port_hint(uint16_t port)
+{
+    uint32_t n, p = port;
+
+    if (!shard_self || (shard_self->group->n == 1))
+        return port;
+
+    n = shard_self->group->n;
+    if (p < PICO_SHARD_PORT_MIN)
+        p = PICO_SHARD_PORT_MIN + (p % (65536u - PICO_SHARD_PORT_MIN));
+
+    p += (shard_self->idx + n - (p % n)) % n;
+    if (p > 0xFFFFu)
+        p = PICO_SHARD_PORT_MIN + ((shard_self->idx + n - (PICO_SHARD_PORT_MIN % n)) % n);
+
+    return (uint16_t)p;
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+ *********************************************************************/
+#ifndef INCLUDE_PICO_SHARD
+#define INCLUDE_PICO_SHARD
+#include "pico_config.h"
+#include "pico_addressing.h"
+#include "pico_device.h"
+#include "pico_spsc.h"
+
+/* The instances are fed through lock free rings: without them (no atomic
+ * builtins on the target) sharding is left out of the build. */
+#ifndef PICO_SUPPORT_SPSC
+#undef PICO_SUPPORT_SHARD
+#endif
+
+/* Local TCP and UDP ports from here up belong to instance (port % n): the
+ * ephemeral ports of an instance are taken among its own, so that the
+ * replies are steered back to it. Ports below are steered by flow hash. */
+#ifndef PICO_SHARD_PORT_MIN
+# define PICO_SHARD_PORT_MIN 32768u
+#endif
+
+#define PICO_SHARD_MAX    32    /* instances in a group */
+#define PICO_SHARD_ADDRS  8     /* local addresses of a group */
+#define PICO_SHARD_CALLS  16    /* calls pending per instance, power of two */
+#define PICO_SHARD_ALL    (-2)  /* steered to every instance */
+
+struct pico_shard_group;
+
+/* Control thread */
+struct pico_shard_group *pico_shard_group_create(uint32_t n, uint32_t depth,
+                                                 int (*send)(struct pico_device *dev, void *buf, int len));
+int pico_shard_group_destroy(struct pico_shard_group *g);
+int pico_shard_group_address(struct pico_shard_group *g, uint16_t net, union pico_address *addr);
+int pico_shard_group_call(struct pico_shard_group *g, void (*fn)(struct pico_device *dev, void *arg), void *arg);
+uint32_t pico_shard_group_pending(struct pico_shard_group *g);
+
+/* Receive thread */
+int pico_shard_steer(struct pico_shard_group *g, const uint8_t *buf, uint32_t len);
+int32_t pico_shard_group_recv(struct pico_shard_group *g, uint8_t *buf, uint32_t len);
+
+/* Instance threads */
+struct pico_device *pico_shard_attach(struct pico_shard_group *g, uint32_t idx, const char *name, uint8_t *mac);
+int pico_shard_self(void);
+int pico_shard_port_mine(uint16_t port);
+uint16_t pico_shard_port_hint(uint16_t port);
+
+#endif
@@ -52,7 +52,7 @@ struct slaacv4_cookie {
 
 static void pico_slaacv4_hotplug_cb(struct pico_device *dev, int event);
 
-static struct slaacv4_cookie slaacv4_local;
+static PICO_TLS struct slaacv4_cookie slaacv4_local;
 
 static uint32_t pico_slaacv4_getip(struct pico_device *dev, uint8_t rand)
 {
@@ -32,6 +32,9 @@ int pico_getsockopt_tcp(struct pico_socket *s, int option, void *value)
         *(int *)value = PICO_SOCKET_GETOPT(s, PICO_SOCKET_OPT_TCPNODELAY);
         return 0;
     }
+    else if (option == PICO_TCP_FASTOPEN) {
+        return pico_tcp_get_fastopen(s, (uint32_t *)value);
+    }
     else if (option == PICO_SOCKET_OPT_RCVBUF) {
         return pico_tcp_get_bufsize_in(s, (uint32_t *)value);
     }
@@ -40,6 +43,10 @@ int pico_getsockopt_tcp(struct pico_socket *s, int option, void *value)
         return pico_tcp_get_bufsize_out(s, (uint32_t *)value);
     }
 
+    else if (option == PICO_SOCKET_OPT_MAX_PACING_RATE) {
+        return pico_tcp_get_max_pacing_rate(s, (uint32_t *)value);
+    }
+
 #endif
     return -1;
 }
@@ -66,6 +73,11 @@ int pico_setsockopt_tcp(struct pico_socket *s, int option, void *value)
         tcp_set_nagle_option(s, value);
         return 0;
     }
+    else if (option == PICO_TCP_FASTOPEN) {
+        uint32_t *val = (uint32_t*)value;
+        pico_tcp_set_fastopen(s, *val);
+        return 0;
+    }
     else if (option == PICO_SOCKET_OPT_RCVBUF) {
         uint32_t *val = (uint32_t*)value;
         pico_tcp_set_bufsize_in(s, *val);
@@ -91,6 +103,11 @@ int pico_setsockopt_tcp(struct pico_socket *s, int option, void *value)
         pico_tcp_set_keepalive_intvl(s, *val);
         return 0;
     }
+    else if (option == PICO_SOCKET_OPT_MAX_PACING_RATE) {
+        uint32_t *val = (uint32_t*)value;
+        pico_tcp_set_max_pacing_rate(s, *val);
+        return 0;
+    }
     else if (option == PICO_SOCKET_OPT_LINGER) {
         uint32_t *val = (uint32_t*)value;
         pico_tcp_set_linger(s, *val);
@@ -217,6 +234,10 @@ int pico_socket_tcp_deliver(struct pico_sockport *sp, struct pico_frame *f)
             break;
     } /* FOREACH */
 
+    /* new connections to a port shared by several listeners are spread by flow */
+    if (found && (found->remote_port == 0))
+        found = pico_socket_reuseport_select(sp, found, f);
+
     return socket_tcp_do_deliver(found, f);
 }
 
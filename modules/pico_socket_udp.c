@@ -182,16 +182,49 @@ static int pico_socket_udp_deliver_ipv6(struct pico_socket *s, struct pico_frame
 #endif
 
 
+/* Whether s can take a datagram sent to the destination of f */
+static int pico_socket_udp_match(struct pico_socket *s, struct pico_frame *f)
+{
+#ifdef PICO_SUPPORT_IPV4
+    if (IS_IPV4(f)) {
+        struct pico_ipv4_hdr *ip4hdr = (struct pico_ipv4_hdr*)(f->net_hdr);
+        return (s->net == &pico_proto_ipv4) &&
+               ((s->local_addr.ip4.addr == PICO_IPV4_INADDR_ANY) || (s->local_addr.ip4.addr == ip4hdr->dst.addr) ||
+                pico_ipv4_is_broadcast(ip4hdr->dst.addr) || pico_ipv4_is_multicast(ip4hdr->dst.addr));
+    }
+#endif
+#ifdef PICO_SUPPORT_IPV6
+    if (IS_IPV6(f)) {
+        struct pico_ipv6_hdr *ip6hdr = (struct pico_ipv6_hdr*)(f->net_hdr);
+        return (s->net == &pico_proto_ipv6) &&
+               (pico_ipv6_is_unspecified(s->local_addr.ip6.addr) || (pico_ipv6_compare(&s->local_addr.ip6, &ip6hdr->dst) == 0) ||
+                pico_ipv6_is_multicast(ip6hdr->dst.addr));
+    }
+#endif
+    (void)s;
+    (void)f;
+    return 0;
+}
+
 int pico_socket_udp_deliver(struct pico_sockport *sp, struct pico_frame *f)
 {
     struct pico_tree_node *index = NULL;
     struct pico_tree_node *_tmp;
-    struct pico_socket *s = NULL;
+    struct pico_socket *s = NULL, *found = NULL;
     pico_err = PICO_ERR_EPROTONOSUPPORT;
     #ifdef PICO_SUPPORT_UDP
     pico_err = PICO_ERR_NOERR;
     pico_tree_foreach_safe(index, &sp->socks, _tmp){
         s = index->keyValue;
+        if (pico_socket_udp_match(s, f)) {
+            found = s;
+            break;
+        }
+    }
+
+    /* a socket sharing the port with others takes the flows hashed to it */
+    s = pico_socket_reuseport_select(sp, found, f);
+    if (s) {
         if (IS_IPV4(f)) { /* IPV4 */
 #ifdef PICO_SUPPORT_IPV4
             return pico_socket_udp_deliver_ipv4(s, f);
@@ -203,9 +236,10 @@ int pico_socket_udp_deliver(struct pico_sockport *sp, struct pico_frame *f)
         } else {
             /* something wrong in the packet header*/
         }
-    } /* FOREACH */
+    }
+
     pico_frame_discard(f);
-    if (s)
+    if (!pico_tree_empty(&sp->socks))
         return 0;
 
     pico_err = PICO_ERR_ENXIO;
@@ -42,6 +42,43 @@
 
 #define ONE_GIGABYTE ((uint32_t)(1024UL * 1024UL * 1024UL))
 
+/* Buffer auto-tuning: queues start at PICO_DEFAULT_SOCKETQ and grow with the
+ * measured bandwidth-delay product, up to PICO_TCP_AUTOTUNE_MAX per queue.
+ * The growth of all the sockets together is bounded by PICO_TCP_AUTOTUNE_BUDGET.
+ */
+#ifndef PICO_TCP_AUTOTUNE_MAX
+#define PICO_TCP_AUTOTUNE_MAX    (16u * PICO_DEFAULT_SOCKETQ)
+#endif
+#ifndef PICO_TCP_AUTOTUNE_BUDGET
+#define PICO_TCP_AUTOTUNE_BUDGET (64u * PICO_DEFAULT_SOCKETQ)
+#endif
+#define PICO_TCP_AUTOTUNE_IDLE   5000u
+
+#define PICO_TCP_AUTOTUNE_RCV    0x01u
+#define PICO_TCP_AUTOTUNE_SND    0x02u
+
+/* Pacing: a socket may run ahead of its schedule by this much (in us), as the
+ * stack clock only has millisecond resolution.
+ */
+#define PICO_TCP_PACING_QUANTUM  1000u
+
+/* TCP Fast Open (RFC 7413) */
+#define PICO_TCP_FASTOPEN_COOKIE_SIZE 8u
+#define PICO_TCP_FASTOPEN_COOKIE_MAX  16u
+#ifndef PICO_TCP_FASTOPEN_CACHE_SIZE
+#define PICO_TCP_FASTOPEN_CACHE_SIZE  16u
+#endif
+/* Connections still in SYN_RECV whose SYN data was accepted (RFC 7413, 4.4) */
+#ifndef PICO_TCP_FASTOPEN_MAX_PENDING
+#define PICO_TCP_FASTOPEN_MAX_PENDING 16u
+#endif
+
+#define PICO_TCP_TFO_SERVER      0x01u /* listening socket accepts data in SYN */
+#define PICO_TCP_TFO_OPTION      0x02u /* fast open option received in SYN or SYN-ACK */
+#define PICO_TCP_TFO_SEND        0x04u /* fast open option to be sent in SYN or SYN-ACK */
+#define PICO_TCP_TFO_ACCEPTED    0x08u /* data carried by the SYN was accepted */
+#define PICO_TCP_TFO_PENDING     0x10u /* accepted, handshake not completed yet */
+
 /* check if the Nagle algorithm is enabled on the socket */
 #define IS_NAGLE_ENABLED(s)     (!(!(!(s->opt_flags & (1u << PICO_SOCKET_OPT_TCPNODELAY)))))
 /* check if tcp connection is "idle" according to Nagle (RFC 896) */
@@ -248,6 +285,18 @@ struct tcp_sack_block {
     struct tcp_sack_block *next;
 };
 
+/* Range of our outgoing data reported as SACKed by the peer */
+struct tcp_sack_range {
+    uint32_t start;
+    uint32_t end;
+};
+
+static int sack_range_compare(void *ka, void *kb)
+{
+    struct tcp_sack_range *a = ka, *b = kb;
+    return pico_seq_compare(a->start, b->start);
+}
+
 struct pico_socket_tcp {
     struct pico_socket sock;
 
@@ -311,16 +360,35 @@ struct pico_socket_tcp {
 
     /* FIN timer */
     uint32_t fin_tmr;
-};
 
-/* Queues */
-static struct pico_queue tcp_in = {
-    0
-};
-static struct pico_queue tcp_out = {
-    0
+    /* SACK scoreboard: disjoint, sorted ranges above snd_una */
+    struct pico_tree sack_board;
+    uint32_t sacked_bytes;
+    uint32_t sack_high;    /* right edge of the highest SACKed range */
+
+    /* Buffer auto-tuning */
+    uint8_t autotune;
+    uint32_t rcv_space;
+    uint32_t rcv_space_seq;
+    pico_time rcv_space_time;
+
+    /* Pacing */
+    uint32_t max_pacing_rate;
+    uint32_t pacing_tmr;
+    pico_time pacing_next; /* in us */
+
+    /* Fast Open */
+    uint8_t tfo;
+    uint8_t tfo_cookie_len;
+    uint8_t tfo_cookie[PICO_TCP_FASTOPEN_COOKIE_MAX];
+    uint16_t tfo_syn_len;     /* data carried by the SYN */
+    const uint8_t *tfo_data;  /* data to send with the next connect */
+    uint16_t tfo_len;
 };
 
+/* Memory granted to auto-tuned queues on top of their default size */
+static PICO_TLS uint32_t tcp_autotune_mem = 0;
+
 /* If Nagle enabled, this function can make 1 new segment from smaller segments in hold queue */
 static struct pico_frame *pico_hold_segment_make(struct pico_socket_tcp *t);
 
@@ -335,6 +403,13 @@ int pico_tcp_queue_in_is_empty(struct pico_socket *s)
         return 0;
 }
 
+int pico_tcp_queue_out_is_full(struct pico_socket *s)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *) s;
+
+    return t->tcpq_out.size >= t->tcpq_out.max_size;
+}
+
 /* Useful for getting rid of the beginning of the buffer (read() op) */
 static int release_until(struct pico_tcp_queue *q, uint32_t seq)
 {
@@ -521,20 +596,18 @@ static int pico_tcp_process_out(struct pico_protocol *self, struct pico_frame *f
 int pico_tcp_push(struct pico_protocol *self, struct pico_frame *data);
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_tcp = {
+PICO_TLS struct pico_protocol pico_proto_tcp = {
     .name = "tcp",
     .proto_number = PICO_PROTO_TCP,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_transport_process_in,
     .process_out = pico_tcp_process_out,
     .push = pico_tcp_push,
-    .q_in = &tcp_in,
-    .q_out = &tcp_out,
 };
 
 static uint32_t pico_paws(void)
 {
-    static uint32_t _paws = 0;
+    static PICO_TLS uint32_t _paws = 0;
     _paws = pico_rand();
     return long_be(_paws);
 }
@@ -577,6 +650,12 @@ static void tcp_add_options(struct pico_socket_tcp *ts, struct pico_frame *f, ui
         f->start[i++] = (uint8_t)(ts->mss & 0xFF);
         f->start[i++] = PICO_TCP_OPTION_SACK_OK;
         f->start[i++] = PICO_TCPOPTLEN_SACK_OK;
+        if (ts->tfo & PICO_TCP_TFO_SEND) {
+            f->start[i++] = PICO_TCP_OPTION_FASTOPEN;
+            f->start[i++] = (uint8_t)(PICO_TCPOPTLEN_FASTOPEN + ts->tfo_cookie_len);
+            memcpy(f->start + i, ts->tfo_cookie, ts->tfo_cookie_len);
+            i += ts->tfo_cookie_len;
+        }
     }
 
     f->start[i++] = PICO_TCP_OPTION_WS;
@@ -681,6 +760,105 @@ static void tcp_set_space(struct pico_socket_tcp *t)
     tcp_set_space_check_winupdate(t, space, shift);
 }
 
+/* Resize an auto-tuned queue. Growth above PICO_DEFAULT_SOCKETQ is charged to
+ * the global budget, and a queue is never shrunk below the data it holds.
+ */
+static void tcp_autotune_resize(struct pico_tcp_queue *q, uint32_t size)
+{
+    uint32_t cur = q->max_size;
+
+    if (size > PICO_TCP_AUTOTUNE_MAX)
+        size = PICO_TCP_AUTOTUNE_MAX;
+
+    if (size < PICO_DEFAULT_SOCKETQ)
+        size = PICO_DEFAULT_SOCKETQ;
+
+    if (size > cur) {
+        if ((size - cur) > (PICO_TCP_AUTOTUNE_BUDGET - tcp_autotune_mem))
+            size = cur + (PICO_TCP_AUTOTUNE_BUDGET - tcp_autotune_mem);
+    } else if (size < q->size) {
+        size = q->size;
+    }
+
+    tcp_autotune_mem -= (cur - PICO_DEFAULT_SOCKETQ);
+    tcp_autotune_mem += (size - PICO_DEFAULT_SOCKETQ);
+    q->max_size = size;
+}
+
+/* Give back to the budget what an auto-tuned queue was granted, and stop tuning it */
+static void tcp_autotune_release(struct pico_socket_tcp *t, uint8_t which)
+{
+    if ((t->autotune & which & PICO_TCP_AUTOTUNE_RCV) != 0)
+        tcp_autotune_mem -= (t->tcpq_in.max_size - PICO_DEFAULT_SOCKETQ);
+
+    if ((t->autotune & which & PICO_TCP_AUTOTUNE_SND) != 0)
+        tcp_autotune_mem -= (t->tcpq_out.max_size - PICO_DEFAULT_SOCKETQ);
+
+    t->autotune = (uint8_t)(t->autotune & (uint8_t)(~which));
+}
+
+/* Receive side dynamic right-sizing: once per RTT, compare what the application
+ * consumed with the previous round. If it grew, the sender is limited by our
+ * window, so make room for twice that amount to let it keep opening.
+ */
+static void tcp_autotune_rcvbuf(struct pico_socket_tcp *t)
+{
+    pico_time now = TCP_TIME;
+    uint32_t rtt = t->avg_rtt ? t->avg_rtt : PICO_TCP_RTO_MIN;
+    uint32_t copied;
+
+    if ((t->autotune & PICO_TCP_AUTOTUNE_RCV) == 0)
+        return;
+
+    if (t->rcv_space_time == 0) {
+        t->rcv_space_time = now;
+        t->rcv_space_seq = t->rcv_processed;
+        return;
+    }
+
+    if ((now - t->rcv_space_time) < rtt)
+        return;
+
+    copied = t->rcv_processed - t->rcv_space_seq;
+    if (copied > t->rcv_space) {
+        t->rcv_space = copied;
+        if ((copied << 1) > t->tcpq_in.max_size)
+            tcp_autotune_resize(&t->tcpq_in, copied << 1);
+    }
+
+    t->rcv_space_seq = t->rcv_processed;
+    t->rcv_space_time = now;
+}
+
+/* Send side: keep room for one congestion window in flight plus one queued */
+static void tcp_autotune_sndbuf(struct pico_socket_tcp *t)
+{
+    uint32_t want = ((uint32_t)t->cwnd * t->mss) << 1;
+
+    if ((t->autotune & PICO_TCP_AUTOTUNE_SND) == 0)
+        return;
+
+    if (want > t->tcpq_out.max_size)
+        tcp_autotune_resize(&t->tcpq_out, want);
+}
+
+/* Idle connections hand their extra memory back to the budget */
+static void tcp_autotune_idle(struct pico_socket_tcp *t, pico_time now)
+{
+    if ((now - t->ack_timestamp) < PICO_TCP_AUTOTUNE_IDLE)
+        return;
+
+    if (((t->autotune & PICO_TCP_AUTOTUNE_RCV) != 0) && (t->tcpq_in.max_size > PICO_DEFAULT_SOCKETQ)) {
+        tcp_autotune_resize(&t->tcpq_in, PICO_DEFAULT_SOCKETQ);
+        t->rcv_space = 0;
+        t->rcv_space_time = 0;
+        tcp_set_space(t);
+    }
+
+    if (((t->autotune & PICO_TCP_AUTOTUNE_SND) != 0) && (t->tcpq_out.max_size > PICO_DEFAULT_SOCKETQ))
+        tcp_autotune_resize(&t->tcpq_out, PICO_DEFAULT_SOCKETQ);
+}
+
 /* Return 32-bit aligned option size */
 static uint16_t tcp_options_size(struct pico_socket_tcp *t, uint16_t flags)
 {
@@ -689,6 +867,8 @@ static uint16_t tcp_options_size(struct pico_socket_tcp *t, uint16_t flags)
 
     if (flags & PICO_TCP_SYN) { /* Full options */
         size = PICO_TCPOPTLEN_MSS + PICO_TCP_OPTION_SACK_OK + PICO_TCPOPTLEN_WS + PICO_TCPOPTLEN_TIMESTAMP;
+        if (t->tfo & PICO_TCP_TFO_SEND)
+            size = (uint16_t)(size + PICO_TCPOPTLEN_FASTOPEN + t->tfo_cookie_len);
     } else {
 
         /* Always update window scale. */
@@ -721,43 +901,423 @@ uint16_t pico_tcp_overhead(struct pico_socket *s)
 
 }
 
-static inline int tcp_sack_marker(struct pico_frame *f, uint32_t start, uint32_t end, uint16_t *count)
+/* Fast Open cookies. The server derives them from the client address with a
+ * keyed hash; the key is random and never leaves the stack. The client keeps
+ * the last cookie received from each server in a small cache.
+ */
+struct tcp_fastopen_entry {
+    union pico_address addr;
+    uint8_t is_ip6;
+    uint8_t cookie_len;
+    uint8_t cookie[PICO_TCP_FASTOPEN_COOKIE_MAX];
+    pico_time timestamp;
+};
+
+static PICO_TLS uint32_t tcp_fastopen_key[4];
+static PICO_TLS uint8_t tcp_fastopen_key_set_up = 0;
+static PICO_TLS uint32_t tcp_fastopen_entries = 0;
+static PICO_TLS uint32_t tcp_fastopen_pending = 0;
+
+static int tcp_fastopen_entry_cmp(void *ka, void *kb)
+{
+    struct tcp_fastopen_entry *a = ka, *b = kb;
+    if (a->is_ip6 != b->is_ip6)
+        return (a->is_ip6 < b->is_ip6) ? -1 : 1;
+
+    return memcmp(&a->addr, &b->addr, a->is_ip6 ? PICO_SIZE_IP6 : PICO_SIZE_IP4);
+}
+
+static PICO_TLS PICO_TREE_DECLARE(TCPFastOpenCache, tcp_fastopen_entry_cmp);
+
+static void tcp_fastopen_key_set(struct tcp_fastopen_entry *e, struct pico_socket *s)
+{
+    memset(e, 0, sizeof(struct tcp_fastopen_entry));
+    e->is_ip6 = (uint8_t)(IS_SOCK_IPV6(s) ? 1 : 0);
+    if (e->is_ip6)
+        memcpy(&e->addr, &s->remote_addr, PICO_SIZE_IP6);
+    else
+        memcpy(&e->addr, &s->remote_addr, PICO_SIZE_IP4);
+}
+
+static uint32_t tcp_fastopen_mix(uint32_t h, uint32_t v)
+{
+    v *= 0xcc9e2d51u;
+    v = (v << 15) | (v >> 17);
+    v *= 0x1b873593u;
+    h ^= v;
+    h = (h << 13) | (h >> 19);
+    return (h * 5u) + 0xe6546b64u;
+}
+
+static uint32_t tcp_fastopen_final(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static void tcp_fastopen_cookie(struct pico_socket *s, uint8_t *cookie)
+{
+    struct tcp_fastopen_entry e;
+    uint32_t h1, h2, w;
+    uint32_t i, len;
+
+    if (!tcp_fastopen_key_set_up) {
+        for (i = 0; i < 4; i++)
+            tcp_fastopen_key[i] = pico_rand();
+        tcp_fastopen_key_set_up = 1;
+    }
+
+    tcp_fastopen_key_set(&e, s);
+    len = e.is_ip6 ? PICO_SIZE_IP6 : PICO_SIZE_IP4;
+    h1 = tcp_fastopen_key[0];
+    h2 = tcp_fastopen_key[1];
+    for (i = 0; i < len; i += 4) {
+        memcpy(&w, ((uint8_t *)&e.addr) + i, sizeof(uint32_t));
+        h1 = tcp_fastopen_mix(h1, w ^ tcp_fastopen_key[2]);
+        h2 = tcp_fastopen_mix(h2, w ^ tcp_fastopen_key[3]);
+    }
+    h1 = tcp_fastopen_final(h1 ^ len);
+    h2 = tcp_fastopen_final(h2 ^ h1);
+    memcpy(cookie, &h1, sizeof(uint32_t));
+    memcpy(cookie + sizeof(uint32_t), &h2, sizeof(uint32_t));
+}
+
+static struct tcp_fastopen_entry *tcp_fastopen_cache_find(struct pico_socket *s)
+{
+    struct tcp_fastopen_entry test;
+    tcp_fastopen_key_set(&test, s);
+    return pico_tree_findKey(&TCPFastOpenCache, &test);
+}
+
+static void tcp_fastopen_cache_del(struct pico_socket *s)
+{
+    struct tcp_fastopen_entry *e = tcp_fastopen_cache_find(s);
+    if (!e)
+        return;
+
+    pico_tree_delete(&TCPFastOpenCache, e);
+    PICO_FREE(e);
+    tcp_fastopen_entries--;
+}
+
+static void tcp_fastopen_cache_add(struct pico_socket *s, uint8_t *cookie, uint8_t len)
+{
+    struct tcp_fastopen_entry *e = tcp_fastopen_cache_find(s);
+    struct tcp_fastopen_entry *oldest = NULL;
+    struct pico_tree_node *index;
+
+    if (!e) {
+        if (tcp_fastopen_entries >= PICO_TCP_FASTOPEN_CACHE_SIZE) {
+            pico_tree_foreach(index, &TCPFastOpenCache) {
+                e = index->keyValue;
+                if (!oldest || (e->timestamp < oldest->timestamp))
+                    oldest = e;
+            }
+            pico_tree_delete(&TCPFastOpenCache, oldest);
+            PICO_FREE(oldest);
+            tcp_fastopen_entries--;
+        }
+
+        e = PICO_ZALLOC(sizeof(struct tcp_fastopen_entry));
+        if (!e)
+            return;
+
+        tcp_fastopen_key_set(e, s);
+        pico_tree_insert(&TCPFastOpenCache, e);
+        tcp_fastopen_entries++;
+    }
+
+    memcpy(e->cookie, cookie, len);
+    e->cookie_len = len;
+    e->timestamp = TCP_TIME;
+}
+
+/* Client: the data passed to connect is queued for output right behind the
+ * SYN. If the server acknowledges it in the SYN-ACK it is released from the
+ * queue, otherwise it is transmitted once the connection is established.
+ */
+static uint16_t tcp_fastopen_queue(struct pico_socket_tcp *t, uint16_t len)
 {
-    int cmp;
-    cmp = pico_seq_compare(SEQN(f), start);
-    if (cmp > 0)
+    uint16_t overhead = pico_tcp_overhead(&t->sock);
+    struct pico_frame *f = pico_socket_frame_alloc(&t->sock, (uint16_t)(overhead + len));
+    if (!f)
+        return 0;
+
+    f->payload += overhead;
+    f->payload_len = len;
+    memcpy(f->payload, t->tfo_data, len);
+    pico_tcp_flags_update(f, &t->sock);
+    if (pico_tcp_push(&pico_proto_tcp, f) == 0) {
+        pico_frame_discard(f);
         return 0;
+    }
+
+    return len;
+}
+
+/* Client: prepare a SYN carrying data. The cookie for the server comes from
+ * the cache; without one, an empty option requests a cookie and the data
+ * waits for the handshake. Returns the amount of data carried by the SYN.
+ */
+static uint16_t tcp_fastopen_client(struct pico_socket_tcp *t)
+{
+    struct tcp_fastopen_entry *e = tcp_fastopen_cache_find(&t->sock);
+    uint16_t max;
+
+    t->tfo |= PICO_TCP_TFO_SEND;
+    t->tfo_syn_len = 0;
+    t->tfo_cookie_len = 0;
+    if (e) {
+        memcpy(t->tfo_cookie, e->cookie, e->cookie_len);
+        t->tfo_cookie_len = e->cookie_len;
+    }
+
+    max = (uint16_t)(t->mss - tcp_options_size(t, PICO_TCP_SYN));
+    if (t->tfo_len > max)
+        t->tfo_len = max;
+
+    t->tfo_len = tcp_fastopen_queue(t, t->tfo_len);
+    if (e)
+        t->tfo_syn_len = t->tfo_len;
+
+    return t->tfo_syn_len;
+}
+
+/* Server: check the cookie in an incoming SYN. With a valid cookie, the data
+ * it carries is accepted right away; otherwise a fresh cookie is returned in
+ * the SYN-ACK and the data is left for the client to retransmit.
+ */
+static void tcp_fastopen_server(struct pico_socket_tcp *listen, struct pico_socket_tcp *t, struct pico_frame *f)
+{
+    uint8_t cookie[PICO_TCP_FASTOPEN_COOKIE_SIZE];
+    struct tcp_input_segment *input;
+
+    if (((listen->tfo & PICO_TCP_TFO_SERVER) == 0) || ((t->tfo & PICO_TCP_TFO_OPTION) == 0))
+        return;
+
+    tcp_fastopen_cookie(&t->sock, cookie);
+    if ((t->tfo_cookie_len != PICO_TCP_FASTOPEN_COOKIE_SIZE) || (memcmp(t->tfo_cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE) != 0)) {
+        memcpy(t->tfo_cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE);
+        t->tfo_cookie_len = PICO_TCP_FASTOPEN_COOKIE_SIZE;
+        t->tfo |= PICO_TCP_TFO_SEND;
+        return;
+    }
+
+    /* Too many handshakes with data pending: fall back to a regular one */
+    if ((f->payload_len == 0) || (tcp_fastopen_pending >= PICO_TCP_FASTOPEN_MAX_PENDING))
+        return;
 
-    if (cmp == 0) {
-        cmp = pico_seq_compare(SEQN(f) + f->payload_len, end);
-        if (cmp > 0) {
-            tcp_dbg("Invalid SACK: ignoring.\n");
+    input = segment_from_frame(f);
+    if (!input)
+        return;
+
+    input->seq = t->rcv_nxt;
+    if (pico_enqueue_segment(&t->tcpq_in, input) <= 0) {
+        PICO_FREE(input->payload);
+        PICO_FREE(input);
+        return;
+    }
+
+    t->rcv_nxt += f->payload_len;
+    t->tfo_syn_len = f->payload_len;
+    t->tfo |= PICO_TCP_TFO_ACCEPTED | PICO_TCP_TFO_PENDING;
+    tcp_fastopen_pending++;
+    t->sock.ev_pending |= PICO_SOCK_EV_RD;
+}
+
+static void tcp_fastopen_release(struct pico_socket_tcp *t)
+{
+    if (t->tfo & PICO_TCP_TFO_PENDING) {
+        t->tfo = (uint8_t)(t->tfo & (uint8_t)(~PICO_TCP_TFO_PENDING));
+        tcp_fastopen_pending--;
+    }
+}
+
+/* SACK scoreboard (RFC 6675).
+ * Ranges are merged on insertion, so the range with the highest start at or
+ * below a sequence number is the only one that may cover it. */
+static struct tcp_sack_range *tcp_sack_floor(struct pico_socket_tcp *t, uint32_t seq)
+{
+    struct pico_tree_node *n = t->sack_board.root;
+    struct tcp_sack_range *r, *found = NULL;
+
+    while (n != &LEAF) {
+        r = n->keyValue;
+        if (pico_seq_compare(r->start, seq) <= 0) {
+            found = r;
+            n = n->rightChild;
+        } else {
+            n = n->leftChild;
         }
+    }
+    return found;
+}
+
+/* First sequence number at or after seq that has not been SACKed */
+static uint32_t tcp_sack_next_hole(struct pico_socket_tcp *t, uint32_t seq)
+{
+    struct tcp_sack_range *r = tcp_sack_floor(t, seq);
+    if (r && (pico_seq_compare(r->end, seq) > 0))
+        return r->end;
+
+    return seq;
+}
+
+static void tcp_sack_del(struct pico_socket_tcp *t, struct tcp_sack_range *r)
+{
+    pico_tree_delete(&t->sack_board, r);
+    PICO_FREE(r);
+}
+
+/* Adds [start, end) to the scoreboard, returns the number of newly SACKed bytes */
+static uint32_t tcp_sack_insert(struct pico_socket_tcp *t, uint32_t start, uint32_t end)
+{
+    struct tcp_sack_range *r = tcp_sack_floor(t, start);
+    struct tcp_sack_range *nxt;
+    struct pico_tree_node *n;
+    uint32_t known;
 
-        tcp_dbg("Marking (by SACK) segment %08x BLK:[%08x::%08x]\n", SEQN(f), start, end);
-        f->flags |= PICO_FRAME_FLAG_SACKED;
-        (*count)++;
+    if (r && (pico_seq_compare(r->end, start) >= 0)) {
+        if (pico_seq_compare(r->end, end) >= 0)
+            return 0;
+    } else {
+        r = PICO_ZALLOC(sizeof(struct tcp_sack_range));
+        if (!r)
+            return 0;
+
+        r->start = start;
+        r->end = start;
+        if (pico_tree_insert(&t->sack_board, r)) {
+            PICO_FREE(r);
+            return 0;
+        }
     }
 
-    return cmp;
+    known = r->end - r->start;
+    r->end = end;
+    /* Swallow the ranges now overlapped by r */
+    while ((n = pico_tree_next(pico_tree_findNode(&t->sack_board, r))) != &LEAF) {
+        nxt = n->keyValue;
+        if (pico_seq_compare(nxt->start, r->end) > 0)
+            break;
+
+        if (pico_seq_compare(nxt->end, r->end) > 0)
+            r->end = nxt->end;
+
+        known += nxt->end - nxt->start;
+        tcp_sack_del(t, nxt);
+    }
+    t->sacked_bytes += (r->end - r->start) - known;
+    t->sack_high = ((struct tcp_sack_range *)pico_tree_last(&t->sack_board))->end;
+    return (r->end - r->start) - known;
 }
 
-static void tcp_process_sack(struct pico_socket_tcp *t, uint32_t start, uint32_t end)
+/* Drops everything below the cumulative ACK from the scoreboard */
+static void tcp_sack_trim(struct pico_socket_tcp *t, uint32_t una)
+{
+    struct tcp_sack_range *r;
+
+    while ((r = pico_tree_first(&t->sack_board)) != NULL) {
+        if (pico_seq_compare(r->start, una) >= 0)
+            break;
+
+        if (pico_seq_compare(r->end, una) > 0) {
+            t->sacked_bytes -= una - r->start;
+            r->start = una;
+            break;
+        }
+
+        t->sacked_bytes -= r->end - r->start;
+        tcp_sack_del(t, r);
+    }
+}
+
+static void tcp_sack_clear(struct pico_socket_tcp *t)
+{
+    struct tcp_sack_range *r;
+    while ((r = pico_tree_first(&t->sack_board)) != NULL)
+        tcp_sack_del(t, r);
+    t->sacked_bytes = 0;
+}
+
+/* Segment of the output queue holding seq, or the first one after it */
+static struct pico_frame *tcp_sack_segment(struct pico_socket_tcp *t, uint32_t seq)
 {
+    struct pico_tree_node *n = t->tcpq_out.pool.root, *found = NULL;
     struct pico_frame *f;
-    struct pico_tree_node *index, *temp;
-    uint16_t count = 0;
 
-    pico_tree_foreach_safe(index, &t->tcpq_out.pool, temp){
-        f = index->keyValue;
-        if (tcp_sack_marker(f, start, end, &count) == 0)
-            goto done;
+    while (n != &LEAF) {
+        f = n->keyValue;
+        if (pico_seq_compare(SEQN(f), seq) <= 0) {
+            found = n;
+            n = n->rightChild;
+        } else {
+            n = n->leftChild;
+        }
+    }
+    if (!found)
+        return first_segment(&t->tcpq_out);
+
+    f = found->keyValue;
+    if (pico_seq_compare(SEQN(f) + f->payload_len, seq) > 0)
+        return f;
+
+    found = pico_tree_next(found);
+    return (found != &LEAF) ? found->keyValue : NULL;
+}
+
+/* Next segment to retransmit in recovery: the first hole at or after
+ * snd_retry below the highest SACKed byte. Without SACK information
+ * the head of the queue is resent. */
+static struct pico_frame *tcp_sack_next_segment(struct pico_socket_tcp *t)
+{
+    struct pico_frame *una = first_segment(&t->tcpq_out);
+    uint32_t seq;
+
+    if (!una || pico_tree_empty(&t->sack_board))
+        return una;
+
+    seq = t->snd_retry;
+    if (pico_seq_compare(seq, SEQN(una)) < 0)
+        seq = SEQN(una);
+
+    seq = tcp_sack_next_hole(t, seq);
+    if (pico_seq_compare(seq, t->sack_high) >= 0)
+        return NULL;
+
+    /* SACK blocks need not end on a segment boundary */
+    return tcp_sack_segment(t, seq);
+}
+
+static void tcp_process_sack(struct pico_socket_tcp *t, uint32_t start, uint32_t end)
+{
+    struct pico_frame *una = first_segment(&t->tcpq_out);
+    struct pico_frame *last = pico_tree_last(&t->tcpq_out.pool);
+    uint32_t sacked, count;
+
+    if (!una || (pico_seq_compare(start, end) >= 0) ||
+        (pico_seq_compare(end, SEQN(last) + last->payload_len) > 0)) {
+        tcp_dbg("Invalid SACK: ignoring.\n");
+        return;
     }
 
-done:
-    if (t->x_mode > PICO_TCP_LOOKAHEAD) {
-        if (t->in_flight > (count))
-            t->in_flight -= (count);
+    /* Blocks below snd_una are D-SACKs */
+    if (pico_seq_compare(end, SEQN(una)) <= 0)
+        return;
+
+    if (pico_seq_compare(start, SEQN(una)) < 0)
+        start = SEQN(una);
+
+    tcp_dbg("Marking (by SACK) BLK:[%08x::%08x]\n", start, end);
+    sacked = tcp_sack_insert(t, start, end);
+    if (sacked && (t->x_mode > PICO_TCP_LOOKAHEAD)) {
+        count = (sacked + t->mss - 1u) / t->mss;
+        if (t->in_flight > count)
+            t->in_flight -= count;
         else
             t->in_flight = 0;
     }
@@ -850,6 +1410,28 @@ static inline void tcp_parse_option_timestamp(struct pico_socket_tcp *t, struct
     t->ts_nxt = long_be(tsval);
 }
 
+static inline void tcp_parse_option_fastopen(struct pico_socket_tcp *t, struct pico_frame *f, uint8_t len, uint8_t *opt, uint32_t *idx)
+{
+    struct pico_tcp_hdr *hdr = (struct pico_tcp_hdr *)(f->transport_hdr);
+    uint32_t cookie_len;
+
+    if (len < PICO_TCPOPTLEN_FASTOPEN)
+        return;
+
+    cookie_len = (uint32_t)(len - PICO_TCPOPTLEN_FASTOPEN);
+    if (((*idx + cookie_len + PICO_SIZE_TCPHDR) > (uint32_t)((hdr->len & 0xf0u) >> 2u)) ||
+        (cookie_len > PICO_TCP_FASTOPEN_COOKIE_MAX) || (cookie_len & 1u) ||
+        ((hdr->flags & PICO_TCP_SYN) == 0)) {
+        *idx += cookie_len;
+        return;
+    }
+
+    memcpy(t->tfo_cookie, opt + *idx, cookie_len);
+    t->tfo_cookie_len = (uint8_t)cookie_len;
+    t->tfo |= PICO_TCP_TFO_OPTION;
+    *idx += cookie_len;
+}
+
 static void tcp_parse_options(struct pico_frame *f)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)f->sock;
@@ -884,6 +1466,9 @@ static void tcp_parse_options(struct pico_frame *f)
         case PICO_TCP_OPTION_TIMESTAMP:
             tcp_parse_option_timestamp(t, f, len, opt, &i);
             break;
+        case PICO_TCP_OPTION_FASTOPEN:
+            tcp_parse_option_fastopen(t, f, len, opt, &i);
+            break;
 
         case PICO_TCP_OPTION_SACK:
             tcp_rcv_sack(t, opt + i, len - 2);
@@ -931,7 +1516,7 @@ static inline int tcp_send_try_enqueue(struct pico_socket_tcp *ts, struct pico_f
         return -1;
     }
 
-    if ((pico_enqueue(&tcp_out, cpy) > 0)) {
+    if ((pico_enqueue(&pico_proto_tcp.q_out, cpy) > 0)) {
         if (f->payload_len > 0) {
             ts->in_flight++;
             ts->snd_nxt += f->payload_len; /* update next pointer here to prevent sending same segment twice when called twice in same tick */
@@ -1006,6 +1591,8 @@ static void pico_tcp_keepalive(pico_time now, void *arg)
             t->ka_retries_count = 0;
         }
     }
+
+    tcp_autotune_idle(t, now);
     t->keepalive_tmr = pico_timer_add(1000, pico_tcp_keepalive, t);
 }
 
@@ -1033,9 +1620,12 @@ struct pico_socket *pico_tcp_open(uint16_t family)
     t->tcpq_in.pool.root = t->tcpq_hold.pool.root = t->tcpq_out.pool.root = &LEAF;
     t->tcpq_hold.pool.compare = t->tcpq_out.pool.compare = segment_compare;
     t->tcpq_in.pool.compare = input_segment_compare;
+    t->sack_board.root = &LEAF;
+    t->sack_board.compare = sack_range_compare;
     t->tcpq_in.max_size = PICO_DEFAULT_SOCKETQ;
     t->tcpq_out.max_size = PICO_DEFAULT_SOCKETQ;
     t->tcpq_hold.max_size = 2u * t->mss;
+    t->autotune = PICO_TCP_AUTOTUNE_RCV | PICO_TCP_AUTOTUNE_SND;
     rto_set(t, PICO_TCP_RTO_MIN);
 
     /* Uncomment next line and disable Nagle by default */
@@ -1141,6 +1731,7 @@ uint32_t pico_tcp_read(struct pico_socket *s, void *buf, uint32_t len)
         tcp_read_check_segment_done(t, f, in_frame_len);
 
     }
+    tcp_autotune_rcvbuf(t);
     return tcp_read_finish(s, tot_rd_len);
 }
 
@@ -1175,13 +1766,7 @@ int pico_tcp_initconn(struct pico_socket *s)
     struct pico_socket_tcp *ts = TCP_SOCK(s);
     struct pico_frame *syn;
     struct pico_tcp_hdr *hdr;
-    uint16_t mtu, opt_len = tcp_options_size(ts, PICO_TCP_SYN);
-
-    syn = s->net->alloc(s->net, (uint16_t)(PICO_SIZE_TCPHDR + opt_len));
-    if (!syn)
-        return -1;
-
-    hdr = (struct pico_tcp_hdr *) syn->transport_hdr;
+    uint16_t mtu, opt_len, data_len = 0;
 
     if (!ts->snd_nxt)
         ts->snd_nxt = long_be(pico_paws());
@@ -1191,6 +1776,19 @@ int pico_tcp_initconn(struct pico_socket *s)
     mtu = (uint16_t)pico_socket_get_mss(s);
     ts->mss = (uint16_t)(mtu - PICO_SIZE_TCPHDR);
     ts->ssthresh = (uint16_t)((uint16_t)(PICO_DEFAULT_SOCKETQ / ts->mss) -  (((uint16_t)(PICO_DEFAULT_SOCKETQ / ts->mss)) >> 3u));
+
+    /* Fast Open: only the first SYN carries the option and the data */
+    if (ts->tfo_data)
+        data_len = tcp_fastopen_client(ts);
+
+    opt_len = tcp_options_size(ts, PICO_TCP_SYN);
+    syn = s->net->alloc(s->net, (uint16_t)(PICO_SIZE_TCPHDR + opt_len + data_len));
+    if (!syn) {
+        ts->tfo_data = NULL;
+        return -1;
+    }
+
+    hdr = (struct pico_tcp_hdr *) syn->transport_hdr;
     syn->sock = s;
     hdr->seq = long_be(ts->snd_nxt);
     hdr->len = (uint8_t)((PICO_SIZE_TCPHDR + opt_len) << 2 | ts->jumbo);
@@ -1200,13 +1798,21 @@ int pico_tcp_initconn(struct pico_socket *s)
     tcp_add_options(ts, syn, PICO_TCP_SYN, opt_len);
     hdr->trans.sport = ts->sock.local_port;
     hdr->trans.dport = ts->sock.remote_port;
+    if (data_len > 0) {
+        syn->payload = syn->transport_hdr + PICO_SIZE_TCPHDR + opt_len;
+        syn->payload_len = data_len;
+        memcpy(syn->payload, ts->tfo_data, data_len);
+    }
+
+    ts->tfo_data = NULL;
+    ts->tfo = (uint8_t)(ts->tfo & (uint8_t)(~PICO_TCP_TFO_SEND));
 
     hdr->crc = 0;
     hdr->crc = short_be(pico_tcp_checksum(syn));
 
     /* TCP: ENQUEUE to PROTO ( SYN ) */
     tcp_dbg("Sending SYN... (ports: %d - %d) size: %d\n", short_be(ts->sock.local_port), short_be(ts->sock.remote_port), syn->buffer_len);
-    pico_enqueue(&tcp_out, syn);
+    pico_enqueue(&pico_proto_tcp.q_out, syn);
     ts->retrans_tmr = pico_timer_add(PICO_TCP_SYN_TO << ts->backoff, initconn_retry, ts);
     return 0;
 }
@@ -1275,7 +1881,7 @@ static void tcp_send_empty(struct pico_socket_tcp *t, uint16_t flags, int is_kee
     hdr->crc = short_be(pico_tcp_checksum(f));
 
     /* TCP: ENQUEUE to PROTO */
-    pico_enqueue(&tcp_out, f);
+    pico_enqueue(&pico_proto_tcp.q_out, f);
 }
 
 static void tcp_send_ack(struct pico_socket_tcp *t)
@@ -1319,7 +1925,7 @@ static int tcp_do_send_rst(struct pico_socket *s, uint32_t seq)
     hdr->crc = short_be(pico_tcp_checksum(f));
 
     /* TCP: ENQUEUE to PROTO */
-    pico_enqueue(&tcp_out, f);
+    pico_enqueue(&pico_proto_tcp.q_out, f);
     tcp_dbg("TCP SEND_RST >>>>>>>>>>>>>>> DONE\n");
     return 0;
 }
@@ -1490,7 +2096,7 @@ static int tcp_nosync_rst(struct pico_socket *s, struct pico_frame *fr)
     hdr->crc = short_be(pico_tcp_checksum(f));
 
     /* TCP: ENQUEUE to PROTO */
-    pico_enqueue(&tcp_out, f);
+    pico_enqueue(&pico_proto_tcp.q_out, f);
 
     /***************************************************************************/
 
@@ -1536,7 +2142,7 @@ static void tcp_send_fin(struct pico_socket_tcp *t)
     hdr->crc = short_be(pico_tcp_checksum(f));
     /* tcp_dbg("SENDING FIN...\n"); */
     if (t->linger_timeout > 0) {
-        pico_enqueue(&tcp_out, f);
+        pico_enqueue(&pico_proto_tcp.q_out, f);
         t->snd_nxt++;
     } else {
         pico_frame_discard(f);
@@ -1778,6 +2384,7 @@ static void tcp_congestion_control(struct pico_socket_tcp *t)
         }
     }
 
+    tcp_autotune_sndbuf(t);
     tcp_dbg("TCP_CWND, %lu, %u, %u, %u\n", TCP_TIME, t->cwnd, t->ssthresh, t->in_flight);
 }
 
@@ -1803,7 +2410,7 @@ static int tcp_rto_xmit(struct pico_socket_tcp *t, struct pico_frame *f)
         return -1;
     }
 
-    if (pico_enqueue(&tcp_out, cpy) > 0) {
+    if (pico_enqueue(&pico_proto_tcp.q_out, cpy) > 0) {
         t->snd_last_out = SEQN(cpy);
         add_retransmission_timer(t, (t->rto << (++t->backoff)) + TCP_TIME);
         tcp_dbg("TCP_CWND, %lu, %u, %u, %u\n", TCP_TIME, t->cwnd, t->ssthresh, t->in_flight);
@@ -1948,7 +2555,7 @@ static int tcp_retrans(struct pico_socket_tcp *t, struct pico_frame *f)
             return -1;
         }
 
-        if (pico_enqueue(&tcp_out, cpy) > 0) {
+        if (pico_enqueue(&pico_proto_tcp.q_out, cpy) > 0) {
             t->in_flight++;
             t->snd_last_out = SEQN(cpy);
         } else {
@@ -2035,6 +2642,7 @@ static int tcp_ack(struct pico_socket *s, struct pico_frame *f)
     t->recv_wnd = short_be(hdr->rwnd);
 
     acked = (uint16_t)tcp_ack_advance_una(t, f, &acked_timestamp);
+    tcp_sack_trim(t, ACKN(f));
     una = first_segment(&t->tcpq_out);
     t->ack_timestamp = TCP_TIME;
 
@@ -2112,26 +2720,14 @@ static int tcp_ack(struct pico_socket *s, struct pico_frame *f)
         } else if (t->x_mode == PICO_TCP_RECOVER) {
             /* tcp_dbg("TCP RECOVER> DUPACK! snd_una: %08x, snd_nxt: %08x, acked now: %08x\n", SEQN(first_segment(&t->tcpq_out)), t->snd_nxt, ACKN(f)); */
             if (t->in_flight <= t->cwnd) {
-                struct pico_frame *nxt = peek_segment(&t->tcpq_out, t->snd_retry);
-                if (!nxt)
-                    nxt = first_segment(&t->tcpq_out);
-
-                while (nxt && (nxt->flags & PICO_FRAME_FLAG_SACKED) && (nxt != first_segment(&t->tcpq_out))) {
-                    tcp_dbg("Skipping %08x because it is sacked.\n", SEQN(nxt));
-                    nxt = next_segment(&t->tcpq_out, nxt);
-                }
-                if (nxt && (pico_seq_compare(SEQN(nxt), t->snd_nxt)) > 0)
-                    nxt = NULL;
-
+                struct pico_frame *nxt = tcp_sack_next_segment(t);
                 if (nxt && (pico_seq_compare(SEQN(nxt), SEQN((struct pico_frame *)first_segment(&t->tcpq_out))) > (int)(t->recv_wnd << t->recv_wnd_scale)))
-                    nxt = NULL;
-
-                if(!nxt)
                     nxt = first_segment(&t->tcpq_out);
 
                 if (nxt) {
-                    tcp_retrans(t, peek_segment(&t->tcpq_out, t->snd_retry));
-                    t->snd_retry = SEQN(nxt);
+                    tcp_retrans(t, nxt);
+                    if (!pico_tree_empty(&t->sack_board))
+                        t->snd_retry = SEQN(nxt) + nxt->payload_len;
                 }
             }
 
@@ -2340,6 +2936,7 @@ static int tcp_syn(struct pico_socket *s, struct pico_frame *f)
     new->tcpq_in.max_size = PICO_DEFAULT_SOCKETQ;
     new->tcpq_out.max_size = PICO_DEFAULT_SOCKETQ;
     new->tcpq_hold.max_size = 2u * mtu;
+    new->autotune = PICO_TCP_AUTOTUNE_RCV | PICO_TCP_AUTOTUNE_SND;
     new->rcv_nxt = long_be(hdr->seq) + 1;
     new->snd_nxt = long_be(pico_paws());
     new->snd_last = new->snd_nxt;
@@ -2352,11 +2949,19 @@ static int tcp_syn(struct pico_socket *s, struct pico_frame *f)
     new->sock.parent = s;
     new->sock.wakeup = s->wakeup;
     rto_set(new, PICO_TCP_RTO_MIN);
+    tcp_fastopen_server(TCP_SOCK(s), new, f);
     /* Initialize timestamp values */
     new->sock.state = PICO_SOCKET_STATE_BOUND | PICO_SOCKET_STATE_CONNECTED | PICO_SOCKET_STATE_TCP_SYN_RECV;
     pico_socket_add(&new->sock);
     tcp_send_synack(&new->sock);
     tcp_dbg("SYNACK sent, socket added. snd_nxt is %08x\n", new->snd_nxt);
+    if (new->tfo & PICO_TCP_TFO_ACCEPTED) {
+        /* The data from the SYN can be read as soon as the socket is accepted */
+        new->rcv_processed = new->rcv_nxt - new->tfo_syn_len;
+        if (s->wakeup)
+            s->wakeup(PICO_SOCK_EV_CONN, s);
+    }
+
     return 0;
 }
 
@@ -2365,7 +2970,7 @@ static int tcp_synrecv_syn(struct pico_socket *s, struct pico_frame *f)
     struct pico_tcp_hdr *hdr = NULL;
     struct pico_socket_tcp *t = TCP_SOCK(s);
     hdr = (struct pico_tcp_hdr *)f->transport_hdr;
-    if (t->rcv_nxt == long_be(hdr->seq) + 1u) {
+    if (t->rcv_nxt == long_be(hdr->seq) + 1u + t->tfo_syn_len) {
         /* take back our own SEQ number to its original value,
          * so the synack retransmitted is identical to the original.
          */
@@ -2395,12 +3000,37 @@ uint16_t pico_tcp_get_socket_mss(struct pico_socket *s)
         return (uint16_t)pico_socket_get_mss(s);
 }
 
+/* Client: learn the cookie from the SYN-ACK. If our data was not acknowledged
+ * and no new cookie came back, the server no longer takes data in the SYN.
+ */
+static void tcp_fastopen_synack(struct pico_socket_tcp *t, struct pico_frame *f)
+{
+    if ((t->tfo & PICO_TCP_TFO_OPTION) && (t->tfo_cookie_len > 0)) {
+        tcp_fastopen_cache_add(&t->sock, t->tfo_cookie, t->tfo_cookie_len);
+    } else if ((t->tfo_syn_len > 0) && (ACKN(f) == (1u + t->snd_nxt))) {
+        tcp_fastopen_cache_del(&t->sock);
+    }
+}
+
+/* Server: after a Fast Open SYN, data may already be in flight towards the
+ * client, so the handshake completes with any ACK up to snd_nxt.
+ */
+static int tcp_fastopen_first_ack(struct pico_socket_tcp *t, struct pico_frame *f)
+{
+    struct pico_frame *una = first_segment(&t->tcpq_out);
+    if (((t->tfo & PICO_TCP_TFO_ACCEPTED) == 0) || !una)
+        return 0;
+
+    return (pico_seq_compare(ACKN(f), SEQN(una)) >= 0) && (pico_seq_compare(ACKN(f), t->snd_nxt) <= 0);
+}
+
 static int tcp_synack(struct pico_socket *s, struct pico_frame *f)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *) s;
     struct pico_tcp_hdr *hdr  = (struct pico_tcp_hdr *)f->transport_hdr;
 
-    if (ACKN(f) ==  (1u + t->snd_nxt)) {
+    if ((ACKN(f) == (1u + t->snd_nxt)) ||
+        ((t->tfo_syn_len > 0) && (ACKN(f) == (1u + t->snd_nxt + t->tfo_syn_len)))) {
         /* Get rid of initconn retry */
         pico_timer_cancel(t->retrans_tmr);
         t->retrans_tmr = 0;
@@ -2408,6 +3038,7 @@ static int tcp_synack(struct pico_socket *s, struct pico_frame *f)
         t->rcv_nxt = long_be(hdr->seq);
         t->rcv_processed = t->rcv_nxt + 1;
         tcp_ack(s, f);
+        tcp_fastopen_synack(t, f);
 
         s->state &= 0x00FFU;
         s->state |= PICO_SOCKET_STATE_TCP_ESTABLISHED;
@@ -2419,7 +3050,7 @@ static int tcp_synack(struct pico_socket *s, struct pico_frame *f)
         s->ev_pending |= PICO_SOCK_EV_WR;
 
         t->rcv_nxt++;
-        t->snd_nxt++;
+        t->snd_nxt = ACKN(f);
         tcp_send_ack(t);              /* return ACK */
 
         return 0;
@@ -2439,18 +3070,21 @@ static int tcp_first_ack(struct pico_socket *s, struct pico_frame *f)
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
     struct pico_tcp_hdr *hdr  = (struct pico_tcp_hdr *)f->transport_hdr;
     tcp_dbg("ACK in SYN_RECV: expecting %08x got %08x\n", t->snd_nxt, ACKN(f));
-    if (t->snd_nxt == ACKN(f)) {
-        tcp_set_init_point(s);
+    if ((t->snd_nxt == ACKN(f)) || tcp_fastopen_first_ack(t, f)) {
+        if ((t->tfo & PICO_TCP_TFO_ACCEPTED) == 0)
+            tcp_set_init_point(s);
+
         tcp_ack(s, f);
+        tcp_fastopen_release(t);
         s->state &= 0x00FFU;
         s->state |= PICO_SOCKET_STATE_TCP_ESTABLISHED;
         tcp_dbg("TCP: Established. State now: %04x\n", s->state);
-        if( !s->parent && s->wakeup) {              /* If the socket has no parent, -> sending socket that has a sim_open */
+        if (t->tfo & PICO_TCP_TFO_ACCEPTED) {
+            /* The listening socket was notified when the SYN was accepted */
+        } else if( !s->parent && s->wakeup) {              /* If the socket has no parent, -> sending socket that has a sim_open */
             tcp_dbg("FIRST ACK - No parent found -> sending socket\n");
             s->wakeup(PICO_SOCK_EV_CONN,  s);
-        }
-
-        if (s->parent && s->parent->wakeup) {
+        } else if (s->parent && s->parent->wakeup) {
             tcp_dbg("FIRST ACK - Parent found -> listening socket\n");
             s->wakeup = s->parent->wakeup;
             s->parent->wakeup(PICO_SOCK_EV_CONN, s->parent);
@@ -2739,6 +3373,73 @@ static int tcp_action_by_flags(const struct tcp_action_entry *action, struct pic
     return ret;
 }
 
+/* Options accepted by header prediction: none, or the timestamp alone,
+ * either NOP-aligned or after the window scale picoTCP repeats in every
+ * segment. The window scale must be unchanged. */
+static int tcp_input_predicted_options(struct pico_socket_tcp *t, struct pico_frame *f, uint8_t *opt, uint32_t len)
+{
+    f->timestamp = 0;
+    if (len == 0)
+        return 0;
+
+    if ((len >= 4u) && (opt[0] == PICO_TCP_OPTION_WS)) {
+        if ((opt[1] != PICO_TCPOPTLEN_WS) || (opt[2] != t->recv_wnd_scale))
+            return -1;
+
+        if (len == 4u)
+            return (opt[3] == PICO_TCP_OPTION_END) ? 0 : -1;
+
+        opt += PICO_TCPOPTLEN_WS;
+        if ((len != 16u) || (opt[10] != PICO_TCP_OPTION_NOOP) || (opt[11] != PICO_TCP_OPTION_NOOP) ||
+            (opt[12] != PICO_TCP_OPTION_END))
+            return -1;
+    } else if ((len == 12u) && (opt[0] == PICO_TCP_OPTION_NOOP) && (opt[1] == PICO_TCP_OPTION_NOOP)) {
+        opt += 2;
+    } else {
+        return -1;
+    }
+
+    if (!t->ts_ok || (opt[0] != PICO_TCP_OPTION_TIMESTAMP) || (opt[1] != PICO_TCPOPTLEN_TIMESTAMP))
+        return -1;
+
+    t->ts_nxt = long_be(long_from(opt + 2));
+    f->timestamp = long_be(long_from(opt + 6));
+    return 0;
+}
+
+/* Header prediction (Van Jacobson). In ESTABLISHED, the next in-order
+ * data segment with ACK (and PSH) only, no option but the timestamp, an
+ * unchanged window and nothing outstanding to ack skips flag validation,
+ * option parsing and the FSM dispatch. Pure ACKs take the full path: the
+ * ACK processing is the cost there, and prediction saved nothing measurable
+ * on it. Returns -1 when the segment has to take the full path.
+ */
+static int tcp_input_predicted(struct pico_socket_tcp *t, struct pico_frame *f)
+{
+    struct pico_tcp_hdr *hdr = (struct pico_tcp_hdr *) (f->transport_hdr);
+    uint8_t *opt = f->transport_hdr + PICO_SIZE_TCPHDR;
+    uint32_t hlen = (hdr->len & 0xf0u) >> 2u;
+
+    if ((f->payload_len == 0) ||
+        ((t->sock.state & PICO_SOCKET_STATE_TCP) != PICO_SOCKET_STATE_TCP_ESTABLISHED) ||
+        ((hdr->flags & (uint8_t)~PICO_TCP_PSH) != PICO_TCP_ACK) ||
+        (SEQN(f) != t->rcv_nxt) || (t->x_mode != PICO_TCP_LOOKAHEAD) ||
+        (short_be(hdr->rwnd) != t->recv_wnd) || (hlen > f->transport_len))
+        return -1;
+
+    if (first_segment(&t->tcpq_out) || (ACKN(f) != t->snd_nxt) || !IS_TCP_HOLDQ_EMPTY(t))
+        return -1;
+
+    if (tcp_input_predicted_options(t, f, opt, hlen - PICO_SIZE_TCPHDR) < 0)
+        return -1;
+
+    tcp_data_in_expected(t, f);
+    tcp_send_ack(t);
+    t->ack_timestamp = TCP_TIME;
+    t->snd_old_ack = ACKN(f);
+    return f->payload_len;
+}
+
 int pico_tcp_input(struct pico_socket *s, struct pico_frame *f)
 {
     struct pico_tcp_hdr *hdr = (struct pico_tcp_hdr *) (f->transport_hdr);
@@ -2757,17 +3458,21 @@ int pico_tcp_input(struct pico_socket *s, struct pico_frame *f)
     /* This copy of the frame has the current socket as owner */
     f->sock = s;
     s->timestamp = TCP_TIME;
-    /* Those are not supported at this time. */
-    /* flags &= (uint8_t) ~(PICO_TCP_CWR | PICO_TCP_URG | PICO_TCP_ECN); */
-    if(invalid_flags(s, flags)) {
-        pico_tcp_reply_rst(f);
-    }
-    else if (flags == PICO_TCP_SYN) {
-        tcp_action_call(action->syn, s, f);
-    } else if (flags == (PICO_TCP_SYN | PICO_TCP_ACK)) {
-        tcp_action_call(action->synack, s, f);
-    } else {
-        ret = tcp_action_by_flags(action, s, f, flags);
+    ret = tcp_input_predicted((struct pico_socket_tcp *)s, f);
+    if (ret < 0) {
+        ret = 0;
+        /* Those are not supported at this time. */
+        /* flags &= (uint8_t) ~(PICO_TCP_CWR | PICO_TCP_URG | PICO_TCP_ECN); */
+        if(invalid_flags(s, flags)) {
+            pico_tcp_reply_rst(f);
+        }
+        else if (flags == PICO_TCP_SYN) {
+            tcp_action_call(action->syn, s, f);
+        } else if (flags == (PICO_TCP_SYN | PICO_TCP_ACK)) {
+            tcp_action_call(action->synack, s, f);
+        } else {
+            ret = tcp_action_by_flags(action, s, f, flags);
+        }
     }
 
     if (s->ev_pending)
@@ -2843,6 +3548,76 @@ static struct pico_frame *tcp_split_segment(struct pico_socket_tcp *t, struct pi
 }
 
 
+/* Pacing rate in bytes per second: the congestion window spread over one
+ * smoothed RTT, with some headroom (2x in slow start, 1.25x afterwards) so that
+ * pacing does not hold back the growth of cwnd. The application can put an
+ * upper limit through PICO_SOCKET_OPT_MAX_PACING_RATE. Zero means no pacing.
+ */
+static uint32_t tcp_pacing_rate(struct pico_socket_tcp *t)
+{
+    uint64_t rate = 0;
+
+    if (t->avg_rtt > 0) {
+        rate = ((uint64_t)t->cwnd * t->mss * 1000u) / t->avg_rtt;
+        if (t->cwnd < t->ssthresh)
+            rate <<= 1;
+        else
+            rate += (rate >> 2);
+
+        if (rate > 0xFFFFFFFFu)
+            rate = 0xFFFFFFFFu;
+    }
+
+    if ((t->max_pacing_rate > 0) && ((rate == 0) || (rate > t->max_pacing_rate)))
+        rate = t->max_pacing_rate;
+
+    return (uint32_t)rate;
+}
+
+static void tcp_pacing_timer(pico_time now, void *arg)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)arg;
+    IGNORE_PARAMETER(now);
+    t->pacing_tmr = 0;
+    pico_tcp_output(&t->sock, (int)t->cwnd);
+}
+
+/* Check whether the pacing schedule allows a transmission now. If not, arm a
+ * timer to resume output when the next slot is due.
+ */
+static int tcp_pacing_hold(struct pico_socket_tcp *t, uint32_t rate)
+{
+    pico_time now = TCP_TIME * 1000u;
+    pico_time wait;
+
+    if ((rate == 0) || (t->pacing_next <= (now + PICO_TCP_PACING_QUANTUM)))
+        return 0;
+
+    if (!t->pacing_tmr) {
+        wait = (t->pacing_next - now - PICO_TCP_PACING_QUANTUM + 999u) / 1000u;
+        if (wait == 0)
+            wait = 1;
+
+        t->pacing_tmr = pico_timer_add(wait, tcp_pacing_timer, t);
+    }
+
+    return 1;
+}
+
+/* Advance the pacing schedule by the transmission time of len bytes */
+static void tcp_pacing_update(struct pico_socket_tcp *t, uint32_t rate, uint32_t len)
+{
+    pico_time now = TCP_TIME * 1000u;
+
+    if (rate == 0)
+        return;
+
+    if (t->pacing_next < now)
+        t->pacing_next = now;
+
+    t->pacing_next += ((pico_time)len * 1000000u) / rate;
+}
+
 int pico_tcp_output(struct pico_socket *s, int loop_score)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
@@ -2850,11 +3625,15 @@ int pico_tcp_output(struct pico_socket *s, int loop_score)
     int sent = 0;
     int data_sent = 0;
     int32_t seq_diff = 0;
+    uint32_t rate = tcp_pacing_rate(t);
 
     una = first_segment(&t->tcpq_out);
     f = peek_segment(&t->tcpq_out, t->snd_nxt);
 
     while((f) && (t->cwnd >= t->in_flight)) {
+        if (tcp_pacing_hold(t, rate))
+            break;
+
         f->timestamp = TCP_TIME;
         add_retransmission_timer(t, t->rto + TCP_TIME);
         tcp_add_options_frame(t, f);
@@ -2891,6 +3670,7 @@ int pico_tcp_output(struct pico_socket *s, int loop_score)
 
         tcp_dbg("TCP> DEQUEUED (for output) frame %08x, acks %08x len= %d, remaining frames %d\n", SEQN(f), ACKN(f), f->payload_len, t->tcpq_out.frames);
         tcp_send(t, f);
+        tcp_pacing_update(t, rate, f->payload_len);
         sent++;
         loop_score--;
         t->snd_last_out = SEQN(f);
@@ -3109,11 +3889,16 @@ void pico_tcp_cleanup_queues(struct pico_socket *sck)
     pico_timer_cancel(tcp->retrans_tmr);
     pico_timer_cancel(tcp->keepalive_tmr);
     pico_timer_cancel(tcp->fin_tmr);
+    pico_timer_cancel(tcp->pacing_tmr);
 
     tcp->retrans_tmr = 0;
     tcp->keepalive_tmr = 0;
     tcp->fin_tmr = 0;
+    tcp->pacing_tmr = 0;
 
+    tcp_autotune_release(tcp, PICO_TCP_AUTOTUNE_RCV | PICO_TCP_AUTOTUNE_SND);
+    tcp_fastopen_release(tcp);
+    tcp_sack_clear(tcp);
     tcp_discard_all_segments(&tcp->tcpq_in);
     tcp_discard_all_segments(&tcp->tcpq_out);
     tcp_discard_all_segments(&tcp->tcpq_hold);
@@ -3180,6 +3965,7 @@ void pico_tcp_flags_update(struct pico_frame *f, struct pico_socket *s)
 int pico_tcp_set_bufsize_in(struct pico_socket *s, uint32_t value)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    tcp_autotune_release(t, PICO_TCP_AUTOTUNE_RCV);
     t->tcpq_in.max_size = value;
     return 0;
 }
@@ -3187,6 +3973,7 @@ int pico_tcp_set_bufsize_in(struct pico_socket *s, uint32_t value)
 int pico_tcp_set_bufsize_out(struct pico_socket *s, uint32_t value)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    tcp_autotune_release(t, PICO_TCP_AUTOTUNE_SND);
     t->tcpq_out.max_size = value;
     return 0;
 }
@@ -3205,6 +3992,58 @@ int pico_tcp_get_bufsize_out(struct pico_socket *s, uint32_t *value)
     return 0;
 }
 
+int pico_tcp_set_max_pacing_rate(struct pico_socket *s, uint32_t value)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    t->max_pacing_rate = value;
+    return 0;
+}
+
+int pico_tcp_get_max_pacing_rate(struct pico_socket *s, uint32_t *value)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    *value = t->max_pacing_rate;
+    return 0;
+}
+
+int pico_tcp_set_fastopen(struct pico_socket *s, uint32_t value)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    if (value)
+        t->tfo |= PICO_TCP_TFO_SERVER;
+    else
+        t->tfo = (uint8_t)(t->tfo & (uint8_t)(~PICO_TCP_TFO_SERVER));
+
+    return 0;
+}
+
+int pico_tcp_get_fastopen(struct pico_socket *s, uint32_t *value)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    *value = (t->tfo & PICO_TCP_TFO_SERVER) ? 1u : 0u;
+    return 0;
+}
+
+/* Data for the next connect: sent in the SYN if a cookie for the server is known */
+void pico_tcp_fastopen_data(struct pico_socket *s, const void *buf, uint16_t len)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    t->tfo_data = (const uint8_t *)buf;
+    t->tfo_len = len;
+}
+
+uint16_t pico_tcp_fastopen_queued(struct pico_socket *s)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    return t->tfo_len;
+}
+
+int pico_tcp_fastopen_accepted(struct pico_socket *s)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
+    return ((t->tfo & PICO_TCP_TFO_ACCEPTED) != 0);
+}
+
 int pico_tcp_set_keepalive_probes(struct pico_socket *s, uint32_t value)
 {
     struct pico_socket_tcp *t = (struct pico_socket_tcp *)s;
@@ -11,7 +11,7 @@
 #include "pico_protocol.h"
 #include "pico_socket.h"
 
-extern struct pico_protocol pico_proto_tcp;
+extern PICO_TLS struct pico_protocol pico_proto_tcp;
 
 PACKED_STRUCT_DEF pico_tcp_hdr {
     struct pico_trans trans;
@@ -52,6 +52,8 @@ PACKED_STRUCT_DEF tcp_pseudo_hdr_ipv4
 #define PICO_TCPOPTLEN_SACK       2 /* Plus the block */
 #define PICO_TCP_OPTION_TIMESTAMP   0x08
 #define PICO_TCPOPTLEN_TIMESTAMP  10u
+#define PICO_TCP_OPTION_FASTOPEN    0x22
+#define PICO_TCPOPTLEN_FASTOPEN   2u /* Plus the cookie */
 
 /* TCP flags */
 #define PICO_TCP_FIN 0x01u
@@ -88,6 +90,7 @@ uint16_t pico_tcp_checksum_ipv6(struct pico_frame *f);
 uint16_t pico_tcp_overhead(struct pico_socket *s);
 int pico_tcp_output(struct pico_socket *s, int loop_score);
 int pico_tcp_queue_in_is_empty(struct pico_socket *s);
+int pico_tcp_queue_out_is_full(struct pico_socket *s);
 int pico_tcp_reply_rst(struct pico_frame *f);
 void pico_tcp_cleanup_queues(struct pico_socket *sck);
 void pico_tcp_notify_closing(struct pico_socket *sck);
@@ -96,6 +99,13 @@ int pico_tcp_set_bufsize_in(struct pico_socket *s, uint32_t value);
 int pico_tcp_set_bufsize_out(struct pico_socket *s, uint32_t value);
 int pico_tcp_get_bufsize_in(struct pico_socket *s, uint32_t *value);
 int pico_tcp_get_bufsize_out(struct pico_socket *s, uint32_t *value);
+int pico_tcp_set_max_pacing_rate(struct pico_socket *s, uint32_t value);
+int pico_tcp_get_max_pacing_rate(struct pico_socket *s, uint32_t *value);
+int pico_tcp_set_fastopen(struct pico_socket *s, uint32_t value);
+int pico_tcp_get_fastopen(struct pico_socket *s, uint32_t *value);
+void pico_tcp_fastopen_data(struct pico_socket *s, const void *buf, uint16_t len);
+uint16_t pico_tcp_fastopen_queued(struct pico_socket *s);
+int pico_tcp_fastopen_accepted(struct pico_socket *s);
 int pico_tcp_set_keepalive_probes(struct pico_socket *s, uint32_t value);
 int pico_tcp_set_keepalive_intvl(struct pico_socket *s, uint32_t value);
 int pico_tcp_set_keepalive_time(struct pico_socket *s, uint32_t value);
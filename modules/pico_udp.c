@@ -17,15 +17,6 @@
 #define UDP_FRAME_OVERHEAD (sizeof(struct pico_frame))
 #define udp_dbg(...) do {} while(0)
 
-/* Queues */
-static struct pico_queue udp_in = {
-    0
-};
-static struct pico_queue udp_out = {
-    0
-};
-
-
 /* Functions */
 
 uint16_t pico_udp_checksum_ipv4(struct pico_frame *f)
@@ -118,7 +109,7 @@ static int pico_udp_push(struct pico_protocol *self, struct pico_frame *f)
         hdr->crc = 0;
     }
 
-    if (pico_enqueue(self->q_out, f) > 0) {
+    if (pico_enqueue(&self->q_out, f) > 0) {
         return f->payload_len;
     } else {
         return 0;
@@ -126,15 +117,13 @@ static int pico_udp_push(struct pico_protocol *self, struct pico_frame *f)
 }
 
 /* Interface: protocol definition */
-struct pico_protocol pico_proto_udp = {
+PICO_TLS struct pico_protocol pico_proto_udp = {
     .name = "udp",
     .proto_number = PICO_PROTO_UDP,
     .layer = PICO_LAYER_TRANSPORT,
     .process_in = pico_transport_process_in,
     .process_out = pico_udp_process_out,
     .push = pico_udp_push,
-    .q_in = &udp_in,
-    .q_out = &udp_out,
 };
 
 
@@ -22,7 +22,7 @@ struct pico_socket_udp
 };
 
 
-extern struct pico_protocol pico_proto_udp;
+extern PICO_TLS struct pico_protocol pico_proto_udp;
 
 PACKED_STRUCT_DEF pico_udp_hdr {
     struct pico_trans trans;
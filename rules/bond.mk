@@ -0,0 +1,3 @@
+OPTIONS+=-DPICO_SUPPORT_BOND
+MOD_OBJ:=$(filter-out $(LIBBASE)modules/pico_hotplug_detection.o,$(MOD_OBJ))
+MOD_OBJ+=$(LIBBASE)modules/pico_dev_bond.o $(LIBBASE)modules/pico_hotplug_detection.o
@@ -0,0 +1,2 @@
+OPTIONS+=-DPICO_SUPPORT_BRIDGE
+MOD_OBJ+=$(LIBBASE)modules/pico_dev_bridge.o
@@ -0,0 +1,2 @@
+OPTIONS+=-DPICO_SUPPORT_CONNTRACK
+MOD_OBJ+=$(LIBBASE)modules/pico_conntrack.o
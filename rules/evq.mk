@@ -0,0 +1,2 @@
+OPTIONS+=-DPICO_SUPPORT_EVQ
+MOD_OBJ+=$(LIBBASE)modules/pico_evq.o
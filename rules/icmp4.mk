@@ -1,5 +1,6 @@
 OPTIONS+=-DPICO_SUPPORT_ICMP4
-MOD_OBJ+=$(LIBBASE)modules/pico_icmp4.o
+MOD_OBJ:=$(filter-out $(LIBBASE)modules/pico_icmp_ratelimit.o,$(MOD_OBJ))
+MOD_OBJ+=$(LIBBASE)modules/pico_icmp4.o $(LIBBASE)modules/pico_icmp_ratelimit.o
 ifneq ($(PING),0)
   OPTIONS+=-DPICO_SUPPORT_PING
 endif
@@ -1,3 +1,4 @@
 OPTIONS+=-DPICO_SUPPORT_IPV6 -DPICO_SUPPORT_ICMP6
-MOD_OBJ+=$(LIBBASE)modules/pico_ipv6.o $(LIBBASE)modules/pico_ipv6_nd.o $(LIBBASE)modules/pico_icmp6.o
+MOD_OBJ:=$(filter-out $(LIBBASE)modules/pico_icmp_ratelimit.o,$(MOD_OBJ))
+MOD_OBJ+=$(LIBBASE)modules/pico_ipv6.o $(LIBBASE)modules/pico_ipv6_nd.o $(LIBBASE)modules/pico_icmp6.o $(LIBBASE)modules/pico_icmp_ratelimit.o
 include rules/ipv6frag.mk
@@ -0,0 +1,3 @@
+OPTIONS+=-DPICO_SUPPORT_MT -DPICO_SUPPORT_EVQ
+MOD_OBJ:=$(filter-out $(LIBBASE)modules/pico_evq.o,$(MOD_OBJ))
+MOD_OBJ+=$(LIBBASE)modules/pico_mt.o $(LIBBASE)modules/pico_evq.o
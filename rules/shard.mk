@@ -0,0 +1,2 @@
+OPTIONS+=-DPICO_SUPPORT_SHARD
+MOD_OBJ+=$(LIBBASE)modules/pico_shard.o
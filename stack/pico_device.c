@@ -16,13 +16,15 @@
 #include "pico_ipv4.h"
 #include "pico_icmp6.h"
 #include "pico_eth.h"
+#include "pico_dev_bridge.h"
+#include "pico_dev_bond.h"
 #define PICO_DEVICE_DEFAULT_MTU (1500)
 
 struct pico_devices_rr_info {
     struct pico_tree_node *node_in, *node_out;
 };
 
-static struct pico_devices_rr_info Devices_rr_info = {
+static PICO_TLS struct pico_devices_rr_info Devices_rr_info = {
     NULL, NULL
 };
 
@@ -38,7 +40,7 @@ static int pico_dev_cmp(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(Device_tree, pico_dev_cmp);
+PICO_TLS PICO_TREE_DECLARE(Device_tree, pico_dev_cmp);
 
 #ifdef PICO_SUPPORT_IPV6
 static void device_init_ipv6_final(struct pico_device *dev, struct pico_ip6 *linklocal)
@@ -88,6 +90,9 @@ static int device_init_mac(struct pico_device *dev, uint8_t *mac)
             PICO_FREE(dev->q_in);
             PICO_FREE(dev->q_out);
             PICO_FREE(dev->eth);
+            dev->q_in = NULL;
+            dev->q_out = NULL;
+            dev->eth = NULL;
             return -1;
         }
 
@@ -136,6 +141,8 @@ static int device_init_nomac(struct pico_device *dev)
     if (pico_device_ipv6_random_ll(dev) < 0) {
         PICO_FREE(dev->q_in);
         PICO_FREE(dev->q_out);
+        dev->q_in = NULL;
+        dev->q_out = NULL;
         return -1;
     }
 
@@ -183,12 +190,58 @@ static void pico_queue_destroy(struct pico_queue *q)
 {
     if (q) {
         pico_queue_empty(q);
+        pico_queue_deinit(q);
         PICO_FREE(q);
     }
 }
 
+#ifdef PICO_SUPPORT_SPSC
+static int pico_device_queue_spsc_ok(struct pico_queue *q, uint32_t slots)
+{
+    if (!slots)
+        return 1;
+
+    return !(slots & (slots - 1u)) && !q->ring && !q->shared && !q->frames;
+}
+
+/* Lock free queues, for a driver that hands frames over from another
+ * thread: pico_stack_recv may then be called by one thread other than the
+ * stack. The number of slots of each queue is a power of two, or 0 to keep
+ * the queue as it is. Must be called before the device is used. */
+int pico_device_queues_spsc(struct pico_device *dev, uint32_t rx_slots, uint32_t tx_slots)
+{
+    if (!dev || !pico_device_queue_spsc_ok(dev->q_in, rx_slots) || !pico_device_queue_spsc_ok(dev->q_out, tx_slots)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (rx_slots && (pico_queue_spsc(dev->q_in, rx_slots) < 0)) {
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    if (tx_slots && (pico_queue_spsc(dev->q_out, tx_slots) < 0)) {
+        if (rx_slots)
+            pico_queue_deinit(dev->q_in);
+
+        pico_err = PICO_ERR_ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
 void pico_device_destroy(struct pico_device *dev)
 {
+#ifdef PICO_SUPPORT_BRIDGE
+    if (dev->bridge)
+        pico_bridge_del_port(dev->bridge, dev);
+#endif
+#ifdef PICO_SUPPORT_BOND
+    if (dev->bond)
+        pico_bond_del_member(dev->bond, dev);
+#endif
 
     pico_queue_destroy(dev->q_in);
     pico_queue_destroy(dev->q_out);
@@ -241,6 +294,19 @@ static int devloop_in(struct pico_device *dev, int loop_score)
         /* Receive */
         f = pico_dequeue(dev->q_in);
         if (f) {
+#ifdef PICO_SUPPORT_BOND
+            if (dev->bond)
+                f->dev = dev->bond; /* received by the bond, on any member */
+#endif
+#ifdef PICO_SUPPORT_BRIDGE
+            if (f->dev->bridge) {
+                /* Port of a bridge: switched, not received */
+                f->datalink_hdr = f->buffer;
+                (void)pico_bridge_receive(f);
+                loop_score--;
+                continue;
+            }
+#endif
             if (dev->eth) {
                 f->datalink_hdr = f->buffer;
                 (void)pico_ethernet_receive(f);
@@ -250,6 +316,8 @@ static int devloop_in(struct pico_device *dev, int loop_score)
             }
 
             loop_score--;
+        } else {
+            break; /* counted, not yet in the lock free ring */
         }
     }
     return loop_score;
@@ -257,6 +325,12 @@ static int devloop_in(struct pico_device *dev, int loop_score)
 
 static int devloop_sendto_dev(struct pico_device *dev, struct pico_frame *f)
 {
+#ifdef PICO_SUPPORT_BRIDGE
+    if (f->flags & PICO_FRAME_FLAG_BRIDGED) {
+        /* Switched by a bridge: the ethernet header is already in place */
+        return (dev->send(dev, f->start, (int)f->len) <= 0);
+    }
+#endif
 
     if (dev->eth) {
         /* Ethernet: pass management of the frame to the pico_ethernet_send() rdv function */
@@ -381,6 +455,14 @@ int32_t pico_device_broadcast(struct pico_frame *f)
     pico_tree_foreach(index, &Device_tree)
     {
         struct pico_device *dev = index->keyValue;
+#ifdef PICO_SUPPORT_BRIDGE
+        if (dev->bridge)
+            continue; /* reached through the bridge */
+#endif
+#ifdef PICO_SUPPORT_BOND
+        if (dev->bond)
+            continue; /* reached through the bond */
+#endif
         if(dev != f->dev)
         {
             struct pico_frame *copy = pico_frame_copy(f);
@@ -215,6 +215,9 @@ struct pico_frame *pico_frame_deepcopy(struct pico_frame *f)
     /* ...restore the two key pointers */
     new->buffer = buf;
     new->usage_count = uc;
+    /* ...and copy the content into the buffer the copy owns */
+    new->flags = (uint8_t)(new->flags & ~(PICO_FRAME_FLAG_EXT_BUFFER | PICO_FRAME_FLAG_EXT_USAGE_COUNTER));
+    memcpy(new->buffer, f->buffer, f->buffer_len);
 
     /* Update in-buffer pointers with offset */
     addr_diff = (int)(new->buffer - f->buffer);
@@ -30,33 +30,25 @@ static int pico_proto_cmp(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(Datalink_proto_tree, pico_proto_cmp);
-PICO_TREE_DECLARE(Network_proto_tree, pico_proto_cmp);
-PICO_TREE_DECLARE(Transport_proto_tree, pico_proto_cmp);
-PICO_TREE_DECLARE(Socket_proto_tree, pico_proto_cmp);
+PICO_TLS PICO_TREE_DECLARE(Datalink_proto_tree, pico_proto_cmp);
+PICO_TLS PICO_TREE_DECLARE(Network_proto_tree, pico_proto_cmp);
+PICO_TLS PICO_TREE_DECLARE(Transport_proto_tree, pico_proto_cmp);
+PICO_TLS PICO_TREE_DECLARE(Socket_proto_tree, pico_proto_cmp);
 
 /* Static variables to keep track of the round robin loop */
-static struct pico_proto_rr proto_rr_datalink   = {
-    &Datalink_proto_tree,     NULL, NULL
-};
-static struct pico_proto_rr proto_rr_network    = {
-    &Network_proto_tree,      NULL, NULL
-};
-static struct pico_proto_rr proto_rr_transport  = {
-    &Transport_proto_tree,    NULL, NULL
-};
-static struct pico_proto_rr proto_rr_socket     = {
-    &Socket_proto_tree,       NULL, NULL
-};
+static PICO_TLS struct pico_proto_rr proto_rr_datalink;
+static PICO_TLS struct pico_proto_rr proto_rr_network;
+static PICO_TLS struct pico_proto_rr proto_rr_transport;
+static PICO_TLS struct pico_proto_rr proto_rr_socket;
 
 static int proto_loop_in(struct pico_protocol *proto, int loop_score)
 {
     struct pico_frame *f;
     while(loop_score > 0) {
-        if (proto->q_in->frames == 0)
+        if (proto->q_in.frames == 0)
             break;
 
-        f = pico_dequeue(proto->q_in);
+        f = pico_dequeue(&proto->q_in);
         if ((f) && (proto->process_in(proto, f) > 0)) {
             loop_score--;
         }
@@ -64,14 +56,46 @@ static int proto_loop_in(struct pico_protocol *proto, int loop_score)
     return loop_score;
 }
 
+/* Run-to-completion: a frame received by a device goes up through the
+ * process_in of each layer in one call chain, down to the socket, instead
+ * of waiting in the queue of each layer for its turn in the tick. The queue
+ * is still used when frames are waiting in it already, so that they are
+ * not overtaken, and when the chain nests deeper than the layers do. */
+#define PICO_PROTOCOL_RTC_DEPTH 4
+
+static PICO_TLS int proto_rtc = 0;
+static PICO_TLS int proto_rtc_depth = 0;
+
+/* Returns the previous setting */
+int pico_protocol_run_to_completion(int enable)
+{
+    int was = proto_rtc;
+    proto_rtc = enable;
+    return was;
+}
+
+int32_t pico_protocol_receive(struct pico_protocol *proto, struct pico_frame *f)
+{
+    int32_t len;
+
+    if (!proto_rtc || (proto->q_in.frames > 0) || (proto_rtc_depth >= PICO_PROTOCOL_RTC_DEPTH))
+        return pico_enqueue(&proto->q_in, f);
+
+    len = (int32_t)f->buffer_len;
+    proto_rtc_depth++;
+    (void)proto->process_in(proto, f);
+    proto_rtc_depth--;
+    return len;
+}
+
 static int proto_loop_out(struct pico_protocol *proto, int loop_score)
 {
     struct pico_frame *f;
     while(loop_score > 0) {
-        if (proto->q_out->frames == 0)
+        if (proto->q_out.frames == 0)
             break;
 
-        f = pico_dequeue(proto->q_out);
+        f = pico_dequeue(&proto->q_out);
         if ((f) && (proto->process_out(proto, f) > 0)) {
             loop_score--;
         }
@@ -147,24 +171,32 @@ static int pico_protocol_generic_loop(struct pico_proto_rr *rr, int loop_score,
     return loop_score;
 }
 
+/* The trees are per instance of the stack (PICO_TLS), their address is only
+ * known at run time */
+static int pico_protocol_layer_loop(struct pico_proto_rr *rr, struct pico_tree *t, int loop_score, int direction)
+{
+    rr->t = t;
+    return pico_protocol_generic_loop(rr, loop_score, direction);
+}
+
 int pico_protocol_datalink_loop(int loop_score, int direction)
 {
-    return pico_protocol_generic_loop(&proto_rr_datalink, loop_score, direction);
+    return pico_protocol_layer_loop(&proto_rr_datalink, &Datalink_proto_tree, loop_score, direction);
 }
 
 int pico_protocol_network_loop(int loop_score, int direction)
 {
-    return pico_protocol_generic_loop(&proto_rr_network, loop_score, direction);
+    return pico_protocol_layer_loop(&proto_rr_network, &Network_proto_tree, loop_score, direction);
 }
 
 int pico_protocol_transport_loop(int loop_score, int direction)
 {
-    return pico_protocol_generic_loop(&proto_rr_transport, loop_score, direction);
+    return pico_protocol_layer_loop(&proto_rr_transport, &Transport_proto_tree, loop_score, direction);
 }
 
 int pico_protocol_socket_loop(int loop_score, int direction)
 {
-    return pico_protocol_generic_loop(&proto_rr_socket, loop_score, direction);
+    return pico_protocol_layer_loop(&proto_rr_socket, &Socket_proto_tree, loop_score, direction);
 }
 
 int pico_protocols_loop(int loop_score)
@@ -22,6 +22,10 @@
 #include "pico_socket_multicast.h"
 #include "pico_socket_tcp.h"
 #include "pico_socket_udp.h"
+#ifdef PICO_SUPPORT_EVQ
+#include "pico_evq.h"
+#include "pico_shard.h"
+#endif
 
 #if defined (PICO_SUPPORT_IPV4) || defined (PICO_SUPPORT_IPV6)
 #if defined (PICO_SUPPORT_TCP) || defined (PICO_SUPPORT_UDP)
@@ -43,7 +47,7 @@ static void *Mutex = NULL;
 # define frag_dbg(...) do {} while(0)
 
 
-static struct pico_sockport *sp_udp = NULL, *sp_tcp = NULL;
+static PICO_TLS struct pico_sockport *sp_udp = NULL, *sp_tcp = NULL;
 
 struct pico_frame *pico_socket_frame_alloc(struct pico_socket *s, uint16_t len);
 
@@ -142,6 +146,16 @@ static int socket_cmp(void *ka, void *kb)
     if (ret == 0)
         ret = b->remote_port - a->remote_port;
 
+    /* Sockets sharing a port through PICO_SOCKET_OPT_REUSEPORT are all kept */
+    if (ret == 0) {
+        uintptr_t ta = PICO_SOCKET_GETOPT(a, PICO_SOCKET_OPT_REUSEPORT) ? (uintptr_t)a : 0;
+        uintptr_t tb = PICO_SOCKET_GETOPT(b, PICO_SOCKET_OPT_REUSEPORT) ? (uintptr_t)b : 0;
+        if (ta < tb)
+            ret = -1;
+        else if (ta > tb)
+            ret = 1;
+    }
+
     return ret;
 }
 
@@ -160,8 +174,8 @@ static int sockport_cmp(void *ka, void *kb)
     return 0;
 }
 
-PICO_TREE_DECLARE(UDPTable, sockport_cmp);
-PICO_TREE_DECLARE(TCPTable, sockport_cmp);
+PICO_TLS PICO_TREE_DECLARE(UDPTable, sockport_cmp);
+PICO_TLS PICO_TREE_DECLARE(TCPTable, sockport_cmp);
 
 struct pico_sockport *pico_get_sockport(uint16_t proto, uint16_t port)
 {
@@ -177,6 +191,79 @@ struct pico_sockport *pico_get_sockport(uint16_t proto, uint16_t port)
     else return NULL;
 }
 
+/* Ephemeral ports: the ports above PICO_SOCKET_PORT_MIN that have a
+ * sockport are mirrored in a bitmap per protocol, so that a free port is
+ * found without probing the socket tables, and the search ends when all
+ * of them are taken. */
+#define PICO_SOCKET_PORT_MIN   1024u
+#define PICO_SOCKET_PORT_COUNT (65536u - PICO_SOCKET_PORT_MIN)
+#define PICO_SOCKET_PORT_WORDS (PICO_SOCKET_PORT_COUNT >> 5)
+
+struct pico_socket_ports {
+    uint32_t *map;  /* bit set: port has a sockport */
+    uint32_t used;
+};
+
+static PICO_TLS struct pico_socket_ports socket_ports[2]; /* TCP, UDP */
+
+static struct pico_socket_ports *pico_socket_ports_get(uint16_t proto, struct pico_tree **table)
+{
+    if (proto == PICO_PROTO_TCP) {
+        *table = &TCPTable;
+        return &socket_ports[0];
+    }
+
+    if (proto == PICO_PROTO_UDP) {
+        *table = &UDPTable;
+        return &socket_ports[1];
+    }
+
+    return NULL;
+}
+
+static void pico_socket_ports_mark(uint16_t proto, uint16_t port, int used)
+{
+    struct pico_tree *table;
+    struct pico_socket_ports *p = pico_socket_ports_get(proto, &table);
+    uint32_t idx = (uint32_t)short_be(port), bit;
+
+    if (!p || !p->map || (idx < PICO_SOCKET_PORT_MIN))
+        return;
+
+    idx -= PICO_SOCKET_PORT_MIN;
+    bit = 1u << (idx & 31u);
+    if (used && !(p->map[idx >> 5] & bit)) {
+        p->map[idx >> 5] |= bit;
+        p->used++;
+    } else if (!used && (p->map[idx >> 5] & bit)) {
+        p->map[idx >> 5] &= ~bit;
+        p->used--;
+    }
+}
+
+/* Allocated on the first ephemeral port request, from the ports bound so far */
+static struct pico_socket_ports *pico_socket_ports_init(uint16_t proto)
+{
+    struct pico_tree *table;
+    struct pico_socket_ports *p = pico_socket_ports_get(proto, &table);
+    struct pico_tree_node *index;
+
+    if (!p || p->map)
+        return p;
+
+    p->map = PICO_ZALLOC(PICO_SOCKET_PORT_WORDS * sizeof(uint32_t));
+    if (!p->map) {
+        pico_err = PICO_ERR_ENOMEM;
+        return NULL;
+    }
+
+    p->used = 0;
+    pico_tree_foreach(index, table) {
+        pico_socket_ports_mark(proto, ((struct pico_sockport *)index->keyValue)->number, 1);
+    }
+    return p;
+}
+
 #ifdef PICO_SUPPORT_IPV4
 
 static int pico_port_in_use_by_nat(uint16_t proto, uint16_t port)
@@ -311,6 +398,117 @@ static int pico_generic_port_in_use(uint16_t proto, uint16_t port, struct pico_s
     return 0;
 }
 
+static int pico_socket_addr_is_any(struct pico_socket *s, union pico_address *addr)
+{
+#ifdef PICO_SUPPORT_IPV6
+    if (is_sock_ipv6(s))
+        return pico_ipv6_is_unspecified(addr->ip6.addr);
+#endif
+    (void)s;
+    return addr->ip4.addr == PICO_IP4_ANY;
+}
+
+static int pico_socket_addr_equal(struct pico_socket *s, union pico_address *a, union pico_address *b)
+{
+    return memcmp(a, b, is_sock_ipv6(s) ? sizeof(struct pico_ip6) : sizeof(struct pico_ip4)) == 0;
+}
+
+/* A port in use can be bound again when all the sockets bound to the
+ * same address, or to a wildcard covering it, have PICO_SOCKET_OPT_REUSEPORT
+ * and the very same local address. Connections accepted on the port do
+ * not count. */
+static int pico_socket_reuseport_bind_ok(struct pico_socket *s, uint16_t port, union pico_address *addr)
+{
+    struct pico_sockport *sp = pico_get_sockport(PROTO(s), port);
+    struct pico_tree_node *index;
+    struct pico_socket *o;
+
+    if (!sp || !PICO_SOCKET_GETOPT(s, PICO_SOCKET_OPT_REUSEPORT))
+        return 0;
+
+    pico_tree_foreach(index, &sp->socks) {
+        o = index->keyValue;
+        if ((o->net != s->net) || ((PROTO(s) == PICO_PROTO_TCP) && o->remote_port))
+            continue;
+
+        if (!pico_socket_addr_equal(s, &o->local_addr, addr) &&
+            !pico_socket_addr_is_any(s, &o->local_addr) && !pico_socket_addr_is_any(s, addr))
+            continue; /* no overlap */
+
+        if (!PICO_SOCKET_GETOPT(o, PICO_SOCKET_OPT_REUSEPORT) || !pico_socket_addr_equal(s, &o->local_addr, addr))
+            return 0;
+    }
+    return 1;
+}
+
+static int pico_socket_reuseport_member(struct pico_socket *s, struct pico_socket *o)
+{
+    if ((o->net != s->net) || !PICO_SOCKET_GETOPT(o, PICO_SOCKET_OPT_REUSEPORT))
+        return 0;
+
+    if ((PROTO(s) == PICO_PROTO_TCP) && (TCPSTATE(o) != PICO_SOCKET_STATE_TCP_LISTEN))
+        return 0;
+
+    return pico_socket_addr_equal(s, &o->local_addr, &s->local_addr);
+}
+
+/* Hash of the remote end of a received frame, the same for all its segments */
+static uint32_t pico_socket_flow_hash(struct pico_frame *f)
+{
+    struct pico_trans *tr = (struct pico_trans *)f->transport_hdr;
+    uint32_t h = 0;
+#ifdef PICO_SUPPORT_IPV6
+    uint32_t w, i;
+#endif
+
+#ifdef PICO_SUPPORT_IPV4
+    if (IS_IPV4(f))
+        h = ((struct pico_ipv4_hdr *)f->net_hdr)->src.addr;
+#endif
+#ifdef PICO_SUPPORT_IPV6
+    if (IS_IPV6(f)) {
+        for (i = 0; i < PICO_SIZE_IP6; i += 4) {
+            memcpy(&w, ((struct pico_ipv6_hdr *)f->net_hdr)->src.addr + i, sizeof(w));
+            h ^= w;
+        }
+    }
+#endif
+    h ^= ((uint32_t)tr->sport << 16) | tr->dport;
+    /* mix all the bits down, the ports sit in the high bytes */
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    return h ^ (h >> 16);
+}
+
+/* The socket of the PICO_SOCKET_OPT_REUSEPORT group of s that receives f.
+ * A flow always lands on the same socket while the group is unchanged. */
+struct pico_socket *pico_socket_reuseport_select(struct pico_sockport *sp, struct pico_socket *s, struct pico_frame *f)
+{
+    struct pico_tree_node *index;
+    struct pico_socket *o;
+    uint32_t n = 0, pick;
+
+    if (!s || !PICO_SOCKET_GETOPT(s, PICO_SOCKET_OPT_REUSEPORT))
+        return s;
+
+    pico_tree_foreach(index, &sp->socks) {
+        if (pico_socket_reuseport_member(s, index->keyValue))
+            n++;
+    }
+    if (n < 2)
+        return s;
+
+    pick = pico_socket_flow_hash(f) % n;
+    pico_tree_foreach(index, &sp->socks) {
+        o = index->keyValue;
+        if (pico_socket_reuseport_member(s, o) && (pick-- == 0))
+            return o;
+    }
+    return s;
+}
+
 int pico_is_port_free(uint16_t proto, uint16_t port, void *addr, void *net)
 {
     struct pico_sockport *sp;
@@ -385,6 +583,7 @@ int8_t pico_socket_add(struct pico_socket *s)
         sp->number = s->local_port;
         sp->socks.root = &LEAF;
         sp->socks.compare = socket_cmp;
+        pico_socket_ports_mark(sp->proto, sp->number, 1);
 
         if (PROTO(s) == PICO_PROTO_UDP)
         {
@@ -450,6 +649,7 @@ static void socket_garbage_collect(pico_time now, void *arg)
 static void pico_socket_check_empty_sockport(struct pico_socket *s, struct pico_sockport *sp)
 {
     if(pico_tree_empty(&sp->socks)) {
+        pico_socket_ports_mark(sp->proto, sp->number, 0);
         if (PROTO(s) == PICO_PROTO_UDP)
         {
             pico_tree_delete(&UDPTable, sp);
@@ -472,6 +672,9 @@ static void pico_socket_check_empty_sockport(struct pico_socket *s, struct pico_
 int8_t pico_socket_del(struct pico_socket *s)
 {
     struct pico_sockport *sp = pico_get_sockport(PROTO(s), s->local_port);
+#ifdef PICO_SUPPORT_EVQ
+    pico_evq_socket_gone(s);
+#endif
     if (!sp) {
         pico_err = PICO_ERR_ENXIO;
         return -1;
@@ -755,8 +958,27 @@ int pico_socket_write(struct pico_socket *s, const void *buf, int len)
     return pico_socket_write_attempt(s, buf, len);
 }
 
+static int pico_socket_high_port_taken(uint16_t proto, uint16_t port)
+{
+#ifdef PICO_SUPPORT_SHARD
+    /* the replies must be steered back to this instance */
+    if (!pico_shard_port_mine(port))
+        return 1;
+
+#endif
+#ifdef PICO_SUPPORT_IPV4
+    if (pico_port_in_use_by_nat(proto, port))
+        return 1;
+#endif
+    return pico_get_sockport(proto, port) != NULL;
+}
+
+/* A free port from a random offset, skipping full words of the bitmap.
+ * Returns 0 when none is left. */
 static uint16_t pico_socket_high_port(uint16_t proto)
 {
+    struct pico_socket_ports *p;
+    uint32_t idx, scanned = 0;
     uint16_t port;
     if (0 ||
 #ifdef PICO_SUPPORT_TCP
@@ -766,16 +988,83 @@ static uint16_t pico_socket_high_port(uint16_t proto)
         (proto == PICO_PROTO_UDP) ||
 #endif
         0) {
-        do {
-            uint32_t rand = pico_rand();
-            port = (uint16_t) (rand & 0xFFFFU);
-            port = (uint16_t)((port % (65535 - 1024)) + 1024U);
-            if (pico_is_port_free(proto, port, NULL, NULL)) {
-                return short_be(port);
+        p = pico_socket_ports_init(proto);
+        if (!p) {
+            /* no memory for the bitmap: a few random probes */
+            for (idx = 0; idx < 64u; idx++) {
+                port = short_be((uint16_t)((pico_rand() % PICO_SOCKET_PORT_COUNT) + PICO_SOCKET_PORT_MIN));
+                if (!pico_socket_high_port_taken(proto, port))
+                    return port;
             }
-        } while(1);
+            return 0U;
+        }
+
+        idx = pico_rand() % PICO_SOCKET_PORT_COUNT;
+#ifdef PICO_SUPPORT_SHARD
+        idx = (uint32_t)pico_shard_port_hint((uint16_t)(idx + PICO_SOCKET_PORT_MIN)) - PICO_SOCKET_PORT_MIN;
+#endif
+        while ((p->used < PICO_SOCKET_PORT_COUNT) && (scanned < PICO_SOCKET_PORT_COUNT)) {
+            if (p->map[idx >> 5] == 0xFFFFFFFFu) {
+                scanned += 32u - (idx & 31u);
+                idx = (idx | 31u) + 1u;
+            } else {
+                if (!(p->map[idx >> 5] & (1u << (idx & 31u)))) {
+                    port = short_be((uint16_t)(idx + PICO_SOCKET_PORT_MIN));
+                    if (!pico_socket_high_port_taken(proto, port))
+                        return port;
+                }
+
+                scanned++;
+                idx++;
+            }
+
+            if (idx >= PICO_SOCKET_PORT_COUNT)
+                idx = 0;
+        }
     }
-    else return 0U;
+
+    return 0U;
+}
+
+/* With all the ephemeral ports taken, a TCP connection can still share the
+ * local port of other connections, as long as the remote endpoints differ.
+ * The socket trees tell connections apart by remote port only, hence the
+ * stricter test. UDP delivery does not look at the remote endpoint at all,
+ * so UDP sockets never share a port this way. */
+static uint16_t pico_socket_shared_port(uint16_t proto, uint16_t remote_port)
+{
+    struct pico_tree *table;
+    struct pico_tree_node *index, *idx;
+    struct pico_sockport *sp;
+    struct pico_socket *o;
+    int ok;
+
+    if (!pico_socket_ports_get(proto, &table))
+        return 0U;
+
+    pico_tree_foreach(index, table) {
+        sp = index->keyValue;
+        if (short_be(sp->number) < PICO_SOCKET_PORT_MIN)
+            continue;
+
+#ifdef PICO_SUPPORT_SHARD
+        if (!pico_shard_port_mine(sp->number))
+            continue;
+
+#endif
+
+        ok = 1;
+        pico_tree_foreach(idx, &sp->socks) {
+            o = idx->keyValue;
+            if (!(o->state & PICO_SOCKET_STATE_CONNECTED) || (o->remote_port == remote_port)) {
+                ok = 0;
+                break;
+            }
+        }
+        if (ok)
+            return sp->number;
+    }
+    return 0U;
 }
 
 static void *pico_socket_sendto_get_ip4_src(struct pico_socket *s, struct pico_ip4 *dst)
@@ -899,6 +1188,29 @@ static void *pico_socket_sendto_get_src(struct pico_socket *s, void *dst)
     return src;
 }
 
+/* As pico_socket_sendto_get_src(), but IPv6 multicast sent on the device
+ * given by msginfo leaves from the link-local address of that device */
+static void *pico_socket_sendto_get_src_msginfo(struct pico_socket *s, void *dst, struct pico_msginfo *msginfo)
+{
+    void *src = pico_socket_sendto_get_src(s, dst);
+#ifdef PICO_SUPPORT_IPV6
+    struct pico_ipv6_link *ll;
+
+    if (!src && (s->net->proto_number == PICO_PROTO_IPV6)
+        && msginfo && msginfo->dev
+        && pico_ipv6_is_multicast(((struct pico_ip6 *)dst)->addr))
+    {
+        ll = pico_ipv6_linklocal_get(msginfo->dev);
+        if (ll)
+            src = &ll->address;
+    }
+
+#else
+    IGNORE_PARAMETER(msginfo);
+#endif
+    return src;
+}
+
 static struct pico_remote_endpoint *pico_socket_sendto_destination_ipv4(struct pico_socket *s, struct pico_ip4 *dst, uint16_t port)
 {
     struct pico_remote_endpoint *ep = NULL;
@@ -1320,19 +1632,9 @@ int MOCKABLE pico_socket_sendto_extended(struct pico_socket *s, const void *buf,
         return -1;
 
 
-    src = pico_socket_sendto_get_src(s, dst);
-    if (!src) {
-#ifdef PICO_SUPPORT_IPV6
-        if((s->net->proto_number == PICO_PROTO_IPV6)
-           && msginfo && msginfo->dev
-           && pico_ipv6_is_multicast(((struct pico_ip6 *)dst)->addr))
-        {
-            src = &(pico_ipv6_linklocal_get(msginfo->dev)->address);
-        }
-        else
-#endif
+    src = pico_socket_sendto_get_src_msginfo(s, dst, msginfo);
+    if (!src)
         return -1;
-    }
 
     remote_endpoint = pico_socket_sendto_destination(s, dst, remote_port);
     if (pico_socket_sendto_set_localport(s) < 0) {
@@ -1349,6 +1651,156 @@ int MOCKABLE pico_socket_sendto(struct pico_socket *s, const void *buf, const in
     return pico_socket_sendto_extended(s, buf, len, dst, remote_port, NULL);
 }
 
+static int pico_mmsg_same_destination(struct pico_socket *s, struct pico_mmsg *a, struct pico_mmsg *b)
+{
+    size_t len = is_sock_ipv6(s) ? sizeof(struct pico_ip6) : sizeof(struct pico_ip4);
+
+    if ((a->port != b->port) || (memcmp(&a->addr, &b->addr, len) != 0))
+        return 0;
+
+    if (a->msginfo && b->msginfo)
+        return a->msginfo->dev == b->msginfo->dev;
+
+    return !a->msginfo && !b->msginfo;
+}
+
+/* Sends the datagrams to the destination of msgs[0], looking up the source
+ * and the route once. Stores the number of datagrams sent in *sent. */
+static int pico_socket_sendmmsg_run(struct pico_socket *s, struct pico_mmsg *msgs, int n, int *sent)
+{
+    struct pico_remote_endpoint *ep;
+    void *src;
+    int i, space, ret = 0;
+
+    *sent = 0;
+    if (pico_socket_sendto_dest_check(s, &msgs[0].addr, msgs[0].port) < 0)
+        return -1;
+
+    src = pico_socket_sendto_get_src(s, &msgs[0].addr);
+    if (!src) {
+        /* e.g. multicast on the device given by msginfo */
+        msgs[0].ret = pico_socket_sendto_extended(s, msgs[0].buf, msgs[0].len, &msgs[0].addr, msgs[0].port, msgs[0].msginfo);
+        if (msgs[0].ret < 0)
+            return -1;
+
+        *sent = 1;
+        return 0;
+    }
+
+    ep = pico_socket_sendto_destination(s, &msgs[0].addr, msgs[0].port);
+    if (!ep)
+        return -1;
+
+    pico_socket_sendto_set_dport(s, msgs[0].port);
+    space = pico_socket_xmit_avail_space(s);
+    for (i = 0; (i < n) && pico_mmsg_same_destination(s, &msgs[0], &msgs[i]); i++) {
+        if ((msgs[i].len < 0) || (!msgs[i].buf && msgs[i].len)) {
+            pico_err = PICO_ERR_EINVAL;
+            msgs[i].ret = -1;
+        } else if (msgs[i].len == 0) {
+            msgs[i].ret = 0;
+        } else if (msgs[i].len > space) {
+            /* needs fragmentation, left to the single datagram path */
+            msgs[i].ret = pico_socket_sendto_extended(s, msgs[i].buf, msgs[i].len, &msgs[i].addr, msgs[i].port, msgs[i].msginfo);
+        } else {
+            msgs[i].ret = pico_socket_xmit_one(s, msgs[i].buf, msgs[i].len, src, ep, msgs[i].msginfo);
+        }
+
+        if (msgs[i].ret < 0) {
+            ret = -1;
+            break;
+        }
+
+        (*sent)++;
+    }
+    pico_endpoint_free(ep);
+    return ret;
+}
+
+int pico_socket_sendmmsg(struct pico_socket *s, struct pico_mmsg *msgs, int n)
+{
+    int sent = 0, run;
+
+    if (!s || !msgs || (n < 0)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (PROTO(s) != PICO_PROTO_UDP) {
+        pico_err = PICO_ERR_EPROTONOSUPPORT;
+        return -1;
+    }
+
+    if (n == 0)
+        return 0;
+
+    if (pico_socket_sendto_set_localport(s) < 0)
+        return -1;
+
+    while (sent < n) {
+        int ret = pico_socket_sendmmsg_run(s, msgs + sent, n - sent, &run);
+        sent += run;
+        if (ret < 0)
+            break;
+    }
+    /* as sendmmsg(): an error is only reported if no datagram was sent */
+    return (sent > 0) ? sent : -1;
+}
+
+/* Sends buf as consecutive datagrams of segsize bytes, the last one possibly
+ * shorter, with a single source and endpoint resolution. Each datagram must
+ * fit in one frame. Stops when the socket queue is full, returning the
+ * bytes sent so far. */
+int pico_socket_sendto_segmented(struct pico_socket *s, const void *buf, int len, int segsize,
+                                 void *dst, uint16_t remote_port, struct pico_msginfo *msginfo)
+{
+    struct pico_remote_endpoint *ep;
+    const uint8_t *p = (const uint8_t *)buf;
+    void *src;
+    int sent = 0, seg, ret = 0;
+
+    if (pico_socket_sendto_initial_checks(s, buf, len, dst, remote_port) < 0)
+        return -1;
+
+    if (PROTO(s) != PICO_PROTO_UDP) {
+        pico_err = PICO_ERR_EPROTONOSUPPORT;
+        return -1;
+    }
+
+    if ((segsize <= 0) || (segsize > pico_socket_xmit_avail_space(s))) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (len <= segsize)
+        return pico_socket_sendto_extended(s, buf, len, dst, remote_port, msginfo);
+
+    src = pico_socket_sendto_get_src_msginfo(s, dst, msginfo);
+    if (!src)
+        return -1;
+
+    ep = pico_socket_sendto_destination(s, dst, remote_port);
+    if (!ep)
+        return -1;
+
+    if (pico_socket_sendto_set_localport(s) < 0) {
+        pico_endpoint_free(ep);
+        return -1;
+    }
+
+    pico_socket_sendto_set_dport(s, remote_port);
+    while (sent < len) {
+        seg = ((len - sent) < segsize) ? (len - sent) : segsize;
+        ret = pico_socket_xmit_one(s, p + sent, seg, src, ep, msginfo);
+        if (ret <= 0)
+            break;
+
+        sent += ret;
+    }
+    pico_endpoint_free(ep);
+    return (sent > 0) ? sent : ret;
+}
+
 int pico_socket_send(struct pico_socket *s, const void *buf, int len)
 {
     if (!s || buf == NULL) {
@@ -1420,6 +1872,40 @@ int pico_socket_recvfrom_extended(struct pico_socket *s, void *buf, int len, voi
     return 0;
 }
 
+int pico_socket_recvmmsg(struct pico_socket *s, struct pico_mmsg *msgs, int n)
+{
+    int i;
+
+    if (!s || !msgs || (n < 0) || (pico_check_socket(s) != 0)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (PROTO(s) != PICO_PROTO_UDP) {
+        pico_err = PICO_ERR_EPROTONOSUPPORT;
+        return -1;
+    }
+
+    if ((s->state & PICO_SOCKET_STATE_BOUND) == 0) {
+        pico_err = PICO_ERR_EADDRNOTAVAIL;
+        return -1;
+    }
+
+#ifdef PICO_SUPPORT_UDP
+    for (i = 0; (i < n) && (s->q_in.frames > 0); i++) {
+        if (!msgs[i].buf || (msgs[i].len < 0) || (msgs[i].len > 0xFFFF)) {
+            pico_err = PICO_ERR_EINVAL;
+            return (i > 0) ? i : -1;
+        }
+
+        msgs[i].ret = pico_udp_recv(s, msgs[i].buf, (uint16_t)msgs[i].len, &msgs[i].addr, &msgs[i].port, msgs[i].msginfo);
+    }
+#else
+    i = 0;
+#endif
+    return i;
+}
+
 int pico_socket_recvfrom(struct pico_socket *s, void *buf, int len, void *orig,
                          uint16_t *remote_port)
 {
@@ -1539,7 +2025,8 @@ int pico_socket_bind(struct pico_socket *s, void *local_addr, uint16_t *port)
         }
     }
 
-    if (pico_is_port_free(PROTO(s), *port, local_addr, s->net) == 0) {
+    if ((pico_is_port_free(PROTO(s), *port, local_addr, s->net) == 0) &&
+        !pico_socket_reuseport_bind_ok(s, *port, (union pico_address *)local_addr)) {
         pico_err = PICO_ERR_EADDRINUSE;
         return -1;
     }
@@ -1578,8 +2065,11 @@ int pico_socket_connect(struct pico_socket *s, const void *remote_addr, uint16_t
 
     if (s->local_port == 0) {
         s->local_port = pico_socket_high_port(PROTO(s));
+        if (!s->local_port && (PROTO(s) == PICO_PROTO_TCP))
+            s->local_port = pico_socket_shared_port(PROTO(s), remote_port);
+
         if (!s->local_port) {
-            pico_err = PICO_ERR_EINVAL;
+            pico_err = PICO_ERR_EADDRINUSE;
             return -1;
         }
     }
@@ -1649,6 +2139,29 @@ int pico_socket_connect(struct pico_socket *s, const void *remote_addr, uint16_t
 
 #ifdef PICO_SUPPORT_TCP
 
+/* Connect with TCP Fast Open: the first len bytes of buf (up to one segment)
+ * are queued with the SYN, and sent within it if the server has given us a
+ * cookie before. Returns the number of bytes queued.
+ */
+int pico_socket_connect_fastopen(struct pico_socket *s, const void *remote_addr, uint16_t remote_port, const void *buf, int len)
+{
+    if (!s || !buf || (len < 0) || (PROTO(s) != PICO_PROTO_TCP)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (len > 0xFFFF)
+        len = 0xFFFF;
+
+    pico_tcp_fastopen_data(s, buf, (uint16_t)len);
+    if (pico_socket_connect(s, remote_addr, remote_port) < 0) {
+        pico_tcp_fastopen_data(s, NULL, 0);
+        return -1;
+    }
+
+    return pico_tcp_fastopen_queued(s);
+}
+
 int pico_socket_listen(struct pico_socket *s, int backlog)
 {
     if (!s || backlog < 1) {
@@ -1711,8 +2224,11 @@ struct pico_socket *pico_socket_accept(struct pico_socket *s, void *orig, uint16
             /* RB_FOREACH(found, socket_tree, &sp->socks) { */
             pico_tree_foreach(index, &sp->socks){
                 found = index->keyValue;
-                if ((s == found->parent) && ((found->state & PICO_SOCKET_STATE_TCP) == PICO_SOCKET_STATE_TCP_ESTABLISHED)) {
+                if ((s == found->parent) && (((found->state & PICO_SOCKET_STATE_TCP) == PICO_SOCKET_STATE_TCP_ESTABLISHED) || pico_tcp_fastopen_accepted(found))) {
                     found->parent = NULL;
+#ifdef PICO_SUPPORT_EVQ
+                    pico_evq_socket_accepted(found, s);
+#endif
                     pico_err = PICO_ERR_NOERR;
                     #ifdef PICO_SUPPORT_IPV6
                     if (is_sock_ipv6(s))
@@ -1733,6 +2249,17 @@ struct pico_socket *pico_socket_accept(struct pico_socket *s, void *orig, uint16
 
 #else
 
+int pico_socket_connect_fastopen(struct pico_socket *s, const void *remote_addr, uint16_t remote_port, const void *buf, int len)
+{
+    IGNORE_PARAMETER(s);
+    IGNORE_PARAMETER(remote_addr);
+    IGNORE_PARAMETER(remote_port);
+    IGNORE_PARAMETER(buf);
+    IGNORE_PARAMETER(len);
+    pico_err = PICO_ERR_EINVAL;
+    return -1;
+}
+
 int pico_socket_listen(struct pico_socket *s, int backlog)
 {
     IGNORE_PARAMETER(s);
@@ -1753,6 +2280,22 @@ struct pico_socket *pico_socket_accept(struct pico_socket *s, void *orig, uint16
 #endif
 
 
+static int pico_socket_set_reuseport(struct pico_socket *s, void *value)
+{
+    if (!value || (s->state & PICO_SOCKET_STATE_BOUND)) {
+        /* the socket trees are ordered on it */
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    if (*(int *)value)
+        PICO_SOCKET_SETOPT_EN(s, PICO_SOCKET_OPT_REUSEPORT);
+    else
+        PICO_SOCKET_SETOPT_DIS(s, PICO_SOCKET_OPT_REUSEPORT);
+
+    return 0;
+}
+
 int pico_socket_setoption(struct pico_socket *s, int option, void *value)
 {
 
@@ -1761,6 +2304,9 @@ int pico_socket_setoption(struct pico_socket *s, int option, void *value)
         return -1;
     }
 
+    if (option == PICO_SOCKET_OPT_REUSEPORT)
+        return pico_socket_set_reuseport(s, value);
+
 
     if (PROTO(s) == PICO_PROTO_TCP)
         return pico_setsockopt_tcp(s, option, value);
@@ -1780,6 +2326,16 @@ int pico_socket_getoption(struct pico_socket *s, int option, void *value)
         return -1;
     }
 
+    if (option == PICO_SOCKET_OPT_REUSEPORT) {
+        if (!value) {
+            pico_err = PICO_ERR_EINVAL;
+            return -1;
+        }
+
+        *(int *)value = PICO_SOCKET_GETOPT(s, PICO_SOCKET_OPT_REUSEPORT);
+        return 0;
+    }
+
 
     if (PROTO(s) == PICO_PROTO_TCP)
         return pico_getsockopt_tcp(s, option, value);
@@ -1845,6 +2401,9 @@ int MOCKABLE pico_socket_close(struct pico_socket *s)
     if (!s)
         return -1;
 
+#ifdef PICO_SUPPORT_EVQ
+    pico_evq_socket_gone(s);
+#endif
 #ifdef PICO_SUPPORT_TCP
     if (PROTO(s) == PICO_PROTO_TCP) {
         if (pico_tcp_check_listen_close(s) == 0)
@@ -1954,9 +2513,23 @@ static int check_socket_sanity(struct pico_socket *s)
 
     /* checking for pending connections */
     if(TCP_STATE(s) == PICO_SOCKET_STATE_TCP_SYN_RECV) {
-        if((PICO_TIME_MS() - s->timestamp) >= PICO_SOCKET_BOUND_TIMEOUT)
-            return -1;
+        if((PICO_TIME_MS() - s->timestamp) < PICO_SOCKET_BOUND_TIMEOUT)
+            return 0;
+
+        /* Already handed to the application by a fast open accept: it owns the socket */
+        if (!s->parent && pico_tcp_fastopen_accepted(s)) {
+            if (!(s->state & PICO_SOCKET_STATE_SHUT_REMOTE) && s->wakeup) {
+                pico_err = PICO_ERR_ETIMEDOUT;
+                s->state |= PICO_SOCKET_STATE_SHUT_REMOTE;
+                s->wakeup(PICO_SOCK_EV_ERR, s);
+            }
+
+            return 0;
+        }
+
+        return -1;
     }
+
     return 0;
 }
 #endif
@@ -1966,7 +2539,7 @@ static int pico_sockets_loop_udp(int loop_score)
 {
 
 #ifdef PICO_SUPPORT_UDP
-    static struct pico_tree_node *index_udp;
+    static PICO_TLS struct pico_tree_node *index_udp;
     struct pico_sockport *start;
     struct pico_socket *s;
     struct pico_frame *f;
@@ -2016,7 +2589,7 @@ static int pico_sockets_loop_tcp(int loop_score)
 #ifdef PICO_SUPPORT_TCP
     struct pico_sockport *start;
     struct pico_socket *s;
-    static struct pico_tree_node *index_tcp;
+    static PICO_TLS struct pico_tree_node *index_tcp;
     if (sp_tcp == NULL)
     {
         index_tcp = pico_tree_firstNode(TCPTable.root);
@@ -130,7 +130,7 @@ static int mcast_socket_cmp(void *ka, void *kb)
 }
 
 /* gather all multicast sockets to hasten filter aggregation */
-PICO_TREE_DECLARE(MCASTSockets, mcast_socket_cmp);
+PICO_TLS PICO_TREE_DECLARE(MCASTSockets, mcast_socket_cmp);
 
 static int mcast_filter_cmp(void *ka, void *kb)
 {
@@ -144,7 +144,7 @@ static int mcast_filter_cmp(void *ka, void *kb)
     return 0;
 }
 /* gather sources to be filtered */
-PICO_TREE_DECLARE(MCASTFilter, mcast_filter_cmp);
+PICO_TLS PICO_TREE_DECLARE(MCASTFilter, mcast_filter_cmp);
 
 static int mcast_filter_cmp_ipv6(void *ka, void *kb)
 {
@@ -152,7 +152,7 @@ static int mcast_filter_cmp_ipv6(void *ka, void *kb)
     return memcmp(&a->ip6, &b->ip6, sizeof(struct pico_ip6));
 }
 /* gather sources to be filtered */
-PICO_TREE_DECLARE(MCASTFilter_ipv6, mcast_filter_cmp_ipv6);
+PICO_TLS PICO_TREE_DECLARE(MCASTFilter_ipv6, mcast_filter_cmp_ipv6);
 
 inline static struct pico_tree *mcast_get_src_tree(struct pico_socket *s,struct pico_mcast *mcast) {
     if( IS_SOCK_IPV4(s)) {
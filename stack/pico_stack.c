@@ -28,6 +28,9 @@
 #include "pico_udp.h"
 #include "pico_tcp.h"
 #include "pico_socket.h"
+#ifdef PICO_SUPPORT_MT
+#include "pico_mt.h"
+#endif
 #include "heap.h"
 
 #define IS_LIMITED_BCAST(f) (((struct pico_ipv4_hdr *) f->net_hdr)->dst.addr == PICO_IP4_BCAST)
@@ -49,10 +52,10 @@ const uint8_t PICO_ETHADDR_MCAST6[6] = {
 #endif
 
 
-volatile pico_time pico_tick;
-volatile pico_err_t pico_err;
+PICO_TLS volatile pico_time pico_tick;
+PICO_TLS volatile pico_err_t pico_err;
 
-static uint32_t _rand_seed;
+static PICO_TLS uint32_t _rand_seed;
 
 void WEAK pico_rand_feed(uint32_t feed)
 {
@@ -199,32 +202,32 @@ MOCKABLE int32_t pico_transport_receive(struct pico_frame *f, uint8_t proto)
 
 #ifdef PICO_SUPPORT_ICMP4
     case PICO_PROTO_ICMP4:
-        ret = pico_enqueue(pico_proto_icmp4.q_in, f);
+        ret = pico_protocol_receive(&pico_proto_icmp4, f);
         break;
 #endif
 
 #ifdef PICO_SUPPORT_ICMP6
     case PICO_PROTO_ICMP6:
-        ret = pico_enqueue(pico_proto_icmp6.q_in, f);
+        ret = pico_protocol_receive(&pico_proto_icmp6, f);
         break;
 #endif
 
 
 #if defined(PICO_SUPPORT_IGMP) && defined(PICO_SUPPORT_MCAST)
     case PICO_PROTO_IGMP:
-        ret = pico_enqueue(pico_proto_igmp.q_in, f);
+        ret = pico_protocol_receive(&pico_proto_igmp, f);
         break;
 #endif
 
 #ifdef PICO_SUPPORT_UDP
     case PICO_PROTO_UDP:
-        ret = pico_enqueue(pico_proto_udp.q_in, f);
+        ret = pico_protocol_receive(&pico_proto_udp, f);
         break;
 #endif
 
 #ifdef PICO_SUPPORT_TCP
     case PICO_PROTO_TCP:
-        ret = pico_enqueue(pico_proto_tcp.q_in, f);
+        ret = pico_protocol_receive(&pico_proto_tcp, f);
         break;
 #endif
 
@@ -240,16 +243,19 @@ MOCKABLE int32_t pico_transport_receive(struct pico_frame *f, uint8_t proto)
 
 int32_t pico_network_receive(struct pico_frame *f)
 {
+    /* f may be gone once handed to the protocol */
+    int32_t len = f ? (int32_t)f->buffer_len : -1;
+
     if (0) {}
 
 #ifdef PICO_SUPPORT_IPV4
     else if (IS_IPV4(f)) {
-        pico_enqueue(pico_proto_ipv4.q_in, f);
+        pico_protocol_receive(&pico_proto_ipv4, f);
     }
 #endif
 #ifdef PICO_SUPPORT_IPV6
     else if (IS_IPV6(f)) {
-        pico_enqueue(pico_proto_ipv6.q_in, f);
+        pico_protocol_receive(&pico_proto_ipv6, f);
     }
 #endif
     else {
@@ -257,7 +263,7 @@ int32_t pico_network_receive(struct pico_frame *f)
         pico_frame_discard(f);
         return -1;
     }
-    return (int32_t)f->buffer_len;
+    return len;
 }
 
 /* Network layer: interface towards socket for frame sending */
@@ -349,30 +355,34 @@ static int destination_is_mcast(struct pico_frame *f)
 #ifdef PICO_SUPPORT_IPV4
 static int32_t pico_ipv4_ethernet_receive(struct pico_frame *f)
 {
+    int32_t len = (int32_t)f->buffer_len;
+
     if (IS_IPV4(f)) {
-        pico_enqueue(pico_proto_ipv4.q_in, f);
+        pico_protocol_receive(&pico_proto_ipv4, f);
     } else {
         (void)pico_icmp4_param_problem(f, 0);
         pico_frame_discard(f);
         return -1;
     }
 
-    return (int32_t)f->buffer_len;
+    return len;
 }
 #endif
 
 #ifdef PICO_SUPPORT_IPV6
 static int32_t pico_ipv6_ethernet_receive(struct pico_frame *f)
 {
+    int32_t len = (int32_t)f->buffer_len;
+
     if (IS_IPV6(f)) {
-        pico_enqueue(pico_proto_ipv6.q_in, f);
+        pico_protocol_receive(&pico_proto_ipv6, f);
     } else {
         /* Wrong version for link layer type */
         pico_frame_discard(f);
         return -1;
     }
 
-    return (int32_t)f->buffer_len;
+    return len;
 }
 #endif
 
@@ -758,6 +768,79 @@ int32_t pico_stack_recv(struct pico_device *dev, uint8_t *buffer, uint32_t len)
     return ret;
 }
 
+static inline uint32_t pico_flow_get32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Flow hash on the addresses and, unless fragmented, the TCP or UDP ports.
+ * It is symmetric: both directions of a flow hash the same, so that the
+ * frames of a connection and its replies are handled by the same instance.
+ * buf starts at the ethernet header if eth is set, at the IP header
+ * otherwise. Other ethernet frames are hashed by hardware address. */
+uint32_t pico_flow_hash(const uint8_t *buf, uint32_t len, int eth)
+{
+    const uint8_t *l3 = buf;
+    uint32_t h = 0, hlen = 0, l3len = len;
+    uint16_t sport, dport;
+    uint8_t version, proto = 0;
+
+    if (eth) {
+        const struct pico_eth_hdr *ehdr = (const struct pico_eth_hdr *)buf;
+        if (len < PICO_SIZE_ETHHDR)
+            return 0;
+
+        h = pico_flow_get32(ehdr->daddr + 2) ^ pico_flow_get32(ehdr->saddr + 2);
+        l3 += PICO_SIZE_ETHHDR;
+        l3len -= PICO_SIZE_ETHHDR;
+        if ((ehdr->proto != PICO_IDETH_IPV4) && (ehdr->proto != PICO_IDETH_IPV6))
+            l3len = 0;
+    }
+
+    version = (l3len > 0) ? (uint8_t)(l3[0] >> 4) : 0;
+#ifdef PICO_SUPPORT_IPV4
+    if ((version == 4) && (l3len >= PICO_SIZE_IP4HDR)) {
+        const struct pico_ipv4_hdr *hdr = (const struct pico_ipv4_hdr *)l3;
+        h = hdr->src.addr ^ hdr->dst.addr;
+        if (!(hdr->frag & short_be(PICO_IPV4_MOREFRAG | PICO_IPV4_FRAG_MASK))) {
+            proto = hdr->proto;
+            hlen = (uint32_t)(hdr->vhl & 0x0fu) << 2;
+        }
+    }
+
+#endif
+#ifdef PICO_SUPPORT_IPV6
+    if ((version == 6) && (l3len >= PICO_SIZE_IP6HDR)) {
+        const struct pico_ipv6_hdr *hdr = (const struct pico_ipv6_hdr *)l3;
+        uint32_t i;
+        h = 0;
+        for (i = 0; i < PICO_SIZE_IP6; i += 4)
+            h ^= pico_flow_get32(hdr->src.addr + i) ^ pico_flow_get32(hdr->dst.addr + i);
+        proto = hdr->nxthdr;
+        hlen = PICO_SIZE_IP6HDR;
+    }
+
+#endif
+    if (((proto == PICO_PROTO_TCP) || (proto == PICO_PROTO_UDP)) && (l3len >= hlen + 4u)) {
+        /* the ports would cancel out bits of the addresses if just xored */
+        h *= 0x9E3779B1u;
+        memcpy(&sport, l3 + hlen, sizeof(sport));
+        memcpy(&dport, l3 + hlen + 2, sizeof(dport));
+        if (sport < dport)
+            h ^= ((uint32_t)sport << 16) | dport;
+        else
+            h ^= ((uint32_t)dport << 16) | sport;
+    }
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    return h ^ (h >> 16);
+}
+
 static int32_t _pico_stack_recv_zerocopy(struct pico_device *dev, uint8_t *buffer, uint32_t len, int ext_buffer, void (*notify_free)(uint8_t *))
 {
     struct pico_frame *f;
@@ -832,7 +915,7 @@ struct pico_timer
 };
 
 
-static uint32_t tmr_id = 0u;
+static PICO_TLS uint32_t tmr_id = 0u;
 struct pico_timer_ref
 {
     pico_time expire;
@@ -844,7 +927,7 @@ typedef struct pico_timer_ref pico_timer_ref;
 
 DECLARE_HEAP(pico_timer_ref, expire);
 
-static heap_pico_timer_ref *Timers;
+static PICO_TLS heap_pico_timer_ref *Timers;
 
 int32_t pico_seq_compare(uint32_t a, uint32_t b)
 {
@@ -1000,67 +1083,184 @@ static int calc_score(int *score, int *index, int avg[][PROTO_DEF_AVG_NR], int *
     return 0;
 }
 
-void pico_stack_tick(void)
+/* The tick runs the input and output loops of each layer, in phases, the
+ * input then the output. The scheduler tells with which loop score, the
+ * budget of frames a phase may handle:
+ * - adaptive (default): calc_score above;
+ * - latency: small fixed quanta, and the frames taken from the devices go
+ *   up to the sockets in one call chain (pico_protocol_receive), so that a
+ *   reply is queued before the output phases of the same tick, with no
+ *   wait in the queue of each layer;
+ * - throughput: large fixed quanta.
+ * The fixed quanta are shared between input and output by weighted deficit
+ * round robin: each tick a phase is credited the quantum of its direction,
+ * a phase that runs idle loses what it did not use, and one that overruns
+ * its budget (a device poll delivering a whole burst) pays it back on the
+ * following ticks. */
+#define PICO_SCHED_LATENCY_QUANTUM      PROTO_MIN_SCORE
+#define PICO_SCHED_THROUGHPUT_QUANTUM   (PROTO_MAX_SCORE << 2)
+#define PICO_SCHED_MAX_WEIGHT           8
+
+#if defined (PICO_SUPPORT_IPV4) || defined (PICO_SUPPORT_IPV6)
+#if defined (PICO_SUPPORT_TCP) || defined (PICO_SUPPORT_UDP)
+#define PICO_SCHED_SOCKETS
+#endif
+#endif
+
+static int pico_sched_sockets_loop(int loop_score, int direction)
 {
-    static int score[PROTO_DEF_NR] = {
-        PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE
-    };
-    static int index[PROTO_DEF_NR] = {
-        0, 0, 0, 0, 0, 0
-    };
-    static int avg[PROTO_DEF_NR][PROTO_DEF_AVG_NR];
-    static int ret[PROTO_DEF_NR] = {
-        0
-    };
+    IGNORE_PARAMETER(direction);
+#ifdef PICO_SCHED_SOCKETS
+    return pico_sockets_loop(loop_score);
+#else
+    return loop_score;
+#endif
+}
 
-    pico_check_timers();
+struct pico_sched_phase {
+    int (*loop)(int loop_score, int direction);
+    int direction;
+};
+
+/* Indexed by PICO_SCHED_PHASE_* */
+static const struct pico_sched_phase pico_sched_phases[PICO_SCHED_PHASES] = {
+    { pico_devices_loop, PICO_LOOP_DIR_IN },
+    { pico_protocol_datalink_loop, PICO_LOOP_DIR_IN },
+    { pico_protocol_network_loop, PICO_LOOP_DIR_IN },
+    { pico_protocol_transport_loop, PICO_LOOP_DIR_IN },
+    { pico_protocol_socket_loop, PICO_LOOP_DIR_IN },
+    { pico_sched_sockets_loop, PICO_LOOP_DIR_OUT },
+    { pico_protocol_socket_loop, PICO_LOOP_DIR_OUT },
+    { pico_protocol_transport_loop, PICO_LOOP_DIR_OUT },
+    { pico_protocol_network_loop, PICO_LOOP_DIR_OUT },
+    { pico_protocol_datalink_loop, PICO_LOOP_DIR_OUT },
+    { pico_devices_loop, PICO_LOOP_DIR_OUT }
+};
 
-    /* dbg("LOOP_SCORES> %3d - %3d - %3d - %3d - %3d - %3d - %3d - %3d - %3d - %3d - %3d\n",score[0],score[1],score[2],score[3],score[4],score[5],score[6],score[7],score[8],score[9],score[10]); */
+/* The sockets loop runs before the socket input, as it always did */
+static const uint8_t pico_sched_order[PICO_SCHED_PHASES] = {
+    0, 1, 2, 3, 5, 4, 6, 7, 8, 9, 10
+};
 
-    /* score = pico_protocols_loop(100); */
+struct pico_sched {
+    int quantum;                /* per phase and unit of weight, 0 for calc_score */
+    int rtc;                    /* received frames go up the layers in one call chain */
+};
 
-    ret[0] = pico_devices_loop(score[0], PICO_LOOP_DIR_IN);
-    pico_rand_feed((uint32_t)ret[0]);
+/* Indexed by PICO_SCHED_* */
+static const struct pico_sched pico_scheds[] = {
+    { 0, 0 },
+    { PICO_SCHED_LATENCY_QUANTUM, 1 },
+    { PICO_SCHED_THROUGHPUT_QUANTUM, 0 }
+};
 
-    ret[1] = pico_protocol_datalink_loop(score[1], PICO_LOOP_DIR_IN);
-    pico_rand_feed((uint32_t)ret[1]);
+static PICO_TLS const struct pico_sched *pico_sched_cur = &pico_scheds[PICO_SCHED_ADAPTIVE];
+static PICO_TLS int pico_sched_weight_in = 1, pico_sched_weight_out = 1;
+static PICO_TLS int pico_sched_deficit[PICO_SCHED_PHASES];
+static PICO_TLS struct pico_sched_stats pico_sched_stat;
 
-    ret[2] = pico_protocol_network_loop(score[2], PICO_LOOP_DIR_IN);
-    pico_rand_feed((uint32_t)ret[2]);
+static int pico_sched_run(int phase, int loop_score)
+{
+    const struct pico_sched_phase *p = &pico_sched_phases[phase];
+    int ret = p->loop(loop_score, p->direction);
 
-    ret[3] = pico_protocol_transport_loop(score[3], PICO_LOOP_DIR_IN);
-    pico_rand_feed((uint32_t)ret[3]);
+    pico_rand_feed((uint32_t)ret);
+    if (ret < loop_score)
+        pico_sched_stat.work[phase] += (uint32_t)(loop_score - ret);
 
+    return ret;
+}
 
-    ret[5] = score[5];
-#if defined (PICO_SUPPORT_IPV4) || defined (PICO_SUPPORT_IPV6)
-#if defined (PICO_SUPPORT_TCP) || defined (PICO_SUPPORT_UDP)
-    ret[5] = pico_sockets_loop(score[5]); /* swapped */
-    pico_rand_feed((uint32_t)ret[5]);
-#endif
-#endif
+static void pico_sched_drr(int phase)
+{
+    int weight = (pico_sched_phases[phase].direction == PICO_LOOP_DIR_IN) ? pico_sched_weight_in : pico_sched_weight_out;
+    int ret;
+
+    pico_sched_deficit[phase] += pico_sched_cur->quantum * weight;
+    if (pico_sched_deficit[phase] <= 0)
+        return; /* still paying back an overrun */
+
+    ret = pico_sched_run(phase, pico_sched_deficit[phase]);
+    pico_sched_deficit[phase] = (ret < 0) ? ret : 0;
+}
+
+int pico_stack_sched_mode(int mode)
+{
+    if ((mode < PICO_SCHED_ADAPTIVE) || (mode > PICO_SCHED_THROUGHPUT)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
+
+    pico_sched_cur = &pico_scheds[mode];
+    memset(pico_sched_deficit, 0, sizeof(pico_sched_deficit));
+    return 0;
+}
+
+/* Share of the fixed quanta between input and output, 1 to 8 each */
+int pico_stack_sched_weights(int in, int out)
+{
+    if ((in < 1) || (in > PICO_SCHED_MAX_WEIGHT) || (out < 1) || (out > PICO_SCHED_MAX_WEIGHT)) {
+        pico_err = PICO_ERR_EINVAL;
+        return -1;
+    }
 
-    ret[4] = pico_protocol_socket_loop(score[4], PICO_LOOP_DIR_IN);
-    pico_rand_feed((uint32_t)ret[4]);
+    pico_sched_weight_in = in;
+    pico_sched_weight_out = out;
+    return 0;
+}
 
+void pico_stack_sched_stats(struct pico_sched_stats *stats, int reset)
+{
+    if (stats)
+        memcpy(stats, &pico_sched_stat, sizeof(struct pico_sched_stats));
 
-    ret[6] = pico_protocol_socket_loop(score[6], PICO_LOOP_DIR_OUT);
-    pico_rand_feed((uint32_t)ret[6]);
+    if (reset)
+        memset(&pico_sched_stat, 0, sizeof(struct pico_sched_stats));
+}
 
-    ret[7] = pico_protocol_transport_loop(score[7], PICO_LOOP_DIR_OUT);
-    pico_rand_feed((uint32_t)ret[7]);
+void pico_stack_tick(void)
+{
+    static PICO_TLS int score[PROTO_DEF_NR] = {
+        PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE, PROTO_DEF_SCORE
+    };
+    static PICO_TLS int index[PROTO_DEF_NR] = {
+        0, 0, 0, 0, 0, 0
+    };
+    static PICO_TLS int avg[PROTO_DEF_NR][PROTO_DEF_AVG_NR];
+    static PICO_TLS int ret[PROTO_DEF_NR] = {
+        0
+    };
+    const struct pico_sched *sched = pico_sched_cur;
+    uint32_t i;
+    int rtc = 0;
 
-    ret[8] = pico_protocol_network_loop(score[8], PICO_LOOP_DIR_OUT);
-    pico_rand_feed((uint32_t)ret[8]);
+    pico_check_timers();
 
-    ret[9] = pico_protocol_datalink_loop(score[9], PICO_LOOP_DIR_OUT);
-    pico_rand_feed((uint32_t)ret[9]);
+#ifdef PICO_SUPPORT_MT
+    /* operations posted by the application threads */
+    pico_mt_run_commands();
+#endif
 
-    ret[10] = pico_devices_loop(score[10], PICO_LOOP_DIR_OUT);
-    pico_rand_feed((uint32_t)ret[10]);
+    pico_sched_stat.ticks++;
+    if (sched->rtc) /* for this tick only, as set by the application otherwise */
+        rtc = pico_protocol_run_to_completion(1);
+
+    for (i = 0; i < PICO_SCHED_PHASES; i++) {
+        if (sched->quantum)
+            pico_sched_drr(pico_sched_order[i]);
+        else
+            ret[pico_sched_order[i]] = pico_sched_run(pico_sched_order[i], score[pico_sched_order[i]]);
+    }
+    if (sched->rtc)
+        pico_protocol_run_to_completion(rtc);
+
+#ifdef PICO_SUPPORT_MT
+    pico_mt_run_completions();
+#endif
 
     /* calculate new loop scores for next iteration */
-    calc_score(score, index, (int (*)[])avg, ret);
+    if (!sched->quantum)
+        calc_score(score, index, (int (*)[])avg, ret);
 }
 
 void pico_stack_loop(void)
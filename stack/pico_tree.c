@@ -13,7 +13,8 @@
 #define RED     0
 #define BLACK 1
 
-/* By default the null leafs are black */
+/* By default the null leafs are black. LEAF is shared by all the trees, of
+ * all the instances of a sharded stack: it is never written. */
 struct pico_tree_node LEAF = {
     NULL, /* key */
     &LEAF, &LEAF, &LEAF, /* parent, left,right */
@@ -571,5 +572,6 @@ static void fix_delete_collisions(struct pico_tree*tree, struct pico_tree_node *
             }
         }
     }
-    node->color = BLACK;
+    if (IS_NOT_LEAF(node))
+        node->color = BLACK;
 }
@@ -0,0 +1,41 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   Helpers shared by the micro-benchmarks in test/bench.
+   They are built by 'make bench' and run on the host.
+ *********************************************************************/
+#ifndef PICO_BENCH_H
+#define PICO_BENCH_H
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Cycle counter where available, nanoseconds otherwise */
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static inline uint64_t bench_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+# define BENCH_UNIT "cycles"
+#else
+# define BENCH_UNIT "ns"
+#endif
+
+#endif
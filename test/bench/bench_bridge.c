@@ -0,0 +1,123 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   L2 bridge with four ports, frames injected on the ports and drained
+   by the device loop: frames per second for known unicast destinations,
+   for flooded broadcasts and for a churning population of stations.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_eth.h"
+#include "pico_protocol.h"
+#include "pico_dev_bridge.h"
+#include "bench.h"
+
+#define BENCH_PORTS  4
+#define BENCH_FRAMES 1000000u
+#define BENCH_BURST  64u
+#define BENCH_LEN    64u
+
+static struct pico_device *bench_port[BENCH_PORTS];
+static uint64_t bench_tx;
+
+static int bench_send(struct pico_device *dev, void *buf, int len)
+{
+    (void)dev;
+    (void)buf;
+    bench_tx++;
+    return len;
+}
+
+/* Station i sits behind port i % BENCH_PORTS */
+static void bench_mac(uint8_t *mac, uint32_t i)
+{
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (uint8_t)(i >> 24);
+    mac[3] = (uint8_t)(i >> 16);
+    mac[4] = (uint8_t)(i >> 8);
+    mac[5] = (uint8_t)i;
+}
+
+static void bench_inject(uint32_t src, uint32_t dst, int bcast)
+{
+    uint8_t buf[BENCH_LEN];
+    struct pico_eth_hdr *hdr = (struct pico_eth_hdr *)buf;
+
+    memset(buf, 0, sizeof(buf));
+    bench_mac(hdr->saddr, src);
+    if (bcast)
+        memset(hdr->daddr, 0xff, PICO_SIZE_ETH);
+    else
+        bench_mac(hdr->daddr, dst);
+
+    hdr->proto = 0xb588; /* local experimental ethertype */
+    pico_stack_recv(bench_port[src % BENCH_PORTS], buf, BENCH_LEN);
+}
+
+static void bench_drain(void)
+{
+    pico_devices_loop(1000, PICO_LOOP_DIR_IN);
+    pico_devices_loop(1000, PICO_LOOP_DIR_OUT);
+}
+
+static void bench_run(const char *name, uint32_t stations, int bcast, int churn)
+{
+    uint32_t j, src, dst;
+    uint64_t start, ns;
+
+    /* let the bridge learn the stations first */
+    for (j = 0; j < stations; j++) {
+        bench_inject(j, j, 1);
+        if ((j % BENCH_BURST) == 0)
+            bench_drain();
+    }
+    bench_drain();
+
+    bench_tx = 0;
+    start = bench_ns();
+    for (j = 0; j < BENCH_FRAMES; j++) {
+        src = (j * 2654435761u) % stations;
+        dst = (src + 1u) % stations;
+        if (churn)
+            src = stations + j; /* never seen before */
+
+        bench_inject(src, dst, bcast);
+        if ((j % BENCH_BURST) == (BENCH_BURST - 1u))
+            bench_drain();
+    }
+    bench_drain();
+    ns = bench_ns() - start;
+
+    printf("%-22s %6u stations: %10.0f frames/s  (%.2f tx per frame)\n", name, stations,
+           (double)BENCH_FRAMES * 1e9 / (double)ns, (double)bench_tx / (double)BENCH_FRAMES);
+}
+
+int main(void)
+{
+    struct pico_device *br;
+    uint8_t mac[PICO_SIZE_ETH] = {
+        0x02, 0xff, 0x00, 0x00, 0x00, 0x00
+    };
+    char name[MAX_DEVICE_NAME];
+    int i;
+
+    pico_stack_init();
+    br = pico_bridge_create("br0", mac);
+    for (i = 0; i < BENCH_PORTS; i++) {
+        bench_port[i] = PICO_ZALLOC(sizeof(struct pico_device));
+        bench_port[i]->send = bench_send;
+        snprintf(name, MAX_DEVICE_NAME, "port%d", i);
+        mac[5] = (uint8_t)(i + 1);
+        pico_device_init(bench_port[i], name, mac);
+        pico_bridge_add_port(br, bench_port[i]);
+    }
+
+    bench_run("known unicast", 64u, 0, 0);
+    bench_run("known unicast", 1000u, 0, 0);
+    bench_run("broadcast flood", 64u, 1, 0);
+    bench_run("learning churn", 1000u, 0, 1);
+    return 0;
+}
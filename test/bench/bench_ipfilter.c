@@ -0,0 +1,132 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   Cost of classifying one packet against 10 to 1000 filter rules: the
+   filter tree lookup that was used before (which can miss overlapping
+   wildcard rules), an exact scan of all rules and the compiled classifier.
+   Half of the packets come from outside the filtered networks.
+   Build with 'make bench DEBUG=0' for meaningful numbers.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_ipv4.h"
+#include "modules/pico_ipfilter.c"
+#include "bench.h"
+
+#define BENCH_PACKETS 100000u
+#define BENCH_ROUNDS  5
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return bench_seed >> 8;
+}
+
+/* Rules block sources of 10.0.0.0/16 by /24 or single host, per port */
+static void bench_rules(uint32_t count, uint32_t *ids)
+{
+    struct pico_ip4 in_addr, in_mask;
+    uint32_t i, r;
+
+    for (i = 0; i < count; i++) {
+        do {
+            r = bench_rand();
+            in_addr.addr = long_be(0x0a000000u | (r & 0x0000FF00u) | ((r & 1u) ? (r >> 16) & 0xFFu : 0u));
+            in_mask.addr = long_be((r & 1u) ? 0xFFFFFFFFu : 0xFFFFFF00u);
+            ids[i] = pico_ipv4_filter_add(NULL, (r & 2u) ? PICO_PROTO_TCP : PICO_PROTO_UDP, NULL, NULL,
+                                          &in_addr, &in_mask, (uint16_t)(1u + (r % 64u)), 0, 0, 0, FILTER_DROP);
+        } while (!ids[i]);
+    }
+}
+
+static void bench_packet(struct filter_node *pkt, uint32_t i)
+{
+    uint32_t r = bench_rand();
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->proto = (r & 2u) ? PICO_PROTO_TCP : PICO_PROTO_UDP;
+    /* odd packets come from outside 10.0.0.0/16 */
+    pkt->in_addr = long_be(((i & 1u) ? 0xc0000000u : 0x0a000000u) | (r & 0x0000FFFFu));
+    pkt->out_addr = long_be(0xc0a80001u);
+    pkt->in_port = (uint16_t)(r >> 4);
+    pkt->out_port = (uint16_t)(1u + (r % 64u));
+}
+
+/* Oldest rule matching the packet */
+static struct filter_node *bench_scan(struct filter_node *pkt)
+{
+    struct pico_tree_node *index;
+    struct filter_node *rule, *found = NULL;
+
+    pico_tree_foreach(index, &filter_tree) {
+        rule = index->keyValue;
+        if ((filter_match_packet(pkt, rule) == 0) && (!found || (rule->filter_id < found->filter_id)))
+            found = rule;
+    }
+    return found;
+}
+
+static double bench_lookup(struct filter_node *pkts, int mode, uint32_t *hits)
+{
+    struct ipf_classifier *c = ipf_compiled;
+    struct filter_node *rule;
+    uint64_t start, best = 0;
+    uint32_t i;
+    int round;
+
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        *hits = 0;
+        start = bench_cycles();
+        for (i = 0; i < BENCH_PACKETS; i++) {
+            if (mode == 2)
+                rule = ipf_classify(c, &pkts[i]);
+            else if (mode == 1)
+                rule = bench_scan(&pkts[i]);
+            else
+                rule = pico_tree_findKey(&filter_tree, &pkts[i]);
+
+            if (rule)
+                (*hits)++;
+        }
+        start = bench_cycles() - start;
+        if (!best || (start < best))
+            best = start;
+    }
+    return (double)best / BENCH_PACKETS;
+}
+
+static void bench_run(uint32_t count, struct filter_node *pkts)
+{
+    uint32_t *ids = PICO_ZALLOC(count * sizeof(uint32_t));
+    uint32_t i, tree_hits, scan_hits, hits;
+    double tree, scan, compiled;
+
+    bench_rules(count, ids);
+    tree = bench_lookup(pkts, 0, &tree_hits);
+    scan = bench_lookup(pkts, 1, &scan_hits);
+    compiled = bench_lookup(pkts, 2, &hits);
+    printf("%5u rules: %10.1f %10.1f %10.1f   %6u %6u %6u\n", count, tree, scan, compiled, tree_hits, scan_hits, hits);
+    for (i = 0; i < count; i++)
+        pico_ipv4_filter_del(ids[i]);
+    PICO_FREE(ids);
+}
+
+int main(void)
+{
+    struct filter_node *pkts = PICO_ZALLOC(BENCH_PACKETS * sizeof(struct filter_node));
+    uint32_t i;
+
+    for (i = 0; i < BENCH_PACKETS; i++)
+        bench_packet(&pkts[i], i);
+
+    printf("ipfilter lookup, best of %d x %u packets, " BENCH_UNIT "/packet\n", BENCH_ROUNDS, BENCH_PACKETS);
+    printf("%-12s %10s %10s %10s   matched packets\n", "", "tree", "scan", "compiled");
+    bench_run(10u, pkts);
+    bench_run(100u, pkts);
+    bench_run(500u, pkts);
+    bench_run(1000u, pkts);
+    PICO_FREE(pkts);
+    return 0;
+}
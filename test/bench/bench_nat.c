@@ -0,0 +1,104 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   NAT session table under churn, at 1k, 10k and 100k sessions:
+   lookups per second (inbound and outbound alternated), cost of one
+   periodic cleanup call and session replacements per second.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_ipv4.h"
+#include "modules/pico_nat.c"
+#include "bench.h"
+
+#define BENCH_LOOKUPS 1000000u
+#define BENCH_CHURN   100000u
+
+static struct pico_ip4 bench_nat_addr = {
+    .addr = 0x0132000a /* 10.50.0.1 */
+};
+static struct pico_ip4 bench_dst_addr = {
+    .addr = 0x0932000a /* 10.50.0.9 */
+};
+
+/* Session i: unique source address, NAT port shared by TCP and UDP */
+static void bench_session(uint32_t i, struct pico_ip4 *src, uint16_t *nat_port, uint8_t *proto)
+{
+    src->addr = long_be(0x0a000000u + i);
+    *nat_port = short_be((uint16_t)(1024u + ((i >> 1) % 60000u)));
+    *proto = (i & 1u) ? PICO_PROTO_TCP : PICO_PROTO_UDP;
+}
+
+static int bench_add(uint32_t i)
+{
+    struct pico_ip4 src;
+    uint16_t nat_port;
+    uint8_t proto;
+    bench_session(i, &src, &nat_port, &proto);
+    return pico_ipv4_nat_add(bench_dst_addr, short_be(80), src, short_be(5555), bench_nat_addr, nat_port, proto) ? 0 : -1;
+}
+
+static void bench_del(uint32_t i)
+{
+    struct pico_ip4 src;
+    uint16_t nat_port;
+    uint8_t proto;
+    bench_session(i, &src, &nat_port, &proto);
+    pico_ipv4_nat_del(&bench_nat_addr, nat_port, proto);
+}
+
+static void bench_run(uint32_t sessions)
+{
+    struct pico_ip4 src;
+    uint16_t nat_port;
+    uint8_t proto;
+    uint32_t i, j, found = 0;
+    uint64_t start, lookup_ns, sweep_ns, churn_ns;
+
+    for (i = 0; i < sessions; i++) {
+        if (bench_add(i) < 0) {
+            printf("%7u sessions: insertion %u failed\n", sessions, i);
+            return;
+        }
+    }
+
+    start = bench_ns();
+    for (j = 0; j < BENCH_LOOKUPS; j++) {
+        i = (j * 2654435761u) % sessions;
+        bench_session(i, &src, &nat_port, &proto);
+        if (j & 1u)
+            found += (uint32_t)pico_ipv4_nat_find(nat_port, NULL, 0, proto);
+        else
+            found += (uint32_t)pico_ipv4_nat_find(0, &src, short_be(5555), proto);
+    }
+    lookup_ns = bench_ns() - start;
+
+    start = bench_ns();
+    pico_ipv4_nat_table_cleanup(pico_tick, NULL);
+    sweep_ns = bench_ns() - start;
+
+    /* Replace the oldest session with a new one */
+    start = bench_ns();
+    for (j = 0; j < BENCH_CHURN; j++) {
+        bench_del(j);
+        bench_add(j + sessions);
+    }
+    churn_ns = bench_ns() - start;
+
+    for (i = BENCH_CHURN; i < sessions + BENCH_CHURN; i++)
+        bench_del(i);
+
+    printf("%7u sessions: %10.0f lookups/s (%u hits)  cleanup call %9.1f us  %10.0f replacements/s\n",
+           sessions, (double)BENCH_LOOKUPS * 1e9 / (double)lookup_ns, found,
+           (double)sweep_ns / 1000.0, (double)BENCH_CHURN * 1e9 / (double)churn_ns);
+}
+
+int main(void)
+{
+    pico_stack_init();
+    bench_run(1000u);
+    bench_run(10000u);
+    bench_run(100000u);
+    return 0;
+}
@@ -0,0 +1,200 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   UDP echo requests mixed with a receive flood and a bulk sender, run
+   with each mode of the tick scheduler: latency of the echo, from
+   pico_stack_recv() to the reply given to the device (p50 and p99), with
+   a load the stack keeps up with, the modes taking turns, then frames per
+   second when saturated.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_ipv4.h"
+#include "pico_udp.h"
+#include "pico_socket.h"
+#include "bench.h"
+
+#define BENCH_ROUNDS      20000u  /* echo requests per mode */
+#define BENCH_BLOCK       500u    /* rounds in a row with one mode */
+#define BENCH_MODES       3
+#define BENCH_ECHO_PORT   7000
+#define BENCH_PEER_PORT   7001
+#define BENCH_SINK_PORT   7002
+#define BENCH_BULK_PORT   9000
+#define BENCH_FLOOD       12      /* received per round, besides the echo */
+#define BENCH_BULK        12      /* sent per round */
+#define BENCH_SAT_FLOOD   256
+#define BENCH_SAT_BACKLOG 4096u   /* frames waiting in the device at most */
+
+static const char *bench_names[BENCH_MODES] = {
+    "adaptive", "latency", "throughput"
+};
+static struct pico_device *bench_dev;
+static struct pico_socket *bench_echo, *bench_sink, *bench_bulk;
+static struct pico_ip4 bench_local, bench_peer;
+static uint64_t bench_lat[BENCH_MODES][BENCH_ROUNDS];
+static uint32_t bench_nlat[BENCH_MODES];
+static int bench_mode;
+static uint8_t bench_bulk_data[64];
+
+static int bench_send(struct pico_device *dev, void *buf, int len)
+{
+    uint8_t *p = (uint8_t *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(p + PICO_SIZE_IP4HDR);
+    uint64_t stamp;
+
+    (void)dev;
+    if ((udp->trans.dport == short_be(BENCH_PEER_PORT)) && (bench_nlat[bench_mode] < BENCH_ROUNDS)) {
+        memcpy(&stamp, p + PICO_SIZE_IP4HDR + sizeof(struct pico_udp_hdr), sizeof(stamp));
+        bench_lat[bench_mode][bench_nlat[bench_mode]++] = bench_ns() - stamp;
+    }
+
+    return len;
+}
+
+static void bench_inject(uint16_t dport, uint64_t stamp)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + sizeof(struct pico_udp_hdr) + sizeof(uint64_t)];
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(buf + PICO_SIZE_IP4HDR);
+
+    memset(buf, 0, sizeof(buf));
+    hdr->vhl = 0x45;
+    hdr->len = short_be(sizeof(buf));
+    hdr->ttl = 64;
+    hdr->proto = PICO_PROTO_UDP;
+    hdr->src = bench_peer;
+    hdr->dst = bench_local;
+    hdr->crc = short_be(pico_checksum(hdr, PICO_SIZE_IP4HDR));
+    udp->trans.sport = short_be(BENCH_PEER_PORT);
+    udp->trans.dport = short_be(dport);
+    udp->len = short_be(sizeof(struct pico_udp_hdr) + sizeof(uint64_t));
+    memcpy(buf + PICO_SIZE_IP4HDR + sizeof(struct pico_udp_hdr), &stamp, sizeof(stamp));
+    pico_stack_recv(bench_dev, buf, sizeof(buf));
+}
+
+static void bench_wakeup(uint16_t ev, struct pico_socket *s)
+{
+    uint8_t data[64];
+    struct pico_ip4 from;
+    uint16_t port;
+    int r;
+
+    if (!(ev & PICO_SOCK_EV_RD))
+        return;
+
+    while ((r = pico_socket_recvfrom(s, data, sizeof(data), &from, &port)) > 0) {
+        if (s == bench_echo)
+            pico_socket_sendto(s, data, r, &from, port);
+    }
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void bench_drain(void)
+{
+    int i;
+    while (bench_dev->q_in->frames || bench_dev->q_out->frames)
+        pico_stack_tick();
+    for (i = 0; i < 64; i++)
+        pico_stack_tick();
+}
+
+static void bench_bulk_send(void)
+{
+    int i;
+    for (i = 0; i < BENCH_BULK; i++)
+        pico_socket_sendto(bench_bulk, bench_bulk_data, sizeof(bench_bulk_data), &bench_peer, short_be(BENCH_BULK_PORT));
+}
+
+/* Latency, under a load that is served. The modes take turns by blocks of
+ * rounds, so that a drift of the host affects them all alike. */
+static void bench_latency(void)
+{
+    uint32_t r, i, j;
+    int mode;
+
+    for (r = 0; r < BENCH_ROUNDS; r += BENCH_BLOCK) {
+        for (mode = 0; mode < BENCH_MODES; mode++) {
+            bench_mode = mode;
+            pico_stack_sched_mode(mode);
+            for (i = 0; i < BENCH_BLOCK; i++) {
+                for (j = 0; j < BENCH_FLOOD / 2; j++)
+                    bench_inject(BENCH_SINK_PORT, 0);
+                bench_inject(BENCH_ECHO_PORT, bench_ns());
+                for (j = 0; j < BENCH_FLOOD / 2; j++)
+                    bench_inject(BENCH_SINK_PORT, 0);
+                bench_bulk_send();
+                pico_stack_tick();
+            }
+            bench_drain();
+        }
+    }
+}
+
+/* Throughput, with more frames received than handled in a tick */
+static void bench_throughput(int mode)
+{
+    struct pico_sched_stats st;
+    uint64_t start, ns, frames;
+    uint32_t r, i;
+
+    bench_mode = mode;
+    pico_stack_sched_mode(mode);
+    pico_stack_sched_stats(NULL, 1);
+    start = bench_ns();
+    for (r = 0; r < BENCH_ROUNDS / 4; r++) {
+        for (i = 0; (i < BENCH_SAT_FLOOD) && (bench_dev->q_in->frames < BENCH_SAT_BACKLOG); i++)
+            bench_inject(BENCH_SINK_PORT, 0);
+        bench_bulk_send();
+        pico_stack_tick();
+    }
+    bench_drain();
+    ns = bench_ns() - start;
+    pico_stack_sched_stats(&st, 1);
+    frames = (uint64_t)st.work[PICO_SCHED_PHASE_DEV_IN] + st.work[PICO_SCHED_PHASE_DEV_OUT];
+
+    qsort(bench_lat[mode], bench_nlat[mode], sizeof(uint64_t), bench_cmp);
+    printf("%-11s echo p50 %7.0f ns  p99 %8.0f ns (%u)  |  %10.0f frames/s  %6.1f frames per tick\n", bench_names[mode],
+           bench_nlat[mode] ? (double)bench_lat[mode][bench_nlat[mode] / 2] : 0.0,
+           bench_nlat[mode] ? (double)bench_lat[mode][(bench_nlat[mode] * 99u) / 100u] : 0.0, bench_nlat[mode],
+           (double)frames * 1e9 / (double)ns, (double)frames / (double)st.ticks);
+}
+
+int main(void)
+{
+    struct pico_ip4 netmask, any;
+    uint16_t port;
+
+    pico_stack_init();
+    bench_dev = PICO_ZALLOC(sizeof(struct pico_device));
+    bench_dev->send = bench_send;
+    pico_device_init(bench_dev, "bench0", NULL);
+    bench_dev->q_in->max_frames = 0;
+    bench_local.addr = long_be(0x0a000001u);
+    bench_peer.addr = long_be(0x0a000002u);
+    netmask.addr = long_be(0xffffff00u);
+    pico_ipv4_link_add(bench_dev, bench_local, netmask);
+    any.addr = 0;
+
+    bench_echo = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, bench_wakeup);
+    port = short_be(BENCH_ECHO_PORT);
+    pico_socket_bind(bench_echo, &any, &port);
+    bench_sink = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, bench_wakeup);
+    port = short_be(BENCH_SINK_PORT);
+    pico_socket_bind(bench_sink, &any, &port);
+    bench_bulk = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    bench_bulk->q_out.max_size = 0;
+
+    bench_latency();
+    bench_throughput(PICO_SCHED_ADAPTIVE);
+    bench_throughput(PICO_SCHED_LATENCY);
+    bench_throughput(PICO_SCHED_THROUGHPUT);
+    return 0;
+}
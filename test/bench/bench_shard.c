@@ -0,0 +1,188 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   UDP datagrams from many hosts, handed by one receive thread to a
+   group of 1, 2 and 4 stack instances, each run by a thread of its own:
+   frames per second delivered to the sockets. The instances only scale
+   with as many cores as threads (receive thread included). Needs a
+   build with SHARD=1.
+ *********************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_eth.h"
+#include "pico_ipv4.h"
+#include "pico_socket.h"
+#include "pico_shard.h"
+#include "bench.h"
+
+#ifdef PICO_SUPPORT_SHARD
+
+#define BENCH_FRAMES  1000000u
+#define BENCH_DEPTH   1024u
+#define BENCH_HOSTS   4096u
+#define BENCH_PAYLOAD 18u
+#define BENCH_PORT    9
+
+static uint8_t bench_mac[PICO_SIZE_ETH] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x5a
+};
+
+static struct pico_shard_group *bench_group;
+static int bench_ready;
+static int bench_stop;
+static uint64_t bench_rx[PICO_SHARD_MAX];
+
+static int bench_send(struct pico_device *dev, void *buf, int len)
+{
+    (void)dev;
+    (void)buf;
+    return len;
+}
+
+static void bench_wakeup(uint16_t ev, struct pico_socket *s)
+{
+    uint8_t buf[64];
+    struct pico_ip4 orig;
+    uint16_t port;
+
+    if (ev & PICO_SOCK_EV_RD) {
+        while (pico_socket_recvfrom(s, buf, sizeof(buf), &orig, &port) > 0)
+            __atomic_fetch_add(&bench_rx[pico_shard_self()], 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void bench_setup(struct pico_device *dev, void *arg)
+{
+    struct pico_ip4 addr, nm, any = {
+        0
+    };
+    struct pico_socket *s;
+    uint16_t port = short_be(BENCH_PORT);
+
+    (void)arg;
+    addr.addr = long_be(0x0A000001);
+    nm.addr = long_be(0xFFFF0000);
+    pico_ipv4_link_add(dev, addr, nm);
+    s = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, bench_wakeup);
+    if (s)
+        pico_socket_bind(s, &any, &port);
+}
+
+static void *bench_instance(void *arg)
+{
+    uint32_t idx = (uint32_t)(uintptr_t)arg;
+    struct pico_device *dev;
+    char name[MAX_DEVICE_NAME];
+
+    pico_stack_init();
+    snprintf(name, MAX_DEVICE_NAME, "shard%u", idx);
+    dev = pico_shard_attach(bench_group, idx, name, bench_mac);
+    if (!dev)
+        return NULL;
+
+    __atomic_fetch_add(&bench_ready, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&bench_stop, __ATOMIC_ACQUIRE))
+        pico_stack_tick();
+
+    pico_device_destroy(dev);
+    return NULL;
+}
+
+static uint32_t bench_frame(uint8_t *buf, uint32_t host)
+{
+    struct pico_eth_hdr *eh = (struct pico_eth_hdr *)buf;
+    struct pico_ipv4_hdr *ih = (struct pico_ipv4_hdr *)(buf + PICO_SIZE_ETHHDR);
+    uint8_t *l4 = buf + PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR;
+    uint16_t len = (uint16_t)(PICO_SIZE_IP4HDR + 8u + BENCH_PAYLOAD);
+    uint16_t sport = short_be((uint16_t)(1024u + host)), dport = short_be(BENCH_PORT);
+
+    memset(buf, 0, PICO_SIZE_ETHHDR + len);
+    memcpy(eh->daddr, bench_mac, PICO_SIZE_ETH);
+    eh->saddr[0] = 0x02;
+    eh->saddr[5] = 0x01;
+    eh->proto = PICO_IDETH_IPV4;
+    ih->vhl = 0x45;
+    ih->len = short_be(len);
+    ih->ttl = 64;
+    ih->proto = PICO_PROTO_UDP;
+    ih->src.addr = long_be(0x0A010000u + host);
+    ih->dst.addr = long_be(0x0A000001u);
+    ih->crc = short_be(pico_checksum(ih, PICO_SIZE_IP4HDR));
+    memcpy(l4, &sport, 2);
+    memcpy(l4 + 2, &dport, 2);
+    l4[5] = (uint8_t)(8u + BENCH_PAYLOAD);
+    return PICO_SIZE_ETHHDR + len;
+}
+
+static void bench_run(uint32_t n)
+{
+    pthread_t th[PICO_SHARD_MAX];
+    union pico_address local;
+    uint8_t buf[PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR + 8u + BENCH_PAYLOAD];
+    uint64_t start, ns, rx, last;
+    uint32_t i, j, len;
+
+    bench_group = pico_shard_group_create(n, BENCH_DEPTH, bench_send);
+    local.ip4.addr = long_be(0x0A000001);
+    pico_shard_group_address(bench_group, PICO_PROTO_IPV4, &local);
+    bench_ready = 0;
+    bench_stop = 0;
+    memset(bench_rx, 0, sizeof(bench_rx));
+    for (i = 0; i < n; i++)
+        pthread_create(&th[i], NULL, bench_instance, (void *)(uintptr_t)i);
+
+    while (__atomic_load_n(&bench_ready, __ATOMIC_SEQ_CST) < (int)n)
+        sched_yield();
+    pico_shard_group_call(bench_group, bench_setup, NULL);
+    while (pico_shard_group_pending(bench_group))
+        sched_yield();
+
+    start = bench_ns();
+    for (j = 0; j < BENCH_FRAMES; j++) {
+        len = bench_frame(buf, j % BENCH_HOSTS);
+        while (pico_shard_group_recv(bench_group, buf, len) < 0)
+            sched_yield(); /* ring full */
+    }
+    /* until all are delivered, or none was for a second (dropped) */
+    last = 0;
+    ns = bench_ns();
+    do {
+        for (rx = 0, i = 0; i < n; i++)
+            rx += __atomic_load_n(&bench_rx[i], __ATOMIC_RELAXED);
+        if (rx != last) {
+            last = rx;
+            ns = bench_ns();
+        }
+    } while ((rx < BENCH_FRAMES) && ((bench_ns() - ns) < 1000000000ull));
+    ns -= start;
+
+    __atomic_store_n(&bench_stop, 1, __ATOMIC_RELEASE);
+    for (i = 0; i < n; i++)
+        pthread_join(th[i], NULL);
+    pico_shard_group_destroy(bench_group);
+
+    printf("%u instance(s): %10.0f frames/s  (%.1f%% delivered)\n", n, (double)rx * 1e9 / (double)ns,
+           (double)rx * 100.0 / (double)BENCH_FRAMES);
+}
+
+int main(void)
+{
+    bench_run(1);
+    bench_run(2);
+    bench_run(4);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("bench_shard: build with SHARD=1\n");
+    return 0;
+}
+
+#endif
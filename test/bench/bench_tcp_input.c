@@ -0,0 +1,128 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   Cost of pico_tcp_input() per segment on an established connection,
+   for a bulk receiver (in-order data), the case header prediction
+   handles. The full path is measured with the same segments, alternating
+   the advertised window so that header prediction never matches.
+   Each figure is the best of BENCH_ROUNDS rounds; build with
+   'make bench DEBUG=0' for meaningful numbers.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_ipv4.h"
+#include "modules/pico_tcp.c"
+#include "bench.h"
+
+#define BENCH_SEGMENTS 50000u
+#define BENCH_ROUNDS   7
+#define BENCH_MSS      1460u
+#define BENCH_WND      0x7f00u
+
+static struct pico_frame *bench_segment(struct pico_socket_tcp *t, uint32_t seq, uint32_t ack, uint8_t flags, uint16_t rwnd, uint16_t len)
+{
+    struct pico_frame *f = pico_frame_alloc((uint32_t)(PICO_SIZE_TCPHDR + 12u + len));
+    struct pico_tcp_hdr *hdr;
+    uint8_t *opt;
+    uint32_t tsval = long_be(1), tsecr = long_be((uint32_t)TCP_TIME);
+
+    if (!f)
+        return NULL;
+
+    f->transport_hdr = f->start;
+    f->transport_len = (uint16_t)(PICO_SIZE_TCPHDR + 12u + len);
+    hdr = (struct pico_tcp_hdr *)f->transport_hdr;
+    memset(hdr, 0, PICO_SIZE_TCPHDR);
+    hdr->trans.sport = t->sock.remote_port;
+    hdr->trans.dport = t->sock.local_port;
+    hdr->len = (uint8_t)(((PICO_SIZE_TCPHDR + 12u) >> 2) << 4);
+    hdr->seq = long_be(seq);
+    hdr->ack = long_be(ack);
+    hdr->flags = flags;
+    hdr->rwnd = short_be(rwnd);
+    opt = f->transport_hdr + PICO_SIZE_TCPHDR;
+    opt[0] = PICO_TCP_OPTION_NOOP;
+    opt[1] = PICO_TCP_OPTION_NOOP;
+    opt[2] = PICO_TCP_OPTION_TIMESTAMP;
+    opt[3] = PICO_TCPOPTLEN_TIMESTAMP;
+    memcpy(opt + 4, &tsval, 4);
+    memcpy(opt + 8, &tsecr, 4);
+    f->payload = opt + 12;
+    f->payload_len = len;
+    return f;
+}
+
+static struct pico_socket_tcp *bench_socket(void)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)pico_tcp_open(PICO_PROTO_IPV4);
+    if (!t)
+        return NULL;
+
+    t->sock.net = &pico_proto_ipv4;
+    t->sock.local_port = short_be(80);
+    t->sock.remote_port = short_be(1024);
+    t->sock.state = PICO_SOCKET_STATE_BOUND | PICO_SOCKET_STATE_CONNECTED | PICO_SOCKET_STATE_TCP_ESTABLISHED;
+    t->sock.opt_flags |= (1 << PICO_SOCKET_OPT_TCPNODELAY);
+    t->ts_ok = 1;
+    t->recv_wnd = BENCH_WND;
+    t->mss = BENCH_MSS;
+    t->cwnd = 0xffff;
+    t->ssthresh = 0xffff;
+    t->tcpq_in.max_size = 0xffffffffu;
+    t->tcpq_out.max_size = 0xffffffffu;
+    return t;
+}
+
+static void bench_drain(void)
+{
+    struct pico_frame *f;
+    while ((f = pico_dequeue(&pico_proto_tcp.q_out)) != NULL)
+        pico_frame_discard(f);
+}
+
+static double bench_receiver(int predicted)
+{
+    struct pico_socket_tcp *t = bench_socket();
+    struct pico_frame *f;
+    uint64_t total = 0, start;
+    uint32_t i;
+    uint16_t wnd;
+
+    for (i = 0; i < BENCH_SEGMENTS; i++) {
+        wnd = (uint16_t)((predicted || (i & 1u)) ? BENCH_WND : (BENCH_WND + 1u));
+        f = bench_segment(t, t->rcv_nxt, t->snd_nxt, PICO_TCP_ACK | PICO_TCP_PSH, wnd, BENCH_MSS);
+        start = bench_cycles();
+        pico_tcp_input(&t->sock, f);
+        total += bench_cycles() - start;
+        bench_drain();
+        if (t->tcpq_in.frames > 64u)
+            tcp_discard_all_segments(&t->tcpq_in);
+    }
+    t->sock.state = PICO_SOCKET_STATE_CLOSED;
+    pico_tcp_cleanup_queues(&t->sock);
+    PICO_FREE(t);
+    return (double)total / BENCH_SEGMENTS;
+}
+
+static double bench_min(double a, double b)
+{
+    return ((a == 0.0) || (b < a)) ? b : a;
+}
+
+int main(void)
+{
+    double rx_full = 0.0, rx_fast = 0.0;
+    int i;
+    pico_stack_init();
+
+    for (i = 0; i < BENCH_ROUNDS; i++) {
+        rx_full = bench_min(rx_full, bench_receiver(0));
+        rx_fast = bench_min(rx_fast, bench_receiver(1));
+    }
+
+    printf("pico_tcp_input, best of %d x %u segments, " BENCH_UNIT "/segment\n", BENCH_ROUNDS, BENCH_SEGMENTS);
+    printf("%-22s %12s %12s\n", "", "full path", "predicted");
+    printf("%-22s %12.1f %12.1f\n", "in-order data", rx_full, rx_fast);
+    return 0;
+}
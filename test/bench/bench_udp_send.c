@@ -0,0 +1,109 @@
+/*********************************************************************
+   PicoTCP. Copyright (c) 2012-2015 Altran Intelligent Systems. Some rights reserved.
+   See LICENSE and COPYING for usage.
+
+   Bursts of equal size UDP datagrams to one peer, sent with one
+   pico_socket_sendto() per datagram, with pico_socket_sendmmsg() and with
+   pico_socket_sendto_segmented(), through a device that discards them.
+ *********************************************************************/
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_ipv4.h"
+#include "pico_socket.h"
+#include "bench.h"
+
+#define BENCH_DATAGRAMS 500000u
+#define BENCH_BURST     32
+#define BENCH_SEG       1000
+#define BENCH_ROUTES    64u
+
+static uint64_t bench_tx;
+static uint8_t bench_data[BENCH_BURST * BENCH_SEG];
+
+static int bench_send(struct pico_device *dev, void *buf, int len)
+{
+    (void)dev;
+    (void)buf;
+    bench_tx++;
+    return len;
+}
+
+static void bench_drain(void)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        pico_stack_tick();
+}
+
+static int bench_burst(int mode, struct pico_socket *s, struct pico_ip4 *peer)
+{
+    struct pico_mmsg msgs[BENCH_BURST];
+    int i, sent = 0;
+
+    switch (mode) {
+    case 0:
+        for (i = 0; i < BENCH_BURST; i++)
+            sent += (pico_socket_sendto(s, bench_data + i * BENCH_SEG, BENCH_SEG, peer, short_be(7000)) > 0);
+        return sent;
+    case 1:
+        memset(msgs, 0, sizeof(msgs));
+        for (i = 0; i < BENCH_BURST; i++) {
+            msgs[i].buf = bench_data + i * BENCH_SEG;
+            msgs[i].len = BENCH_SEG;
+            msgs[i].addr.ip4 = *peer;
+            msgs[i].port = short_be(7000);
+        }
+        return pico_socket_sendmmsg(s, msgs, BENCH_BURST);
+    default:
+        return pico_socket_sendto_segmented(s, bench_data, (int)sizeof(bench_data), BENCH_SEG, peer, short_be(7000), NULL) / BENCH_SEG;
+    }
+}
+
+static void bench_run(const char *name, int mode, struct pico_socket *s, struct pico_ip4 *peer)
+{
+    uint64_t start, ns, sent = 0;
+    uint32_t j;
+
+    bench_tx = 0;
+    start = bench_ns();
+    for (j = 0; j < BENCH_DATAGRAMS / BENCH_BURST; j++) {
+        sent += (uint64_t)bench_burst(mode, s, peer);
+        bench_drain();
+    }
+    ns = bench_ns() - start;
+    printf("%-22s %10.0f datagrams/s  %6.1f ns per datagram  (%llu of %llu out)\n", name,
+           (double)sent * 1e9 / (double)ns, (double)ns / (double)sent,
+           (unsigned long long)bench_tx, (unsigned long long)sent);
+}
+
+int main(void)
+{
+    struct pico_device *dev;
+    struct pico_socket *s;
+    struct pico_ip4 addr, netmask, dst, gw, peer;
+    uint32_t i;
+
+    pico_stack_init();
+    dev = PICO_ZALLOC(sizeof(struct pico_device));
+    dev->send = bench_send;
+    pico_device_init(dev, "bench0", NULL);
+    addr.addr = long_be(0x0a000001u);
+    netmask.addr = long_be(0xffffff00u);
+    pico_ipv4_link_add(dev, addr, netmask);
+
+    /* a routing table that is not trivial to walk */
+    gw.addr = long_be(0x0a0000feu);
+    netmask.addr = long_be(0xffffff00u);
+    for (i = 0; i < BENCH_ROUTES; i++) {
+        dst.addr = long_be(0xac100000u + (i << 8));
+        pico_ipv4_route_add(dst, netmask, gw, 1, NULL);
+    }
+
+    peer.addr = long_be(0x0a000002u);
+    s = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    bench_run("sendto per datagram", 0, s, &peer);
+    bench_run("sendmmsg", 1, s, &peer);
+    bench_run("sendto_segmented", 2, s, &peer);
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_frame.h"
+#include "pico_ipv4.h"
+#include "pico_tcp.h"
+#include "pico_udp.h"
+#include "pico_icmp4.h"
+#include "pico_conntrack.h"
+#include "modules/pico_conntrack.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#define CT_LAN  0x0a000002u /* 10.0.0.2 */
+#define CT_WAN  0xc0a80001u /* 192.168.0.1 */
+#define CT_PEER 0x08080808u /* 8.8.8.8 */
+
+static uint8_t ct_buf[PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR];
+static struct pico_frame ct_frame;
+static uint8_t ct_held_buf[sizeof(ct_buf)];
+static struct pico_frame ct_held;
+
+static struct pico_frame *ct_packet(uint8_t proto, uint32_t src, uint16_t sport, uint32_t dst, uint16_t dport, uint8_t flags)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)ct_buf;
+    struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)(ct_buf + PICO_SIZE_IP4HDR);
+    struct pico_icmp4_hdr *icmp = (struct pico_icmp4_hdr *)(ct_buf + PICO_SIZE_IP4HDR);
+
+    memset(&ct_frame, 0, sizeof(ct_frame));
+    memset(ct_buf, 0, sizeof(ct_buf));
+    hdr->vhl = 0x45;
+    hdr->proto = proto;
+    hdr->src.addr = long_be(src);
+    hdr->dst.addr = long_be(dst);
+    if (proto == PICO_PROTO_ICMP4) {
+        icmp->type = flags;
+        icmp->hun.ih_idseq.idseq_id = short_be(sport);
+    } else {
+        tcp->trans.sport = short_be(sport);
+        tcp->trans.dport = short_be(dport);
+        tcp->flags = flags;
+    }
+
+    ct_frame.net_hdr = ct_buf;
+    ct_frame.transport_hdr = ct_buf + PICO_SIZE_IP4HDR;
+    return &ct_frame;
+}
+
+/* A copy of the last packet that survives the next ct_packet() */
+static struct pico_frame *ct_hold(struct pico_frame *f)
+{
+    memcpy(ct_held_buf, ct_buf, sizeof(ct_buf));
+    ct_held = *f;
+    ct_held.net_hdr = ct_held_buf;
+    ct_held.transport_hdr = ct_held_buf + PICO_SIZE_IP4HDR;
+    return &ct_held;
+}
+
+START_TEST(tc_conntrack_tcp)
+{
+    struct pico_frame *f;
+    struct pico_conn *c;
+
+    pico_stack_init();
+
+    /* handshake */
+    f = ct_packet(PICO_PROTO_TCP, CT_LAN, 1000, CT_PEER, 80, PICO_TCP_SYN);
+    c = pico_conntrack_get(f);
+    fail_if(!c);
+    fail_if(f->conn != c || f->conn_dir != PICO_CT_DIR_ORIGINAL);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(pico_conntrack_count() != 1);
+    f = ct_packet(PICO_PROTO_TCP, CT_PEER, 80, CT_LAN, 1000, PICO_TCP_SYNACK);
+    fail_if(pico_conntrack_get(f) != c);
+    fail_if(f->conn_dir != PICO_CT_DIR_REPLY);
+    fail_if(pico_conntrack_state(f) != PICO_CT_ESTABLISHED);
+    fail_if(c->expire != pico_tick + PICO_CT_TCP_ESTABLISHED);
+
+    /* a frame is tracked once, however many modules ask */
+    f = ct_packet(PICO_PROTO_TCP, CT_LAN, 1000, CT_PEER, 80, PICO_TCP_FIN);
+    fail_if(pico_conntrack_state(f) != PICO_CT_CLOSING);
+    fail_if(pico_conntrack_state(f) != PICO_CT_CLOSING);
+    fail_if(c->fin != 1u);
+    f = ct_packet(PICO_PROTO_TCP, CT_PEER, 80, CT_LAN, 1000, PICO_TCP_FINACK);
+    fail_if(pico_conntrack_state(f) != PICO_CT_CLOSED);
+
+    /* the tuple is reused by a new connection */
+    f = ct_packet(PICO_PROTO_TCP, CT_LAN, 1000, CT_PEER, 80, PICO_TCP_SYN);
+    fail_if(pico_conntrack_get(f) != c);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(c->fin != 0);
+
+    /* RST from either side */
+    f = ct_packet(PICO_PROTO_TCP, CT_PEER, 80, CT_LAN, 1000, PICO_TCP_RSTACK);
+    fail_if(pico_conntrack_state(f) != PICO_CT_CLOSED);
+    fail_if(c->expire != pico_tick + PICO_CT_TCP_CLOSED);
+
+    /* other protocols and later fragments are not tracked */
+    f = ct_packet(PICO_PROTO_IGMP, CT_LAN, 0, CT_PEER, 0, 0);
+    fail_if(pico_conntrack_state(f) != PICO_CT_UNTRACKED);
+    f = ct_packet(PICO_PROTO_TCP, CT_LAN, 1001, CT_PEER, 80, PICO_TCP_SYN);
+    ((struct pico_ipv4_hdr *)f->net_hdr)->frag = short_be(8);
+    fail_if(pico_conntrack_state(f) != PICO_CT_UNTRACKED);
+    fail_if(pico_conntrack_count() != 1);
+
+    pico_conntrack_flush();
+    fail_if(pico_conntrack_count() != 0);
+}
+END_TEST
+
+START_TEST(tc_conntrack_udp_icmp)
+{
+    struct pico_frame *f;
+
+    pico_stack_init();
+
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 5353, CT_PEER, 53, 0);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(f->conn->expire != pico_tick + PICO_CT_UDP_NEW);
+    f = ct_packet(PICO_PROTO_UDP, CT_PEER, 53, CT_LAN, 5353, 0);
+    fail_if(pico_conntrack_state(f) != PICO_CT_ESTABLISHED);
+    fail_if(f->conn->expire != pico_tick + PICO_CT_UDP_ESTABLISHED);
+
+    /* same ports, another protocol */
+    f = ct_packet(PICO_PROTO_TCP, CT_PEER, 53, CT_LAN, 5353, PICO_TCP_SYN);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(pico_conntrack_count() != 2);
+
+    /* echo replies only match a request */
+    f = ct_packet(PICO_PROTO_ICMP4, CT_PEER, 7, CT_LAN, 0, PICO_ICMP_ECHOREPLY);
+    fail_if(pico_conntrack_state(f) != PICO_CT_UNTRACKED);
+    f = ct_packet(PICO_PROTO_ICMP4, CT_LAN, 7, CT_PEER, 0, PICO_ICMP_ECHO);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    f = ct_packet(PICO_PROTO_ICMP4, CT_PEER, 7, CT_LAN, 0, PICO_ICMP_ECHOREPLY);
+    fail_if(pico_conntrack_state(f) != PICO_CT_ESTABLISHED);
+    f = ct_packet(PICO_PROTO_ICMP4, CT_PEER, 7, CT_LAN, 0, PICO_ICMP_UNREACH);
+    fail_if(pico_conntrack_state(f) != PICO_CT_UNTRACKED);
+    fail_if(pico_conntrack_count() != 3);
+
+    /* idle connections expire, on lookup and on the sweep */
+    pico_tick += PICO_CT_UDP_ESTABLISHED;
+    f = ct_packet(PICO_PROTO_UDP, CT_PEER, 53, CT_LAN, 5353, 0);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(pico_conntrack_count() != 3);
+    for (ct_table.sweep = 0; ct_table.sweep < ct_table.size; ct_table.sweep++)
+        ct_expire_bucket(ct_table.sweep, pico_tick);
+    fail_if(pico_conntrack_count() != 1);
+
+    /* a frame held across the sweep is tracked again, not on the freed connection */
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 6000, CT_PEER, 53, 0);
+    fail_if(!pico_conntrack_get(f));
+    pico_tick += PICO_CT_UDP_NEW;
+    for (ct_table.sweep = 0; ct_table.sweep < ct_table.size; ct_table.sweep++)
+        ct_expire_bucket(ct_table.sweep, pico_tick);
+    fail_if(pico_conntrack_count() != 0);
+    fail_if(pico_conntrack_state(f) != PICO_CT_NEW);
+    fail_if(f->conn->expire != pico_tick + PICO_CT_UDP_NEW);
+    fail_if(pico_conntrack_count() != 1);
+
+    pico_conntrack_flush();
+}
+END_TEST
+
+START_TEST(tc_conntrack_nat)
+{
+    struct pico_frame *f;
+    struct pico_conn *c;
+    struct pico_ip4 wan = {
+        0
+    }, lan = {
+        0
+    };
+
+    pico_stack_init();
+    wan.addr = long_be(CT_WAN);
+    lan.addr = long_be(CT_LAN);
+
+    /* source NAT: the reply comes back to the NAT address */
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 5000, CT_PEER, 53, 0);
+    c = pico_conntrack_get(f);
+    fail_if(!c);
+    fail_if(pico_conntrack_snat(f, &wan, short_be(40000)));
+    f = ct_packet(PICO_PROTO_UDP, CT_PEER, 53, CT_WAN, 40000, 0);
+    fail_if(pico_conntrack_get(f) != c);
+    fail_if(f->conn_dir != PICO_CT_DIR_REPLY);
+    fail_if(c->state != PICO_CT_ESTABLISHED);
+    /* replies are left alone */
+    fail_if(pico_conntrack_dnat(f, &lan, short_be(5000)));
+    fail_if(c->tuple[PICO_CT_DIR_REPLY].dst.addr != wan.addr);
+
+    /* port forward: the reply comes from the inside host */
+    f = ct_packet(PICO_PROTO_TCP, CT_PEER, 2000, CT_WAN, 8080, PICO_TCP_SYN);
+    c = pico_conntrack_get(f);
+    fail_if(!c);
+    fail_if(pico_conntrack_dnat(f, &lan, short_be(80)));
+    f = ct_packet(PICO_PROTO_TCP, CT_LAN, 80, CT_PEER, 2000, PICO_TCP_SYNACK);
+    fail_if(pico_conntrack_get(f) != c);
+    fail_if(c->state != PICO_CT_ESTABLISHED);
+    fail_if(pico_conntrack_count() != 2);
+
+    /* untracked frames cannot be translated */
+    f = ct_packet(PICO_PROTO_IGMP, CT_LAN, 0, CT_PEER, 0, 0);
+    fail_if(pico_conntrack_snat(f, &wan, 0) == 0);
+
+    pico_conntrack_flush();
+}
+END_TEST
+
+START_TEST(tc_conntrack_cache)
+{
+    struct pico_frame *f, *held;
+    struct pico_conn *c, *other;
+    pico_time expire;
+
+    pico_stack_init();
+
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 7000, CT_PEER, 53, 0);
+    c = pico_conntrack_get(f);
+    fail_if(!c);
+    f = ct_packet(PICO_PROTO_UDP, CT_PEER, 53, CT_LAN, 7000, 0);
+    fail_if(pico_conntrack_get(f) != c);
+    held = ct_hold(f);
+
+    /* freeing another connection leaves the cache alone */
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 7001, CT_PEER, 53, 0);
+    other = pico_conntrack_get(f);
+    fail_if(!other);
+    ct_free(other);
+    expire = c->expire;
+    pico_tick += 1000;
+    fail_if(pico_conntrack_get(held) != c);
+    fail_if(c->expire != expire);
+
+    /* the memory of the connection goes to a new one with the same tuple:
+     * the held packet is counted in the new connection */
+    ct_free(c);
+    f = ct_packet(PICO_PROTO_UDP, CT_LAN, 7000, CT_PEER, 53, 0);
+    fail_if(pico_conntrack_get(f) != c);
+    fail_if(c->state != PICO_CT_NEW);
+    fail_if(pico_conntrack_get(held) != c);
+    fail_if(held->conn_dir != PICO_CT_DIR_REPLY);
+    fail_if(c->state != PICO_CT_ESTABLISHED);
+    fail_if(pico_conntrack_count() != 1);
+
+    pico_conntrack_flush();
+    fail_if(ct_table.spare);
+}
+END_TEST
+
+START_TEST(tc_conntrack_table)
+{
+    struct pico_frame *f;
+    uint32_t i;
+
+    pico_stack_init();
+
+    /* the table grows and keeps both directions reachable */
+    for (i = 0; i < 1000u; i++) {
+        f = ct_packet(PICO_PROTO_UDP, CT_LAN + i, 1024, CT_PEER, 53, 0);
+        fail_if(!pico_conntrack_get(f));
+    }
+    fail_if(ct_table.size < (1000u * 2u / PICO_CT_HASH_LOAD));
+    for (i = 0; i < 1000u; i++) {
+        f = ct_packet(PICO_PROTO_UDP, CT_PEER, 53, CT_LAN + i, 1024, 0);
+        fail_if(pico_conntrack_state(f) != PICO_CT_ESTABLISHED);
+    }
+    fail_if(pico_conntrack_count() != 1000u);
+
+    pico_conntrack_flush();
+    fail_if(pico_conntrack_count() != 0);
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_conntrack_tcp = tcase_create("Unit test for TCP connection states");
+    TCase *TCase_conntrack_udp_icmp = tcase_create("Unit test for UDP and ICMP echo tracking");
+    TCase *TCase_conntrack_nat = tcase_create("Unit test for translated connections");
+    TCase *TCase_conntrack_cache = tcase_create("Unit test for the connection cached in the frame");
+    TCase *TCase_conntrack_table = tcase_create("Unit test for the connection table");
+
+    tcase_add_test(TCase_conntrack_tcp, tc_conntrack_tcp);
+    suite_add_tcase(s, TCase_conntrack_tcp);
+    tcase_add_test(TCase_conntrack_udp_icmp, tc_conntrack_udp_icmp);
+    suite_add_tcase(s, TCase_conntrack_udp_icmp);
+    tcase_add_test(TCase_conntrack_nat, tc_conntrack_nat);
+    suite_add_tcase(s, TCase_conntrack_nat);
+    tcase_add_test(TCase_conntrack_cache, tc_conntrack_cache);
+    suite_add_tcase(s, TCase_conntrack_cache);
+    tcase_add_test(TCase_conntrack_table, tc_conntrack_table);
+    suite_add_tcase(s, TCase_conntrack_table);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
@@ -0,0 +1,237 @@
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_eth.h"
+#include "pico_ipv4.h"
+#include "pico_tcp.h"
+#include "pico_hotplug_detection.h"
+#include "pico_dev_bond.h"
+#include "modules/pico_dev_bond.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#define BOND_MEMBERS 3
+#define BOND_FLOWS   64
+
+static uint8_t bond_mac[PICO_SIZE_ETH] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0xb0
+};
+
+static struct pico_device *bond_member[BOND_MEMBERS];
+static int bond_sent[BOND_MEMBERS];
+static int bond_link[BOND_MEMBERS];
+static uint8_t bond_buf[PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR];
+
+static int bond_member_index(struct pico_device *dev)
+{
+    int i;
+    for (i = 0; i < BOND_MEMBERS; i++) {
+        if (bond_member[i] == dev)
+            return i;
+    }
+    return -1;
+}
+
+static int bond_member_send(struct pico_device *dev, void *buf, int len)
+{
+    (void)buf;
+    bond_sent[bond_member_index(dev)]++;
+    return len;
+}
+
+static int bond_member_link_state(struct pico_device *dev)
+{
+    return bond_link[bond_member_index(dev)];
+}
+
+static struct pico_device *bond_setup(int mode)
+{
+    struct pico_device *bond;
+    char name[MAX_DEVICE_NAME];
+    uint8_t mac[PICO_SIZE_ETH] = {
+        0x02, 0x00, 0x00, 0x00, 0x00, 0xa0
+    };
+    int i;
+
+    pico_stack_init();
+    bond = pico_bond_create("bond0", bond_mac, mode);
+    fail_if(!bond);
+    for (i = 0; i < BOND_MEMBERS; i++) {
+        bond_member[i] = PICO_ZALLOC(sizeof(struct pico_device));
+        fail_if(!bond_member[i]);
+        bond_member[i]->send = bond_member_send;
+        bond_member[i]->link_state = bond_member_link_state;
+        bond_link[i] = 1;
+        bond_sent[i] = 0;
+        snprintf(name, MAX_DEVICE_NAME, "member%d", i);
+        mac[5] = (uint8_t)(0xa0 + i);
+        fail_if(pico_device_init(bond_member[i], name, mac) != 0);
+        fail_if(pico_bond_add_member(bond, bond_member[i]) != 0);
+    }
+    return bond;
+}
+
+static void bond_teardown(struct pico_device *bond)
+{
+    int i;
+    for (i = 0; i < BOND_MEMBERS; i++)
+        pico_device_destroy(bond_member[i]);
+    pico_device_destroy(bond);
+}
+
+/* TCP segment of flow i, addresses and source port vary with i */
+static int bond_flow(struct pico_device *bond, uint32_t i)
+{
+    struct pico_eth_hdr *eth = (struct pico_eth_hdr *)bond_buf;
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)(bond_buf + PICO_SIZE_ETHHDR);
+    struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)(bond_buf + PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR);
+    int before[BOND_MEMBERS], m, out = -1;
+
+    memset(bond_buf, 0, sizeof(bond_buf));
+    memcpy(eth->saddr, bond_mac, PICO_SIZE_ETH);
+    eth->proto = PICO_IDETH_IPV4;
+    hdr->vhl = 0x45;
+    hdr->proto = PICO_PROTO_TCP;
+    hdr->src.addr = long_be(0x0a000001u);
+    hdr->dst.addr = long_be(0x0a010000u + (i >> 2));
+    tcp->trans.sport = short_be((uint16_t)(1024u + (i & 3u)));
+    tcp->trans.dport = short_be(80);
+
+    memcpy(before, bond_sent, sizeof(before));
+    fail_if(bond->send(bond, bond_buf, (int)sizeof(bond_buf)) != (int)sizeof(bond_buf));
+    for (m = 0; m < BOND_MEMBERS; m++) {
+        if (bond_sent[m] != before[m])
+            out = m;
+    }
+    return out;
+}
+
+START_TEST(tc_bond_members)
+{
+    struct pico_device *bond = bond_setup(PICO_BOND_MODE_XOR);
+    struct pico_device *other;
+    struct pico_bond *b = (struct pico_bond *)bond;
+
+    fail_if(pico_bond_create("bond9", bond_mac, 7) != NULL);
+    fail_if(b->members != BOND_MEMBERS || b->n_active != BOND_MEMBERS);
+    fail_if(pico_device_link_state(bond) != 1);
+
+    /* a device is a member of one bond at most, and bonds do not nest */
+    fail_if(pico_bond_add_member(bond, bond_member[0]) == 0);
+    fail_if(pico_err != PICO_ERR_EINVAL);
+    bond_mac[5]++;
+    other = pico_bond_create("bond1", bond_mac, PICO_BOND_MODE_ROUNDROBIN);
+    bond_mac[5]--;
+    fail_if(!other);
+    fail_if(pico_bond_add_member(other, bond_member[0]) == 0);
+    fail_if(pico_bond_add_member(bond, other) == 0);
+    fail_if(pico_bond_add_member(bond_member[1], bond_member[2]) == 0);
+    fail_if(pico_bond_del_member(other, bond_member[0]) == 0);
+
+    fail_if(pico_bond_del_member(bond, bond_member[0]) != 0);
+    fail_if(bond_member[0]->bond);
+    fail_if(b->members != BOND_MEMBERS - 1);
+    fail_if(b->member[0].dev != bond_member[1]);
+    fail_if(pico_bond_add_member(other, bond_member[0]) != 0);
+
+    /* destroying a member or a bond releases the membership */
+    pico_device_destroy(other);
+    fail_if(bond_member[0]->bond);
+    pico_device_destroy(bond_member[1]);
+    fail_if(b->members != 1);
+    pico_device_destroy(bond);
+    fail_if(bond_member[2]->bond);
+    pico_device_destroy(bond_member[0]);
+    pico_device_destroy(bond_member[2]);
+}
+END_TEST
+
+START_TEST(tc_bond_xor)
+{
+    struct pico_device *bond = bond_setup(PICO_BOND_MODE_XOR);
+    int first[BOND_FLOWS];
+    uint32_t i;
+    int m;
+
+    /* a flow sticks to one member, the flows are spread on all of them */
+    for (i = 0; i < BOND_FLOWS; i++) {
+        first[i] = bond_flow(bond, i);
+        fail_if(first[i] < 0);
+        fail_if(bond_flow(bond, i) != first[i]);
+    }
+    for (m = 0; m < BOND_MEMBERS; m++)
+        fail_if(bond_sent[m] < BOND_FLOWS / 4);
+
+    /* failover: only the flows of the failed member move */
+    bond_link[1] = 0;
+    pico_bond_hotplug(bond_member[1], PICO_HOTPLUG_EVENT_DOWN);
+    for (i = 0; i < BOND_FLOWS; i++) {
+        m = bond_flow(bond, i);
+        fail_if(m == 1);
+        if (first[i] != 1)
+            fail_if(m != first[i]);
+    }
+
+    /* and come back when it does */
+    bond_link[1] = 1;
+    pico_bond_hotplug(bond_member[1], PICO_HOTPLUG_EVENT_UP);
+    for (i = 0; i < BOND_FLOWS; i++)
+        fail_if(bond_flow(bond, i) != first[i]);
+
+    /* all links down: the bond is down, frames are dropped */
+    for (m = 0; m < BOND_MEMBERS; m++)
+        pico_bond_hotplug(bond_member[m], PICO_HOTPLUG_EVENT_DOWN);
+    fail_if(pico_device_link_state(bond) != 0);
+    fail_if(bond_flow(bond, 0) != -1);
+
+    bond_teardown(bond);
+}
+END_TEST
+
+START_TEST(tc_bond_roundrobin)
+{
+    struct pico_device *bond = bond_setup(PICO_BOND_MODE_ROUNDROBIN);
+    int i, m;
+
+    for (i = 0; i < 3 * BOND_MEMBERS; i++)
+        (void)bond_flow(bond, 0);
+    for (m = 0; m < BOND_MEMBERS; m++)
+        fail_if(bond_sent[m] != 3);
+
+    pico_bond_hotplug(bond_member[0], PICO_HOTPLUG_EVENT_DOWN);
+    for (i = 0; i < 4; i++)
+        fail_if(bond_flow(bond, 0) == 0);
+    fail_if(bond_sent[1] != 5 || bond_sent[2] != 5);
+
+    bond_teardown(bond);
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_bond_members = tcase_create("Unit test for bond members");
+    TCase *TCase_bond_xor = tcase_create("Unit test for flow hash distribution and failover");
+    TCase *TCase_bond_roundrobin = tcase_create("Unit test for round-robin distribution");
+
+    tcase_add_test(TCase_bond_members, tc_bond_members);
+    suite_add_tcase(s, TCase_bond_members);
+    tcase_add_test(TCase_bond_xor, tc_bond_xor);
+    suite_add_tcase(s, TCase_bond_xor);
+    tcase_add_test(TCase_bond_roundrobin, tc_bond_roundrobin);
+    suite_add_tcase(s, TCase_bond_roundrobin);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
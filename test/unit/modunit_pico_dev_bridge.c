@@ -0,0 +1,259 @@
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_frame.h"
+#include "pico_eth.h"
+#include "pico_protocol.h"
+#include "pico_dev_bridge.h"
+#include "modules/pico_dev_bridge.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#define BR_PORTS 3
+
+static uint8_t br_mac[PICO_SIZE_ETH] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0xb0
+};
+static uint8_t sta_mac[4][PICO_SIZE_ETH] = {
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x04 }
+};
+static uint8_t bcast_mac[PICO_SIZE_ETH] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static struct pico_device *br_port[BR_PORTS];
+static int br_sent[BR_PORTS];
+
+static int br_port_send(struct pico_device *dev, void *buf, int len)
+{
+    int i;
+    (void)buf;
+    for (i = 0; i < BR_PORTS; i++) {
+        if (br_port[i] == dev)
+            br_sent[i]++;
+    }
+    return len;
+}
+
+static struct pico_device *br_setup(void)
+{
+    struct pico_device *br;
+    char name[MAX_DEVICE_NAME];
+    uint8_t mac[PICO_SIZE_ETH] = {
+        0x02, 0x00, 0x00, 0x00, 0x00, 0xa0
+    };
+    int i;
+
+    pico_stack_init();
+    br = pico_bridge_create("br0", br_mac);
+    fail_if(!br);
+    for (i = 0; i < BR_PORTS; i++) {
+        br_port[i] = PICO_ZALLOC(sizeof(struct pico_device));
+        fail_if(!br_port[i]);
+        br_port[i]->send = br_port_send;
+        br_port[i]->mtu = (uint32_t)(1500 - i);
+        snprintf(name, MAX_DEVICE_NAME, "port%d", i);
+        mac[5] = (uint8_t)(0xa0 + i);
+        fail_if(pico_device_init(br_port[i], name, mac) != 0);
+        fail_if(pico_bridge_add_port(br, br_port[i]) != 0);
+        br_sent[i] = 0;
+    }
+    return br;
+}
+
+/* Frame as the device loop hands it over, received on port in */
+static struct pico_frame *br_frame(int in, uint8_t *src, uint8_t *dst)
+{
+    struct pico_frame *f = pico_frame_alloc(64);
+    struct pico_eth_hdr *hdr;
+
+    fail_if(!f);
+    memset(f->buffer, 0, f->buffer_len);
+    hdr = (struct pico_eth_hdr *)f->buffer;
+    memcpy(hdr->saddr, src, PICO_SIZE_ETH);
+    memcpy(hdr->daddr, dst, PICO_SIZE_ETH);
+    hdr->proto = 0xb588; /* local experimental ethertype, ignored by the stack */
+    f->dev = br_port[in];
+    f->datalink_hdr = f->buffer;
+    return f;
+}
+
+static void br_drain(void)
+{
+    int i;
+    for (i = 0; i < 4; i++)
+        pico_devices_loop(100, PICO_LOOP_DIR_OUT);
+}
+
+START_TEST(tc_bridge_ports)
+{
+    struct pico_device *br = br_setup();
+    struct pico_device *other;
+    struct pico_bridge *b = (struct pico_bridge *)br;
+    int n = 0;
+    struct pico_bridge_port *p;
+
+    /* the bridge takes the smallest MTU of its ports */
+    fail_if(br->mtu != 1500 - (BR_PORTS - 1));
+    for (p = b->ports; p; p = p->next)
+        n++;
+    fail_if(n != BR_PORTS);
+
+    /* a device belongs to one bridge at most, and bridges do not nest */
+    fail_if(pico_bridge_add_port(br, br_port[0]) == 0);
+    fail_if(pico_err != PICO_ERR_EINVAL);
+    other = pico_bridge_create("br1", sta_mac[3]);
+    fail_if(!other);
+    fail_if(pico_bridge_add_port(other, br_port[0]) == 0);
+    fail_if(pico_bridge_add_port(br, other) == 0);
+    fail_if(pico_bridge_add_port(br, br) == 0);
+    fail_if(pico_bridge_add_port(br_port[0], br_port[1]) == 0);
+    fail_if(pico_bridge_del_port(other, br_port[0]) == 0);
+
+    /* ports leave the bridge with their learned stations */
+    (void)pico_bridge_receive(br_frame(0, sta_mac[0], sta_mac[1]));
+    fail_if(b->fdb_count != 1);
+    fail_if(pico_bridge_del_port(br, br_port[0]) != 0);
+    fail_if(br_port[0]->bridge);
+    fail_if(b->fdb_count != 0);
+    fail_if(pico_bridge_add_port(other, br_port[0]) != 0);
+
+    /* destroying a port or a bridge releases the membership */
+    pico_device_destroy(br_port[1]);
+    fail_if(b->ports->next != NULL);
+    pico_device_destroy(other);
+    fail_if(br_port[0]->bridge);
+    pico_device_destroy(br);
+    fail_if(br_port[2]->bridge);
+    pico_device_destroy(br_port[0]);
+    pico_device_destroy(br_port[2]);
+}
+END_TEST
+
+START_TEST(tc_bridge_forward)
+{
+    struct pico_device *br = br_setup();
+    struct pico_frame *f;
+    int i;
+
+    /* unknown destination: flooded, the source is learned */
+    (void)pico_bridge_receive(br_frame(0, sta_mac[0], sta_mac[1]));
+    fail_if(br_port[0]->q_out->frames != 0);
+    fail_if(br_port[1]->q_out->frames != 1 || br_port[2]->q_out->frames != 1);
+    br_drain();
+    fail_if(br_sent[0] != 0 || br_sent[1] != 1 || br_sent[2] != 1);
+
+    /* the answer goes to the learned port only */
+    (void)pico_bridge_receive(br_frame(1, sta_mac[1], sta_mac[0]));
+    fail_if(br_port[0]->q_out->frames != 1 || br_port[2]->q_out->frames != 0);
+    br_drain();
+    fail_if(br_sent[0] != 1 || br_sent[1] != 1 || br_sent[2] != 1);
+
+    /* both known: forwarded */
+    (void)pico_bridge_receive(br_frame(0, sta_mac[0], sta_mac[1]));
+    fail_if(br_port[1]->q_out->frames != 1 || br_port[2]->q_out->frames != 0);
+
+    /* destination on the input port: filtered */
+    (void)pico_bridge_receive(br_frame(0, sta_mac[2], sta_mac[0]));
+    for (i = 0; i < BR_PORTS; i++)
+        fail_if(br_port[i]->q_out->frames != (uint32_t)(i == 1));
+    br_drain();
+
+    /* flooding shares the frame: one buffer, one reference per port */
+    f = br_frame(2, sta_mac[2], bcast_mac);
+    (void)pico_bridge_receive(f);
+    fail_if(*f->usage_count != 2);
+    fail_if(pico_queue_peek(br_port[0]->q_out)->buffer != pico_queue_peek(br_port[1]->q_out)->buffer);
+    fail_if(!(pico_queue_peek(br_port[0]->q_out)->flags & PICO_FRAME_FLAG_BRIDGED));
+    br_drain();
+    fail_if(br_sent[0] != 2 || br_sent[1] != 3 || br_sent[2] != 1);
+
+    /* the station moved */
+    (void)pico_bridge_receive(br_frame(2, sta_mac[0], sta_mac[1]));
+    fail_if(pico_bridge_fdb_find((struct pico_bridge *)br, sta_mac[0]) != br_port[2]);
+    br_drain();
+
+    /* the stack sends through the bridge to the learned port */
+    f = br_frame(0, br_mac, sta_mac[1]);
+    fail_if(br->send(br, f->buffer, 64) != 64);
+    fail_if(br_sent[1] != 5 || br_sent[0] != 2);
+    memcpy(((struct pico_eth_hdr *)f->buffer)->daddr, bcast_mac, PICO_SIZE_ETH);
+    fail_if(br->send(br, f->buffer, 64) != 64);
+    fail_if(br_sent[0] != 3 || br_sent[1] != 6 || br_sent[2] != 2);
+    pico_frame_discard(f);
+
+    for (i = 0; i < BR_PORTS; i++)
+        pico_device_destroy(br_port[i]);
+    pico_device_destroy(br);
+}
+END_TEST
+
+START_TEST(tc_bridge_ageing)
+{
+    struct pico_device *br = br_setup();
+    struct pico_bridge *b = (struct pico_bridge *)br;
+    uint32_t i;
+    int j;
+
+    (void)pico_bridge_receive(br_frame(0, sta_mac[0], sta_mac[1]));
+    (void)pico_bridge_receive(br_frame(1, sta_mac[1], sta_mac[0]));
+    br_drain();
+    fail_if(b->fdb_count != 2);
+
+    /* stale entries are misses before they are swept */
+    pico_tick += PICO_BRIDGE_AGEING / 2;
+    (void)pico_bridge_receive(br_frame(1, sta_mac[1], sta_mac[2]));
+    br_drain();
+    pico_tick += PICO_BRIDGE_AGEING / 2;
+    fail_if(pico_bridge_fdb_find(b, sta_mac[0]) != NULL);
+    fail_if(pico_bridge_fdb_find(b, sta_mac[1]) != br_port[1]);
+    for (i = 0; i < PICO_BRIDGE_FDB_HASH; i++)
+        pico_bridge_fdb_flush(b, i, NULL, pico_tick);
+    fail_if(b->fdb_count != 1);
+
+    /* the table is bounded */
+    for (i = 0; i < PICO_BRIDGE_FDB_MAX + 10u; i++) {
+        sta_mac[3][3] = (uint8_t)(i >> 8);
+        sta_mac[3][4] = (uint8_t)i;
+        (void)pico_bridge_receive(br_frame(2, sta_mac[3], sta_mac[1]));
+    }
+    fail_if(b->fdb_count != PICO_BRIDGE_FDB_MAX);
+    br_drain();
+
+    for (j = 0; j < BR_PORTS; j++)
+        pico_device_destroy(br_port[j]);
+    pico_device_destroy(br);
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_bridge_ports = tcase_create("Unit test for bridge ports");
+    TCase *TCase_bridge_forward = tcase_create("Unit test for bridge forwarding");
+    TCase *TCase_bridge_ageing = tcase_create("Unit test for bridge address ageing");
+
+    tcase_add_test(TCase_bridge_ports, tc_bridge_ports);
+    suite_add_tcase(s, TCase_bridge_ports);
+    tcase_add_test(TCase_bridge_forward, tc_bridge_forward);
+    suite_add_tcase(s, TCase_bridge_forward);
+    tcase_add_test(TCase_bridge_ageing, tc_bridge_ageing);
+    suite_add_tcase(s, TCase_bridge_ageing);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
@@ -0,0 +1,284 @@
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_socket.h"
+#include "pico_ipv4.h"
+#include "pico_dev_mock.h"
+#include "pico_dev_loop.h"
+#include "pico_evq.h"
+#include "modules/pico_evq.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#define EVQ_SOCKS 4
+
+static struct pico_ip4 evq_local;
+static struct pico_socket *evq_sock[EVQ_SOCKS];
+static int evq_user_wakeups;
+
+static void evq_user_wakeup(uint16_t ev, struct pico_socket *s)
+{
+    (void)ev;
+    (void)s;
+    evq_user_wakeups++;
+}
+
+static void evq_setup(void)
+{
+    struct mock_device *mock;
+    struct pico_ip4 netmask;
+    uint16_t port;
+    int i;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.70.0.1", &evq_local.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock);
+    fail_if(pico_ipv4_link_add(mock->dev, evq_local, netmask) < 0);
+    for (i = 0; i < EVQ_SOCKS; i++) {
+        evq_sock[i] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, evq_user_wakeup);
+        fail_if(!evq_sock[i]);
+        port = short_be((uint16_t)(7000 + i));
+        fail_if(pico_socket_bind(evq_sock[i], &evq_local, &port) < 0);
+    }
+    evq_user_wakeups = 0;
+}
+
+static void evq_send(int i)
+{
+    fail_if(pico_socket_sendto(evq_sock[i], "x", 1, &evq_local, evq_sock[i]->local_port) != 1);
+}
+
+static void evq_deliver(void)
+{
+    int i;
+    for (i = 0; i < 10; i++)
+        pico_stack_tick();
+}
+
+/* bitmask of the sockets in the events */
+static int evq_got(struct pico_evq_event *ev, int n, uint16_t events)
+{
+    int i, j, mask = 0;
+
+    for (i = 0; i < n; i++) {
+        fail_if(ev[i].events != events);
+        for (j = 0; j < EVQ_SOCKS; j++) {
+            if (ev[i].s == evq_sock[j]) {
+                fail_if(ev[i].data != &evq_sock[j]);
+                fail_if(mask & (1 << j)); /* once per call */
+                mask |= 1 << j;
+            }
+        }
+    }
+    return mask;
+}
+
+START_TEST(tc_evq_register)
+{
+    struct pico_evq *q, *other;
+    struct pico_evq_event ev[8];
+
+    evq_setup();
+    q = pico_evq_create();
+    other = pico_evq_create();
+    fail_if(!q || !other);
+
+    fail_if(pico_evq_add(NULL, evq_sock[0], PICO_SOCK_EV_RD, 0, NULL) != -1);
+    fail_if(pico_evq_add(q, NULL, PICO_SOCK_EV_RD, 0, NULL) != -1);
+    fail_if(pico_evq_add(q, evq_sock[0], PICO_SOCK_EV_RD, 0x80, NULL) != -1);
+    fail_if(pico_err != PICO_ERR_EINVAL);
+    fail_if(pico_evq_wait(q, ev, 0) != -1);
+
+    fail_if(pico_evq_add(q, evq_sock[0], PICO_SOCK_EV_RD, 0, NULL) != 0);
+    fail_if(evq_sock[0]->wakeup != pico_evq_wakeup);
+    fail_if(pico_evq_add(other, evq_sock[0], PICO_SOCK_EV_RD, 0, NULL) != -1);
+    fail_if(pico_err != PICO_ERR_EEXIST);
+    fail_if(pico_evq_mod(other, evq_sock[0], PICO_SOCK_EV_RD, 0, NULL) != -1);
+    fail_if(pico_err != PICO_ERR_ENOENT);
+    fail_if(pico_evq_del(other, evq_sock[0]) != -1);
+    fail_if(pico_evq_del(q, evq_sock[1]) != -1);
+
+    /* a UDP socket is always writable */
+    fail_if(pico_evq_wait(q, ev, 8) != 0);
+    fail_if(pico_evq_mod(q, evq_sock[0], PICO_SOCK_EV_WR, 0, NULL) != 0);
+    fail_if(pico_evq_wait(q, ev, 8) != 1);
+    fail_if(ev[0].s != evq_sock[0] || ev[0].events != PICO_SOCK_EV_WR);
+
+    /* unregistering gives the callback back */
+    fail_if(pico_evq_del(q, evq_sock[0]) != 0);
+    fail_if(evq_sock[0]->wakeup != evq_user_wakeup || evq_sock[0]->evq);
+    fail_if(pico_evq_wait(q, ev, 8) != 0);
+    fail_if(pico_evq_add(other, evq_sock[0], PICO_SOCK_EV_RD, 0, NULL) != 0);
+    fail_if(pico_evq_add(q, evq_sock[1], PICO_SOCK_EV_RD, 0, NULL) != 0);
+    pico_evq_destroy(other);
+    pico_evq_destroy(q);
+    fail_if(evq_sock[0]->wakeup != evq_user_wakeup || evq_sock[1]->wakeup != evq_user_wakeup);
+}
+END_TEST
+
+START_TEST(tc_evq_level)
+{
+    struct pico_evq *q;
+    struct pico_evq_event ev[8];
+    char buf[4];
+    int i, n;
+
+    evq_setup();
+    q = pico_evq_create();
+    fail_if(!q);
+    for (i = 0; i < EVQ_SOCKS; i++)
+        fail_if(pico_evq_add(q, evq_sock[i], PICO_SOCK_EV_RD, PICO_EVQ_LEVEL, &evq_sock[i]) != 0);
+
+    /* events of a socket are coalesced, idle sockets are not reported */
+    evq_send(0);
+    evq_send(0);
+    evq_send(2);
+    evq_deliver();
+    fail_if(evq_user_wakeups != 0);
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(n != 2);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x5);
+
+    /* still readable: reported again, until drained */
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x5);
+    fail_if(pico_socket_recv(evq_sock[2], buf, sizeof(buf)) != 1);
+    fail_if(pico_socket_recv(evq_sock[0], buf, sizeof(buf)) != 1);
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x1);
+
+    /* batches: the rest is left for the next call */
+    evq_send(1);
+    evq_send(3);
+    evq_deliver();
+    n = pico_evq_wait(q, ev, 2);
+    fail_if(n != 2);
+    i = evq_got(ev, n, PICO_SOCK_EV_RD);
+    n = pico_evq_wait(q, ev, 2);
+    fail_if(n != 2);
+    i |= evq_got(ev, n, PICO_SOCK_EV_RD);
+    fail_if(i != 0xb);
+
+    /* a closed socket leaves the queue */
+    pico_socket_close(evq_sock[1]);
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x9);
+    pico_evq_destroy(q);
+}
+END_TEST
+
+START_TEST(tc_evq_edge)
+{
+    struct pico_evq *q;
+    struct pico_evq_event ev[8];
+    int n;
+
+    evq_setup();
+    q = pico_evq_create();
+    fail_if(!q);
+    fail_if(pico_evq_add(q, evq_sock[0], PICO_SOCK_EV_RD, PICO_EVQ_EDGE, &evq_sock[0]) != 0);
+    fail_if(pico_evq_add(q, evq_sock[1], PICO_SOCK_EV_RD, PICO_EVQ_ONESHOT, &evq_sock[1]) != 0);
+
+    /* edge: once per arrival, even if not drained */
+    evq_send(0);
+    evq_send(1);
+    evq_deliver();
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x3);
+    fail_if(pico_evq_wait(q, ev, 8) != 0);
+    evq_send(0);
+    evq_send(1);
+    evq_deliver();
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x1);
+
+    /* one shot: nothing until rearmed, then the current state is reported */
+    fail_if(pico_evq_mod(q, evq_sock[1], PICO_SOCK_EV_RD, PICO_EVQ_ONESHOT, &evq_sock[1]) != 0);
+    n = pico_evq_wait(q, ev, 8);
+    fail_if(evq_got(ev, n, PICO_SOCK_EV_RD) != 0x2);
+    fail_if(pico_evq_wait(q, ev, 8) != 0);
+    pico_evq_destroy(q);
+}
+END_TEST
+
+START_TEST(tc_evq_accept)
+{
+    struct pico_evq *q;
+    struct pico_evq_event ev[8];
+    struct pico_socket *listener, *client, *child;
+    struct pico_ip4 lo, netmask, orig;
+    uint16_t port = short_be(7100), peer;
+    int i;
+
+    pico_stack_init();
+    pico_string_to_ipv4("127.0.0.1", &lo.addr);
+    pico_string_to_ipv4("255.0.0.0", &netmask.addr);
+    fail_if(pico_ipv4_link_add(pico_loop_create(), lo, netmask) < 0);
+    evq_user_wakeups = 0;
+
+    listener = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, evq_user_wakeup);
+    fail_if(!listener);
+    fail_if(pico_socket_bind(listener, &lo, &port) < 0);
+    fail_if(pico_socket_listen(listener, 4) < 0);
+    q = pico_evq_create();
+    fail_if(!q);
+    fail_if(pico_evq_add(q, listener, PICO_SOCK_EV_CONN, 0, NULL) != 0);
+
+    client = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    fail_if(!client);
+    fail_if(pico_socket_connect(client, &lo, port) < 0);
+    for (i = 0; i < 20; i++)
+        pico_stack_tick();
+    fail_if(pico_evq_wait(q, ev, 8) != 1);
+    fail_if(ev[0].s != listener || ev[0].events != PICO_SOCK_EV_CONN);
+
+    /* the accepted socket gets the callback of the application back */
+    child = pico_socket_accept(listener, &orig, &peer);
+    fail_if(!child);
+    fail_if(child->wakeup != evq_user_wakeup);
+    fail_if(pico_evq_add(q, child, PICO_SOCK_EV_RD, 0, &child) != 0);
+    fail_if(child->evq->wakeup != evq_user_wakeup);
+    fail_if(pico_socket_write(client, "x", 1) != 1);
+    for (i = 0; i < 20; i++)
+        pico_stack_tick();
+    fail_if(pico_evq_wait(q, ev, 8) != 1);
+    fail_if(ev[0].s != child || !(ev[0].events & PICO_SOCK_EV_RD));
+    fail_if(evq_user_wakeups != 0);
+    fail_if(pico_evq_del(q, child) != 0);
+    fail_if(child->wakeup != evq_user_wakeup);
+    pico_evq_destroy(q);
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_evq_register = tcase_create("Unit test for event queue registration");
+    TCase *TCase_evq_level = tcase_create("Unit test for level triggered events");
+    TCase *TCase_evq_edge = tcase_create("Unit test for edge triggered and one shot events");
+    TCase *TCase_evq_accept = tcase_create("Unit test for connections accepted from a registered listener");
+
+    tcase_add_test(TCase_evq_register, tc_evq_register);
+    suite_add_tcase(s, TCase_evq_register);
+    tcase_add_test(TCase_evq_level, tc_evq_level);
+    suite_add_tcase(s, TCase_evq_level);
+    tcase_add_test(TCase_evq_edge, tc_evq_edge);
+    suite_add_tcase(s, TCase_evq_edge);
+    tcase_add_test(TCase_evq_accept, tc_evq_accept);
+    suite_add_tcase(s, TCase_evq_accept);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
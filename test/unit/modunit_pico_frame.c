@@ -155,10 +155,13 @@ END_TEST
 START_TEST(tc_pico_frame_deepcopy)
 {
     struct pico_frame *f = pico_frame_alloc(FRAME_SIZE);
-    struct pico_frame *dc = pico_frame_deepcopy(f);
+    struct pico_frame *dc;
+    memset(f->buffer, 0xA5, FRAME_SIZE);
+    dc = pico_frame_deepcopy(f);
     fail_if(*f->usage_count != 1);
     fail_if(*dc->usage_count != 1);
     fail_if(dc->buffer == f->buffer);
+    fail_if(memcmp(dc->buffer, f->buffer, FRAME_SIZE) != 0);
 #ifdef PICO_FAULTY
     printf("Testing with faulty memory in frame_deepcopy (1)\n");
     pico_set_mm_failure(1);
@@ -0,0 +1,138 @@
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_icmp4.h"
+#include "pico_icmp6.h"
+#include "pico_icmp_ratelimit.h"
+#include "modules/pico_icmp_ratelimit.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+static const uint8_t rl_dst1[PICO_SIZE_IP4] = {
+    10, 0, 0, 1
+};
+static const uint8_t rl_dst2[PICO_SIZE_IP4] = {
+    10, 0, 0, 2
+};
+
+static struct pico_icmp_ratelimit *rl_new(uint32_t interval, uint32_t rate, uint32_t burst)
+{
+    static struct pico_icmp_ratelimit rl;
+
+    memset(&rl, 0, sizeof(rl));
+    pico_icmp_ratelimit_type(&rl, PICO_ICMP_DEST_UNREACH, 1);
+    fail_if(pico_icmp_ratelimit_set(&rl, interval, rate, burst) != 0);
+    return &rl;
+}
+
+START_TEST(tc_icmp_ratelimit_dest)
+{
+    struct pico_icmp_ratelimit *rl = rl_new(1000, 0, 0);
+    uint32_t i;
+
+    /* a burst per destination, then nothing until the bucket refills */
+    for (i = 0; i < PICO_ICMP_RATELIMIT_BURST_FACTOR; i++)
+        fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, rl_dst1, PICO_SIZE_IP4));
+    fail_if(pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, rl_dst1, PICO_SIZE_IP4));
+    fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, rl_dst2, PICO_SIZE_IP4));
+
+    /* types out of the mask are never limited */
+    for (i = 0; i < 100; i++)
+        fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_ECHOREPLY, rl_dst1, PICO_SIZE_IP4));
+    pico_icmp_ratelimit_type(rl, PICO_ICMP_ECHOREPLY, 1);
+    fail_if(pico_icmp_ratelimit_allow(rl, PICO_ICMP_ECHOREPLY, rl_dst1, PICO_SIZE_IP4));
+    pico_icmp_ratelimit_type(rl, PICO_ICMP_DEST_UNREACH, 0);
+    fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, rl_dst1, PICO_SIZE_IP4));
+
+    fail_if(rl->stats.sent != PICO_ICMP_RATELIMIT_BURST_FACTOR + 1);
+    fail_if(rl->stats.suppressed_dest != 2 || rl->stats.suppressed_global != 0);
+
+    /* the bucket refills with time */
+    rl->dest[pico_icmp_ratelimit_hash(rl_dst1, PICO_SIZE_IP4) % PICO_ICMP_RATELIMIT_DESTS].stamp -= 1000;
+    fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_ECHOREPLY, rl_dst1, PICO_SIZE_IP4));
+    fail_if(pico_icmp_ratelimit_allow(rl, PICO_ICMP_ECHOREPLY, rl_dst1, PICO_SIZE_IP4));
+}
+END_TEST
+
+START_TEST(tc_icmp_ratelimit_global)
+{
+    struct pico_icmp_ratelimit *rl = rl_new(0, 10, 4);
+    uint8_t dst[PICO_SIZE_IP4] = {
+        10, 0, 1, 0
+    };
+    uint32_t i;
+
+    /* the global burst is shared by all destinations */
+    for (i = 0; i < 4; i++) {
+        dst[3] = (uint8_t)i;
+        fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, dst, PICO_SIZE_IP4));
+    }
+    dst[3] = 200;
+    fail_if(pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, dst, PICO_SIZE_IP4));
+    fail_if(rl->stats.suppressed_global != 1);
+
+    /* 10 per second: one more after 100 msec */
+    rl->stamp -= 100;
+    fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, dst, PICO_SIZE_IP4));
+    fail_if(pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, dst, PICO_SIZE_IP4));
+
+    /* a message dropped by the destination limit costs no global token */
+    rl = rl_new(1000, 10, 10);
+    for (i = 0; i < PICO_ICMP_RATELIMIT_BURST_FACTOR + 3; i++)
+        (void)pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, rl_dst1, PICO_SIZE_IP4);
+    fail_if(rl->stats.suppressed_dest != 3);
+    for (i = 0; i < 10 - PICO_ICMP_RATELIMIT_BURST_FACTOR; i++) {
+        dst[3] = (uint8_t)i;
+        fail_if(!pico_icmp_ratelimit_allow(rl, PICO_ICMP_DEST_UNREACH, dst, PICO_SIZE_IP4));
+    }
+
+    fail_if(pico_icmp_ratelimit_set(rl, 0, 10, 0) == 0);
+}
+END_TEST
+
+START_TEST(tc_icmp_ratelimit_api)
+{
+    struct pico_icmp_ratelimit_stats stats;
+
+    fail_if(pico_icmp4_ratelimit(500, 100, 10) != 0);
+    fail_if(pico_icmp4_ratelimit(0, 100, 0) == 0);
+    fail_if(pico_err != PICO_ERR_EINVAL);
+    pico_icmp4_ratemask(PICO_ICMP_ECHOREPLY, 1);
+    pico_icmp4_ratelimit_stats(&stats);
+    fail_if(stats.sent != 0);
+#ifdef PICO_SUPPORT_IPV6
+    fail_if(pico_icmp6_ratelimit(500, 100, 10) != 0);
+    pico_icmp6_ratemask(PICO_ICMP6_ECHO_REPLY, 1);
+    pico_icmp6_ratelimit_stats(&stats);
+    fail_if(stats.suppressed_dest != 0);
+#endif
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_icmp_ratelimit_dest = tcase_create("Unit test for per destination ICMP limits");
+    TCase *TCase_icmp_ratelimit_global = tcase_create("Unit test for the global ICMP limit");
+    TCase *TCase_icmp_ratelimit_api = tcase_create("Unit test for the ICMPv4 and ICMPv6 limits API");
+
+    tcase_add_test(TCase_icmp_ratelimit_dest, tc_icmp_ratelimit_dest);
+    suite_add_tcase(s, TCase_icmp_ratelimit_dest);
+    tcase_add_test(TCase_icmp_ratelimit_global, tc_icmp_ratelimit_global);
+    suite_add_tcase(s, TCase_icmp_ratelimit_global);
+    tcase_add_test(TCase_icmp_ratelimit_api, tc_icmp_ratelimit_api);
+    suite_add_tcase(s, TCase_icmp_ratelimit_api);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
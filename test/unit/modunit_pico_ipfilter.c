@@ -24,6 +24,15 @@ void pico_frame_discard(struct pico_frame *f)
     (void)f;
 }
 
+static uint8_t conntrack_state = PICO_CT_NEW;
+static int conntrack_lookups = 0;
+uint8_t pico_conntrack_state(struct pico_frame *f)
+{
+    (void)f;
+    conntrack_lookups++;
+    return conntrack_state;
+}
+
 volatile pico_err_t pico_err;
 
 
@@ -298,14 +307,225 @@ START_TEST(tc_ipfilter)
 }
 END_TEST
 
+/* Brute force reference: the oldest rule matching the packet */
+static struct filter_node *ipfilter_scan(struct filter_node *pkt)
+{
+    struct pico_tree_node *index;
+    struct filter_node *rule, *found = NULL;
+
+    pico_tree_foreach(index, &filter_tree) {
+        rule = index->keyValue;
+        if ((filter_match_packet(pkt, rule) == 0) && (!found || (rule->filter_id < found->filter_id)))
+            found = rule;
+    }
+    return found;
+}
+
+START_TEST(tc_ipfilter_classifier)
+{
+    struct pico_device *devs[2] = {
+        (struct pico_device *)&devs[0], (struct pico_device *)&devs[1]
+    };
+    uint8_t protos[3] = {
+        0, PICO_PROTO_TCP, PICO_PROTO_UDP
+    };
+    uint32_t masks[4] = {
+        0, 0xFFFFFFFFu, 0xFFFFFF00u, 0xFFFF0000u
+    };
+    struct pico_ip4 out_addr, out_mask, in_addr, in_mask;
+    struct filter_node pkt;
+    uint32_t ids[300];
+    uint32_t seed = 1, i, n = 0, hits = 0;
+
+    for (i = 0; i < 300; i++) {
+        seed = seed * 1103515245u + 12345u;
+        out_addr.addr = long_be(0x0a000000u | ((seed >> 8) & 0x00000F0Fu));
+        out_mask.addr = long_be(masks[(seed >> 4) & 3u]);
+        in_addr.addr = long_be(0xc0a80000u | ((seed >> 16) & 0x0F0Fu));
+        in_mask.addr = long_be(masks[(seed >> 6) & 3u]);
+        ids[n] = pico_ipv4_filter_add((seed & 0x100u) ? devs[seed & 1u] : NULL, protos[(seed >> 2) % 3u],
+                                      &out_addr, &out_mask, &in_addr, &in_mask,
+                                      (uint16_t)((seed & 0x200u) ? (seed >> 24) & 7u : 0u),
+                                      (uint16_t)((seed & 0x400u) ? (seed >> 27) & 7u : 0u),
+                                      0, (uint8_t)((seed & 0x800u) ? 0x10u : 0u), FILTER_DROP);
+        if (ids[n])
+            n++;
+    }
+    fail_if(n < 200);
+    fail_if(!ipf_compiled || (ipf_compiled->count != n));
+
+    for (i = 0; i < 20000; i++) {
+        if (i == 10000) {
+            /* deleting rules recompiles the classifier */
+            while (n > 100)
+                fail_if(pico_ipv4_filter_del(ids[--n]));
+            fail_if(ipf_compiled->count != n);
+        }
+
+        seed = seed * 1103515245u + 12345u;
+        memset(&pkt, 0, sizeof(pkt));
+        pkt.fdev = devs[seed & 1u];
+        pkt.proto = protos[1u + ((seed >> 1) & 1u)];
+        pkt.out_addr = long_be(0x0a000000u | ((seed >> 8) & 0x00000F0Fu));
+        pkt.in_addr = long_be(0xc0a80000u | ((seed >> 16) & 0x0F0Fu));
+        pkt.out_port = (uint16_t)((seed >> 24) & 7u);
+        pkt.in_port = (uint16_t)((seed >> 27) & 7u);
+        pkt.tos = (uint8_t)((seed & 0x4u) ? 0x10u : 0u);
+        fail_if(ipf_classify(ipf_compiled, &pkt) != ipfilter_scan(&pkt));
+        if (ipfilter_scan(&pkt))
+            hits++;
+    }
+    fail_if(hits == 0);
+
+    while (n > 0)
+        fail_if(pico_ipv4_filter_del(ids[--n]));
+    fail_if(ipf_compiled != NULL);
+}
+END_TEST
+
+
+static struct pico_frame *ipfilter_frame(uint8_t *buf, uint32_t src)
+{
+    static struct pico_frame f;
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(buf + PICO_SIZE_IP4HDR);
+
+    memset(&f, 0, sizeof(f));
+    memset(buf, 0, PICO_SIZE_IP4HDR + PICO_UDPHDR_SIZE);
+    hdr->vhl = 0x45;
+    hdr->proto = PICO_PROTO_UDP;
+    hdr->src.addr = long_be(src);
+    hdr->dst.addr = long_be(0xc0a80001u);
+    udp->trans.sport = short_be(1000);
+    udp->trans.dport = short_be(53);
+    f.net_hdr = buf;
+    f.transport_hdr = buf + PICO_SIZE_IP4HDR;
+    return &f;
+}
+
+START_TEST(tc_ipfilter_ratelimit)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + PICO_UDPHDR_SIZE];
+    struct pico_frame *f;
+    uint32_t id, i;
+
+    /* rate limits need a rate and a burst */
+    fail_if(pico_ipv4_filter_add(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, 0, 0, FILTER_RATELIMIT) > 0);
+    fail_if(pico_ipv4_filter_add_ratelimit(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, 0, 0, 1, 0, 0) > 0);
+    fail_if(pico_ipv4_filter_add_ratelimit(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, 0, 0, 0, 1, 0) > 0);
+
+    /* one bucket for all sources: the burst goes through, then packets are dropped */
+    id = pico_ipv4_filter_add_ratelimit(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, 0, 0, 1, 3, 0);
+    fail_if(id == 0);
+    for (i = 0; i < 3; i++)
+        fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u + i)) != 0);
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000009u)) != 1);
+    fail_if(pico_ipv4_filter_del(id));
+
+    /* per source buckets: a flooding source does not starve the others */
+    id = pico_ipv4_filter_add_ratelimit(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, 0, 0, 1, 2,
+                                        PICO_IPFILTER_RATE_PER_SOURCE);
+    fail_if(id == 0);
+    for (i = 0; i < 2; i++)
+        fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 0);
+    for (i = 0; i < 100; i++)
+        fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 1);
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000002u)) != 0);
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000002u)) != 0);
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000002u)) != 1);
+
+    /* more sources than buckets: the least recently seen ones are forgotten */
+    for (i = 0; i < 4 * PICO_IPFILTER_RATE_SOURCES; i++)
+        fail_if(ipfilter(ipfilter_frame(buf, 0x0b000000u + i)) != 0);
+    fail_if(pico_ipv4_filter_del(id));
+
+    /* marking: excess packets go through with the filter priority */
+    id = pico_ipv4_filter_add_ratelimit(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 53, 0, -5, 0, 1, 1,
+                                        PICO_IPFILTER_RATE_MARK);
+    fail_if(id == 0);
+    f = ipfilter_frame(buf, 0x0a000001u);
+    fail_if(ipfilter(f) != 0);
+    fail_if(f->priority != 0);
+    f = ipfilter_frame(buf, 0x0a000001u);
+    fail_if(ipfilter(f) != 0);
+    fail_if(f->priority != -5);
+    fail_if(pico_ipv4_filter_del(id));
+}
+END_TEST
+
+START_TEST(tc_ipfilter_state)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + PICO_UDPHDR_SIZE];
+    uint32_t accept, drop;
+
+    fail_if(pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_ACCEPT, 0) > 0);
+    fail_if(pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_ACCEPT, 0x80) > 0);
+    fail_if(pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_RATELIMIT, PICO_CT_NEW) > 0);
+
+    /* stateless rules do not look packets up */
+    drop = pico_ipv4_filter_add(NULL, PICO_PROTO_UDP, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_DROP);
+    fail_if(drop == 0);
+    conntrack_lookups = 0;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 1);
+    fail_if(conntrack_lookups != 0);
+    fail_if(pico_ipv4_filter_del(drop));
+
+    /* accept established, drop everything else; the older rule wins */
+    accept = pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_ACCEPT,
+                                        PICO_CT_ESTABLISHED | PICO_CT_CLOSING);
+    fail_if(accept == 0);
+    drop = pico_ipv4_filter_add(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_DROP);
+    fail_if(drop == 0);
+    fail_if(ipf_compiled == NULL);
+
+    conntrack_state = PICO_CT_ESTABLISHED;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 0);
+    fail_if(conntrack_lookups != 1);
+    conntrack_state = PICO_CT_CLOSING;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 0);
+    conntrack_state = PICO_CT_NEW;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 1);
+    conntrack_state = PICO_CT_UNTRACKED;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 1);
+
+    /* same through the rule tree */
+    ipf_classifier_free(ipf_compiled);
+    ipf_compiled = NULL;
+    conntrack_state = PICO_CT_ESTABLISHED;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 0);
+    conntrack_state = PICO_CT_NEW;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 1);
+
+    /* a rule on other states with the same fields is a different rule */
+    fail_if(pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_DROP, PICO_CT_NEW) == 0);
+    fail_if(pico_ipv4_filter_add_state(NULL, 0, NULL, NULL, NULL, NULL, 0, 0, 0, 0, FILTER_DROP, PICO_CT_NEW) > 0);
+
+    fail_if(pico_ipv4_filter_del(drop));
+    fail_if(pico_ipv4_filter_del(accept));
+    fail_if(pico_ipv4_filter_del(accept + 2));
+    fail_if(ipf_stateful != 0);
+    conntrack_lookups = 0;
+    fail_if(ipfilter(ipfilter_frame(buf, 0x0a000001u)) != 0);
+    fail_if(conntrack_lookups != 0);
+}
+END_TEST
 
 Suite *pico_suite(void)
 {
     Suite *s = suite_create("IPfilter module");
 
     TCase *TCase_ipfilter = tcase_create("Unit test for ipfilter");
+    TCase *TCase_ipfilter_classifier = tcase_create("Unit test for the compiled classifier");
+    TCase *TCase_ipfilter_ratelimit = tcase_create("Unit test for the rate limit action");
+    TCase *TCase_ipfilter_state = tcase_create("Unit test for connection state rules");
     tcase_add_test(TCase_ipfilter, tc_ipfilter);
     suite_add_tcase(s, TCase_ipfilter);
+    tcase_add_test(TCase_ipfilter_classifier, tc_ipfilter_classifier);
+    suite_add_tcase(s, TCase_ipfilter_classifier);
+    tcase_add_test(TCase_ipfilter_ratelimit, tc_ipfilter_ratelimit);
+    suite_add_tcase(s, TCase_ipfilter_ratelimit);
+    tcase_add_test(TCase_ipfilter_state, tc_ipfilter_state);
+    suite_add_tcase(s, TCase_ipfilter_state);
     return s;
 }
 
@@ -7,6 +7,7 @@
 #include "pico_device.h"
 #include "pico_eth.h"
 #include "pico_addressing.h"
+#include "pico_dev_loop.h"
 #include "modules/pico_ipv6_nd.c"
 #include "check.h"
 #ifdef PICO_SUPPORT_IPV6
@@ -47,33 +48,72 @@ START_TEST(tc_pico_nd_new_expire_time)
 
 }
 END_TEST
-START_TEST(tc_pico_nd_queue)
+static struct pico_frame *nd_frame(struct pico_device *dev, struct pico_ip6 *dst)
 {
-    struct pico_ip6 addr = {{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9 }};
-    int i;
     struct pico_frame *f = pico_frame_alloc(sizeof(struct pico_ipv6_hdr));
-    struct pico_ipv6_hdr *h = (struct pico_ipv6_hdr *) f->buffer;
+    struct pico_ipv6_hdr *h;
+    fail_if(!f);
+    h = (struct pico_ipv6_hdr *) f->buffer;
     f->net_hdr = (uint8_t*) h;
     f->buffer[0] = 0x60; /* Ipv6 */
-    memcpy(h->dst.addr, addr.addr, PICO_SIZE_IP6);
+    f->dev = dev;
+    memcpy(h->dst.addr, dst->addr, PICO_SIZE_IP6);
+    return f;
+}
 
-    fail_if(!f);
+START_TEST(tc_pico_nd_queue)
+{
+    struct pico_ip6 addr = {{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9 }};
+    struct pico_ip6 other = {{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 10 }};
+    struct pico_ipv6_neighbor *n, *m;
+    struct pico_device *dev;
+    struct pico_frame *f;
+    uint8_t *last = NULL;
+    int i;
 
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued_v6[i] != NULL);
-    }
-    pico_ipv6_nd_unreachable(&addr);
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued_v6[i] != NULL);
+    pico_stack_init();
+    dev = pico_loop_create();
+    fail_if(!dev);
+
+    /* Solicitations already in progress for both neighbors */
+    n = pico_nd_add(&addr, dev);
+    m = pico_nd_add(&other, dev);
+    fail_if(!n || !m);
+    n->expire = 1;
+    m->expire = 1;
+
+    /* A burst is parked on the neighbor, the oldest frames give way */
+    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED + 2; i++) {
+        f = nd_frame(dev, &addr);
+        fail_unless(pico_ipv6_get_neighbor(f) == NULL);
+        pico_ipv6_nd_postpone(f);
+        last = f->buffer;
+        pico_frame_discard(f);
     }
+    fail_unless(n->frames_count == PICO_ND_MAX_FRAMES_QUEUED);
+    fail_unless(n->frames_tail->buffer == last);
+    f = nd_frame(dev, &other);
     pico_ipv6_nd_postpone(f);
-    fail_if(frames_queued_v6[0]->buffer != f->buffer);
+    pico_frame_discard(f);
+    fail_unless(m->frames_count == 1);
 
-    pico_ipv6_nd_unreachable(&addr);
+    /* Only the resolved neighbor is flushed */
+    n->state = PICO_ND_STATE_REACHABLE;
+    pico_ipv6_nd_queued_trigger(n);
+    fail_unless(n->frames == NULL);
+    fail_unless(dev->q_out->frames == PICO_ND_MAX_FRAMES_QUEUED);
+    fail_unless(m->frames_count == 1);
+    f = nd_frame(dev, &addr);
+    fail_unless(pico_ipv6_get_neighbor(f) == &n->mac);
+    pico_frame_discard(f);
 
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued_v6[i] != NULL);
-    }
+    pico_ipv6_nd_unreachable(m);
+    fail_unless(m->frames == NULL);
+    fail_unless(m->frames_count == 0);
+
+    pico_nd_del(m);
+    fail_unless(pico_nd_find_neighbor(&other) == NULL);
+    fail_unless(pico_nd_find_neighbor(&addr) == n);
 }
 END_TEST
 
@@ -184,7 +224,33 @@ START_TEST(tc_pico_nd_redirect_recv)
 END_TEST
 START_TEST(tc_pico_ipv6_nd_timer_callback)
 {
-    /* TODO: test this: static void pico_ipv6_nd_timer_callback(pico_time now, void *arg) */
+    struct pico_ip6 a = {{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }};
+    struct pico_ip6 b = {{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 }};
+    struct pico_ipv6_neighbor *na, *nb;
+
+    pico_stack_init();
+    na = pico_nd_add(&a, NULL);
+    nb = pico_nd_add(&b, NULL);
+    fail_if(!na || !nb);
+    na->state = PICO_ND_STATE_REACHABLE;
+    nb->state = PICO_ND_STATE_REACHABLE;
+    na->expire = 100000;
+    nb->expire = 100000 + 100 * PICO_ND_TIMER_TICK * PICO_ND_TIMER_SLOTS;
+    pico_nd_timer_schedule(na);
+    pico_nd_timer_schedule(nb);
+
+    /* Only the neighbor whose time has come changes state */
+    pico_ipv6_nd_timer_callback(100000 + PICO_ND_TIMER_TICK, NULL);
+    fail_unless(na->state == PICO_ND_STATE_STALE);
+    fail_unless(na->tprev == NULL);
+    fail_unless(nb->state == PICO_ND_STATE_REACHABLE);
+    fail_unless(nb->tprev != NULL);
+
+    /* Timers further than one turn are kept across turns */
+    pico_ipv6_nd_timer_callback(100000 + 2 * PICO_ND_TIMER_TICK * PICO_ND_TIMER_SLOTS, NULL);
+    fail_unless(nb->state == PICO_ND_STATE_REACHABLE);
+    pico_ipv6_nd_timer_callback(nb->expire + PICO_ND_TIMER_TICK, NULL);
+    fail_unless(nb->state == PICO_ND_STATE_STALE);
 }
 END_TEST
 
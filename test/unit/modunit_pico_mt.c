@@ -0,0 +1,324 @@
+#include <pthread.h>
+#include <sched.h>
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_socket.h"
+#include "pico_ipv4.h"
+#include "pico_udp.h"
+#include "pico_dev_mock.h"
+#include "pico_spsc.h"
+#include "pico_mt.h"
+#include "modules/pico_mt.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#define MT_RING_ITEMS 100000u
+
+static struct pico_spsc mt_ring;
+static void *mt_ring_slots[64];
+
+static void *mt_ring_producer(void *arg)
+{
+    uintptr_t i;
+
+    (void)arg;
+    for (i = 1; i <= MT_RING_ITEMS; i++) {
+        while (pico_spsc_push(&mt_ring, (void *)i) < 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+START_TEST(tc_spsc_ring)
+{
+    pthread_t producer;
+    uintptr_t expected = 1;
+    void *p;
+
+    fail_if(pico_spsc_init(&mt_ring, mt_ring_slots, 48) == 0);
+    fail_if(pico_spsc_init(&mt_ring, mt_ring_slots, 4) != 0);
+    fail_if(pico_spsc_pop(&mt_ring) != NULL);
+    fail_if(pico_spsc_push(&mt_ring, &expected) != 0);
+    fail_if(pico_spsc_count(&mt_ring) != 1);
+    fail_if(pico_spsc_peek(&mt_ring) != &expected);
+    fail_if(pico_spsc_pop(&mt_ring) != &expected);
+    for (expected = 0; expected < 4; expected++)
+        fail_if(pico_spsc_push(&mt_ring, &expected) != 0);
+    fail_if(pico_spsc_push(&mt_ring, &expected) != -1);
+
+    /* in order and nothing lost across threads */
+    fail_if(pico_spsc_init(&mt_ring, mt_ring_slots, 64) != 0);
+    fail_if(pthread_create(&producer, NULL, mt_ring_producer, NULL) != 0);
+    expected = 1;
+    while (expected <= MT_RING_ITEMS) {
+        p = pico_spsc_pop(&mt_ring);
+        if (!p) {
+            sched_yield();
+            continue;
+        }
+
+        fail_if((uintptr_t)p != expected);
+        expected++;
+    }
+    pthread_join(producer, NULL);
+    fail_if(pico_spsc_pop(&mt_ring) != NULL);
+}
+END_TEST
+
+START_TEST(tc_mt_backlog)
+{
+    struct pico_mt_ctx *ctx;
+    struct pico_mt_op op[8];
+    int i;
+
+    pico_stack_init();
+    fail_if(pico_mt_ctx_create(3) != NULL);
+    ctx = pico_mt_ctx_create(4);
+    fail_if(!ctx);
+
+    memset(op, 0, sizeof(op));
+    for (i = 0; i < 4; i++)
+        fail_if(pico_mt_post(ctx, &op[i]) != 0);
+    fail_if(pico_mt_post(ctx, &op[4]) != -1);
+    pico_stack_tick();
+    for (i = 4; i < 8; i++)
+        fail_if(pico_mt_post(ctx, &op[i]) != 0);
+
+    /* the completions that do not fit wait for room */
+    pico_stack_tick();
+    for (i = 0; i < 4; i++) {
+        fail_if(pico_mt_complete(ctx) != &op[i]);
+        fail_if(op[i].ret != -1 || op[i].err != PICO_ERR_EINVAL);
+    }
+    fail_if(pico_mt_complete(ctx) != NULL);
+    pico_stack_tick();
+    for (i = 4; i < 8; i++)
+        fail_if(pico_mt_complete(ctx) != &op[i]);
+    fail_if(pico_mt_complete(ctx) != NULL);
+    pico_mt_ctx_destroy(ctx);
+}
+END_TEST
+
+/* A UDP echo to itself, run by another thread through the front-end */
+static struct pico_mt_ctx *mt_ctx;
+static struct pico_ip4 mt_local;
+static int mt_finished;
+static int mt_result;
+
+static struct pico_mt_op *mt_call(struct pico_mt_op *op)
+{
+    struct pico_mt_op *done;
+
+    while (pico_mt_post(mt_ctx, op) < 0)
+        sched_yield();
+    while ((done = pico_mt_complete(mt_ctx)) == NULL)
+        sched_yield();
+    return done;
+}
+
+static int mt_echo(void)
+{
+    struct pico_mt_op op, send;
+    struct pico_evq_event ev[4];
+    struct pico_socket *s;
+    char buf[16];
+    int cookie;
+
+    memset(&op, 0, sizeof(op));
+    op.type = PICO_MT_OPEN;
+    op.net = PICO_PROTO_IPV4;
+    op.proto = PICO_PROTO_UDP;
+    op.data = &cookie;
+    if ((mt_call(&op) != &op) || (op.ret != 0) || !op.s)
+        return 1;
+
+    s = op.s;
+    op.type = PICO_MT_BIND;
+    op.addr.ip4 = mt_local;
+    op.port = short_be(5555);
+    if (mt_call(&op)->ret != 0)
+        return 2;
+
+    /* nothing yet: the wait is completed by the datagram */
+    op.type = PICO_MT_WAIT;
+    op.buf = ev;
+    op.len = 4;
+    while (pico_mt_post(mt_ctx, &op) < 0)
+        sched_yield();
+    memset(&send, 0, sizeof(send));
+    send.type = PICO_MT_SENDTO;
+    send.s = s;
+    send.buf = "hello";
+    send.len = 6;
+    send.addr.ip4 = mt_local;
+    send.port = short_be(5555);
+    if ((mt_call(&send) != &send) || (send.ret != 6))
+        return 3;
+
+    while (pico_mt_complete(mt_ctx) != &op)
+        sched_yield();
+    if ((op.ret != 1) || (ev[0].s != s) || (ev[0].data != &cookie) || !(ev[0].events & PICO_SOCK_EV_RD))
+        return 4;
+
+    memset(&op, 0, sizeof(op));
+    op.type = PICO_MT_RECVFROM;
+    op.s = s;
+    op.buf = buf;
+    op.len = sizeof(buf);
+    if ((mt_call(&op)->ret != 6) || strcmp(buf, "hello") || (op.addr.ip4.addr != mt_local.addr) || (op.port != short_be(5555)))
+        return 5;
+
+    op.type = PICO_MT_CLOSE;
+    if (mt_call(&op)->ret != 0)
+        return 6;
+
+    return 0;
+}
+
+static void *mt_app(void *arg)
+{
+    (void)arg;
+    mt_result = mt_echo();
+    __atomic_store_n(&mt_finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+START_TEST(tc_mt_udp)
+{
+    struct mock_device *mock;
+    struct pico_ip4 netmask;
+    pthread_t app;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.80.0.1", &mt_local.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock);
+    fail_if(pico_ipv4_link_add(mock->dev, mt_local, netmask) < 0);
+    mt_ctx = pico_mt_ctx_create(8);
+    fail_if(!mt_ctx);
+
+    mt_finished = 0;
+    fail_if(pthread_create(&app, NULL, mt_app, NULL) != 0);
+    while (!__atomic_load_n(&mt_finished, __ATOMIC_ACQUIRE)) {
+        pico_stack_tick();
+        sched_yield();
+    }
+    pthread_join(app, NULL);
+    fail_if(mt_result != 0, "step %d failed", mt_result);
+    pico_mt_ctx_destroy(mt_ctx);
+}
+END_TEST
+
+/* Frames received by a driver thread, through the lock free device queue */
+#define MT_RX_FRAMES 2000
+
+static struct pico_device *mt_rx_dev;
+
+static void *mt_driver(void *arg)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + 8 + 4];
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(buf + PICO_SIZE_IP4HDR);
+    int i;
+
+    (void)arg;
+    memset(buf, 0, sizeof(buf));
+    hdr->vhl = 0x45;
+    hdr->len = short_be(sizeof(buf));
+    hdr->ttl = 64;
+    hdr->proto = PICO_PROTO_UDP;
+    pico_string_to_ipv4("10.90.0.2", &hdr->src.addr);
+    pico_string_to_ipv4("10.90.0.1", &hdr->dst.addr);
+    hdr->crc = short_be(pico_checksum(hdr, PICO_SIZE_IP4HDR));
+    udp->trans.sport = short_be(6200);
+    udp->trans.dport = short_be(6200);
+    udp->len = short_be(8 + 4);
+    for (i = 0; i < MT_RX_FRAMES; i++) {
+        memcpy(buf + PICO_SIZE_IP4HDR + 8, &i, sizeof(i));
+        while (pico_stack_recv(mt_rx_dev, buf, sizeof(buf)) < 0)
+            sched_yield();
+    }
+    __atomic_store_n(&mt_finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+START_TEST(tc_mt_device_rx)
+{
+    struct mock_device *mock;
+    struct pico_socket *s;
+    struct pico_ip4 local, netmask;
+    uint16_t port = short_be(6200);
+    pthread_t driver;
+    int i, seq, received = 0;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.90.0.1", &local.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock);
+    mt_rx_dev = mock->dev;
+    fail_if(pico_ipv4_link_add(mt_rx_dev, local, netmask) < 0);
+    fail_if(pico_device_queues_spsc(mt_rx_dev, 6, 0) == 0);
+    fail_if(pico_device_queues_spsc(mt_rx_dev, 64, 0) != 0);
+    fail_if(pico_device_queues_spsc(mt_rx_dev, 64, 0) == 0);
+    s = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    fail_if(!s);
+    s->q_in.max_size = 0xFFFFFFFFu;
+    fail_if(pico_socket_bind(s, &local, &port) != 0);
+
+    mt_finished = 0;
+    fail_if(pthread_create(&driver, NULL, mt_driver, NULL) != 0);
+    while (!__atomic_load_n(&mt_finished, __ATOMIC_ACQUIRE) || mt_rx_dev->q_in->frames) {
+        pico_stack_tick();
+        while (pico_socket_recv(s, &seq, sizeof(seq)) == sizeof(seq)) {
+            fail_if(seq != received);
+            received++;
+        }
+        sched_yield();
+    }
+    pthread_join(driver, NULL);
+    for (i = 0; i < 10; i++)
+        pico_stack_tick();
+    while (pico_socket_recv(s, &seq, sizeof(seq)) == sizeof(seq))
+        received++;
+    fail_if(received != MT_RX_FRAMES, "received %d", received);
+    fail_if(mt_rx_dev->q_in->size != 0);
+    pico_socket_close(s);
+}
+END_TEST
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+    TCase *TCase_spsc_ring = tcase_create("Unit test for the lock free ring");
+    TCase *TCase_mt_backlog = tcase_create("Unit test for completions when the ring is full");
+    TCase *TCase_mt_udp = tcase_create("Unit test for UDP from another thread");
+    TCase *TCase_mt_device_rx = tcase_create("Unit test for frames received by another thread");
+
+    tcase_add_test(TCase_spsc_ring, tc_spsc_ring);
+    tcase_set_timeout(TCase_spsc_ring, 20);
+    suite_add_tcase(s, TCase_spsc_ring);
+    tcase_add_test(TCase_mt_backlog, tc_mt_backlog);
+    suite_add_tcase(s, TCase_mt_backlog);
+    tcase_add_test(TCase_mt_udp, tc_mt_udp);
+    tcase_set_timeout(TCase_mt_udp, 20);
+    suite_add_tcase(s, TCase_mt_udp);
+    tcase_add_test(TCase_mt_device_rx, tc_mt_device_rx);
+    tcase_set_timeout(TCase_mt_device_rx, 20);
+    suite_add_tcase(s, TCase_mt_device_rx);
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
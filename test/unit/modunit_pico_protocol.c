@@ -11,10 +11,6 @@ static struct pico_frame f = {
     .next = NULL
 };
 
-static struct pico_queue q = {
-    0
-};
-
 static struct pico_tree_node NODE_IN = {
     0
 };
@@ -77,10 +73,10 @@ static int modunit_proto_loop_cb_out(struct pico_protocol *self, struct pico_fra
 START_TEST(tc_proto_loop_in)
 {
     struct pico_protocol p = {
-        .process_in = modunit_proto_loop_cb_in, .q_in = &q
+        .process_in = modunit_proto_loop_cb_in
     };
     protocol_passby = 0;
-    pico_enqueue(p.q_in, &f);
+    pico_enqueue(&p.q_in, &f);
     fail_if(proto_loop_in(&p, 1) != 0);
     fail_if(protocol_passby != KEY_IN);
 
@@ -95,10 +91,10 @@ END_TEST
 START_TEST(tc_proto_loop_out)
 {
     struct pico_protocol p = {
-        .process_out = modunit_proto_loop_cb_out, .q_out = &q
+        .process_out = modunit_proto_loop_cb_out
     };
     protocol_passby = 0;
-    pico_enqueue(p.q_out, &f);
+    pico_enqueue(&p.q_out, &f);
     fail_if(proto_loop_out(&p, 1) != 0);
     fail_if(protocol_passby != KEY_OUT);
 
@@ -113,23 +109,75 @@ START_TEST(tc_proto_loop)
 {
     struct pico_protocol p = {
         .process_in = modunit_proto_loop_cb_in,
-        .process_out = modunit_proto_loop_cb_out,
-        .q_in = &q,
-        .q_out = &q
+        .process_out = modunit_proto_loop_cb_out
     };
     protocol_passby = 0;
-    pico_enqueue(p.q_in, &f);
+    pico_enqueue(&p.q_in, &f);
     fail_if(proto_loop(&p, 1, PICO_LOOP_DIR_IN) != 0);
     fail_if(protocol_passby != KEY_IN);
 
     protocol_passby = 0;
-    pico_enqueue(p.q_out, &f);
+    pico_enqueue(&p.q_out, &f);
     fail_if(proto_loop(&p, 1, PICO_LOOP_DIR_OUT) != 0);
     fail_if(protocol_passby != KEY_OUT);
 
 }
 END_TEST
 
+static int protocol_nested = 0;
+
+static int modunit_proto_receive_cb_in(struct pico_protocol *self, struct pico_frame *p)
+{
+    protocol_passby++;
+    if (protocol_nested-- > 0)
+        pico_protocol_receive(self, p); /* handed again to the same layer */
+
+    return 1;
+}
+
+START_TEST(tc_pico_protocol_receive)
+{
+    struct pico_protocol p = {
+        .process_in = modunit_proto_receive_cb_in
+    };
+    struct pico_frame rf = {
+        .buffer_len = 64
+    };
+
+    /* queued by default */
+    protocol_passby = 0;
+    fail_if(pico_protocol_receive(&p, &rf) <= 0);
+    fail_if(protocol_passby != 0 || p.q_in.frames != 1);
+    fail_if(proto_loop_in(&p, 1) != 0);
+    fail_if(protocol_passby != 1 || p.q_in.frames != 0);
+
+    /* processed at once in run-to-completion mode */
+    pico_protocol_run_to_completion(1);
+    protocol_passby = 0;
+    fail_if(pico_protocol_receive(&p, &rf) != 64);
+    fail_if(protocol_passby != 1 || p.q_in.frames != 0);
+
+    /* unless frames are waiting, which go first */
+    p.q_in.max_frames = 0;
+    pico_enqueue(&p.q_in, &f);
+    protocol_passby = 0;
+    fail_if(pico_protocol_receive(&p, &rf) <= 0);
+    fail_if(protocol_passby != 0 || p.q_in.frames != 2);
+    fail_if(proto_loop_in(&p, 2) != 0);
+    fail_if(protocol_passby != 2);
+
+    /* or the chain is too deep */
+    protocol_passby = 0;
+    protocol_nested = PICO_PROTOCOL_RTC_DEPTH + 2;
+    fail_if(pico_protocol_receive(&p, &rf) <= 0);
+    fail_if(protocol_passby != PICO_PROTOCOL_RTC_DEPTH || p.q_in.frames != 1);
+    fail_if(proto_rtc_depth != 0);
+    (void)pico_dequeue(&p.q_in);
+    pico_protocol_run_to_completion(0);
+    protocol_nested = 0;
+}
+END_TEST
+
 START_TEST(tc_pico_tree_node)
 {
     struct pico_proto_rr rr = {
@@ -190,6 +238,7 @@ Suite *pico_suite(void)
     TCase *TCase_roundrobin_end = tcase_create("Unit test for roundrobin_end");
     TCase *TCase_pico_protocol_generic_loop = tcase_create("Unit test for pico_protocol_generic_loop");
     TCase *TCase_proto_layer_rr_reset = tcase_create("Unit test for proto_layer_rr_reset");
+    TCase *TCase_pico_protocol_receive = tcase_create("Unit test for pico_protocol_receive");
 
 
     tcase_add_test(TCase_pico_proto_cmp, tc_pico_proto_cmp);
@@ -208,6 +257,8 @@ Suite *pico_suite(void)
     suite_add_tcase(s, TCase_pico_protocol_generic_loop);
     tcase_add_test(TCase_proto_layer_rr_reset, tc_proto_layer_rr_reset);
     suite_add_tcase(s, TCase_proto_layer_rr_reset);
+    tcase_add_test(TCase_pico_protocol_receive, tc_pico_protocol_receive);
+    suite_add_tcase(s, TCase_pico_protocol_receive);
     return s;
 }
 
@@ -0,0 +1,332 @@
+#include <pthread.h>
+#include <sched.h>
+#include "pico_config.h"
+#include "pico_stack.h"
+#include "pico_device.h"
+#include "pico_eth.h"
+#include "pico_ipv4.h"
+#include "pico_socket.h"
+#include "pico_shard.h"
+#include "modules/pico_shard.c"
+#include "check.h"
+
+Suite *pico_suite(void);
+
+#ifdef PICO_SUPPORT_SHARD
+
+#define SHARD_N        2
+#define SHARD_FLOWS    64
+
+static uint8_t shard_mac[PICO_SIZE_ETH] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x5a
+};
+static uint8_t shard_peer_mac[PICO_SIZE_ETH] = {
+    0x02, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+
+static uint8_t shard_buf[PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR + 8 + 16];
+
+/* An IPv4 frame from src to dst, UDP or TCP with the given ports, or ICMP
+ * of type sport */
+static uint32_t shard_frame(uint32_t src, uint32_t dst, uint8_t proto, uint16_t sport, uint16_t dport)
+{
+    struct pico_eth_hdr *eh = (struct pico_eth_hdr *)shard_buf;
+    struct pico_ipv4_hdr *ih = (struct pico_ipv4_hdr *)(shard_buf + PICO_SIZE_ETHHDR);
+    uint8_t *l4 = shard_buf + PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR;
+    uint16_t len = (uint16_t)(PICO_SIZE_IP4HDR + 8 + 16);
+
+    memset(shard_buf, 0, sizeof(shard_buf));
+    memcpy(eh->daddr, shard_mac, PICO_SIZE_ETH);
+    memcpy(eh->saddr, shard_peer_mac, PICO_SIZE_ETH);
+    eh->proto = PICO_IDETH_IPV4;
+    ih->vhl = 0x45;
+    ih->len = short_be(len);
+    ih->ttl = 64;
+    ih->proto = proto;
+    ih->src.addr = long_be(src);
+    ih->dst.addr = long_be(dst);
+    ih->crc = short_be(pico_checksum(ih, PICO_SIZE_IP4HDR));
+    if (proto == PICO_PROTO_ICMP4) {
+        l4[0] = (uint8_t)sport;
+    } else {
+        sport = short_be(sport);
+        dport = short_be(dport);
+        memcpy(l4, &sport, 2);
+        memcpy(l4 + 2, &dport, 2);
+        if (proto == PICO_PROTO_UDP) {
+            l4[5] = 8 + 16;
+        }
+    }
+
+    return (uint32_t)(PICO_SIZE_ETHHDR + len);
+}
+
+static uint32_t shard_arp_request(uint32_t target)
+{
+    struct pico_eth_hdr *eh = (struct pico_eth_hdr *)shard_buf;
+    uint8_t *a = shard_buf + PICO_SIZE_ETHHDR;
+    uint32_t spa = long_be(0x0A000002), tpa = long_be(target);
+    uint16_t v;
+
+    memset(shard_buf, 0, sizeof(shard_buf));
+    memset(eh->daddr, 0xff, PICO_SIZE_ETH);
+    memcpy(eh->saddr, shard_peer_mac, PICO_SIZE_ETH);
+    eh->proto = PICO_IDETH_ARP;
+    v = PICO_ARP_HTYPE_ETH;
+    memcpy(a, &v, 2);
+    v = PICO_IDETH_IPV4;
+    memcpy(a + 2, &v, 2);
+    a[4] = PICO_SIZE_ETH;
+    a[5] = 4;
+    v = PICO_ARP_REQUEST;
+    memcpy(a + 6, &v, 2);
+    memcpy(a + 8, shard_peer_mac, PICO_SIZE_ETH);
+    memcpy(a + 14, &spa, 4);
+    memcpy(a + 24, &tpa, 4);
+    return PICO_SIZE_ETHHDR + 28;
+}
+
+static int shard_nosend(struct pico_device *dev, void *buf, int len)
+{
+    (void)dev;
+    (void)buf;
+    return len;
+}
+
+START_TEST(tc_shard_steer)
+{
+    struct pico_shard_group *g;
+    union pico_address local;
+    uint32_t len, i;
+    int to, back;
+
+    fail_if(pico_shard_group_create(0, 64, shard_nosend) != NULL);
+    fail_if(pico_shard_group_create(PICO_SHARD_MAX + 1, 64, shard_nosend) != NULL);
+    fail_if(pico_shard_group_create(4, 48, shard_nosend) != NULL);
+    g = pico_shard_group_create(4, 64, shard_nosend);
+    fail_if(!g);
+    local.ip4.addr = long_be(0x0A000001);
+    fail_if(pico_shard_group_address(g, PICO_PROTO_IPV4, &local) != 0);
+
+    /* replicated: broadcast, ARP, ICMP other than echo requests */
+    len = shard_arp_request(0x0A000001);
+    fail_if(pico_shard_steer(g, shard_buf, len) != PICO_SHARD_ALL);
+    memcpy(shard_buf, shard_mac, PICO_SIZE_ETH);
+    fail_if(pico_shard_steer(g, shard_buf, len) != PICO_SHARD_ALL);
+    len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_ICMP4, PICO_ICMP_ECHOREPLY, 0);
+    fail_if(pico_shard_steer(g, shard_buf, len) != PICO_SHARD_ALL);
+    len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_ICMP4, PICO_ICMP_ECHO, 0);
+    fail_if(pico_shard_steer(g, shard_buf, len) != (int)(pico_flow_hash(shard_buf, len, 1) % 4));
+
+    /* local ports from PICO_SHARD_PORT_MIN up: owner of the port */
+    for (i = 0; i < 8; i++) {
+        len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_UDP, 53, (uint16_t)(PICO_SHARD_PORT_MIN + 1000 + i));
+        fail_if(pico_shard_steer(g, shard_buf, len) != (int)((PICO_SHARD_PORT_MIN + 1000 + i) % 4));
+        len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_TCP, 80, (uint16_t)(PICO_SHARD_PORT_MIN + 1000 + i));
+        fail_if(pico_shard_steer(g, shard_buf, len) != (int)((PICO_SHARD_PORT_MIN + 1000 + i) % 4));
+    }
+
+    /* below, and forwarded: by flow, both ways alike */
+    for (i = 0; i < SHARD_FLOWS; i++) {
+        len = shard_frame(0x0A000002 + i, 0x0A000001, PICO_PROTO_TCP, (uint16_t)(40000 + i), 80);
+        fail_if(pico_shard_steer(g, shard_buf, len) != (int)(pico_flow_hash(shard_buf, len, 1) % 4));
+        len = shard_frame(0xC0A80002 + i, 0x08080808, PICO_PROTO_TCP, (uint16_t)(1024 + i), 443);
+        to = pico_shard_steer(g, shard_buf, len);
+        len = shard_frame(0x08080808, 0xC0A80002 + i, PICO_PROTO_TCP, 443, (uint16_t)(1024 + i));
+        back = pico_shard_steer(g, shard_buf, len);
+        fail_if(to < 0 || to >= 4 || to != back);
+    }
+
+    /* not in a group: every port is ours */
+    fail_if(pico_shard_self() != -1);
+    fail_if(pico_shard_port_mine(short_be(1024)) != 1);
+    fail_if(pico_shard_port_hint(1024) != 1024);
+    fail_if(pico_shard_group_destroy(g) != 0);
+}
+END_TEST
+
+/* Two instances, each on a thread of its own, behind one shared device */
+static struct pico_shard_group *shard_group;
+static int shard_ready;
+static int shard_stop;
+static int shard_sent[SHARD_N];
+static int shard_rx[SHARD_N];
+static int shard_devices[SHARD_N];
+static uint16_t shard_port[SHARD_N];
+static struct pico_socket *shard_sock[SHARD_N][2];
+
+static int shard_send(struct pico_device *dev, void *buf, int len)
+{
+    (void)dev;
+    (void)buf;
+    shard_sent[pico_shard_self()]++;
+    return len;
+}
+
+static void shard_wakeup(uint16_t ev, struct pico_socket *s)
+{
+    uint8_t buf[64];
+    struct pico_ip4 orig;
+    uint16_t port;
+
+    if (ev & PICO_SOCK_EV_RD) {
+        while (pico_socket_recvfrom(s, buf, sizeof(buf), &orig, &port) > 0)
+            shard_rx[pico_shard_self()]++;
+    }
+}
+
+/* Run by each instance, on its own thread */
+static void shard_setup(struct pico_device *dev, void *arg)
+{
+    struct pico_ip4 addr, nm, any = {
+        0
+    };
+    uint16_t port = short_be(7);
+    int self = pico_shard_self();
+
+    (void)arg;
+    addr.addr = long_be(0x0A000001);
+    nm.addr = long_be(0xFFFFFF00);
+    fail_if(pico_ipv4_link_add(dev, addr, nm) != 0);
+
+    /* a listener per instance below PICO_SHARD_PORT_MIN */
+    shard_sock[self][0] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, shard_wakeup);
+    fail_if(!shard_sock[self][0]);
+    fail_if(pico_socket_bind(shard_sock[self][0], &any, &port) != 0);
+
+    /* and an ephemeral port of its own */
+    port = 0;
+    shard_sock[self][1] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, shard_wakeup);
+    fail_if(!shard_sock[self][1]);
+    fail_if(pico_socket_bind(shard_sock[self][1], &any, &port) != 0);
+    shard_port[self] = short_be(port);
+}
+
+static void *shard_instance(void *arg)
+{
+    uint32_t idx = (uint32_t)(uintptr_t)arg;
+    struct pico_device *dev;
+    struct pico_tree_node *index;
+    char name[MAX_DEVICE_NAME];
+
+    pico_stack_init();
+    snprintf(name, MAX_DEVICE_NAME, "shard%u", idx);
+    dev = pico_shard_attach(shard_group, idx, name, shard_mac);
+    if (!dev)
+        return NULL;
+
+    __atomic_fetch_add(&shard_ready, 1, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&shard_stop, __ATOMIC_SEQ_CST)) {
+        pico_stack_tick();
+        sched_yield();
+    }
+
+    /* the devices of the other instances are not seen here */
+    pico_tree_foreach(index, &Device_tree) {
+        shard_devices[idx]++;
+    }
+    pico_socket_close(shard_sock[idx][0]);
+    pico_socket_close(shard_sock[idx][1]);
+    pico_device_destroy(dev);
+    return NULL;
+}
+
+START_TEST(tc_shard_instances)
+{
+    pthread_t th[SHARD_N];
+    union pico_address local;
+    int expect[SHARD_N] = {
+        0
+    };
+    uint32_t i, len;
+    int to, spins;
+
+    shard_group = pico_shard_group_create(SHARD_N, 64, shard_send);
+    fail_if(!shard_group);
+    local.ip4.addr = long_be(0x0A000001);
+    fail_if(pico_shard_group_address(shard_group, PICO_PROTO_IPV4, &local) != 0);
+    for (i = 0; i < SHARD_N; i++)
+        fail_if(pthread_create(&th[i], NULL, shard_instance, (void *)(uintptr_t)i) != 0);
+
+    while (__atomic_load_n(&shard_ready, __ATOMIC_SEQ_CST) < SHARD_N)
+        sched_yield();
+
+    fail_if(pico_shard_group_call(shard_group, shard_setup, NULL) != 0);
+    while (pico_shard_group_pending(shard_group))
+        sched_yield();
+
+    /* to the ephemeral port of each instance */
+    for (i = 0; i < SHARD_N; i++) {
+        fail_if(shard_port[i] < PICO_SHARD_PORT_MIN);
+        fail_if((shard_port[i] % SHARD_N) != i);
+        len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_UDP, 53, shard_port[i]);
+        fail_if(pico_shard_steer(shard_group, shard_buf, len) != (int)i);
+        fail_if(pico_shard_group_recv(shard_group, shard_buf, len) != 1);
+        expect[i]++;
+    }
+
+    /* to the listeners, by flow */
+    for (i = 0; i < SHARD_FLOWS; i++) {
+        len = shard_frame(0x0A000002, 0x0A000001, PICO_PROTO_UDP, (uint16_t)(2000 + i), 7);
+        to = pico_shard_steer(shard_group, shard_buf, len);
+        fail_if(to < 0 || to >= SHARD_N);
+        expect[to]++;
+        while (pico_shard_group_recv(shard_group, shard_buf, len) < 0)
+            sched_yield();
+    }
+
+    /* ARP is seen, and answered, by every instance */
+    len = shard_arp_request(0x0A000001);
+    fail_if(pico_shard_group_recv(shard_group, shard_buf, len) != SHARD_N);
+
+    for (spins = 0; spins < 1000000; spins++) {
+        if ((__atomic_load_n(&shard_rx[0], __ATOMIC_SEQ_CST) == expect[0]) &&
+            (__atomic_load_n(&shard_rx[1], __ATOMIC_SEQ_CST) == expect[1]) &&
+            __atomic_load_n(&shard_sent[0], __ATOMIC_SEQ_CST) && __atomic_load_n(&shard_sent[1], __ATOMIC_SEQ_CST))
+            break;
+
+        sched_yield();
+    }
+
+    fail_if(pico_shard_group_destroy(shard_group) == 0);
+    __atomic_store_n(&shard_stop, 1, __ATOMIC_SEQ_CST);
+    for (i = 0; i < SHARD_N; i++)
+        pthread_join(th[i], NULL);
+
+    for (i = 0; i < SHARD_N; i++) {
+        fail_if(shard_rx[i] != expect[i]);
+        fail_if(shard_sent[i] < 1);
+        fail_if(shard_devices[i] != 1);
+    }
+    fail_if(pico_shard_group_destroy(shard_group) != 0);
+}
+END_TEST
+#endif
+
+Suite *pico_suite(void)
+{
+    Suite *s = suite_create("PicoTCP");
+
+#ifdef PICO_SUPPORT_SHARD
+    TCase *TCase_shard_steer = tcase_create("Unit test for the steering of the frames");
+    TCase *TCase_shard_instances = tcase_create("Unit test for instances on their own threads");
+
+    tcase_add_test(TCase_shard_steer, tc_shard_steer);
+    suite_add_tcase(s, TCase_shard_steer);
+    tcase_add_test(TCase_shard_instances, tc_shard_instances);
+    tcase_set_timeout(TCase_shard_instances, 20);
+    suite_add_tcase(s, TCase_shard_instances);
+#endif
+    return s;
+}
+
+int main(void)
+{
+    int fails;
+    Suite *s = pico_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    fails = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return fails;
+}
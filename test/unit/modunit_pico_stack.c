@@ -67,6 +67,197 @@ START_TEST(tc_calc_score)
 }
 END_TEST
 
+/* TCP segment from a:sport to b:dport, behind an ethernet header */
+static void flow_frame(uint8_t *buf, const char *a, uint16_t sport, const char *b, uint16_t dport)
+{
+    struct pico_eth_hdr *eth = (struct pico_eth_hdr *)buf;
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)(buf + PICO_SIZE_ETHHDR);
+    struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)(buf + PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR);
+
+    memset(buf, 0, PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR);
+    memset(eth->saddr, sport & 0xFF, PICO_SIZE_ETH);
+    memset(eth->daddr, dport & 0xFF, PICO_SIZE_ETH);
+    eth->proto = PICO_IDETH_IPV4;
+    hdr->vhl = 0x45;
+    hdr->proto = PICO_PROTO_TCP;
+    pico_string_to_ipv4(a, &hdr->src.addr);
+    pico_string_to_ipv4(b, &hdr->dst.addr);
+    tcp->trans.sport = short_be(sport);
+    tcp->trans.dport = short_be(dport);
+}
+
+START_TEST(tc_pico_flow_hash)
+{
+    uint8_t f1[PICO_SIZE_ETHHDR + PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR];
+    uint8_t f2[sizeof(f1)];
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)(f1 + PICO_SIZE_ETHHDR);
+    uint32_t h, i, hits[4] = { 0 };
+
+    /* both directions of a flow */
+    flow_frame(f1, "10.0.0.1", 1024, "10.0.0.2", 80);
+    flow_frame(f2, "10.0.0.2", 80, "10.0.0.1", 1024);
+    h = pico_flow_hash(f1, sizeof(f1), 1);
+    fail_if(h != pico_flow_hash(f2, sizeof(f2), 1));
+    fail_if(h != pico_flow_hash(f1 + PICO_SIZE_ETHHDR, sizeof(f1) - PICO_SIZE_ETHHDR, 0));
+
+    /* another port is another flow, a fragment has no ports */
+    flow_frame(f2, "10.0.0.2", 80, "10.0.0.1", 1025);
+    fail_if(h == pico_flow_hash(f2, sizeof(f2), 1));
+    hdr->frag = short_be(PICO_IPV4_MOREFRAG);
+    flow_frame(f2, "10.0.0.1", 1025, "10.0.0.2", 80);
+    ((struct pico_ipv4_hdr *)(f2 + PICO_SIZE_ETHHDR))->frag = short_be(PICO_IPV4_MOREFRAG);
+    fail_if(pico_flow_hash(f1, sizeof(f1), 1) != pico_flow_hash(f2, sizeof(f2), 1));
+
+    /* truncated and non IP frames */
+    fail_if(pico_flow_hash(f1, 4, 1) != 0);
+    fail_if(pico_flow_hash(f1, 4, 0) != 0);
+    flow_frame(f1, "10.0.0.1", 1024, "10.0.0.2", 80);
+    ((struct pico_eth_hdr *)f1)->proto = PICO_IDETH_ARP;
+    fail_if(pico_flow_hash(f1, sizeof(f1), 1) == 0);
+
+    /* flows spread over the buckets */
+    for (i = 0; i < 400; i++) {
+        flow_frame(f1, "10.0.0.1", (uint16_t)(1024 + i), "10.0.0.2", 80);
+        hits[pico_flow_hash(f1, sizeof(f1), 1) % 4]++;
+    }
+    for (i = 0; i < 4; i++)
+        fail_if((hits[i] < 60) || (hits[i] > 140), "bucket %u: %u", i, hits[i]);
+}
+END_TEST
+
+/* UDP datagram to 10.40.0.1:6300, as received by a non-ethernet device */
+static uint32_t rtc_datagram(uint8_t *buf)
+{
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(buf + PICO_SIZE_IP4HDR);
+
+    memset(buf, 0, PICO_SIZE_IP4HDR + 8 + 4);
+    hdr->vhl = 0x45;
+    hdr->len = short_be(PICO_SIZE_IP4HDR + 8 + 4);
+    hdr->ttl = 64;
+    hdr->proto = PICO_PROTO_UDP;
+    pico_string_to_ipv4("10.40.0.2", &hdr->src.addr);
+    pico_string_to_ipv4("10.40.0.1", &hdr->dst.addr);
+    hdr->crc = short_be(pico_checksum(hdr, PICO_SIZE_IP4HDR));
+    udp->trans.sport = short_be(6300);
+    udp->trans.dport = short_be(6300);
+    udp->len = short_be(8 + 4);
+    memcpy(buf + PICO_SIZE_IP4HDR + 8, "rtc", 4);
+    return PICO_SIZE_IP4HDR + 8 + 4;
+}
+
+START_TEST(tc_run_to_completion)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + 8 + 4];
+    struct pico_device *dev;
+    struct pico_socket *s;
+    struct pico_ip4 local, netmask;
+    uint16_t port = short_be(6300);
+    char data[8];
+
+    pico_stack_init();
+    dev = PICO_ZALLOC(sizeof(struct pico_device));
+    fail_if(!dev);
+    fail_if(pico_device_init(dev, "rtc0", NULL) != 0);
+    pico_string_to_ipv4("10.40.0.1", &local.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    fail_if(pico_ipv4_link_add(dev, local, netmask) < 0);
+    s = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    fail_if(!s);
+    fail_if(pico_socket_bind(s, &local, &port) != 0);
+
+    /* queued: the device loop leaves the datagram to the network layer */
+    fail_if(pico_stack_recv(dev, buf, rtc_datagram(buf)) <= 0);
+    pico_devices_loop(32, PICO_LOOP_DIR_IN);
+    fail_if(pico_socket_recv(s, data, sizeof(data)) != 0);
+    fail_if(pico_proto_ipv4.q_in.frames != 1);
+    pico_stack_tick();
+    fail_if(pico_socket_recv(s, data, sizeof(data)) != 4);
+
+    /* run to completion: the socket has it when the device loop returns */
+    pico_protocol_run_to_completion(1);
+    fail_if(pico_stack_recv(dev, buf, rtc_datagram(buf)) <= 0);
+    pico_devices_loop(32, PICO_LOOP_DIR_IN);
+    fail_if(pico_proto_ipv4.q_in.frames != 0);
+    fail_if(pico_proto_udp.q_in.frames != 0);
+    fail_if(pico_socket_recv(s, data, sizeof(data)) != 4);
+    fail_if(strcmp(data, "rtc") != 0);
+    pico_protocol_run_to_completion(0);
+
+    pico_socket_close(s);
+    pico_device_destroy(dev);
+}
+END_TEST
+
+/* delivers more than it is allowed to, every time */
+static int sched_greedy_poll(struct pico_device *dev, int loop_score)
+{
+    (void)dev;
+    return loop_score - 48;
+}
+
+START_TEST(tc_stack_sched)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + 8 + 4];
+    struct pico_sched_stats st;
+    struct pico_device *dev;
+    int i;
+
+    pico_stack_init();
+    fail_if(pico_stack_sched_mode(3) != -1);
+    fail_if(pico_stack_sched_mode(-1) != -1);
+    fail_if(pico_stack_sched_weights(0, 1) != -1);
+    fail_if(pico_stack_sched_weights(1, 9) != -1);
+    dev = PICO_ZALLOC(sizeof(struct pico_device));
+    fail_if(!dev);
+    fail_if(pico_device_init(dev, "sched0", NULL) != 0);
+    dev->q_in->max_frames = 0;
+    for (i = 0; i < 1200; i++)
+        fail_if(pico_stack_recv(dev, buf, rtc_datagram(buf)) <= 0);
+
+    /* one fixed quantum per tick, times the weight of the direction */
+    fail_if(pico_stack_sched_mode(PICO_SCHED_LATENCY) != 0);
+    pico_stack_sched_stats(NULL, 1);
+    pico_stack_tick();
+    pico_stack_sched_stats(&st, 1);
+    fail_if(st.ticks != 1);
+    fail_if(st.work[PICO_SCHED_PHASE_DEV_IN] != 32);
+    fail_if(pico_protocol_run_to_completion(0) != 0); /* left as it was */
+    fail_if(pico_stack_sched_weights(2, 1) != 0);
+    pico_stack_tick();
+    pico_stack_sched_stats(&st, 1);
+    fail_if(st.work[PICO_SCHED_PHASE_DEV_IN] != 64);
+    fail_if(pico_stack_sched_weights(1, 1) != 0);
+    fail_if(pico_stack_sched_mode(PICO_SCHED_THROUGHPUT) != 0);
+    pico_stack_tick();
+    pico_stack_sched_stats(&st, 1);
+    fail_if(st.work[PICO_SCHED_PHASE_DEV_IN] != 512);
+    pico_stack_tick();
+    pico_stack_tick();
+    pico_stack_sched_stats(&st, 0);
+    fail_if(st.ticks != 2);
+    fail_if(st.work[PICO_SCHED_PHASE_DEV_IN] != 1200 - 32 - 64 - 512);
+    fail_if(dev->q_in->frames != 0);
+
+    /* an overrun is paid back on the next ticks */
+    dev->poll = sched_greedy_poll;
+    fail_if(pico_stack_sched_mode(PICO_SCHED_LATENCY) != 0);
+    pico_stack_sched_stats(NULL, 1);
+    for (i = 0; i < 3; i++)
+        pico_stack_tick();
+    pico_stack_sched_stats(&st, 1);
+    fail_if(st.work[PICO_SCHED_PHASE_DEV_IN] != 2 * 48); /* not on the second tick */
+    dev->poll = NULL;
+
+    fail_if(pico_stack_sched_mode(PICO_SCHED_ADAPTIVE) != 0);
+    pico_stack_sched_stats(NULL, 1);
+    pico_stack_tick();
+    pico_stack_sched_stats(&st, 0);
+    fail_if(st.ticks != 1);
+    pico_device_destroy(dev);
+}
+END_TEST
+
 #ifdef PICO_FAULTY
 void fake_timer(pico_time __attribute__((unused)) now, void __attribute__((unused)) *n)
 {
@@ -107,6 +298,9 @@ Suite *pico_suite(void)
     TCase *TCase_pico_ethsend_dispatch = tcase_create("Unit test for pico_ethsend_dispatch");
     TCase *TCase_calc_score = tcase_create("Unit test for calc_score");
     TCase *TCase_stack_generic = tcase_create("GENERIC stack initialization unit test");
+    TCase *TCase_pico_flow_hash = tcase_create("Unit test for pico_flow_hash");
+    TCase *TCase_run_to_completion = tcase_create("Unit test for the run-to-completion receive path");
+    TCase *TCase_stack_sched = tcase_create("Unit test for the tick scheduler");
 
 
     tcase_add_test(TCase_pico_ll_receive, tc_pico_ll_receive);
@@ -129,6 +323,12 @@ Suite *pico_suite(void)
     suite_add_tcase(s, TCase_calc_score);
     tcase_add_test(TCase_stack_generic, tc_stack_generic);
     suite_add_tcase(s, TCase_stack_generic);
+    tcase_add_test(TCase_pico_flow_hash, tc_pico_flow_hash);
+    suite_add_tcase(s, TCase_pico_flow_hash);
+    tcase_add_test(TCase_run_to_completion, tc_run_to_completion);
+    suite_add_tcase(s, TCase_run_to_completion);
+    tcase_add_test(TCase_stack_sched, tc_stack_sched);
+    suite_add_tcase(s, TCase_stack_sched);
     return s;
 }
 
@@ -648,6 +648,411 @@ START_TEST(tc_checkRemoteClosing)
 }
 END_TEST
 
+START_TEST(tc_tcp_autotune)
+{
+    struct pico_socket_tcp *t = PICO_ZALLOC(sizeof(struct pico_socket_tcp));
+    fail_if(!t);
+    t->mss = 1460;
+    t->tcpq_in.max_size = PICO_DEFAULT_SOCKETQ;
+    t->tcpq_out.max_size = PICO_DEFAULT_SOCKETQ;
+    t->autotune = PICO_TCP_AUTOTUNE_RCV | PICO_TCP_AUTOTUNE_SND;
+    tcp_autotune_mem = 0;
+
+    /* Small window: nothing to do */
+    t->cwnd = 2;
+    tcp_autotune_sndbuf(t);
+    fail_if(t->tcpq_out.max_size != PICO_DEFAULT_SOCKETQ);
+    fail_if(tcp_autotune_mem != 0);
+
+    /* Send queue follows the congestion window */
+    t->cwnd = 40;
+    tcp_autotune_sndbuf(t);
+    fail_if(t->tcpq_out.max_size != 2u * 40u * 1460u);
+    fail_if(tcp_autotune_mem != t->tcpq_out.max_size - PICO_DEFAULT_SOCKETQ);
+
+    /* Never above the per-queue limit */
+    t->cwnd = 0xFFFF;
+    tcp_autotune_sndbuf(t);
+    fail_if(t->tcpq_out.max_size != PICO_TCP_AUTOTUNE_MAX);
+
+    /* Receive queue grows with what was consumed during the last RTT */
+    t->avg_rtt = 100;
+    t->rcv_space_time = TCP_TIME - 200;
+    t->rcv_space_seq = 1000;
+    t->rcv_processed = 1000 + PICO_DEFAULT_SOCKETQ;
+    tcp_autotune_rcvbuf(t);
+    fail_if(t->rcv_space != PICO_DEFAULT_SOCKETQ);
+    fail_if(t->tcpq_in.max_size != 2u * PICO_DEFAULT_SOCKETQ);
+    fail_if(t->rcv_space_seq != t->rcv_processed);
+
+    /* Not yet one RTT later: no new measurement */
+    t->rcv_processed += 4 * PICO_DEFAULT_SOCKETQ;
+    tcp_autotune_rcvbuf(t);
+    fail_if(t->tcpq_in.max_size != 2u * PICO_DEFAULT_SOCKETQ);
+
+    /* Growth is capped by the global budget */
+    tcp_autotune_mem = PICO_TCP_AUTOTUNE_BUDGET - 100;
+    t->rcv_space_time = TCP_TIME - 200;
+    tcp_autotune_rcvbuf(t);
+    fail_if(t->tcpq_in.max_size != 2u * PICO_DEFAULT_SOCKETQ + 100u);
+    fail_if(tcp_autotune_mem != PICO_TCP_AUTOTUNE_BUDGET);
+    tcp_autotune_mem = (t->tcpq_in.max_size - PICO_DEFAULT_SOCKETQ) + (t->tcpq_out.max_size - PICO_DEFAULT_SOCKETQ);
+
+    /* Idle connections shrink back, but keep what is queued */
+    t->tcpq_out.size = PICO_DEFAULT_SOCKETQ + 10;
+    t->ack_timestamp = TCP_TIME - PICO_TCP_AUTOTUNE_IDLE - 1;
+    tcp_autotune_idle(t, TCP_TIME);
+    fail_if(t->tcpq_in.max_size != PICO_DEFAULT_SOCKETQ);
+    fail_if(t->tcpq_out.max_size != PICO_DEFAULT_SOCKETQ + 10);
+    fail_if(tcp_autotune_mem != 10);
+    t->tcpq_out.size = 0;
+
+    /* Setting the buffer size by hand disables tuning and frees the budget */
+    pico_tcp_set_bufsize_out(&t->sock, 4096);
+    fail_if(tcp_autotune_mem != 0);
+    fail_if(t->autotune != PICO_TCP_AUTOTUNE_RCV);
+    t->cwnd = 40;
+    tcp_autotune_sndbuf(t);
+    fail_if(t->tcpq_out.max_size != 4096);
+    PICO_FREE(t);
+}
+END_TEST
+
+START_TEST(tc_tcp_pacing)
+{
+    struct pico_socket_tcp *t = PICO_ZALLOC(sizeof(struct pico_socket_tcp));
+    uint32_t rate;
+    fail_if(!t);
+    t->mss = 1000;
+
+    /* No RTT sample and no limit: not paced */
+    t->cwnd = 10;
+    fail_if(tcp_pacing_rate(t) != 0);
+    fail_if(tcp_pacing_hold(t, 0) != 0);
+
+    /* Slow start: twice cwnd per RTT */
+    t->avg_rtt = 100;
+    t->ssthresh = 20;
+    fail_if(tcp_pacing_rate(t) != 200000);
+
+    /* Congestion avoidance: 1.25 times cwnd per RTT */
+    t->ssthresh = 5;
+    fail_if(tcp_pacing_rate(t) != 125000);
+
+    /* Application limit */
+    pico_tcp_set_max_pacing_rate(&t->sock, 50000);
+    pico_tcp_get_max_pacing_rate(&t->sock, &rate);
+    fail_if(rate != 50000);
+    rate = tcp_pacing_rate(t);
+    fail_if(rate != 50000);
+    t->avg_rtt = 0;
+    fail_if(tcp_pacing_rate(t) != 50000);
+
+    /* 1000 bytes at 50 KB/s take 20 ms: the second segment has to wait */
+    fail_if(tcp_pacing_hold(t, rate) != 0);
+    tcp_pacing_update(t, rate, 1000);
+    fail_if(t->pacing_next < (TCP_TIME * 1000u) + 19000u);
+    fail_if(tcp_pacing_hold(t, rate) != 1);
+
+    /* Only one quantum of credit is allowed to build up */
+    t->pacing_next = 0;
+    tcp_pacing_update(t, rate, 10);
+    fail_if(t->pacing_next < (TCP_TIME * 1000u));
+    PICO_FREE(t);
+}
+END_TEST
+
+START_TEST(tc_tcp_fastopen)
+{
+    struct pico_socket_tcp *listen = (struct pico_socket_tcp *)pico_tcp_open(PICO_PROTO_IPV4);
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)pico_tcp_open(PICO_PROTO_IPV4);
+    struct pico_frame *f = pico_frame_alloc(80);
+    struct pico_tcp_hdr *hdr;
+    uint8_t cookie[PICO_TCP_FASTOPEN_COOKIE_SIZE], other[PICO_TCP_FASTOPEN_COOKIE_SIZE];
+    uint32_t val = 0;
+    uint32_t i;
+    uint16_t optsiz;
+    fail_if(!listen || !t || !f);
+
+    /* Cookies depend on the client address only */
+    t->sock.remote_addr.ip4.addr = long_be(0x0a000001);
+    tcp_fastopen_cookie(&t->sock, cookie);
+    tcp_fastopen_cookie(&t->sock, other);
+    fail_if(memcmp(cookie, other, PICO_TCP_FASTOPEN_COOKIE_SIZE) != 0);
+    t->sock.remote_addr.ip4.addr = long_be(0x0a000002);
+    tcp_fastopen_cookie(&t->sock, other);
+    fail_if(memcmp(cookie, other, PICO_TCP_FASTOPEN_COOKIE_SIZE) == 0);
+    t->sock.remote_addr.ip4.addr = long_be(0x0a000001);
+
+    /* Option in the SYN: written and parsed back */
+    memcpy(t->tfo_cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE);
+    t->tfo_cookie_len = PICO_TCP_FASTOPEN_COOKIE_SIZE;
+    t->tfo = PICO_TCP_TFO_SEND;
+    optsiz = tcp_options_size(t, PICO_TCP_SYN);
+    f->transport_hdr = f->start;
+    f->transport_len = (uint16_t)(PICO_SIZE_TCPHDR + optsiz + 10);
+    f->payload = f->transport_hdr + PICO_SIZE_TCPHDR + optsiz;
+    f->payload_len = 10;
+    memset(f->payload, 'd', f->payload_len);
+    f->sock = &t->sock;
+    hdr = (struct pico_tcp_hdr *)f->transport_hdr;
+    hdr->flags = PICO_TCP_SYN;
+    hdr->seq = long_be(1000);
+    hdr->len = (uint8_t)((PICO_SIZE_TCPHDR + optsiz) << 2);
+    tcp_add_options(t, f, PICO_TCP_SYN, optsiz);
+    t->tfo = 0;
+    memset(t->tfo_cookie, 0, PICO_TCP_FASTOPEN_COOKIE_MAX);
+    t->tfo_cookie_len = 0;
+    tcp_parse_options(f);
+    fail_if((t->tfo & PICO_TCP_TFO_OPTION) == 0);
+    fail_if(t->tfo_cookie_len != PICO_TCP_FASTOPEN_COOKIE_SIZE);
+    fail_if(memcmp(t->tfo_cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE) != 0);
+
+    /* Server disabled: nothing happens */
+    t->rcv_nxt = 1001;
+    tcp_fastopen_server(listen, t, f);
+    fail_if(t->tfo & (PICO_TCP_TFO_ACCEPTED | PICO_TCP_TFO_SEND));
+
+    /* Valid cookie: data is accepted with the SYN */
+    pico_tcp_set_fastopen(&listen->sock, 1);
+    pico_tcp_get_fastopen(&listen->sock, &val);
+    fail_if(val != 1);
+    tcp_fastopen_server(listen, t, f);
+    fail_if(!pico_tcp_fastopen_accepted(&t->sock));
+    fail_if(t->rcv_nxt != 1011);
+    fail_if(t->tfo_syn_len != 10);
+    fail_if(t->tcpq_in.size != 10);
+    fail_if(tcp_fastopen_pending != 1);
+    tcp_fastopen_release(t);
+    tcp_fastopen_release(t);
+    fail_if(tcp_fastopen_pending != 0);
+
+    /* Too many handshakes pending: the data waits for the regular handshake */
+    tcp_discard_all_segments(&t->tcpq_in);
+    tcp_fastopen_pending = PICO_TCP_FASTOPEN_MAX_PENDING;
+    t->tfo = PICO_TCP_TFO_OPTION;
+    t->rcv_nxt = 1001;
+    tcp_fastopen_server(listen, t, f);
+    fail_if(pico_tcp_fastopen_accepted(&t->sock));
+    fail_if(t->rcv_nxt != 1001);
+    fail_if(t->tcpq_in.size != 0);
+    tcp_fastopen_pending = 0;
+
+    /* Invalid cookie: a new one is sent back, data is not accepted */
+    t->tfo = PICO_TCP_TFO_OPTION;
+    t->tfo_cookie[0] ^= 0xFF;
+    t->rcv_nxt = 1001;
+    tcp_fastopen_server(listen, t, f);
+    fail_if(pico_tcp_fastopen_accepted(&t->sock));
+    fail_if((t->tfo & PICO_TCP_TFO_SEND) == 0);
+    fail_if(memcmp(t->tfo_cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE) != 0);
+    fail_if(t->rcv_nxt != 1001);
+
+    /* Client cache */
+    fail_if(tcp_fastopen_cache_find(&t->sock) != NULL);
+    tcp_fastopen_cache_add(&t->sock, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE);
+    fail_if(tcp_fastopen_cache_find(&t->sock) == NULL);
+    fail_if(memcmp(tcp_fastopen_cache_find(&t->sock)->cookie, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE) != 0);
+    tcp_fastopen_cache_del(&t->sock);
+    fail_if(tcp_fastopen_cache_find(&t->sock) != NULL);
+    for (i = 0; i < PICO_TCP_FASTOPEN_CACHE_SIZE + 4; i++) {
+        t->sock.remote_addr.ip4.addr = long_be(0x0b000000 + i);
+        tcp_fastopen_cache_add(&t->sock, cookie, PICO_TCP_FASTOPEN_COOKIE_SIZE);
+    }
+    fail_if(tcp_fastopen_entries != PICO_TCP_FASTOPEN_CACHE_SIZE);
+}
+END_TEST
+
+
+START_TEST(tc_tcp_sack_scoreboard)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)pico_tcp_open(PICO_PROTO_IPV4);
+    struct pico_frame *f;
+    uint32_t i;
+    fail_if(!t);
+    t->mss = 100;
+
+    /* Eight segments in flight: 1000 to 1800 */
+    for (i = 0; i < 8; i++) {
+        f = pico_frame_alloc(140);
+        fail_if(!f);
+        f->transport_hdr = f->start;
+        f->transport_len = 140;
+        f->payload = f->start + 40;
+        f->payload_len = 100;
+        ((struct pico_tcp_hdr *)f->transport_hdr)->seq = long_be(1000 + 100 * i);
+        fail_if(pico_enqueue_segment(&t->tcpq_out, f) <= 0);
+    }
+    t->x_mode = PICO_TCP_RECOVER;
+    t->in_flight = 8;
+
+    tcp_process_sack(t, 1200, 1300);
+    fail_if(t->sacked_bytes != 100);
+    fail_if(t->sack_high != 1300);
+    fail_if(t->in_flight != 7);
+    tcp_process_sack(t, 1400, 1600);
+    fail_if(t->sacked_bytes != 300);
+    fail_if(t->in_flight != 5);
+
+    /* Already known, out of range or empty blocks change nothing */
+    tcp_process_sack(t, 1400, 1500);
+    tcp_process_sack(t, 1700, 1900);
+    tcp_process_sack(t, 1500, 1500);
+    tcp_process_sack(t, 900, 1000);
+    fail_if(t->sacked_bytes != 300);
+    fail_if(t->in_flight != 5);
+
+    /* Filling the gap merges the ranges */
+    tcp_process_sack(t, 1300, 1400);
+    fail_if(t->sacked_bytes != 400);
+    fail_if(pico_tree_first(&t->sack_board) != pico_tree_last(&t->sack_board));
+    fail_if(tcp_sack_next_hole(t, 1250) != 1600);
+    fail_if(tcp_sack_next_hole(t, 1100) != 1100);
+
+    /* Holes below the highest SACKed byte are resent in order */
+    t->snd_retry = 1000;
+    f = tcp_sack_next_segment(t);
+    fail_if(!f || SEQN(f) != 1000);
+    t->snd_retry = 1100;
+    f = tcp_sack_next_segment(t);
+    fail_if(!f || SEQN(f) != 1100);
+    t->snd_retry = 1200;
+    fail_if(tcp_sack_next_segment(t) != NULL);
+
+    /* Cumulative ACKs trim the scoreboard */
+    tcp_sack_trim(t, 1250);
+    fail_if(t->sacked_bytes != 350);
+    tcp_sack_trim(t, 1700);
+    fail_if(t->sacked_bytes != 0);
+    fail_if(!pico_tree_empty(&t->sack_board));
+
+    /* No SACK information: the head of the queue is resent */
+    f = tcp_sack_next_segment(t);
+    fail_if(!f || SEQN(f) != 1000);
+
+    /* A block ending inside a segment: that segment is resent, not the
+     * head of the queue that was SACKed */
+    tcp_process_sack(t, 1000, 1250);
+    tcp_process_sack(t, 1400, 1500);
+    t->snd_retry = 1000;
+    f = tcp_sack_next_segment(t);
+    fail_if(!f || SEQN(f) != 1200);
+    t->snd_retry = 1300;
+    f = tcp_sack_next_segment(t);
+    fail_if(!f || SEQN(f) != 1300);
+    tcp_sack_clear(t);
+
+    tcp_process_sack(t, 1500, 1700);
+    tcp_sack_clear(t);
+    tcp_discard_all_segments(&t->tcpq_out);
+    fail_if(!pico_tree_empty(&t->sack_board));
+    fail_if(t->sacked_bytes != 0);
+    PICO_FREE(t);
+}
+END_TEST
+
+static struct pico_frame *tcp_predicted_frame(uint32_t seq, uint32_t ack, uint8_t flags, uint16_t rwnd, uint16_t len)
+{
+    struct pico_frame *f = pico_frame_alloc((uint32_t)(PICO_SIZE_TCPHDR + len));
+    struct pico_tcp_hdr *hdr;
+    if (!f)
+        return NULL;
+
+    f->transport_hdr = f->start;
+    f->transport_len = (uint16_t)(PICO_SIZE_TCPHDR + len);
+    f->payload = f->start + PICO_SIZE_TCPHDR;
+    f->payload_len = len;
+    hdr = (struct pico_tcp_hdr *)f->transport_hdr;
+    hdr->len = (uint8_t)((PICO_SIZE_TCPHDR >> 2) << 4);
+    hdr->seq = long_be(seq);
+    hdr->ack = long_be(ack);
+    hdr->flags = flags;
+    hdr->rwnd = short_be(rwnd);
+    memset(f->payload, 'a', len);
+    return f;
+}
+
+START_TEST(tc_tcp_input_predicted)
+{
+    struct pico_socket_tcp *t = (struct pico_socket_tcp *)pico_tcp_open(PICO_PROTO_IPV4);
+    struct pico_frame *f, *out;
+    uint8_t aligned[12] = {
+        1, 1, 8, 10, 0, 0, 0, 5, 0, 0, 0, 7
+    };
+    uint8_t pico[16] = {
+        3, 3, 2, 8, 10, 0, 0, 0, 6, 0, 0, 0, 8, 1, 1, 0
+    };
+    uint8_t ws[4] = {
+        3, 3, 2, 0
+    };
+    uint8_t sack[12] = {
+        1, 1, 5, 10, 0, 0, 0, 1, 0, 0, 0, 2
+    };
+    fail_if(!t);
+    t->sock.net = &pico_proto_ipv4;
+    t->sock.state = PICO_SOCKET_STATE_BOUND | PICO_SOCKET_STATE_CONNECTED | PICO_SOCKET_STATE_TCP_ESTABLISHED;
+    t->rcv_nxt = 5000;
+    t->snd_nxt = 1000;
+    t->recv_wnd = 1000;
+    t->recv_wnd_scale = 2;
+    t->cwnd = 10;
+
+    /* Options */
+    f = tcp_predicted_frame(5000, 1000, PICO_TCP_ACK, 1000, 0);
+    fail_if(!f);
+    fail_if(tcp_input_predicted_options(t, f, aligned, 12) != -1);
+    t->ts_ok = 1;
+    fail_if(tcp_input_predicted_options(t, f, aligned, 12) != 0);
+    fail_if(t->ts_nxt != 5 || f->timestamp != 7);
+    fail_if(tcp_input_predicted_options(t, f, pico, 16) != 0);
+    fail_if(t->ts_nxt != 6 || f->timestamp != 8);
+    fail_if(tcp_input_predicted_options(t, f, ws, 4) != 0);
+    fail_if(f->timestamp != 0);
+    fail_if(tcp_input_predicted_options(t, f, sack, 12) != -1);
+    t->recv_wnd_scale = 3;
+    fail_if(tcp_input_predicted_options(t, f, ws, 4) != -1);
+    fail_if(tcp_input_predicted_options(t, f, pico, 16) != -1);
+    t->recv_wnd_scale = 2;
+    pico_frame_discard(f);
+
+    /* In-order data while nothing is outstanding */
+    f = tcp_predicted_frame(5000, 1000, PICO_TCP_ACK | PICO_TCP_PSH, 1000, 10);
+    fail_if(tcp_input_predicted(t, f) != 10);
+    fail_if(t->rcv_nxt != 5010);
+    fail_if(t->tcpq_in.size != 10);
+    out = pico_dequeue(&pico_proto_tcp.q_out);
+    fail_if(!out);
+    pico_frame_discard(out);
+
+    /* Out of order, window update, unexpected flags: full path */
+    fail_if(tcp_input_predicted(t, f) != -1);
+    pico_frame_discard(f);
+    f = tcp_predicted_frame(5010, 1000, PICO_TCP_ACK, 2000, 10);
+    fail_if(tcp_input_predicted(t, f) != -1);
+    pico_frame_discard(f);
+    f = tcp_predicted_frame(5010, 1000, PICO_TCP_ACK | PICO_TCP_FIN, 1000, 0);
+    fail_if(tcp_input_predicted(t, f) != -1);
+    pico_frame_discard(f);
+
+    /* Pure ACKs, and data while something is outstanding: full path */
+    f = tcp_predicted_frame(1000, 5010, PICO_TCP_ACK, 1000, 100);
+    fail_if(pico_enqueue_segment(&t->tcpq_out, f) <= 0);
+    t->snd_nxt = 1100;
+    t->in_flight = 1;
+    out = tcp_predicted_frame(5010, 1100, PICO_TCP_ACK, 1000, 0);
+    fail_if(tcp_input_predicted(t, out) != -1);
+    fail_if(t->tcpq_out.frames != 1);
+    pico_frame_discard(out);
+    out = tcp_predicted_frame(5010, 1100, PICO_TCP_ACK, 1000, 10);
+    fail_if(tcp_input_predicted(t, out) != -1);
+    fail_if(t->rcv_nxt != 5010);
+    pico_frame_discard(out);
+
+    tcp_discard_all_segments(&t->tcpq_out);
+    tcp_discard_all_segments(&t->tcpq_in);
+    PICO_FREE(t);
+}
+END_TEST
 
 Suite *pico_suite(void)
 {
@@ -715,6 +1120,11 @@ Suite *pico_suite(void)
     TCase *TCase_invalid_flags = tcase_create("Unit test for invalid_flags");
     TCase *TCase_checkLocalClosing = tcase_create("Unit test for checkLocalClosing");
     TCase *TCase_checkRemoteClosing = tcase_create("Unit test for checkRemoteClosing");
+    TCase *TCase_tcp_autotune = tcase_create("Unit test for tcp buffer auto-tuning");
+    TCase *TCase_tcp_pacing = tcase_create("Unit test for tcp pacing");
+    TCase *TCase_tcp_fastopen = tcase_create("Unit test for tcp fast open");
+    TCase *TCase_tcp_sack_scoreboard = tcase_create("Unit test for tcp sack scoreboard");
+    TCase *TCase_tcp_input_predicted = tcase_create("Unit test for tcp header prediction");
 
 
     tcase_add_test(TCase_input_segment_compare, tc_input_segment_compare);
@@ -841,6 +1251,16 @@ Suite *pico_suite(void)
     suite_add_tcase(s, TCase_checkLocalClosing);
     tcase_add_test(TCase_checkRemoteClosing, tc_checkRemoteClosing);
     suite_add_tcase(s, TCase_checkRemoteClosing);
+    tcase_add_test(TCase_tcp_autotune, tc_tcp_autotune);
+    suite_add_tcase(s, TCase_tcp_autotune);
+    tcase_add_test(TCase_tcp_pacing, tc_tcp_pacing);
+    suite_add_tcase(s, TCase_tcp_pacing);
+    tcase_add_test(TCase_tcp_fastopen, tc_tcp_fastopen);
+    suite_add_tcase(s, TCase_tcp_fastopen);
+    tcase_add_test(TCase_tcp_sack_scoreboard, tc_tcp_sack_scoreboard);
+    suite_add_tcase(s, TCase_tcp_sack_scoreboard);
+    tcase_add_test(TCase_tcp_input_predicted, tc_tcp_input_predicted);
+    suite_add_tcase(s, TCase_tcp_input_predicted);
     return s;
 }
 
@@ -1,3 +1,5 @@
+#include <pthread.h>
+#include <sched.h>
 #include "pico_frame.h"
 #include "pico_queue.h"
 #include "stack/pico_frame.c"
@@ -61,14 +63,91 @@ START_TEST(tc_q)
 }
 END_TEST
 
+#define SPSC_FRAMES 20000u
+
+static struct pico_queue q3 = {
+    0
+};
+
+static void *spsc_producer(void *arg)
+{
+    struct pico_frame *f;
+    uint32_t i;
+
+    (void)arg;
+    for (i = 0; i < SPSC_FRAMES; i++) {
+        f = pico_frame_alloc(100);
+        memcpy(f->buffer, &i, sizeof(i));
+        while (pico_enqueue(&q3, f) < 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+START_TEST(tc_q_spsc)
+{
+    struct pico_frame *f[5];
+    pthread_t producer;
+    uint32_t i, seq;
+    int j;
+
+    for (j = 0; j < 5; j++)
+        f[j] = pico_frame_alloc(100);
+
+    fail_if(pico_queue_spsc(&q3, 3) == 0);
+    fail_if(pico_queue_spsc(&q3, 4) != 0);
+    fail_if(pico_queue_spsc(&q3, 4) == 0);
+
+    /* same accounting as the list, bounded by the ring */
+    for (j = 0; j < 4; j++)
+        fail_if(pico_enqueue(&q3, f[j]) != (j + 1) * 100);
+    fail_if(pico_enqueue(&q3, f[4]) >= 0);
+    fail_if(q3.frames != 4 || q3.size != 400);
+    fail_if(pico_queue_peek(&q3) != f[0]);
+    for (j = 0; j < 4; j++)
+        fail_if(pico_dequeue(&q3) != f[j]);
+    fail_if(pico_dequeue(&q3) != NULL);
+    fail_if(q3.frames != 0 || q3.size != 0);
+    q3.max_frames = 2;
+    fail_if(pico_enqueue(&q3, f[0]) < 0);
+    fail_if(pico_enqueue(&q3, f[1]) < 0);
+    fail_if(pico_enqueue(&q3, f[2]) >= 0);
+    pico_queue_empty(&q3);
+    fail_if(q3.frames != 0 || q3.size != 0);
+    pico_frame_discard(f[2]);
+    pico_frame_discard(f[3]);
+    pico_frame_discard(f[4]);
+    pico_queue_deinit(&q3);
+    fail_if(q3.ring);
+
+    /* across threads: in order, nothing lost */
+    q3.max_frames = 0;
+    fail_if(pico_queue_spsc(&q3, 64) != 0);
+    fail_if(pthread_create(&producer, NULL, spsc_producer, NULL) != 0);
+    for (i = 0; i < SPSC_FRAMES; i++) {
+        while ((f[0] = pico_dequeue(&q3)) == NULL)
+            sched_yield();
+        memcpy(&seq, f[0]->buffer, sizeof(seq));
+        fail_if(seq != i);
+        pico_frame_discard(f[0]);
+    }
+    pthread_join(producer, NULL);
+    fail_if(q3.frames != 0 || q3.size != 0);
+    pico_queue_deinit(&q3);
+}
+END_TEST
+
 
 Suite *pico_suite(void)
 {
     Suite *s = suite_create("Packet Queues");
 
     TCase *TCase_q = tcase_create("Unit test for pico_queue.c");
+    TCase *TCase_q_spsc = tcase_create("Unit test for the lock free mode of pico_queue");
     tcase_add_test(TCase_q, tc_q);
     suite_add_tcase(s, TCase_q);
+    tcase_add_test(TCase_q_spsc, tc_q_spsc);
+    suite_add_tcase(s, TCase_q_spsc);
     return s;
 }
 
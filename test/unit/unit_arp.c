@@ -23,17 +23,37 @@ START_TEST (arp_update_max_arp_reqs_test)
 }
 END_TEST
 
-START_TEST (arp_compare_test)
+START_TEST (arp_table_test)
 {
-    struct pico_arp a, b;
-    char ipstr[] = "192.168.1.1";
+    struct pico_ip4 ip;
+    struct pico_arp *a;
+    uint8_t mac[6] = {
+        0, 0, 0, 0xa, 0xb, 0
+    };
+    uint32_t i;
 
-    memset(&a, 0, sizeof(a));
-    pico_string_to_ipv4(ipstr, &b.ipv4.addr);
+    pico_stack_init();
+    /* More entries than buckets, so that chains are walked */
+    for (i = 0; i < 4 * PICO_ARP_HASH_SIZE; i++) {
+        ip.addr = long_be(0x0A280000 + i);
+        mac[5] = (uint8_t)i;
+        fail_if(pico_arp_create_entry(mac, ip, NULL) < 0);
+    }
+    for (i = 0; i < 4 * PICO_ARP_HASH_SIZE; i++) {
+        ip.addr = long_be(0x0A280000 + i);
+        a = pico_arp_find(ip.addr);
+        fail_if(!a);
+        fail_unless(a->ipv4.addr == ip.addr);
+        fail_unless(a->eth.addr[5] == (uint8_t)i);
+    }
+    mac[5] = 7;
+    fail_unless(pico_arp_reverse_lookup((struct pico_eth *)mac)->addr == long_be(0x0A280007));
 
-    fail_unless(arp_compare(&a, &b) == -1);
-    fail_unless(arp_compare(&b, &a) == 1);
-    fail_unless(arp_compare(&a, &a) == 0);
+    ip.addr = long_be(0x0A280007);
+    pico_arp_del(pico_arp_find(ip.addr));
+    fail_unless(pico_arp_lookup(&ip) == NULL);
+    ip.addr = long_be(0x0A280008);
+    fail_unless(pico_arp_lookup(&ip) != NULL);
 }
 END_TEST
 
@@ -44,6 +64,7 @@ START_TEST (arp_lookup_test)
     char ipstr[] = "192.168.1.1";
     struct pico_arp entry;
 
+    memset(&entry, 0, sizeof(entry));
     eth = pico_arp_lookup(&ip);
     fail_unless(eth == NULL);
 
@@ -52,8 +73,13 @@ START_TEST (arp_lookup_test)
 
     pico_stack_init();
     pico_arp_add_entry(&entry);
+    fail_unless(pico_arp_lookup(&ip) == &entry.eth);
+    /* A stale address is still usable, an unresolved one is not */
     entry.arp_status = PICO_ARP_STATUS_STALE;
     eth = pico_arp_lookup(&ip);
+    fail_unless(eth == &entry.eth);
+    entry.arp_status = PICO_ARP_STATUS_INCOMPLETE;
+    eth = pico_arp_lookup(&ip);
     fail_unless(eth == NULL);
 }
 END_TEST
@@ -61,40 +87,123 @@ END_TEST
 START_TEST (arp_expire_test)
 {
     struct pico_arp entry;
+    memset(&entry, 0, sizeof(entry));
     entry.arp_status = PICO_ARP_STATUS_REACHABLE;
     entry.timestamp = 0;
 
+    pico_stack_init();
     arp_expire(PICO_ARP_TIMEOUT, &entry);
     fail_unless(entry.arp_status == PICO_ARP_STATUS_STALE);
+    pico_arp_timer_stop(&entry);
 }
 END_TEST
 
+static struct pico_frame *arp_ipv4_frame(struct pico_device *dev, struct pico_ip4 src, struct pico_ip4 dst)
+{
+    struct pico_frame *f = pico_frame_alloc(PICO_SIZE_ETHHDR + sizeof(struct pico_ipv4_hdr));
+    struct pico_ipv4_hdr *hdr;
+    fail_if(!f);
+    f->datalink_hdr = f->start;
+    f->net_hdr = f->start + PICO_SIZE_ETHHDR;
+    f->dev = dev;
+    hdr = (struct pico_ipv4_hdr *) f->net_hdr;
+    hdr->src.addr = src.addr;
+    hdr->dst.addr = dst.addr;
+    return f;
+}
+
+static void arp_reply(struct pico_device *dev, uint8_t *mac, struct pico_ip4 src, struct pico_ip4 dst)
+{
+    struct pico_frame *f = init_frame(dev);
+    struct pico_arp_hdr *ah = (struct pico_arp_hdr *) f->net_hdr;
+    ah->htype  = PICO_ARP_HTYPE_ETH;
+    ah->ptype  = PICO_IDETH_IPV4;
+    ah->hsize  = PICO_SIZE_ETH;
+    ah->psize  = PICO_SIZE_IP4;
+    ah->opcode = PICO_ARP_REPLY;
+    memcpy(ah->s_mac, mac, PICO_SIZE_ETH);
+    ah->src.addr = src.addr;
+    ah->dst.addr = dst.addr;
+    fail_unless(pico_arp_receive(f) == 0);
+}
+
 START_TEST(tc_pico_arp_queue)
 {
-    struct pico_ip4 addr = {
-        .addr = 0xaabbccdd
+    struct mock_device *mock;
+    struct pico_frame *f;
+    struct pico_arp *a;
+    uint8_t macaddr1[6] = {
+        0, 0, 0, 0xa, 0xb, 0xf
+    };
+    uint8_t macaddr2[6] = {
+        0, 0, 0, 0xc, 0xd, 0xf
+    };
+    struct pico_ip4 netmask = {
+        .addr = long_be(0xffffff00)
+    };
+    struct pico_ip4 ip1 = {
+        .addr = long_be(0x0A28000A)
+    };
+    struct pico_ip4 ip2 = {
+        .addr = long_be(0x0A28000B)
+    };
+    struct pico_ip4 ip3 = {
+        .addr = long_be(0x0A28000C)
     };
     int i;
-    struct pico_frame *f = pico_frame_alloc(sizeof(struct pico_ipv4_hdr));
-    struct pico_ipv4_hdr *h = (struct pico_ipv4_hdr *) f->buffer;
-    fail_if(!f);
-    f->net_hdr = h;
-    h->dst.addr = addr.addr;
 
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued[i] != NULL);
-    }
-    pico_arp_unreachable(&addr);
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued[i] != NULL);
+    pico_stack_init();
+    mock = pico_mock_create(macaddr1);
+    fail_if(!mock, "MOCK DEVICE creation failed");
+    fail_if(pico_ipv4_link_add(mock->dev, ip1, netmask), "add link to mock device failed");
+
+    /* A burst to a new neighbor is parked on its entry, up to the limit */
+    for (i = 0; i < PICO_ARP_MAX_PENDING + 4; i++) {
+        f = arp_ipv4_frame(mock->dev, ip1, ip2);
+        fail_unless(pico_arp_get(f) == NULL);
+        pico_arp_postpone(f);
+        pico_frame_discard(f);
     }
+    a = pico_arp_find(ip2.addr);
+    fail_if(!a);
+    fail_unless(a->arp_status == PICO_ARP_STATUS_INCOMPLETE);
+    fail_unless(a->pending_count == PICO_ARP_MAX_PENDING);
+    fail_unless(a->probes == 1);
+
+    /* Traffic to another neighbor is not released by the reply */
+    f = arp_ipv4_frame(mock->dev, ip1, ip3);
+    fail_unless(pico_arp_get(f) == NULL);
     pico_arp_postpone(f);
-    fail_if(frames_queued[0]->buffer != f->buffer);
-    pico_arp_unreachable(&addr);
-    for (i = 0; i < PICO_ND_MAX_FRAMES_QUEUED; i++) {
-        fail_if(frames_queued[i] != NULL);
-    }
-    PICO_FREE(f);
+    pico_frame_discard(f);
+
+    arp_reply(mock->dev, macaddr2, ip2, ip1);
+    fail_unless(a->arp_status == PICO_ARP_STATUS_REACHABLE);
+    fail_unless(a->pending == NULL);
+    fail_unless(mock->dev->q_out->frames == PICO_ARP_MAX_PENDING);
+    fail_unless(pico_arp_find(ip3.addr)->pending_count == 1);
+
+    f = arp_ipv4_frame(mock->dev, ip1, ip2);
+    fail_unless(pico_arp_get(f) == &a->eth);
+    fail_unless(memcmp(a->eth.addr, macaddr2, PICO_SIZE_ETH) == 0);
+
+    /* A stale neighbor is used while being probed */
+    a->arp_status = PICO_ARP_STATUS_STALE;
+    fail_unless(pico_arp_get(f) == &a->eth);
+    fail_unless(a->arp_status == PICO_ARP_STATUS_PROBE);
+    arp_reply(mock->dev, macaddr2, ip2, ip1);
+    fail_unless(a->arp_status == PICO_ARP_STATUS_REACHABLE);
+    pico_frame_discard(f);
+
+    /* Unanswered neighbor: frames dropped, entry removed */
+    a = pico_arp_find(ip3.addr);
+    pico_arp_timer_stop(a);
+    a->probes = PICO_ARP_MAX_PROBES;
+    arp_retry(PICO_TIME_MS(), a);
+    fail_unless(pico_arp_find(ip3.addr) == NULL);
+    f = arp_ipv4_frame(mock->dev, ip1, ip3);
+    fail_unless(pico_arp_get(f) == NULL);
+    fail_unless(pico_arp_find(ip3.addr)->arp_status == PICO_ARP_STATUS_INCOMPLETE);
+    pico_frame_discard(f);
 }
 END_TEST
 
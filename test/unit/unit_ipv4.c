@@ -106,7 +106,7 @@ START_TEST (test_nat_enable_disable)
     pico_stack_init();
 
     fail_if(pico_ipv4_nat_enable(&link));
-    fail_unless(nat_link->address.addr == link.address.addr);
+    fail_unless(pico_ipv4_nat_link_find(&link.address)->link == &link);
     fail_unless(pico_ipv4_nat_is_enabled(&link.address));
 
     fail_if(pico_ipv4_nat_outbound(f, &net->dst));
@@ -164,14 +164,14 @@ START_TEST (test_nat_translation)
     fail_if(pico_ipv4_nat_enable(&link));
 
     /* perform outbound translation, check if source IP got translated */
-    fail_if(pico_ipv4_nat_outbound(f, &nat_link->address));
+    fail_if(pico_ipv4_nat_outbound(f, &link.address));
     fail_if(net->src.addr != link.address.addr, "source address not translated");
 
     /* perform outbound translation of same packet, check if source IP and PORT got translated the same as previous packet */
     nat_port = udp->trans.sport;
     net->src = src_ori; /* restore original src */
     udp->trans.sport = sport_ori; /* restore original sport */
-    fail_if(pico_ipv4_nat_outbound(f, &nat_link->address));
+    fail_if(pico_ipv4_nat_outbound(f, &link.address));
     fail_if(net->src.addr != link.address.addr, "source address not translated");
     fail_if(udp->trans.sport != nat_port, "frames with the same source IP, source PORT and PROTO did not get translated the same");
 
@@ -179,7 +179,7 @@ START_TEST (test_nat_translation)
     nat_port = udp->trans.sport;
     net->src = src_ori; /* restore original src */
     udp->trans.sport = short_be(5556); /* change sport */
-    fail_if(pico_ipv4_nat_outbound(f, &nat_link->address));
+    fail_if(pico_ipv4_nat_outbound(f, &link.address));
     fail_if(net->src.addr != link.address.addr, "source address not translated");
     fail_if(udp->trans.sport == short_be(sport_ori), "two frames with different sport get translated the same");
 
@@ -189,7 +189,7 @@ START_TEST (test_nat_translation)
     net->dst = nat;
     udp->trans.sport = sport_ori;
     udp->trans.dport = nat_port;
-    fail_if(pico_ipv4_nat_inbound(f, &nat_link->address));
+    fail_if(pico_ipv4_nat_inbound(f, &link.address));
     fail_if(net->dst.addr != src_ori.addr, "destination address not translated correctly");
     fail_if(udp->trans.dport != short_be(5556), "ports not translated correctly");
     pico_ipv4_nat_table_cleanup(pico_tick, NULL);
@@ -246,7 +246,7 @@ START_TEST (test_nat_port_forwarding)
 
     fail_if(pico_ipv4_port_forward(nat_addr, fport_pub, src_addr, fport_priv, 17, PICO_NAT_PORT_FORWARD_ADD));
 
-    fail_if(pico_ipv4_nat_inbound(f, &nat_link->address));
+    fail_if(pico_ipv4_nat_inbound(f, &link.address));
     fail_if(net->dst.addr != src_addr.addr, "destination address not translated correctly");
     fail_if(udp->trans.dport != fport_priv, "destination port not translated correctly");
 
@@ -255,6 +255,243 @@ START_TEST (test_nat_port_forwarding)
 }
 END_TEST
 
+START_TEST (test_nat_expiry)
+{
+    struct pico_ip4 src_addr, dst_addr = {
+        .addr = long_be(0x0a320009)
+    };
+    struct pico_ip4 nat_addr = {
+        .addr = long_be(0x0a320001)
+    };
+    pico_time start;
+    uint32_t i;
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> NAT EXPIRY TEST\n");
+    pico_stack_init();
+    start = pico_tick;
+
+    for (i = 0; i < 1000; i++) {
+        src_addr.addr = long_be(0x0a280000 + i);
+        fail_if(!pico_ipv4_nat_add(dst_addr, short_be(53), src_addr, short_be(5555), nat_addr, short_be((uint16_t)(2000 + i)), PICO_PROTO_UDP));
+    }
+    fail_if(nat_table.count != 1000);
+    fail_if(nat_table.size < (1000 / PICO_NAT_HASH_LOAD));
+    fail_if(pico_ipv4_nat_add(dst_addr, short_be(53), src_addr, short_be(5555), nat_addr, short_be(1999), PICO_PROTO_UDP));
+    fail_if(pico_ipv4_nat_add(dst_addr, short_be(53), src_addr, short_be(5556), nat_addr, short_be(2999), PICO_PROTO_UDP));
+    for (i = 0; i < 1000; i++) {
+        src_addr.addr = long_be(0x0a280000 + i);
+        fail_unless(pico_ipv4_nat_find(short_be((uint16_t)(2000 + i)), NULL, 0, PICO_PROTO_UDP));
+        fail_unless(pico_ipv4_nat_find(0, &src_addr, short_be(5555), PICO_PROTO_UDP));
+    }
+    fail_if(pico_ipv4_port_forward(nat_addr, short_be(80), dst_addr, short_be(8080), PICO_PROTO_TCP, PICO_NAT_PORT_FORWARD_ADD));
+
+    /* Idle sessions expire, lazily on lookup or when their bucket is swept */
+    pico_tick = start + PICO_NAT_TIMEWAIT + 1;
+    fail_if(pico_ipv4_nat_find(short_be(2000), NULL, 0, PICO_PROTO_UDP));
+    fail_if(nat_table.count >= 1001);
+    for (i = 0; i < PICO_NAT_SWEEP_SLICES; i++)
+        pico_ipv4_nat_table_cleanup(pico_tick, NULL);
+    fail_if(nat_table.count != 1);
+
+    /* Port forwarding never expires */
+    fail_unless(pico_ipv4_nat_find(short_be(80), NULL, 0, PICO_PROTO_TCP));
+    fail_if(pico_ipv4_port_forward(nat_addr, short_be(80), dst_addr, short_be(8080), PICO_PROTO_TCP, PICO_NAT_PORT_FORWARD_DEL));
+    fail_if(nat_table.count != 0);
+}
+END_TEST
+
+START_TEST (test_nat_untracked)
+{
+    struct pico_ipv4_link link = {
+        .address = {.addr = long_be(0x0a320001)}
+    };                                                                       /* 10.50.0.1 */
+    struct pico_frame *f = pico_ipv4_alloc(&pico_proto_ipv4, PICO_SIZE_TCPHDR);
+    struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct pico_tcp_hdr *tcp = (struct pico_tcp_hdr *)f->transport_hdr;
+    struct pico_ip4 src_ori = {
+        .addr = long_be(0x0a280008)
+    };                                                      /* 10.40.0.8 */
+    struct pico_ip4 peer = {
+        .addr = long_be(0x08080808)
+    };
+    struct pico_nat_tuple *t;
+    uint16_t nat_port;
+    uint32_t i;
+
+    net->vhl = 0x45;
+    net->len = short_be(PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR);
+    net->ttl = 64;
+    f->payload = f->transport_hdr + PICO_SIZE_TCPHDR;
+    f->payload_len = 0;
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> NAT UNTRACKED TEST\n");
+    pico_stack_init();
+    fail_if(pico_ipv4_nat_enable(&link));
+
+    /* fill the connection table */
+    net->proto = PICO_PROTO_UDP;
+    net->dst = peer;
+    tcp->trans.sport = short_be(5555);
+    tcp->trans.dport = short_be(53);
+    for (i = 0; i < PICO_CONNTRACK_MAX; i++) {
+        net->src.addr = long_be(0x0b000000 + i);
+        f->conn = NULL;
+        fail_if(!pico_conntrack_get(f));
+    }
+    fail_if(pico_conntrack_count() != PICO_CONNTRACK_MAX);
+
+    /* the TCP session is not tracked, its flags age it */
+    net->proto = PICO_PROTO_TCP;
+    net->src = src_ori;
+    tcp->trans.sport = short_be(5555);
+    tcp->trans.dport = short_be(80);
+    tcp->flags = PICO_TCP_SYN;
+    f->conn = NULL;
+    fail_if(pico_ipv4_nat_outbound(f, &link.address));
+    fail_if(pico_conntrack_state(f) != PICO_CT_UNTRACKED);
+    nat_port = tcp->trans.sport;
+    t = pico_ipv4_nat_find_in(&link.address, nat_port, PICO_PROTO_TCP);
+    fail_if(!t);
+    fail_if(t->expire != pico_tick + PICO_NAT_TIMEWAIT);
+
+    net->src = peer;
+    net->dst = link.address;
+    tcp->trans.sport = short_be(80);
+    tcp->trans.dport = nat_port;
+    tcp->flags = PICO_TCP_SYNACK;
+    f->conn = NULL;
+    fail_if(pico_ipv4_nat_inbound(f, &link.address));
+    fail_if(t->expire != pico_tick + PICO_NAT_TCP_TIMEOUT);
+
+    net->src = src_ori;
+    net->dst = peer;
+    tcp->trans.sport = short_be(5555);
+    tcp->trans.dport = short_be(80);
+    tcp->flags = PICO_TCP_FINACK;
+    f->conn = NULL;
+    fail_if(pico_ipv4_nat_outbound(f, &link.address));
+    fail_if(t->expire != pico_tick + PICO_NAT_TIMEWAIT);
+
+    /* the last ACK does not bring the long timeout back */
+    net->src = peer;
+    net->dst = link.address;
+    tcp->trans.sport = short_be(80);
+    tcp->trans.dport = nat_port;
+    tcp->flags = PICO_TCP_ACK;
+    f->conn = NULL;
+    fail_if(pico_ipv4_nat_inbound(f, &link.address));
+    fail_if(t->expire != pico_tick + PICO_NAT_TIMEWAIT);
+
+    pico_tick += PICO_NAT_TIMEWAIT + 1;
+    fail_if(pico_ipv4_nat_find(nat_port, NULL, 0, PICO_PROTO_TCP));
+
+    pico_conntrack_flush();
+    fail_if(pico_ipv4_nat_disable());
+    pico_frame_discard(f);
+}
+END_TEST
+
+START_TEST (test_nat_links)
+{
+    struct pico_ipv4_link link_a = {
+        .address = {.addr = long_be(0x0a320001)}
+    };                                                                       /* 10.50.0.1 */
+    struct pico_ipv4_link link_b = {
+        .address = {.addr = long_be(0x0a3c0001)}
+    };                                                                       /* 10.60.0.1 */
+    struct pico_frame *f = pico_ipv4_alloc(&pico_proto_ipv4, PICO_UDPHDR_SIZE);
+    struct pico_ipv4_hdr *net = (struct pico_ipv4_hdr *)f->net_hdr;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)f->transport_hdr;
+    struct pico_ip4 src_ori = {
+        .addr = long_be(0x0a280008)
+    };                                                      /* 10.40.0.8 */
+    struct pico_nat_link *nl;
+    uint16_t port_a, port;
+    uint32_t n = 0, idx;
+
+    net->vhl = 0x45;
+    net->len = short_be(32);
+    net->ttl = 64;
+    net->proto = PICO_PROTO_UDP;
+    net->src = src_ori;
+    net->dst.addr = long_be(0x08080808);
+    udp->trans.sport = short_be(5555);
+    udp->trans.dport = short_be(53);
+    udp->len = short_be(12);
+    f->payload = f->transport_hdr + PICO_UDPHDR_SIZE;
+
+    printf(">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> NAT LINKS TEST\n");
+    pico_stack_init();
+    fail_if(pico_ipv4_nat_enable(&link_a));
+    fail_if(pico_ipv4_nat_enable(&link_b));
+    fail_if(pico_ipv4_nat_enable(&link_a));
+    fail_unless(pico_ipv4_nat_is_enabled(&link_a.address));
+    fail_unless(pico_ipv4_nat_is_enabled(&link_b.address));
+
+    fail_if(pico_ipv4_nat_outbound(f, &link_a.address));
+    fail_if(net->src.addr != link_a.address.addr);
+    port_a = udp->trans.sport;
+
+    /* endpoint-independent mapping: same external port for another destination */
+    net->src = src_ori;
+    net->dst.addr = long_be(0x08080404);
+    udp->trans.sport = short_be(5555);
+    udp->trans.dport = short_be(123);
+    fail_if(pico_ipv4_nat_outbound(f, &link_a.address));
+    fail_if(udp->trans.sport != port_a, "mapping depends on the destination");
+
+    /* the same source gets its own mapping on the second link */
+    net->src = src_ori;
+    udp->trans.sport = short_be(5555);
+    fail_if(pico_ipv4_nat_outbound(f, &link_b.address));
+    fail_if(net->src.addr != link_b.address.addr);
+    fail_if(nat_table.count != 2);
+
+    /* disabling a link flushes its sessions and leaves the other one alone */
+    fail_if(pico_ipv4_nat_disable_link(&link_a));
+    fail_if(pico_ipv4_nat_is_enabled(&link_a.address));
+    fail_unless(pico_ipv4_nat_is_enabled(&link_b.address));
+    fail_unless(pico_ipv4_nat_disable_link(&link_a));
+    fail_if(nat_table.count != 1);
+
+    fail_if(pico_ipv4_nat_enable(&link_a));
+    net->src = src_ori;
+    udp->trans.sport = short_be(5555);
+    fail_if(pico_ipv4_nat_outbound(f, &link_a.address));
+    port_a = udp->trans.sport;
+
+    /* allocation only fails once every port of the address is taken */
+    nl = pico_ipv4_nat_link_find(&link_a.address);
+    while (pico_ipv4_nat_port_alloc(nl, PICO_PROTO_UDP, &port) == 0)
+        n++;
+    fail_if(n != PICO_NAT_PORT_COUNT - 1);
+    fail_if(pico_err != PICO_ERR_EAGAIN);
+    fail_if(nl->ports[1].used != PICO_NAT_PORT_COUNT);
+    pico_ipv4_nat_port_release(nl, PICO_PROTO_UDP, short_be(4000));
+    fail_if(pico_ipv4_nat_port_alloc(nl, PICO_PROTO_UDP, &port));
+    fail_if(port != short_be(4000));
+
+    /* a full map only reclaims the expired sessions of the ports next to
+     * the cursor, the sweep timer gets the others */
+    pico_tick += PICO_NAT_TIMEWAIT + 1;
+    idx = (uint32_t)short_be(port_a) - PICO_NAT_PORT_MIN;
+    n = nat_table.count;
+    nl->ports[1].next = (idx + (PICO_NAT_PORT_COUNT / 2u)) % PICO_NAT_PORT_COUNT;
+    fail_unless(pico_ipv4_nat_port_alloc(nl, PICO_PROTO_UDP, &port));
+    fail_if(pico_err != PICO_ERR_EAGAIN);
+    fail_if(nat_table.count != n);
+    nl->ports[1].next = (idx + PICO_NAT_PORT_COUNT - 1u) % PICO_NAT_PORT_COUNT;
+    fail_if(pico_ipv4_nat_port_alloc(nl, PICO_PROTO_UDP, &port));
+    fail_if(port != port_a);
+    fail_if(nat_table.count != n - 1u);
+
+    fail_if(pico_ipv4_nat_disable());
+    fail_if(pico_ipv4_nat_is_enabled(&link_a.address));
+    fail_if(pico_ipv4_nat_is_enabled(&link_b.address));
+    pico_frame_discard(f);
+}
+END_TEST
+
 START_TEST (test_ipfilter)
 {
     struct pico_device *dev = NULL;
@@ -412,6 +412,374 @@ START_TEST (test_socket)
 }
 END_TEST
 
+START_TEST (test_socket_mmsg)
+{
+    struct mock_device *mock;
+    struct pico_socket *sk_udp, *sk_tcp;
+    struct pico_ip4 local, remote, other, netmask;
+    struct pico_mmsg msgs[6];
+    char payload[6][8], rbuf[6][16], fbuf[1500];
+    uint16_t port_be = short_be(6000);
+    int i, ret, frames = 0, to_remote = 0;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.50.0.1", &local.addr);
+    pico_string_to_ipv4("10.50.0.2", &remote.addr);
+    pico_string_to_ipv4("10.50.0.3", &other.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock, "mmsg> mock device");
+    fail_if(pico_ipv4_link_add(mock->dev, local, netmask) < 0, "mmsg> link add");
+
+    sk_udp = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    fail_if(!sk_udp, "mmsg> udp socket open");
+    fail_if(pico_socket_bind(sk_udp, &local, &port_be) < 0, "mmsg> udp socket bind");
+    sk_tcp = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    fail_if(!sk_tcp, "mmsg> tcp socket open");
+
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < 6; i++) {
+        snprintf(payload[i], sizeof(payload[i]), "msg%d", i);
+        msgs[i].buf = payload[i];
+        msgs[i].len = (int)strlen(payload[i]) + 1;
+        msgs[i].port = short_be(7000);
+        msgs[i].addr.ip4 = (i < 3) ? remote : other;
+    }
+
+    /* wrong parameters */
+    fail_if(pico_socket_sendmmsg(NULL, msgs, 6) != -1, "mmsg> sendmmsg NULL socket");
+    fail_if(pico_socket_sendmmsg(sk_udp, NULL, 6) != -1, "mmsg> sendmmsg NULL messages");
+    fail_if(pico_socket_sendmmsg(sk_tcp, msgs, 6) != -1, "mmsg> sendmmsg on TCP");
+    fail_if(pico_err != PICO_ERR_EPROTONOSUPPORT, "mmsg> sendmmsg on TCP error");
+    fail_if(pico_socket_recvmmsg(sk_tcp, msgs, 6) != -1, "mmsg> recvmmsg on TCP");
+    fail_if(pico_socket_sendmmsg(sk_udp, msgs, 0) != 0, "mmsg> empty batch");
+
+    /* two runs of destinations, all sent */
+    ret = pico_socket_sendmmsg(sk_udp, msgs, 5);
+    fail_if(ret != 5, "mmsg> sendmmsg sent %d", ret);
+    for (i = 0; i < 5; i++)
+        fail_if(msgs[i].ret != msgs[i].len, "mmsg> message %d not sent", i);
+
+    /* the batch stops at the first invalid message */
+    msgs[4].port = 0;
+    ret = pico_socket_sendmmsg(sk_udp, msgs + 3, 3);
+    fail_if(ret != 1, "mmsg> sendmmsg partial batch %d", ret);
+    fail_if(pico_socket_sendmmsg(sk_udp, msgs + 4, 2) != -1, "mmsg> sendmmsg invalid first message");
+    msgs[4].port = short_be(7000);
+
+    for (i = 0; i < 10; i++)
+        pico_stack_tick();
+    while ((ret = pico_mock_network_read(mock, fbuf, (int)sizeof(fbuf))) > 0) {
+        frames++;
+        if (((struct pico_ipv4_hdr *)fbuf)->dst.addr == remote.addr)
+            to_remote++;
+    }
+    fail_if(frames != 6, "mmsg> %d frames out", frames);
+    fail_if(to_remote != 3, "mmsg> %d frames to the first destination", to_remote);
+
+    /* receive: as many datagrams as queued, each with its origin */
+    fail_if(pico_socket_recvmmsg(sk_udp, msgs, 6) != 0, "mmsg> nothing to receive");
+    for (i = 0; i < 3; i++) {
+        msgs[i].addr.ip4 = local;
+        msgs[i].port = port_be;
+    }
+    fail_if(pico_socket_sendmmsg(sk_udp, msgs, 3) != 3, "mmsg> sendmmsg to self");
+    for (i = 0; i < 10; i++)
+        pico_stack_tick();
+    memset(msgs, 0, sizeof(msgs));
+    for (i = 0; i < 6; i++) {
+        msgs[i].buf = rbuf[i];
+        msgs[i].len = (int)sizeof(rbuf[i]);
+    }
+    ret = pico_socket_recvmmsg(sk_udp, msgs, 6);
+    fail_if(ret != 3, "mmsg> recvmmsg got %d", ret);
+    for (i = 0; i < 3; i++) {
+        fail_if(msgs[i].ret != 5, "mmsg> message %d length %d", i, msgs[i].ret);
+        fail_if(strcmp(rbuf[i], payload[i]) != 0, "mmsg> message %d payload", i);
+        fail_if(msgs[i].addr.ip4.addr != local.addr || msgs[i].port != port_be, "mmsg> message %d origin", i);
+    }
+
+    pico_socket_close(sk_udp);
+    pico_socket_close(sk_tcp);
+}
+END_TEST
+
+START_TEST (test_socket_segmented)
+{
+    struct mock_device *mock;
+    struct pico_socket *sk_udp;
+    struct pico_ip4 local, remote, netmask;
+    struct pico_ip6 ll, netmask6, mcast, any6 = {{0}};
+    struct pico_ipv6_link *link6;
+    struct pico_msginfo msginfo;
+    struct pico_ipv4_hdr *hdr;
+    struct pico_ipv6_hdr *hdr6;
+    struct pico_udp_hdr *udp;
+    static uint8_t data[10500];
+    uint8_t fbuf[1500];
+    uint16_t port_be = short_be(6001);
+    int i, ret, frames = 0, bytes = 0;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.60.0.1", &local.addr);
+    pico_string_to_ipv4("10.60.0.2", &remote.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock, "segmented> mock device");
+    fail_if(pico_ipv4_link_add(mock->dev, local, netmask) < 0, "segmented> link add");
+    sk_udp = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    fail_if(!sk_udp, "segmented> udp socket open");
+    fail_if(pico_socket_bind(sk_udp, &local, &port_be) < 0, "segmented> udp socket bind");
+    for (i = 0; i < (int)sizeof(data); i++)
+        data[i] = (uint8_t)i;
+
+    /* segments must fit in a frame */
+    fail_if(pico_socket_sendto_segmented(sk_udp, data, (int)sizeof(data), 0, &remote, short_be(7000), NULL) != -1, "segmented> zero segment size");
+    fail_if(pico_socket_sendto_segmented(sk_udp, data, (int)sizeof(data), 4000, &remote, short_be(7000), NULL) != -1, "segmented> segment larger than a frame");
+    fail_if(pico_err != PICO_ERR_EINVAL, "segmented> segment size error");
+
+    ret = pico_socket_sendto_segmented(sk_udp, data, (int)sizeof(data), 1000, &remote, short_be(7000), NULL);
+    fail_if(ret != (int)sizeof(data), "segmented> sent %d", ret);
+    for (i = 0; i < 20; i++)
+        pico_stack_tick();
+
+    while (pico_mock_network_read(mock, fbuf, (int)sizeof(fbuf)) > 0) {
+        hdr = (struct pico_ipv4_hdr *)fbuf;
+        udp = (struct pico_udp_hdr *)(fbuf + PICO_SIZE_IP4HDR);
+        fail_if(hdr->dst.addr != remote.addr, "segmented> destination");
+        fail_if(udp->trans.dport != short_be(7000), "segmented> port");
+        fail_if(short_be(udp->len) != ((frames < 10) ? 1008 : 508), "segmented> datagram %d length", frames);
+        fail_if(memcmp(fbuf + PICO_SIZE_IP4HDR + 8, data + bytes, (size_t)(short_be(udp->len) - 8)) != 0, "segmented> datagram %d payload", frames);
+        bytes += short_be(udp->len) - 8;
+        frames++;
+    }
+    fail_if(frames != 11, "segmented> %d datagrams", frames);
+    fail_if(bytes != (int)sizeof(data), "segmented> %d bytes", bytes);
+    pico_socket_close(sk_udp);
+
+    /* IPv6 multicast on the device of msginfo: from its link-local address */
+    pico_string_to_ipv6("fe80::1", ll.addr);
+    pico_string_to_ipv6("ffff:ffff:ffff:ffff::", netmask6.addr);
+    link6 = pico_ipv6_link_add(mock->dev, ll, netmask6);
+    fail_if(!link6, "segmented> link-local add");
+    /* no multicast route: only msginfo tells the device */
+    pico_string_to_ipv6("ff00::", mcast.addr);
+    pico_ipv6_route_del(mcast, mcast, any6, 1, link6);
+    pico_string_to_ipv6("ff02::1", mcast.addr);
+    sk_udp = pico_socket_open(PICO_PROTO_IPV6, PICO_PROTO_UDP, NULL);
+    fail_if(!sk_udp, "segmented> udp6 socket open");
+    msginfo.dev = mock->dev;
+    msginfo.ttl = 1;
+    msginfo.tos = 0;
+    ret = pico_socket_sendto_segmented(sk_udp, data, 2000, 500, &mcast, short_be(7000), &msginfo);
+    fail_if(ret != 2000, "segmented> sent %d on ipv6 multicast", ret);
+    for (i = 0; i < 20; i++)
+        pico_stack_tick();
+
+    frames = 0;
+    while (pico_mock_network_read(mock, fbuf, (int)sizeof(fbuf)) > 0) {
+        hdr6 = (struct pico_ipv6_hdr *)fbuf;
+        if (hdr6->nxthdr != PICO_PROTO_UDP)
+            continue; /* neighbor discovery */
+
+        fail_if(memcmp(hdr6->src.addr, ll.addr, PICO_SIZE_IP6) != 0, "segmented> ipv6 source");
+        fail_if(short_be(hdr6->len) != 508, "segmented> ipv6 datagram %d length", frames);
+        frames++;
+    }
+    fail_if(frames != 4, "segmented> %d ipv6 datagrams", frames);
+    pico_socket_close(sk_udp);
+}
+END_TEST
+
+#define REUSEPORT_SOCKS 4
+#define REUSEPORT_FLOWS 64
+
+/* UDP datagram from 10.70.0.2:sport to 10.70.0.1:6100 */
+static void reuseport_inject(struct mock_device *mock, uint16_t sport)
+{
+    uint8_t buf[PICO_SIZE_IP4HDR + 8 + 4];
+    struct pico_ipv4_hdr *hdr = (struct pico_ipv4_hdr *)buf;
+    struct pico_udp_hdr *udp = (struct pico_udp_hdr *)(buf + PICO_SIZE_IP4HDR);
+
+    memset(buf, 0, sizeof(buf));
+    hdr->vhl = 0x45;
+    hdr->len = short_be(sizeof(buf));
+    hdr->ttl = 64;
+    hdr->proto = PICO_PROTO_UDP;
+    pico_string_to_ipv4("10.70.0.2", &hdr->src.addr);
+    pico_string_to_ipv4("10.70.0.1", &hdr->dst.addr);
+    hdr->crc = short_be(pico_checksum(hdr, PICO_SIZE_IP4HDR));
+    udp->trans.sport = short_be(sport);
+    udp->trans.dport = short_be(6100);
+    udp->len = short_be(8 + 4);
+    pico_mock_network_write(mock, buf, (int)sizeof(buf));
+}
+
+START_TEST (test_socket_reuseport)
+{
+    struct mock_device *mock;
+    struct pico_socket *sk[REUSEPORT_SOCKS], *other, *l1, *l2;
+    struct pico_ip4 local, any, netmask;
+    struct pico_sockport *sp;
+    struct pico_frame *f;
+    struct pico_tcp_hdr *tcp;
+    uint16_t port_be = short_be(6100), tport_be = short_be(6200);
+    int i, on = 1, off = 0, val = 0, total = 0, to_l1 = 0;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.70.0.1", &local.addr);
+    any.addr = 0;
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock, "reuseport> mock device");
+    fail_if(pico_ipv4_link_add(mock->dev, local, netmask) < 0, "reuseport> link add");
+
+    /* a group of sockets on one address and port */
+    for (i = 0; i < REUSEPORT_SOCKS; i++) {
+        sk[i] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+        fail_if(!sk[i], "reuseport> socket open");
+        fail_if(pico_socket_setoption(sk[i], PICO_SOCKET_OPT_REUSEPORT, &on) < 0, "reuseport> setoption");
+        fail_if(pico_socket_getoption(sk[i], PICO_SOCKET_OPT_REUSEPORT, &val) < 0 || val != 1, "reuseport> getoption");
+        port_be = short_be(6100);
+        fail_if(pico_socket_bind(sk[i], &local, &port_be) < 0, "reuseport> bind %d", i);
+    }
+    fail_if(pico_socket_setoption(sk[0], PICO_SOCKET_OPT_REUSEPORT, &off) == 0, "reuseport> option changed once bound");
+
+    /* without the option, or on an overlapping address, the port is in use */
+    other = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    fail_if(pico_socket_bind(other, &local, &port_be) == 0, "reuseport> bound without the option");
+    fail_if(pico_err != PICO_ERR_EADDRINUSE, "reuseport> bind error");
+    pico_socket_setoption(other, PICO_SOCKET_OPT_REUSEPORT, &on);
+    fail_if(pico_socket_bind(other, &any, &port_be) == 0, "reuseport> bound to the wildcard address");
+    pico_socket_close(other);
+
+    /* datagrams are spread on the group */
+    for (i = 0; i < REUSEPORT_FLOWS; i++) {
+        reuseport_inject(mock, (uint16_t)(20000 + i));
+        pico_stack_tick();
+    }
+    for (i = 0; i < 5; i++)
+        pico_stack_tick();
+    for (i = 0; i < REUSEPORT_SOCKS; i++) {
+        fail_if(sk[i]->q_in.frames == 0, "reuseport> socket %d got no datagram", i);
+        total += (int)sk[i]->q_in.frames;
+    }
+    fail_if(total != REUSEPORT_FLOWS, "reuseport> %d datagrams delivered", total);
+
+    /* new TCP connections are spread on the listeners, a flow always on the same one */
+    l1 = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    l2 = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    pico_socket_setoption(l1, PICO_SOCKET_OPT_REUSEPORT, &on);
+    pico_socket_setoption(l2, PICO_SOCKET_OPT_REUSEPORT, &on);
+    fail_if(pico_socket_bind(l1, &local, &tport_be) < 0, "reuseport> tcp bind");
+    tport_be = short_be(6200);
+    fail_if(pico_socket_bind(l2, &local, &tport_be) < 0, "reuseport> tcp bind");
+    fail_if(pico_socket_listen(l1, 4) < 0 || pico_socket_listen(l2, 4) < 0, "reuseport> listen");
+    sp = pico_get_sockport(PICO_PROTO_TCP, tport_be);
+    fail_if(!sp, "reuseport> tcp sockport");
+    f = pico_frame_alloc(PICO_SIZE_IP4HDR + PICO_SIZE_TCPHDR);
+    f->net_hdr = f->buffer;
+    f->transport_hdr = f->buffer + PICO_SIZE_IP4HDR;
+    ((struct pico_ipv4_hdr *)f->net_hdr)->vhl = 0x45;
+    ((struct pico_ipv4_hdr *)f->net_hdr)->src.addr = long_be(0x0a460002);
+    tcp = (struct pico_tcp_hdr *)f->transport_hdr;
+    tcp->trans.dport = tport_be;
+    for (i = 0; i < REUSEPORT_FLOWS; i++) {
+        tcp->trans.sport = short_be((uint16_t)(30000 + i));
+        other = pico_socket_reuseport_select(sp, l1, f);
+        fail_if(other != l1 && other != l2, "reuseport> not a listener");
+        fail_if(pico_socket_reuseport_select(sp, l2, f) != other, "reuseport> flow moved");
+        to_l1 += (other == l1);
+    }
+    fail_if(to_l1 == 0 || to_l1 == REUSEPORT_FLOWS, "reuseport> %d of %d connections on one listener", to_l1, REUSEPORT_FLOWS);
+    pico_frame_discard(f);
+
+    for (i = 0; i < REUSEPORT_SOCKS; i++)
+        pico_socket_close(sk[i]);
+    pico_socket_close(l1);
+    pico_socket_close(l2);
+}
+END_TEST
+
+#define EPHEMERAL_SOCKS 200
+
+START_TEST (test_socket_ephemeral_ports)
+{
+    struct mock_device *mock;
+    struct pico_socket *sk[EPHEMERAL_SOCKS], *c1, *c2;
+    struct pico_socket_ports *p;
+    struct pico_ip4 local, remote, netmask;
+    uint16_t port, used;
+    int i, j;
+
+    pico_stack_init();
+    pico_string_to_ipv4("10.80.0.1", &local.addr);
+    pico_string_to_ipv4("10.80.0.2", &remote.addr);
+    netmask.addr = long_be(0xFFFFFF00);
+    mock = pico_mock_create(NULL);
+    fail_if(!mock, "ephemeral> mock device");
+    fail_if(pico_ipv4_link_add(mock->dev, local, netmask) < 0, "ephemeral> link add");
+
+    /* every socket gets its own port, the bitmap follows the sockports */
+    p = pico_socket_ports_init(PICO_PROTO_UDP);
+    fail_if(!p, "ephemeral> bitmap");
+    used = (uint16_t)p->used;
+    for (i = 0; i < EPHEMERAL_SOCKS; i++) {
+        sk[i] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+        port = 0;
+        fail_if(pico_socket_bind(sk[i], &local, &port) < 0, "ephemeral> bind %d", i);
+        fail_if(short_be(port) < PICO_SOCKET_PORT_MIN, "ephemeral> port %u", short_be(port));
+        for (j = 0; j < i; j++)
+            fail_if(sk[j]->local_port == port, "ephemeral> port given twice");
+    }
+    fail_if(p->used != (uint32_t)(used + EPHEMERAL_SOCKS), "ephemeral> %u ports in use", p->used);
+    for (i = 0; i < EPHEMERAL_SOCKS; i++)
+        pico_socket_close(sk[i]);
+    fail_if(p->used != used, "ephemeral> ports not released");
+
+    /* all ports taken: the allocator gives up */
+    memset(p->map, 0xFF, PICO_SOCKET_PORT_WORDS * sizeof(uint32_t));
+    p->used = PICO_SOCKET_PORT_COUNT;
+    fail_if(pico_socket_high_port(PICO_PROTO_UDP) != 0, "ephemeral> port from a full bitmap");
+    sk[0] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    port = 0;
+    fail_if(pico_socket_bind(sk[0], &local, &port) == 0, "ephemeral> bound with no port left");
+    pico_socket_close(sk[0]);
+
+    /* UDP delivery ignores the remote endpoint: no shared port for a connect */
+    sk[0] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    sk[1] = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_UDP, NULL);
+    sk[1]->local_port = short_be(PICO_SOCKET_PORT_MIN);
+    fail_if(pico_socket_connect(sk[1], &remote, short_be(53)) < 0, "ephemeral> udp connect");
+    fail_if(pico_socket_connect(sk[0], &remote, short_be(54)) == 0, "ephemeral> udp connect on a shared port");
+    fail_if(pico_err != PICO_ERR_EADDRINUSE, "ephemeral> udp connect error %d", pico_err);
+    pico_socket_close(sk[0]);
+    pico_socket_close(sk[1]);
+    PICO_FREE(p->map);
+    p->map = NULL;
+
+    /* and TCP connections share the local port of connections to other endpoints */
+    c1 = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    fail_if(pico_socket_connect(c1, &remote, short_be(80)) < 0, "ephemeral> connect");
+    p = pico_socket_ports_init(PICO_PROTO_TCP);
+    fail_if(!p, "ephemeral> tcp bitmap");
+    memset(p->map, 0xFF, PICO_SOCKET_PORT_WORDS * sizeof(uint32_t));
+    p->used = PICO_SOCKET_PORT_COUNT;
+    c2 = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    fail_if(pico_socket_connect(c2, &remote, short_be(80)) == 0, "ephemeral> same endpoint on a shared port");
+    pico_socket_close(c2);
+    c2 = pico_socket_open(PICO_PROTO_IPV4, PICO_PROTO_TCP, NULL);
+    fail_if(pico_socket_connect(c2, &remote, short_be(81)) < 0, "ephemeral> connect on a shared port");
+    fail_if(c2->local_port != c1->local_port, "ephemeral> local port not shared");
+    fail_if(pico_check_socket(c1) != 0 || pico_check_socket(c2) != 0, "ephemeral> connections not both on the port");
+    PICO_FREE(p->map);
+    p->map = NULL;
+
+    pico_socket_close(c1);
+    pico_socket_close(c2);
+}
+END_TEST
+
 #ifdef PICO_SUPPORT_CRC_FAULTY_UNIT_TEST
 START_TEST (test_crc_check)
 {
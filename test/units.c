@@ -25,6 +25,7 @@
 #include "pico_tcp.c"
 #include "pico_arp.c"
 #include "pico_icmp4.c"
+#include "pico_icmp_ratelimit.c"
 #include "pico_dns_client.c"
 #include "pico_dns_common.c"
 #include "pico_dhcp_common.c"
@@ -32,6 +33,11 @@
 #include "pico_dhcp_client.c"
 #include "pico_nat.c"
 #include "pico_ipfilter.c"
+#include "pico_conntrack.c"
+#include "pico_dev_bridge.c"
+#include "pico_dev_bond.c"
+#include "pico_evq.c"
+#include "pico_mt.c"
 #include "pico_tree.c"
 #include "pico_slaacv4.c"
 #include "pico_hotplug_detection.c"
@@ -159,11 +165,18 @@ Suite *pico_suite(void)
     suite_add_tcase(s, rb2);
 
     tcase_add_test(socket, test_socket);
+    tcase_add_test(socket, test_socket_mmsg);
+    tcase_add_test(socket, test_socket_segmented);
+    tcase_add_test(socket, test_socket_reuseport);
+    tcase_add_test(socket, test_socket_ephemeral_ports);
     suite_add_tcase(s, socket);
 
     tcase_add_test(nat, test_nat_enable_disable);
     tcase_add_test(nat, test_nat_translation);
     tcase_add_test(nat, test_nat_port_forwarding);
+    tcase_add_test(nat, test_nat_expiry);
+    tcase_add_test(nat, test_nat_untracked);
+    tcase_add_test(nat, test_nat_links);
     tcase_set_timeout(nat, 30);
     suite_add_tcase(s, nat);
 
@@ -202,7 +215,7 @@ Suite *pico_suite(void)
 #endif
 
     tcase_add_test(arp, arp_update_max_arp_reqs_test);
-    tcase_add_test(arp, arp_compare_test);
+    tcase_add_test(arp, arp_table_test);
     tcase_add_test(arp, arp_lookup_test);
     tcase_add_test(arp, arp_expire_test);
     tcase_add_test(arp, arp_receive_test);
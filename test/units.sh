@@ -16,9 +16,16 @@ ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_ipv6_nd.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_mdns.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_dns_sd.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_ipfilter.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_conntrack.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_icmp_ratelimit.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_queue.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_evq.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_mt.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_shard.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_tftp.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_aodv.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_dev_bridge.elf || exit 1
+ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_dev_bond.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_dev_ppp.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_mld.elf || exit 1
 ASAN_OPTIONS="detect_leaks=0" ./build/test/modunit_igmp.elf || exit 1